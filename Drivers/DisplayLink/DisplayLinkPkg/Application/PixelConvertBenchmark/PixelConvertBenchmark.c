@@ -0,0 +1,233 @@
+/**
+ * @file PixelConvertBenchmark.c
+ * @brief Compare the DisplayLink driver's pixel conversion with the original byte-at-a-time loop.
+ * Both converters are run over full HD frames, their output is checked to be identical, and the
+ * time taken by each is printed in ms per frame and MB/s.
+ *
+ * Copyright (c) 2018-2019, DisplayLink (UK) Ltd. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-Patent
+ *
+**/
+
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+#include "../../DisplayLinkGop/PixelConvert.h"
+
+#define BENCHMARK_WIDTH       1920
+#define BENCHMARK_HEIGHT      1080
+#define BENCHMARK_FRAMES      100
+#define BENCHMARK_TICK_PERIOD 1000   // 1ms in 100ns units
+
+typedef VOID (*PIXEL_CONVERTER) (
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src,
+    IN UINTN Count
+    );
+
+STATIC volatile UINTN mElapsedMs;
+
+/**
+ * Periodic timer callback used as the benchmark clock.
+ * @param Event
+ * @param Context
+ */
+STATIC VOID
+EFIAPI
+BenchmarkTick (
+    IN EFI_EVENT Event,
+    IN VOID* Context
+    )
+{
+  mElapsedMs++;
+}
+
+/**
+ * The conversion used by the driver before it worked four pixels at a time.
+ * @param Dst
+ * @param Src
+ * @param Count   Number of pixels
+ */
+STATIC VOID
+ConvertBltPixelsToRgb24Bytewise (
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src,
+    IN UINTN Count
+    )
+{
+  for (; Count > 0; Count--) {
+    // Need to swap round the RGB values
+    Dst[0] = ((CONST UINT8 *)Src)[2];
+    Dst[1] = ((CONST UINT8 *)Src)[1];
+    Dst[2] = ((CONST UINT8 *)Src)[0];
+    Src++;
+    Dst += 3;
+  }
+}
+
+/**
+ * Convert a frame line by line, as ConvertDamageRect does for a full screen damage rectangle.
+ * @param Converter
+ * @param Dst
+ * @param Src
+ */
+STATIC VOID
+ConvertFrame (
+    IN PIXEL_CONVERTER Converter,
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src
+    )
+{
+  UINTN H;
+
+  for (H = 0; H < BENCHMARK_HEIGHT; H++) {
+    Converter (Dst, Src, BENCHMARK_WIDTH);
+    Dst += BENCHMARK_WIDTH * 3;
+    Src += BENCHMARK_WIDTH;
+  }
+}
+
+/**
+ * Time a converter over BENCHMARK_FRAMES full frames and print the result.
+ * @param Name
+ * @param Converter
+ * @param Dst
+ * @param Src
+ * @return Elapsed time in ms
+ */
+STATIC UINTN
+TimeConverter (
+    IN CONST CHAR16* Name,
+    IN PIXEL_CONVERTER Converter,
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src
+    )
+{
+  UINTN Frame;
+  UINTN Start;
+  UINTN Elapsed;
+
+  Start = mElapsedMs;
+  for (Frame = 0; Frame < BENCHMARK_FRAMES; Frame++) {
+    ConvertFrame (Converter, Dst, Src);
+  }
+  Elapsed = mElapsedMs - Start;
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  // Bytes per ms / 1000 is MB/s; count the 32bpp input side
+  Print (L"%-10s %d frames in %d ms, %d us/frame, %d MB/s\n",
+    Name,
+    BENCHMARK_FRAMES,
+    (UINT32)Elapsed,
+    (UINT32)((Elapsed * 1000) / BENCHMARK_FRAMES),
+    (UINT32)((BENCHMARK_FRAMES * BENCHMARK_WIDTH * BENCHMARK_HEIGHT * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)) / (Elapsed * 1000)));
+
+  return Elapsed;
+}
+
+/**
+ * Entry point of the benchmark application.
+ * @param ImageHandle
+ * @param SystemTable
+ * @return EFI_SUCCESS if the converters agree, EFI_ABORTED if they do not
+ */
+EFI_STATUS
+EFIAPI
+PixelConvertBenchmarkMain (
+    IN EFI_HANDLE ImageHandle,
+    IN EFI_SYSTEM_TABLE* SystemTable
+    )
+{
+  EFI_STATUS Status;
+  EFI_EVENT TimerEvent;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Frame;
+  UINT8* Expected;
+  UINT8* Actual;
+  UINTN FrameBytes24;
+  UINTN Index;
+  UINTN Start;
+  UINTN Count;
+  UINTN OldMs;
+  UINTN NewMs;
+
+  FrameBytes24 = BENCHMARK_WIDTH * BENCHMARK_HEIGHT * 3;
+  Frame = AllocatePool (BENCHMARK_WIDTH * BENCHMARK_HEIGHT * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  // One spare byte after each 24bpp frame, so that an overrun shows up as a mismatch
+  Expected = AllocateZeroPool (FrameBytes24 + 1);
+  Actual = AllocateZeroPool (FrameBytes24 + 1);
+  if (Frame == NULL || Expected == NULL || Actual == NULL) {
+    Print (L"Failed to allocate the frame buffers\n");
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  // Fill the frame with a pattern in which every byte of a pixel differs, including the reserved byte
+  for (Index = 0; Index < BENCHMARK_WIDTH * BENCHMARK_HEIGHT; Index++) {
+    Frame[Index].Blue = (UINT8)Index;
+    Frame[Index].Green = (UINT8)(Index >> 8);
+    Frame[Index].Red = (UINT8)(Index >> 16);
+    Frame[Index].Reserved = 0xA5;
+  }
+
+  // Check the converters against each other on whole frames, and on short runs at every
+  // alignment so that the per-pixel tail of the word-at-a-time loop is covered too.
+  ConvertFrame (ConvertBltPixelsToRgb24Bytewise, Expected, Frame);
+  ConvertFrame (DlConvertBltPixelsToRgb24, Actual, Frame);
+  if (CompareMem (Expected, Actual, FrameBytes24 + 1) != 0) {
+    Print (L"FAIL: converters differ on a full frame\n");
+    Status = EFI_ABORTED;
+    goto Done;
+  }
+
+  for (Start = 0; Start < 4; Start++) {
+    for (Count = 0; Count < 16; Count++) {
+      SetMem (Expected, 16 * 3 + 1, 0x5A);
+      SetMem (Actual, 16 * 3 + 1, 0x5A);
+      ConvertBltPixelsToRgb24Bytewise (Expected + Start, Frame + Start, Count);
+      DlConvertBltPixelsToRgb24 (Actual + Start, Frame + Start, Count);
+      if (CompareMem (Expected, Actual, 16 * 3 + 1) != 0) {
+        Print (L"FAIL: converters differ at offset %d, %d pixels\n", (UINT32)Start, (UINT32)Count);
+        Status = EFI_ABORTED;
+        goto Done;
+      }
+    }
+  }
+  Print (L"Converters agree\n");
+
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_NOTIFY, BenchmarkTick, NULL, &TimerEvent);
+  if (EFI_ERROR (Status)) {
+    Print (L"Failed to create the timer: %r\n", Status);
+    goto Done;
+  }
+
+  Status = gBS->SetTimer (TimerEvent, TimerPeriodic, BENCHMARK_TICK_PERIOD);
+  if (!EFI_ERROR (Status)) {
+    Print (L"Converting %d frames of %d x %d\n", BENCHMARK_FRAMES, BENCHMARK_WIDTH, BENCHMARK_HEIGHT);
+    OldMs = TimeConverter (L"Bytewise", ConvertBltPixelsToRgb24Bytewise, Actual, Frame);
+    NewMs = TimeConverter (L"Wordwise", DlConvertBltPixelsToRgb24, Actual, Frame);
+    Print (L"Speedup x%d.%02d\n", (UINT32)(OldMs / NewMs), (UINT32)(((OldMs % NewMs) * 100) / NewMs));
+    gBS->SetTimer (TimerEvent, TimerCancel, 0);
+  } else {
+    Print (L"Failed to start the timer: %r\n", Status);
+  }
+  gBS->CloseEvent (TimerEvent);
+
+Done:
+  if (Frame != NULL) {
+    FreePool (Frame);
+  }
+  if (Expected != NULL) {
+    FreePool (Expected);
+  }
+  if (Actual != NULL) {
+    FreePool (Actual);
+  }
+  return Status;
+}
@@ -10,6 +10,7 @@
 
 #include "UsbDisplayLink.h"
 #include "Edid.h"
+#include "PixelConvert.h"
 
 
 /**
@@ -69,6 +70,128 @@ CheckBounds (
   return EFI_SUCCESS;
 }
 
+/**
+ * Check whether two damage rectangles overlap or share an edge, in which case
+ * sending them as one rectangle costs no more than sending them separately.
+ * @param A
+ * @param B
+ * @return TRUE if the rectangles should be merged
+ */
+STATIC BOOLEAN
+DamageRectsTouch (
+    IN CONST DISPLAYLINK_DAMAGE_RECT* A,
+    IN CONST DISPLAYLINK_DAMAGE_RECT* B
+    )
+{
+  return (A->X1 <= B->X2) && (B->X1 <= A->X2) && (A->Y1 <= B->Y2) && (B->Y1 <= A->Y2);
+}
+
+/**
+ * Grow a damage rectangle so that it also covers another one.
+ * @param Dst
+ * @param Src
+ */
+STATIC VOID
+DamageRectUnion (
+    IN OUT DISPLAYLINK_DAMAGE_RECT* Dst,
+    IN CONST DISPLAYLINK_DAMAGE_RECT* Src
+    )
+{
+  Dst->X1 = MIN (Dst->X1, Src->X1);
+  Dst->Y1 = MIN (Dst->Y1, Src->Y1);
+  Dst->X2 = MAX (Dst->X2, Src->X2);
+  Dst->Y2 = MAX (Dst->Y2, Src->Y2);
+}
+
+/**
+ * Area of a damage rectangle, in pixels.
+ * @param Rect
+ * @return
+ */
+STATIC UINTN
+DamageRectArea (
+    IN CONST DISPLAYLINK_DAMAGE_RECT* Rect
+    )
+{
+  return (Rect->X2 - Rect->X1) * (Rect->Y2 - Rect->Y1);
+}
+
+/**
+ * Record that an area of the back buffer has changed and must be processed in the next screen update.
+ * The area is clipped to the current mode, and merged with any overlapping or adjacent regions already recorded.
+ * If the set of regions is full, the new area is merged into the region that grows the least as a result.
+ * @param UsbDisplayLinkDev
+ * @param X
+ * @param Y
+ * @param Width
+ * @param Height
+ */
+VOID
+DlGopAddDamage (
+    IN USB_DISPLAYLINK_DEV* UsbDisplayLinkDev,
+    IN UINTN X,
+    IN UINTN Y,
+    IN UINTN Width,
+    IN UINTN Height
+    )
+{
+  DISPLAYLINK_DAMAGE_RECT New;
+  DISPLAYLINK_DAMAGE_RECT Merged;
+  UINTN Index;
+  UINTN BestIndex;
+  UINTN BestGrowth;
+  UINTN Growth;
+  CONST EFI_GRAPHICS_OUTPUT_MODE_INFORMATION* ScreenMode;
+
+  ScreenMode = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info;
+
+  if ((X >= ScreenMode->HorizontalResolution) || (Y >= ScreenMode->VerticalResolution)) {
+    return;
+  }
+
+  New.X1 = X;
+  New.Y1 = Y;
+  New.X2 = X + MIN (Width, ScreenMode->HorizontalResolution - X);
+  New.Y2 = Y + MIN (Height, ScreenMode->VerticalResolution - Y);
+
+  if ((New.X2 == New.X1) || (New.Y2 == New.Y1)) {
+    return;
+  }
+
+  // Absorb every recorded region that touches the new one. Each merge can make the new
+  // region touch ones already checked, so start again from the beginning after each merge.
+  Index = 0;
+  while (Index < UsbDisplayLinkDev->DamageRectCount) {
+    if (DamageRectsTouch (&UsbDisplayLinkDev->DamageRects[Index], &New)) {
+      DamageRectUnion (&New, &UsbDisplayLinkDev->DamageRects[Index]);
+      UsbDisplayLinkDev->DamageRectCount--;
+      UsbDisplayLinkDev->DamageRects[Index] = UsbDisplayLinkDev->DamageRects[UsbDisplayLinkDev->DamageRectCount];
+      Index = 0;
+    } else {
+      Index++;
+    }
+  }
+
+  if (UsbDisplayLinkDev->DamageRectCount < DISPLAYLINK_MAX_DAMAGE_RECTS) {
+    UsbDisplayLinkDev->DamageRects[UsbDisplayLinkDev->DamageRectCount++] = New;
+    return;
+  }
+
+  // No free slot - fold the new region into the one where this adds the fewest pixels.
+  BestIndex = 0;
+  BestGrowth = MAX_UINTN;
+  for (Index = 0; Index < DISPLAYLINK_MAX_DAMAGE_RECTS; Index++) {
+    Merged = UsbDisplayLinkDev->DamageRects[Index];
+    DamageRectUnion (&Merged, &New);
+    Growth = DamageRectArea (&Merged) - DamageRectArea (&UsbDisplayLinkDev->DamageRects[Index]);
+    if (Growth < BestGrowth) {
+      BestGrowth = Growth;
+      BestIndex = Index;
+    }
+  }
+  DamageRectUnion (&UsbDisplayLinkDev->DamageRects[BestIndex], &New);
+}
+
 /**
  * Update the local copy of the Frame Buffer. This local copy is periodically transmitted to the
  * DisplayLink device (via DlGopSendScreenUpdate)
@@ -100,7 +223,10 @@ BuildBackBuffer (
 )
 {
   UINTN H;
-  UINTN W;
+  UINTN RowBytes;
+
+  RowBytes = Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
   switch (BltOperation) {
   case EfiBltVideoToBltBuffer:
   {
@@ -110,11 +236,9 @@ BuildBackBuffer (
     SrcB = UsbDisplayLinkDev->Screen + SourceY * PixelsPerScanLine + SourceX;
 
     for (H = 0; H < Height; H++) {
-      for (W = 0; W < Width; W++) {
-        Blt[W] = *SrcB++;
-      }
+      CopyMem (Blt, SrcB, RowBytes);
       Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)(((UINT8*)Blt) + BltBufferStride);
-      SrcB += PixelsPerScanLine - Width;
+      SrcB += PixelsPerScanLine;
     }
   }
   break;
@@ -122,12 +246,7 @@ BuildBackBuffer (
   case EfiBltBufferToVideo:
   {
     // Update the store of the area of the screen that is "dirty" - that we need to send in the next screen update.
-    if (DestinationY < UsbDisplayLinkDev->LastY1) {
-      UsbDisplayLinkDev->LastY1 = DestinationY;
-    }
-    if ((DestinationY + Height) > UsbDisplayLinkDev->LastY2) {
-      UsbDisplayLinkDev->LastY2 = DestinationY + Height;
-    }
+    DlGopAddDamage (UsbDisplayLinkDev, DestinationX, DestinationY, Width, Height);
 
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Blt;
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
@@ -135,41 +254,50 @@ BuildBackBuffer (
     DstB = UsbDisplayLinkDev->Screen + DestinationY * PixelsPerScanLine + DestinationX;
 
     for (H = 0; H < Height; H++) {
-      for (W = 0; W < Width; W++) {
-        *DstB++ = Blt[W];
-      }
+      CopyMem (DstB, Blt, RowBytes);
       Blt = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)(((UINT8*)Blt) + BltBufferStride);
-      DstB += PixelsPerScanLine - Width;
+      DstB += PixelsPerScanLine;
     }
   }
   break;
 
   case EfiBltVideoToVideo:
   {
+    DlGopAddDamage (UsbDisplayLinkDev, DestinationX, DestinationY, Width, Height);
+
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* SrcB;
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
-    SrcB = UsbDisplayLinkDev->Screen + SourceY * PixelsPerScanLine + SourceX;
-    DstB = UsbDisplayLinkDev->Screen + DestinationY * PixelsPerScanLine + DestinationX;
+    INTN LineStep;
+
+    // CopyMem copes with overlap within a line; when moving the area down the screen, also
+    // copy the lines bottom-up so that a line is not overwritten before it has been read.
+    if (DestinationY > SourceY) {
+      SrcB = UsbDisplayLinkDev->Screen + (SourceY + Height - 1) * PixelsPerScanLine + SourceX;
+      DstB = UsbDisplayLinkDev->Screen + (DestinationY + Height - 1) * PixelsPerScanLine + DestinationX;
+      LineStep = -(INTN)PixelsPerScanLine;
+    } else {
+      SrcB = UsbDisplayLinkDev->Screen + SourceY * PixelsPerScanLine + SourceX;
+      DstB = UsbDisplayLinkDev->Screen + DestinationY * PixelsPerScanLine + DestinationX;
+      LineStep = (INTN)PixelsPerScanLine;
+    }
 
     for (H = 0; H < Height; H++) {
-      for (W = 0; W < Width; W++) {
-        *DstB++ = *SrcB++;
-      }
-      SrcB += PixelsPerScanLine - Width;
-      DstB += PixelsPerScanLine - Width;
+      CopyMem (DstB, SrcB, RowBytes);
+      SrcB += LineStep;
+      DstB += LineStep;
     }
   }
   break;
 
   case EfiBltVideoFill:
   {
+    DlGopAddDamage (UsbDisplayLinkDev, DestinationX, DestinationY, Width, Height);
+
     EFI_GRAPHICS_OUTPUT_BLT_PIXEL* DstB;
     DstB = UsbDisplayLinkDev->Screen + DestinationY * PixelsPerScanLine + DestinationX;
     for (H = 0; H < Height; H++) {
-      for (W = 0; W < Width; W++) {
-        *DstB++ = *BltBuffer;
-      }
-      DstB += PixelsPerScanLine - Width;
+      SetMem32 (DstB, RowBytes, ReadUnaligned32 ((UINT32 *)BltBuffer));
+      DstB += PixelsPerScanLine;
     }
   }
   break;
@@ -252,7 +380,33 @@ DlGopSendTestPattern (
 
 
 /**
- * Transfer the latest copy of the Blt buffer over USB to the DisplayLink device
+ * Convert a damaged area of the back buffer into the 24bpp copy that is sent to the device.
+ * @param UsbDisplayLinkDev
+ * @param Rect
+ */
+STATIC VOID
+ConvertDamageRect (
+    IN USB_DISPLAYLINK_DEV* UsbDisplayLinkDev,
+    IN CONST DISPLAYLINK_DAMAGE_RECT* Rect
+    )
+{
+  UINTN Width;
+  UINTN H;
+
+  Width = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution;
+
+  for (H = Rect->Y1; H < Rect->Y2; H++) {
+    DlConvertBltPixelsToRgb24 (
+      UsbDisplayLinkDev->Screen24 + H * UsbDisplayLinkDev->Screen24Stride + Rect->X1 * 3,
+      UsbDisplayLinkDev->Screen + H * Width + Rect->X1,
+      Rect->X2 - Rect->X1);
+  }
+}
+
+/**
+ * Transfer the latest copy of the Blt buffer over USB to the DisplayLink device.
+ * Only the areas that have been BLTted to since the last update are converted to the device format;
+ * the rest of the frame is sent from the 24bpp copy kept from previous updates.
  * @param UsbDisplayLinkDev
  * @return
  */
@@ -268,12 +422,15 @@ DlGopSendScreenUpdate (
   // If it has been a while since we sent an update, send a full screen.
   // This allows us to update a hot-plugged monitor quickly.
   if (UsbDisplayLinkDev->TimeSinceLastScreenUpdate > DISPLAYLINK_FULL_SCREEN_UPDATE_PERIOD) {
-    UsbDisplayLinkDev->LastY1 = 0;
-    UsbDisplayLinkDev->LastY2 = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution - 1;
+    DlGopAddDamage (
+      UsbDisplayLinkDev,
+      0, 0,
+      UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution,
+      UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->VerticalResolution);
   }
 
   // If there has been no BLT since the last update/poll, drop out quietly.
-  if (UsbDisplayLinkDev->LastY2 < UsbDisplayLinkDev->LastY1) {
+  if (UsbDisplayLinkDev->DamageRectCount == 0) {
     UsbDisplayLinkDev->TimeSinceLastScreenUpdate += (DISPLAYLINK_SCREEN_UPDATE_TIMER_PERIOD / 1000);  // Convert us to ms
     return EFI_SUCCESS;
   }
@@ -282,62 +439,72 @@ DlGopSendScreenUpdate (
 
   EFI_TPL OriginalTPL = gBS->RaiseTPL (TPL_NOTIFY);
 
-  UINTN DataLen;
+  UINTN DataSentBefore;
+  UINTN TransfersSentBefore;
   UINTN Width;
   UINTN Height;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL* SrcPtr;
-  UINT8* DstPtr;
-  UINT8 DstBuffer[1920 * 3]; // Get rid of the magic numbers at some point
-                             // Could also use a buffer allocated at runtime to store the line, stored in the USB_DISPLAYLINK_DEV structure.
+  UINTN Stride;
+  UINTN LinesPerTransfer;
+  UINTN Lines;
+  UINTN DataLen;
   UINTN H;
+  UINTN Index;
 
-  DataLen = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution * 3; // Send 1 line @ 24 bits per pixel
+  DataSentBefore = UsbDisplayLinkDev->DataSent;
+  TransfersSentBefore = UsbDisplayLinkDev->TransfersSent;
   Width = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->HorizontalResolution;
   Height = UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info->VerticalResolution;
-  SrcPtr = UsbDisplayLinkDev->Screen;
-  DstPtr = DstBuffer;
-
-  for (H = 0; H < Height; H++) {
-    DstPtr = DstBuffer;
-
-    UINTN W;
-    for (W = 0; W < Width; W++) {
-      // Need to swap round the RGB values
-      DstPtr[0] = ((UINT8 *)SrcPtr)[2];
-      DstPtr[1] = ((UINT8 *)SrcPtr)[1];
-      DstPtr[2] = ((UINT8 *)SrcPtr)[0];
-      SrcPtr++;
-      DstPtr += 3;
-    }
 
-    Status = DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, DataLen, &USBStatus);
+  for (Index = 0; Index < UsbDisplayLinkDev->DamageRectCount; Index++) {
+    ConvertDamageRect (UsbDisplayLinkDev, &UsbDisplayLinkDev->DamageRects[Index]);
+  }
+  // The 24bpp copy is now up to date, even if the transfer below fails.
+  UsbDisplayLinkDev->DamageRectCount = 0;
+
+  // The direct framebuffer protocol has no way to address a line, so every line of the frame is sent, in order,
+  // whatever the damage covered. The device writes the pixel stream in raster order, wrapping at the end of each
+  // line of the mode, so the lines are sent straight from Screen24, where they are contiguous, one transfer per
+  // DISPLAYLINK_BULK_COALESCE_LENGTH bytes, rounded up to whole lines. Every transfer has to end with a short
+  // packet, as each line did when they were sent one at a time.
+  Stride = UsbDisplayLinkDev->Screen24Stride;
+  LinesPerTransfer = (DISPLAYLINK_BULK_COALESCE_LENGTH + Stride - 1) / Stride;
+
+  H = 0;
+  while (H < Height) {
+    Lines = MIN (LinesPerTransfer, Height - H);
+    DataLen = Lines * Stride;
+
+    Status = DlUsbBulkWrite (UsbDisplayLinkDev, UsbDisplayLinkDev->Screen24 + H * Stride, DataLen, &USBStatus);
 
     // USBStatus values defined in usbio.h, e.g. EFI_USB_ERR_TIMEOUT 0x40
     if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Line %d len %d, failure code %r USB status x%x\n", H, DataLen, Status, USBStatus));
+      DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Lines %d-%d len %d, failure code %r USB status x%x\n", H, H + Lines - 1, DataLen, Status, USBStatus));
       break;
     }
     // Need an extra DlUsbBulkWrite if the data length is divisible by USB MaxPacketSize. This spare data will just get written into the (invisible) stride area.
     // Note that the API doesn't let us do a bulk write of 0.
     if ((DataLen & (UsbDisplayLinkDev->BulkOutEndpointDescriptor.MaxPacketSize - 1)) == 0) {
-      Status = DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, 2, &USBStatus);
+      Status = DlUsbBulkWrite (UsbDisplayLinkDev, UsbDisplayLinkDev->Screen24, 2, &USBStatus);
       if (EFI_ERROR (Status)) {
-        DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Line %d len %d, failure code %r USB status x%x\n", H, DataLen, Status, USBStatus));
+        DEBUG ((DEBUG_ERROR, "Screen update - USB bulk transfer of pixel data failed. Lines %d-%d len %d, failure code %r USB status x%x\n", H, H + Lines - 1, DataLen, Status, USBStatus));
         break;
       }
     }
+    H += Lines;
   }
 
-  if (!EFI_ERROR (Status)) {
-    // If we've successfully transmitted the frame, reset the values that store which area of the screen has been BLTted to.
-    // If we haven't succeeded, this will mean we'll try to resend it after the next poll period.
-    UsbDisplayLinkDev->LastY2 = 0;
-    UsbDisplayLinkDev->LastY1 = (UINTN)-1;
+  if (EFI_ERROR (Status)) {
+    // If we haven't succeeded, mark the whole screen as dirty so that we try to resend it after the next poll period.
+    DlGopAddDamage (UsbDisplayLinkDev, 0, 0, Width, Height);
   }
 
   // Payload with length of 1 to terminate the frame
   // We need to do this even if we had an error, to indicate to the DL device that it should now expect a new frame.
-  DlUsbBulkWrite (UsbDisplayLinkDev, DstBuffer, 1, &USBStatus);
+  DlUsbBulkWrite (UsbDisplayLinkDev, UsbDisplayLinkDev->Screen24, 1, &USBStatus);
+
+  UsbDisplayLinkDev->FrameDataSent = UsbDisplayLinkDev->DataSent - DataSentBefore;
+  UsbDisplayLinkDev->FrameTransfersSent = UsbDisplayLinkDev->TransfersSent - TransfersSentBefore;
+  DEBUG ((DEBUG_VERBOSE, "Screen update - %d bytes in %d bulk transfers.\n", UsbDisplayLinkDev->FrameDataSent, UsbDisplayLinkDev->FrameTransfersSent));
 
   gBS->RestoreTPL (OriginalTPL);
 
@@ -486,6 +653,25 @@ DisplayLinkSetMode (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  if (UsbDisplayLinkDev->Screen24 != NULL) {
+    FreePool (UsbDisplayLinkDev->Screen24);
+  }
+
+  // Lines are kept contiguous, with no padding, so that a run of them can go to the device in one bulk transfer.
+  UsbDisplayLinkDev->Screen24Stride = Gop->Mode->Info->HorizontalResolution * 3;
+
+  UsbDisplayLinkDev->Screen24 = (UINT8*)AllocateZeroPool (
+    UsbDisplayLinkDev->Screen24Stride *
+    Gop->Mode->Info->VerticalResolution);
+
+  if (UsbDisplayLinkDev->Screen24 == NULL) {
+    FreePool (UsbDisplayLinkDev->Screen);
+    UsbDisplayLinkDev->Screen = NULL;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  UsbDisplayLinkDev->DamageRectCount = 0;
+
   DEBUG ((DEBUG_INFO, "Video mode %d selected by BIOS - %d x %d.\n", ModeNumber, VideoMode->HActive, VideoMode->VActive));
   // Wait until we are sure that we can set the video mode before we tell the firmware
   Status = DlUsbSendControlWriteMessage (UsbDisplayLinkDev, SET_VIDEO_MODE, 0, VideoMode, sizeof (struct VideoMode));
@@ -496,6 +682,8 @@ DisplayLinkSetMode (
     Gop->Mode->Mode = GRAPHICS_OUTPUT_INVALID_MODE_NUMBER;
     FreePool (UsbDisplayLinkDev->Screen);
     UsbDisplayLinkDev->Screen = NULL;
+    FreePool (UsbDisplayLinkDev->Screen24);
+    UsbDisplayLinkDev->Screen24 = NULL;
   } else {
     BuildBackBuffer (
       UsbDisplayLinkDev,
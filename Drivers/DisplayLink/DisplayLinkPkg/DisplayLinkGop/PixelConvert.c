@@ -0,0 +1,59 @@
+/**
+ * @file PixelConvert.c
+ * @brief Conversion of BLT pixels to the format sent to the DisplayLink device.
+ *
+ * Copyright (c) 2018-2019, DisplayLink (UK) Ltd. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-Patent
+ *
+**/
+
+#include "PixelConvert.h"
+
+/**
+ * Convert a run of BLT pixels (B, G, R, reserved) to the packed 24bpp R, G, B format used by the device.
+ * Four pixels are converted at a time into three 32-bit words, so the inner loop does three stores
+ * instead of twelve; any remaining pixels are swapped one byte at a time.
+ * @param Dst     Destination, need not be aligned
+ * @param Src
+ * @param Count   Number of pixels
+ */
+VOID
+DlConvertBltPixelsToRgb24 (
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src,
+    IN UINTN Count
+    )
+{
+  CONST UINT32* Src32;
+  UINT32 P0;
+  UINT32 P1;
+  UINT32 P2;
+  UINT32 P3;
+
+  Src32 = (CONST UINT32*)Src;
+
+  for (; Count >= 4; Count -= 4) {
+    P0 = Src32[0];
+    P1 = Src32[1];
+    P2 = Src32[2];
+    P3 = Src32[3];
+
+    // Pixels are 0xXXRRGGBB in little endian order; output bytes are R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3
+    WriteUnaligned32 ((UINT32*)&Dst[0], ((P0 >> 16) & 0xFF) | (P0 & 0xFF00) | ((P0 & 0xFF) << 16) | ((P1 & 0xFF0000) << 8));
+    WriteUnaligned32 ((UINT32*)&Dst[4], ((P1 >> 8) & 0xFF) | ((P1 & 0xFF) << 8) | (P2 & 0xFF0000) | ((P2 & 0xFF00) << 16));
+    WriteUnaligned32 ((UINT32*)&Dst[8], (P2 & 0xFF) | ((P3 >> 8) & 0xFF00) | ((P3 & 0xFF00) << 8) | ((P3 & 0xFF) << 24));
+
+    Src32 += 4;
+    Dst += 12;
+  }
+
+  for (; Count > 0; Count--) {
+    // Need to swap round the RGB values
+    Dst[0] = ((CONST UINT8 *)Src32)[2];
+    Dst[1] = ((CONST UINT8 *)Src32)[1];
+    Dst[2] = ((CONST UINT8 *)Src32)[0];
+    Src32++;
+    Dst += 3;
+  }
+}
@@ -0,0 +1,26 @@
+/**
+ * @file PixelConvert.h
+ * @brief Conversion of BLT pixels to the format sent to the DisplayLink device.
+ * Kept apart from the rest of the driver so that the conversion benchmark can build it too.
+ *
+ * Copyright (c) 2018-2019, DisplayLink (UK) Ltd. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause-Patent
+ *
+**/
+
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <Uefi/UefiBaseType.h>
+#include <Protocol/GraphicsOutput.h>
+#include <Library/BaseLib.h>
+
+VOID
+DlConvertBltPixelsToRgb24 (
+    OUT UINT8* Dst,
+    IN CONST EFI_GRAPHICS_OUTPUT_BLT_PIXEL* Src,
+    IN UINTN Count
+    );
+
+#endif // PIXEL_CONVERT_H
@@ -159,8 +159,7 @@ InitializeUsbDisplayLinkDevice (
   Gop->Mode->FrameBufferSize = 0;
 
   // Prevent DlGopSendScreenUpdate from running until we are sure that the video mode is set
-  UsbDisplayLinkDev->LastY2 = 0;
-  UsbDisplayLinkDev->LastY1 = (UINTN)-1;
+  UsbDisplayLinkDev->DamageRectCount = 0;
 
   return EFI_SUCCESS;
 }
@@ -1065,6 +1064,11 @@ UsbDisplayLinkDriverBindingStop (
     UsbDisplayLinkDev->Screen = NULL;
   }
 
+  if (UsbDisplayLinkDev->Screen24 != NULL) {
+    FreePool (UsbDisplayLinkDev->Screen24);
+    UsbDisplayLinkDev->Screen24 = NULL;
+  }
+
   if (UsbDisplayLinkDev->GraphicsOutputProtocol.Mode) {
     if (UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info) {
       FreePool (UsbDisplayLinkDev->GraphicsOutputProtocol.Mode->Info);
@@ -20,6 +20,7 @@
 #include <Protocol/GraphicsOutput.h>
 #include <Protocol/UsbIo.h>
 
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -39,6 +40,9 @@
 #define DISPLAYLINK_USB_CTRL_TIMEOUT  (1000)
 #define DISPLAYLINK_USB_BULK_TIMEOUT  (1)
 
+// Consecutive lines of a screen update are sent in bulk transfers of at least this many bytes
+#define DISPLAYLINK_BULK_COALESCE_LENGTH  (16 * 1024)
+
 #define DISPLAYLINK_SCREEN_UPDATE_TIMER_PERIOD  ((UINTN)1000000) // 0.1s in us
 #define DISPLAYLINK_FULL_SCREEN_UPDATE_PERIOD   ((UINTN)30000) // 3s in ticks
 
@@ -65,6 +69,21 @@ typedef struct {
 
 #define GRAPHICS_OUTPUT_INVALID_MODE_NUMBER 0xffff
 
+// Maximum number of separate dirty regions tracked between two screen updates.
+// Further regions are merged into the existing rectangle that grows the least.
+#define DISPLAYLINK_MAX_DAMAGE_RECTS  8
+
+/**
+ *  Region of the back buffer that has been BLTted to since the last screen update.
+ *  X2 and Y2 are exclusive.
+ */
+typedef struct {
+  UINTN X1;
+  UINTN Y1;
+  UINTN X2;
+  UINTN Y2;
+} DISPLAYLINK_DAMAGE_RECT;
+
 /**
  *  Device instance of USB display.
  */
@@ -80,13 +99,18 @@ typedef struct {
   EFI_EDID_ACTIVE_PROTOCOL      EdidActive;
   EFI_UNICODE_STRING_TABLE      *ControllerNameTable;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Screen;
+  UINT8                         *Screen24;                     /** Copy of Screen in the 24bpp format sent to the device */
+  UINTN                         Screen24Stride;                /** Bytes per line in Screen24; lines are contiguous so that a run of them is one bulk transfer */
   UINTN                         DataSent;                       /** Debug - used to track the bandwidth */
+  UINTN                         TransfersSent;                  /** Debug - number of bulk transfers, used with DataSent */
+  UINTN                         FrameDataSent;                  /** Bytes sent for the last screen update */
+  UINTN                         FrameTransfersSent;             /** Bulk transfers issued for the last screen update */
   EFI_EVENT                     TimerEvent;
   EFI_EVENT                     DriverExitBootServicesEvent;
   BOOLEAN                       ShowBandwidth;                 /** Debugging - show the bandwidth on the screen */
   BOOLEAN                       ShowTestPattern;               /** Show a colourbar pattern instead of the BLTd contents of the framebuffer */
-  UINTN                         LastY1;                        /** Used to track if we can do a partial screen update */
-  UINTN                         LastY2;
+  DISPLAYLINK_DAMAGE_RECT       DamageRects[DISPLAYLINK_MAX_DAMAGE_RECTS]; /** Areas to convert in the next screen update */
+  UINTN                         DamageRectCount;
   UINTN                         LastWidth;
   UINTN                         TimeSinceLastScreenUpdate;     /** Do a full screen update every (x) seconds */
 } USB_DISPLAYLINK_DEV;
@@ -224,6 +248,15 @@ DlGopSendScreenUpdate (
   USB_DISPLAYLINK_DEV* UsbDisplayLinkDev
 );
 
+VOID
+DlGopAddDamage (
+  USB_DISPLAYLINK_DEV* UsbDisplayLinkDev,
+  UINTN X,
+  UINTN Y,
+  UINTN Width,
+  UINTN Height
+);
+
 
 /* ******************************************* */
 /* ********  USB interface functions  ******** */
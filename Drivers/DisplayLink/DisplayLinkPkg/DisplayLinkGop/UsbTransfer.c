@@ -43,6 +43,11 @@ DlUsbBulkWrite (
     DISPLAYLINK_USB_BULK_TIMEOUT,
     USBStatus);
 
+  if (!EFI_ERROR (Status)) {
+    UsbDisplayLinkDev->DataSent += DataLen;
+    UsbDisplayLinkDev->TransfersSent++;
+  }
+
   return Status;
 }
 
@@ -7,12 +7,26 @@
 **/
 
 #include <Uefi.h>
+#include <Protocol/LoadedImage.h>
+#include <Library/BaseLib.h>
 #include <Library/BltLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/UefiLib.h>
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/UefiBootServicesTableLib.h>
 
+//
+// Number of times each operation is repeated by BenchmarkBlt ()
+//
+#define BENCHMARK_ITERATIONS    100
+
+//
+// Number of lines moved by each scroll in BenchmarkBlt ()
+//
+#define BENCHMARK_SCROLL_LINES  16
+
+UINT64  mTicksPerMs;
 
 UINT64
 ReadTimestamp (
@@ -233,10 +247,152 @@ TestColor (
 }
 
 
+VOID
+CalibrateTimestamp (
+  VOID
+  )
+{
+  UINT64   Start;
+
+  Start = ReadTimestamp ();
+  gBS->Stall (10000);
+  mTicksPerMs = DivU64x32 (ReadTimestamp () - Start, 10);
+  if (mTicksPerMs == 0) {
+    mTicksPerMs = 1;
+  }
+}
+
+
+VOID
+PrintThroughput (
+  IN CHAR16  *Name,
+  IN UINTN   Iterations,
+  IN UINT64  Bytes,
+  IN UINT64  Ticks
+  )
+{
+  UINT64   Microseconds;
+
+  Microseconds = DivU64x64Remainder (MultU64x32 (Ticks, 1000), mTicksPerMs, NULL);
+  if (Microseconds == 0) {
+    Microseconds = 1;
+  }
+
+  //
+  // Bytes per microsecond is the same as megabytes per second.
+  //
+  Print (
+    L"%-8s %4u ops in %8ld us, %5ld MB/s\n",
+    Name,
+    (UINT32) Iterations,
+    Microseconds,
+    DivU64x64Remainder (Bytes, Microseconds, NULL)
+    );
+}
+
+
+/**
+  Time full screen fills, scrolls, and blits to and from a buffer.
+
+**/
+VOID
+BenchmarkBlt (
+  VOID
+  )
+{
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Color;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  *Buffer;
+  UINTN                          Loop;
+  UINTN                          Width;
+  UINTN                          Height;
+  UINT64                         FrameBytes;
+  UINT64                         Start;
+
+  BltLibGetSizes (&Width, &Height);
+  if (Height <= BENCHMARK_SCROLL_LINES) {
+    return;
+  }
+
+  FrameBytes = MultU64x32 (Width * Height, sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+  Buffer = AllocatePool ((UINTN) FrameBytes);
+  if (Buffer == NULL) {
+    Print (L"Out of memory\n");
+    return;
+  }
+
+  CalibrateTimestamp ();
+  *(UINT32*) (&Color) = 0;
+
+  Start = ReadTimestamp ();
+  for (Loop = 0; Loop < BENCHMARK_ITERATIONS; Loop++) {
+    *(UINT32*) (&Color) = (UINT32) (Loop * 0x010101) & 0xffffff;
+    BltLibVideoFill (&Color, 0, 0, Width, Height);
+  }
+  PrintThroughput (
+    L"Fill",
+    BENCHMARK_ITERATIONS,
+    MultU64x32 (FrameBytes, BENCHMARK_ITERATIONS),
+    ReadTimestamp () - Start
+    );
+
+  Start = ReadTimestamp ();
+  for (Loop = 0; Loop < BENCHMARK_ITERATIONS; Loop++) {
+    BltLibVideoToVideo (
+      0,
+      BENCHMARK_SCROLL_LINES,
+      0,
+      0,
+      Width,
+      Height - BENCHMARK_SCROLL_LINES
+      );
+    BltLibVideoFill (
+      &Color,
+      0,
+      Height - BENCHMARK_SCROLL_LINES,
+      Width,
+      BENCHMARK_SCROLL_LINES
+      );
+  }
+  PrintThroughput (
+    L"Scroll",
+    BENCHMARK_ITERATIONS,
+    MultU64x32 (FrameBytes, BENCHMARK_ITERATIONS),
+    ReadTimestamp () - Start
+    );
+
+  Start = ReadTimestamp ();
+  for (Loop = 0; Loop < BENCHMARK_ITERATIONS; Loop++) {
+    BltLibVideoToBltBuffer (Buffer, 0, 0, Width, Height);
+  }
+  PrintThroughput (
+    L"Read",
+    BENCHMARK_ITERATIONS,
+    MultU64x32 (FrameBytes, BENCHMARK_ITERATIONS),
+    ReadTimestamp () - Start
+    );
+
+  Start = ReadTimestamp ();
+  for (Loop = 0; Loop < BENCHMARK_ITERATIONS; Loop++) {
+    BltLibBufferToVideo (Buffer, 0, 0, Width, Height);
+  }
+  PrintThroughput (
+    L"Write",
+    BENCHMARK_ITERATIONS,
+    MultU64x32 (FrameBytes, BENCHMARK_ITERATIONS),
+    ReadTimestamp () - Start
+    );
+
+  FreePool (Buffer);
+}
+
+
 /**
   The user Entry Point for Application. The user code starts with this function
   as the real entry point for the application.
 
+  Run with -b to time the BltLib operations instead of drawing the test
+  patterns.
+
   @param[in] ImageHandle    The firmware allocated handle for the EFI image.
   @param[in] SystemTable    A pointer to the EFI System Table.
 
@@ -253,6 +409,7 @@ UefiMain (
 {
   EFI_STATUS                     Status;
   EFI_GRAPHICS_OUTPUT_PROTOCOL   *Gop;
+  EFI_LOADED_IMAGE_PROTOCOL      *LoadedImage;
 
   Status = gBS->HandleProtocol (
                   gST->ConsoleOutHandle,
@@ -271,6 +428,19 @@ UefiMain (
     return Status;
   }
 
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiLoadedImageProtocolGuid,
+                  (VOID **) &LoadedImage
+                  );
+  if (!EFI_ERROR (Status) &&
+      (LoadedImage->LoadOptions != NULL) &&
+      (LoadedImage->LoadOptionsSize >= sizeof (CHAR16)) &&
+      (StrStr ((CHAR16 *) LoadedImage->LoadOptions, L"-b") != NULL)) {
+    BenchmarkBlt ();
+    return EFI_SUCCESS;
+  }
+
   TestFills ();
 
   TestColor ();
@@ -11,6 +11,8 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/BltLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 
 #if 0
 #define VDEBUG DEBUG
@@ -27,6 +29,15 @@ UINTN                           mBltLibWidthInPixels;
 UINTN                           mBltLibHeight;
 UINT8                           mBltLibLineBuffer[MAX_LINE_BUFFER_SIZE];
 UINT8                           *mBltLibFrameBuffer;
+//
+// With PcdFrameBufferBltLibShadow, all drawing and reading is done on a
+// copy of the frame buffer in system memory, mBltLibShadowBuffer, and
+// changed rectangles are written out to the device afterwards. Otherwise
+// mBltLibDrawBuffer is the frame buffer itself.
+//
+UINT8                           *mBltLibShadowBuffer;
+UINTN                           mBltLibShadowSize;
+UINT8                           *mBltLibDrawBuffer;
 EFI_GRAPHICS_PIXEL_FORMAT       mPixelFormat;
 EFI_PIXEL_BITMASK               mPixelBitMasks;
 INTN                            mPixelShl[4]; // R-G-B-Rsvd
@@ -68,6 +79,221 @@ ConfigurePixelBitMaskFormat (
 }
 
 
+/**
+  Convert a row of Blt pixels to the frame buffer pixel format.
+
+  @param[out] Dst    Destination in frame buffer format
+  @param[in]  Src    Source Blt pixels
+  @param[in]  Width  Number of pixels to convert
+
+**/
+VOID
+ConvertBltToVideoLine (
+  OUT UINT8                                 *Dst,
+  IN  EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *Src,
+  IN  UINTN                                 Width
+  )
+{
+  UINT32                          *Src32;
+  UINT32                          *Dst32;
+  UINT32                          Uint32;
+  UINT32                          RedMask;
+  UINT32                          GreenMask;
+  UINT32                          BlueMask;
+  UINTN                           RedShl;
+  UINTN                           RedShr;
+  UINTN                           GreenShl;
+  UINTN                           GreenShr;
+  UINTN                           BlueShl;
+  UINTN                           BlueShr;
+  UINTN                           X;
+
+  Src32 = (UINT32*) Src;
+
+  switch (mPixelFormat) {
+  case PixelBlueGreenRedReserved8BitPerColor:
+    CopyMem (Dst, Src, Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    return;
+
+  case PixelRedGreenBlueReserved8BitPerColor:
+    //
+    // Swap red and blue, clearing the reserved byte like the bit mask
+    // conversion does.
+    //
+    Dst32 = (UINT32*) Dst;
+    for (X = 0; X < Width; X++) {
+      Uint32 = Src32[X];
+      Dst32[X] = (Uint32 & 0x0000ff00) |
+                 ((Uint32 >> 16) & 0x000000ff) |
+                 ((Uint32 << 16) & 0x00ff0000);
+    }
+    return;
+
+  default:
+    break;
+  }
+
+  //
+  // Keep the masks and shifts in locals so the loop does not reload them
+  // from the globals for every pixel.
+  //
+  RedMask   = mPixelBitMasks.RedMask;
+  GreenMask = mPixelBitMasks.GreenMask;
+  BlueMask  = mPixelBitMasks.BlueMask;
+  RedShl    = (UINTN) mPixelShl[0];
+  RedShr    = (UINTN) mPixelShr[0];
+  GreenShl  = (UINTN) mPixelShl[1];
+  GreenShr  = (UINTN) mPixelShr[1];
+  BlueShl   = (UINTN) mPixelShl[2];
+  BlueShr   = (UINTN) mPixelShr[2];
+
+  if (mBltLibBytesPerPixel == sizeof (UINT32)) {
+    Dst32 = (UINT32*) Dst;
+    for (X = 0; X < Width; X++) {
+      Uint32 = Src32[X];
+      Dst32[X] = (((Uint32 << RedShl)   >> RedShr)   & RedMask) |
+                 (((Uint32 << GreenShl) >> GreenShr) & GreenMask) |
+                 (((Uint32 << BlueShl)  >> BlueShr)  & BlueMask);
+    }
+  } else {
+    for (X = 0; X < Width; X++) {
+      Uint32 = Src32[X];
+      Uint32 = (((Uint32 << RedShl)   >> RedShr)   & RedMask) |
+               (((Uint32 << GreenShl) >> GreenShr) & GreenMask) |
+               (((Uint32 << BlueShl)  >> BlueShr)  & BlueMask);
+      CopyMem (Dst + X * mBltLibBytesPerPixel, &Uint32, mBltLibBytesPerPixel);
+    }
+  }
+}
+
+
+/**
+  Convert a row of frame buffer pixels to Blt pixels.
+
+  @param[out] Dst    Destination Blt pixels
+  @param[in]  Src    Source in frame buffer format
+  @param[in]  Width  Number of pixels to convert
+
+**/
+VOID
+ConvertVideoToBltLine (
+  OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL         *Dst,
+  IN  UINT8                                 *Src,
+  IN  UINTN                                 Width
+  )
+{
+  UINT32                          *Src32;
+  UINT32                          *Dst32;
+  UINT32                          Uint32;
+  UINT32                          RedMask;
+  UINT32                          GreenMask;
+  UINT32                          BlueMask;
+  UINTN                           RedShl;
+  UINTN                           RedShr;
+  UINTN                           GreenShl;
+  UINTN                           GreenShr;
+  UINTN                           BlueShl;
+  UINTN                           BlueShr;
+  UINTN                           X;
+
+  Dst32 = (UINT32*) Dst;
+
+  switch (mPixelFormat) {
+  case PixelBlueGreenRedReserved8BitPerColor:
+    CopyMem (Dst, Src, Width * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+    return;
+
+  case PixelRedGreenBlueReserved8BitPerColor:
+    Src32 = (UINT32*) Src;
+    for (X = 0; X < Width; X++) {
+      Uint32 = Src32[X];
+      Dst32[X] = (Uint32 & 0x0000ff00) |
+                 ((Uint32 >> 16) & 0x000000ff) |
+                 ((Uint32 << 16) & 0x00ff0000);
+    }
+    return;
+
+  default:
+    break;
+  }
+
+  RedMask   = mPixelBitMasks.RedMask;
+  GreenMask = mPixelBitMasks.GreenMask;
+  BlueMask  = mPixelBitMasks.BlueMask;
+  RedShl    = (UINTN) mPixelShl[0];
+  RedShr    = (UINTN) mPixelShr[0];
+  GreenShl  = (UINTN) mPixelShl[1];
+  GreenShr  = (UINTN) mPixelShr[1];
+  BlueShl   = (UINTN) mPixelShl[2];
+  BlueShr   = (UINTN) mPixelShr[2];
+
+  for (X = 0; X < Width; X++) {
+    if (mBltLibBytesPerPixel == sizeof (UINT32)) {
+      Uint32 = ((UINT32*) Src)[X];
+    } else {
+      Uint32 = 0;
+      CopyMem (&Uint32, Src + X * mBltLibBytesPerPixel, mBltLibBytesPerPixel);
+    }
+    Dst32[X] = (((Uint32 & RedMask)   >> RedShl)   << RedShr) |
+               (((Uint32 & GreenMask) >> GreenShl) << GreenShr) |
+               (((Uint32 & BlueMask)  >> BlueShl)  << BlueShr);
+  }
+}
+
+
+/**
+  Write a rectangle of the shadow buffer out to the frame buffer.
+
+  Each row is widened to 8 byte boundaries so the copy to the device runs
+  as aligned 64-bit writes; the extra bytes hold what is already on the
+  screen. Full width rectangles are written with a single copy.
+
+  @param[in]  X       X location of the rectangle
+  @param[in]  Y       Y location of the rectangle
+  @param[in]  Width   Width (in pixels)
+  @param[in]  Height  Height
+
+**/
+VOID
+FlushShadowBuffer (
+  IN  UINTN                                 X,
+  IN  UINTN                                 Y,
+  IN  UINTN                                 Width,
+  IN  UINTN                                 Height
+  )
+{
+  UINTN                           Offset;
+  UINTN                           Start;
+  UINTN                           End;
+
+  if (mBltLibShadowBuffer == NULL) {
+    return;
+  }
+
+  Offset = mBltLibBytesPerPixel * ((Y * mBltLibWidthInPixels) + X);
+
+  if ((X == 0) && (Width == mBltLibWidthInPixels)) {
+    //
+    // The rows are contiguous, so write them out as one span.
+    //
+    Width  = Width * Height;
+    Height = 1;
+  }
+
+  while (Height > 0) {
+    Start = Offset & ~(UINTN) 7;
+    End   = ALIGN_VALUE (Offset + Width * mBltLibBytesPerPixel, 8);
+    if (End > mBltLibShadowSize) {
+      End = mBltLibShadowSize;
+    }
+    CopyMem (mBltLibFrameBuffer + Start, mBltLibShadowBuffer + Start, End - Start);
+
+    Offset += mBltLibWidthInBytes;
+    Height--;
+  }
+}
+
+
 /**
   Configure the FrameBufferLib instance
 
@@ -90,6 +316,7 @@ BltLibConfigure (
     { 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
   STATIC EFI_PIXEL_BITMASK  BgrPixelMasks =
     { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+  UINTN                     ShadowSize;
 
   switch (FrameBufferInfo->PixelFormat) {
   case PixelRedGreenBlueReserved8BitPerColor:
@@ -117,6 +344,29 @@ BltLibConfigure (
 
   ASSERT (mBltLibWidthInBytes < sizeof (mBltLibLineBuffer));
 
+  mBltLibDrawBuffer = mBltLibFrameBuffer;
+  if (FeaturePcdGet (PcdFrameBufferBltLibShadow)) {
+    ShadowSize = mBltLibWidthInBytes * mBltLibHeight;
+    if ((mBltLibShadowBuffer != NULL) && (mBltLibShadowSize != ShadowSize)) {
+      FreePool (mBltLibShadowBuffer);
+      mBltLibShadowBuffer = NULL;
+    }
+    if (mBltLibShadowBuffer == NULL) {
+      mBltLibShadowBuffer = AllocatePool (ShadowSize);
+    }
+    if (mBltLibShadowBuffer != NULL) {
+      mBltLibShadowSize = ShadowSize;
+      //
+      // Start from what is on the screen. This is the only time the frame
+      // buffer is read.
+      //
+      CopyMem (mBltLibShadowBuffer, mBltLibFrameBuffer, ShadowSize);
+      mBltLibDrawBuffer = mBltLibShadowBuffer;
+    } else {
+      DEBUG ((EFI_D_WARN, "FrameBufferBltLib: no shadow buffer, drawing to the frame buffer\n"));
+    }
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -302,7 +552,7 @@ BltLibVideoFill (
     VDEBUG ((EFI_D_INFO, "VideoFill (wide, one-shot)\n"));
     Offset = DestinationY * mBltLibWidthInPixels;
     Offset = mBltLibBytesPerPixel * Offset;
-    BltMemDst = (VOID*) (mBltLibFrameBuffer + Offset);
+    BltMemDst = (VOID*) (mBltLibDrawBuffer + Offset);
     SizeInBytes = WidthInBytes * Height;
     if (SizeInBytes >= 8) {
       SetMem32 (BltMemDst, SizeInBytes & ~3, (UINT32) WideFill);
@@ -316,7 +566,7 @@ BltLibVideoFill (
     for (DstY = DestinationY; DstY < (Height + DestinationY); DstY++) {
       Offset = (DstY * mBltLibWidthInPixels) + DestinationX;
       Offset = mBltLibBytesPerPixel * Offset;
-      BltMemDst = (VOID*) (mBltLibFrameBuffer + Offset);
+      BltMemDst = (VOID*) (mBltLibDrawBuffer + Offset);
 
       if (UseWideFill && (((UINTN) BltMemDst & 7) == 0)) {
         VDEBUG ((EFI_D_INFO, "VideoFill (wide)\n"));
@@ -347,6 +597,8 @@ BltLibVideoFill (
     }
   }
 
+  FlushShadowBuffer (DestinationX, DestinationY, Width, Height);
+
   return EFI_SUCCESS;
 }
 
@@ -421,11 +673,8 @@ BltLibVideoToBltBufferEx (
 {
   UINTN                           DstY;
   UINTN                           SrcY;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *Blt;
-  VOID                            *BltMemSrc;
-  VOID                            *BltMemDst;
-  UINTN                           X;
-  UINT32                          Uint32;
+  UINT8                           *BltMemSrc;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *BltMemDst;
   UINTN                           Offset;
   UINTN                           WidthInBytes;
 
@@ -462,33 +711,26 @@ BltLibVideoToBltBufferEx (
 
     Offset = (SrcY * mBltLibWidthInPixels) + SourceX;
     Offset = mBltLibBytesPerPixel * Offset;
-    BltMemSrc = (VOID *) (mBltLibFrameBuffer + Offset);
-
-    if (mPixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
-      BltMemDst =
-        (VOID *) (
-            (UINT8 *) BltBuffer +
-            (DstY * Delta) +
-            (DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))
-          );
-    } else {
-      BltMemDst = (VOID *) mBltLibLineBuffer;
+    BltMemSrc = mBltLibDrawBuffer + Offset;
+
+    BltMemDst =
+      (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (
+          (UINT8 *) BltBuffer +
+          (DstY * Delta) +
+          (DestinationX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))
+        );
+
+    if ((mBltLibShadowBuffer == NULL) &&
+        (mPixelFormat != PixelBlueGreenRedReserved8BitPerColor)) {
+      //
+      // Read the row from video memory in one go, and convert it from the
+      // line buffer.
+      //
+      CopyMem (mBltLibLineBuffer, BltMemSrc, WidthInBytes);
+      BltMemSrc = mBltLibLineBuffer;
     }
 
-    CopyMem (BltMemDst, BltMemSrc, WidthInBytes);
-
-    if (mPixelFormat != PixelBlueGreenRedReserved8BitPerColor) {
-      for (X = 0; X < Width; X++) {
-        Blt         = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) ((UINT8 *) BltBuffer + (DstY * Delta) + (DestinationX + X) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
-        Uint32 = *(UINT32*) (mBltLibLineBuffer + (X * mBltLibBytesPerPixel));
-        *(UINT32*) Blt =
-          (UINT32) (
-              (((Uint32 & mPixelBitMasks.RedMask)   >> mPixelShl[0]) << mPixelShr[0]) |
-              (((Uint32 & mPixelBitMasks.GreenMask) >> mPixelShl[1]) << mPixelShr[1]) |
-              (((Uint32 & mPixelBitMasks.BlueMask)  >> mPixelShl[2]) << mPixelShr[2])
-            );
-      }
-    }
+    ConvertVideoToBltLine (BltMemDst, BltMemSrc, Width);
   }
 
   return EFI_SUCCESS;
@@ -565,11 +807,8 @@ BltLibBufferToVideoEx (
 {
   UINTN                           DstY;
   UINTN                           SrcY;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *Blt;
-  VOID                            *BltMemSrc;
-  VOID                            *BltMemDst;
-  UINTN                           X;
-  UINT32                          Uint32;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *BltMemSrc;
+  UINT8                           *BltMemDst;
   UINTN                           Offset;
   UINTN                           WidthInBytes;
 
@@ -603,32 +842,29 @@ BltLibBufferToVideoEx (
 
     Offset = (DstY * mBltLibWidthInPixels) + DestinationX;
     Offset = mBltLibBytesPerPixel * Offset;
-    BltMemDst = (VOID*) (mBltLibFrameBuffer + Offset);
-
-    if (mPixelFormat == PixelBlueGreenRedReserved8BitPerColor) {
-      BltMemSrc = (VOID *) ((UINT8 *) BltBuffer + (SrcY * Delta));
+    BltMemDst = mBltLibDrawBuffer + Offset;
+
+    BltMemSrc =
+      (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (
+          (UINT8 *) BltBuffer +
+          (SrcY * Delta) +
+          (SourceX * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))
+        );
+
+    if ((mBltLibShadowBuffer != NULL) ||
+        (mPixelFormat == PixelBlueGreenRedReserved8BitPerColor)) {
+      ConvertBltToVideoLine (BltMemDst, BltMemSrc, Width);
     } else {
-      for (X = 0; X < Width; X++) {
-        Blt =
-          (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) (
-              (UINT8 *) BltBuffer +
-              (SrcY * Delta) +
-              ((SourceX + X) * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL))
-            );
-        Uint32 = *(UINT32*) Blt;
-        *(UINT32*) (mBltLibLineBuffer + (X * mBltLibBytesPerPixel)) =
-          (UINT32) (
-              (((Uint32 << mPixelShl[0]) >> mPixelShr[0]) & mPixelBitMasks.RedMask) |
-              (((Uint32 << mPixelShl[1]) >> mPixelShr[1]) & mPixelBitMasks.GreenMask) |
-              (((Uint32 << mPixelShl[2]) >> mPixelShr[2]) & mPixelBitMasks.BlueMask)
-            );
-      }
-      BltMemSrc = (VOID *) mBltLibLineBuffer;
+      //
+      // Convert into the line buffer so video memory is written in one go.
+      //
+      ConvertBltToVideoLine (mBltLibLineBuffer, BltMemSrc, Width);
+      CopyMem (BltMemDst, mBltLibLineBuffer, WidthInBytes);
     }
-
-    CopyMem (BltMemDst, BltMemSrc, WidthInBytes);
   }
 
+  FlushShadowBuffer (DestinationX, DestinationY, Width, Height);
+
   return EFI_SUCCESS;
 }
 
@@ -664,6 +900,7 @@ BltLibVideoToVideo (
   UINTN                           Offset;
   UINTN                           WidthInBytes;
   INTN                            LineStride;
+  UINTN                           Lines;
 
   //
   // Video to Video: Source is Video, destination is Video
@@ -692,25 +929,32 @@ BltLibVideoToVideo (
 
   Offset = (SourceY * mBltLibWidthInPixels) + SourceX;
   Offset = mBltLibBytesPerPixel * Offset;
-  BltMemSrc = (VOID *) (mBltLibFrameBuffer + Offset);
+  BltMemSrc = (VOID *) (mBltLibDrawBuffer + Offset);
 
   Offset = (DestinationY * mBltLibWidthInPixels) + DestinationX;
   Offset = mBltLibBytesPerPixel * Offset;
-  BltMemDst = (VOID *) (mBltLibFrameBuffer + Offset);
+  BltMemDst = (VOID *) (mBltLibDrawBuffer + Offset);
 
+  //
+  // When moving down, copy from the last row up so rows that overlap are
+  // read before they are overwritten.
+  //
   LineStride = mBltLibWidthInBytes;
   if ((UINTN) BltMemDst > (UINTN) BltMemSrc) {
+    BltMemSrc = (VOID*) ((UINT8*) BltMemSrc + (Height - 1) * mBltLibWidthInBytes);
+    BltMemDst = (VOID*) ((UINT8*) BltMemDst + (Height - 1) * mBltLibWidthInBytes);
     LineStride = -LineStride;
   }
 
-  while (Height > 0) {
+  for (Lines = Height; Lines > 0; Lines--) {
     CopyMem (BltMemDst, BltMemSrc, WidthInBytes);
 
     BltMemSrc = (VOID*) ((UINT8*) BltMemSrc + LineStride);
     BltMemDst = (VOID*) ((UINT8*) BltMemDst + LineStride);
-    Height--;
   }
 
+  FlushShadowBuffer (DestinationX, DestinationY, Width, Height);
+
   return EFI_SUCCESS;
 }
 
@@ -15,6 +15,20 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/IpmiCommandLib.h>
 
+#define BMC_ELOG_QUEUE_TICK       1       // [ms] Period of the IPMI command queue, one command per tick
+#define BMC_ELOG_TIMEOUT          5000000 // [us] Time allowed for each queued command
+#define BMC_ELOG_ERASE_DELAY      1000    // [us] First delay between Clear SEL polls
+#define BMC_ELOG_ERASE_DELAY_MAX  100000  // [us] Longest delay between Clear SEL polls
+
+STATIC IPMI_COMMAND_QUEUE                    mBmcElogQueue;
+STATIC IPMI_COMMAND_REQUEST                  mGetEnablesRequest;
+STATIC IPMI_COMMAND_REQUEST                  mSetEnablesRequest;
+STATIC IPMI_COMMAND_REQUEST                  mGetSelInfoRequest;
+STATIC IPMI_GET_BMC_GLOBAL_ENABLES_RESPONSE  mGetBmcGlobalEnables;
+STATIC IPMI_SET_BMC_GLOBAL_ENABLES_REQUEST   mSetBmcGlobalEnables;
+STATIC UINT8                                 mSetEnablesCompletionCode;
+STATIC IPMI_GET_SEL_INFO_RESPONSE            mSelInfo;
+
 EFI_STATUS
 EFIAPI
 CheckIfSelIsFull (
@@ -55,10 +69,12 @@ Returns:
 --*/
 {
   INTN                     Counter;
+  UINTN                    Delay;
   IPMI_CLEAR_SEL_REQUEST   ClearSel;
   IPMI_CLEAR_SEL_RESPONSE  ClearSelResponse;
 
   Counter   = 0x200;
+  Delay     = BMC_ELOG_ERASE_DELAY;
   ZeroMem (&ClearSelResponse, sizeof(ClearSelResponse));
 
   while (TRUE) {
@@ -85,61 +101,52 @@ Returns:
     if (Counter == 0x0) {
       return EFI_NO_RESPONSE;
     }
+
+    //
+    // Give the BMC time to make progress, backing off while it is busy.
+    //
+    gBS->Stall (Delay);
+    Delay = MIN (Delay * 2, BMC_ELOG_ERASE_DELAY_MAX);
   }
 }
 
-EFI_STATUS
-EfiActivateBmcElog (
-  IN BOOLEAN                            *EnableElog,
-  OUT BOOLEAN                           *ElogStatus
+VOID
+EFIAPI
+GetBmcGlobalEnablesDone (
+  IN IPMI_COMMAND_REQUEST  *Request
   )
 /*++
 
 Routine Description:
 
+  Completion of the Get BMC Global Enables command. Queues the Set BMC Global
+  Enables command that turns on system event logging.
+
 Arguments:
 
-  This        - Protocol pointer
-  DataType    - indicate event log type
-  EnableElog  - Enable/Disable event log
-  ElogStatus  - return log status
+  Request     - The completed request
 
 Returns:
 
-  EFI_STATUS
+  None
 
 --*/
 {
-  EFI_STATUS                           Status;
-  UINT8                                ElogStat;
-  IPMI_SET_BMC_GLOBAL_ENABLES_REQUEST  SetBmcGlobalEnables;
-  IPMI_GET_BMC_GLOBAL_ENABLES_RESPONSE GetBmcGlobalEnables;
-  UINT8                                CompletionCode;
-
-  Status              = EFI_SUCCESS;
-  ElogStat            = 0;
-
-  Status = IpmiGetBmcGlobalEnables (&GetBmcGlobalEnables);
-  if (EFI_ERROR(Status)) {
-    return Status;
+  if (EFI_ERROR (Request->Status)) {
+    return;
   }
 
-  if (EnableElog == NULL) {
-    *ElogStatus = GetBmcGlobalEnables.GetEnables.Bits.SystemEventLogging;
-  } else {
-    if (Status == EFI_SUCCESS) {
-      if (*EnableElog) {
-        ElogStat = 1;
-      }
-
-      CopyMem (&SetBmcGlobalEnables, (UINT8 *)&GetBmcGlobalEnables + 1, sizeof(UINT8));
-      SetBmcGlobalEnables.SetEnables.Bits.SystemEventLogging = ElogStat;
-
-      Status = IpmiSetBmcGlobalEnables (&SetBmcGlobalEnables, &CompletionCode);
-    }
-  }
-
-  return Status;
+  CopyMem (&mSetBmcGlobalEnables, (UINT8 *)&mGetBmcGlobalEnables + 1, sizeof(UINT8));
+  mSetBmcGlobalEnables.SetEnables.Bits.SystemEventLogging = 1;
+
+  mSetEnablesRequest.NetFunction        = IPMI_NETFN_APP;
+  mSetEnablesRequest.Command            = IPMI_APP_SET_BMC_GLOBAL_ENABLES;
+  mSetEnablesRequest.RequestData        = &mSetBmcGlobalEnables;
+  mSetEnablesRequest.RequestDataSize    = sizeof(mSetBmcGlobalEnables);
+  mSetEnablesRequest.ResponseData       = &mSetEnablesCompletionCode;
+  mSetEnablesRequest.ResponseBufferSize = sizeof(mSetEnablesCompletionCode);
+  mSetEnablesRequest.Timeout            = BMC_ELOG_TIMEOUT;
+  IpmiQueueCommand (&mBmcElogQueue, &mSetEnablesRequest);
 }
 
 EFI_STATUS
@@ -150,6 +157,8 @@ SetElogRedirInstall (
 
 Routine Description:
 
+  Queue the commands that activate the BMC event log.
+
 Arguments:
 
   None
@@ -160,16 +169,47 @@ Returns:
 
 --*/
 {
-  BOOLEAN     EnableElog;
-  BOOLEAN     ElogStatus;
-
   //
   // Activate the Event Log (This should depend upon Setup).
   //
-  EfiActivateBmcElog (&EnableElog, &ElogStatus);
+  mGetEnablesRequest.NetFunction        = IPMI_NETFN_APP;
+  mGetEnablesRequest.Command            = IPMI_APP_GET_BMC_GLOBAL_ENABLES;
+  mGetEnablesRequest.ResponseData       = &mGetBmcGlobalEnables;
+  mGetEnablesRequest.ResponseBufferSize = sizeof(mGetBmcGlobalEnables);
+  mGetEnablesRequest.Timeout            = BMC_ELOG_TIMEOUT;
+  mGetEnablesRequest.Completion         = GetBmcGlobalEnablesDone;
+  IpmiQueueCommand (&mBmcElogQueue, &mGetEnablesRequest);
   return EFI_SUCCESS;
 }
 
+VOID
+EFIAPI
+BmcElogQueueTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+/*++
+
+Routine Description:
+
+  Advance the IPMI command queue, and stop the timer once it is empty.
+
+Arguments:
+
+  Event       - The timer event
+  Context     - Not used
+
+Returns:
+
+  None
+
+--*/
+{
+  if (IpmiRunCommandQueue (&mBmcElogQueue)) {
+    gBS->CloseEvent (Event);
+  }
+}
+
 EFI_STATUS
 EFIAPI
 InitializeBmcElogLayer (
@@ -191,46 +231,102 @@ Returns:
 
 --*/
 {
+  EFI_STATUS  Status;
+  EFI_EVENT   QueueEvent;
+
+  IpmiInitializeCommandQueue (&mBmcElogQueue);
+
   SetElogRedirInstall ();
 
   CheckIfSelIsFull ();
 
+  //
+  // Talk to the BMC from a timer event rather than holding up the dispatcher.
+  //
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  BmcElogQueueTimer,
+                  NULL,
+                  &QueueEvent
+                  );
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->SetTimer (
+                    QueueEvent,
+                    TimerPeriodic,
+                    EFI_TIMER_PERIOD_MILLISECONDS (BMC_ELOG_QUEUE_TICK)
+                    );
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (QueueEvent);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    while (!IpmiRunCommandQueue (&mBmcElogQueue)) {
+      gBS->Stall (BMC_ELOG_QUEUE_TICK * 1000);
+    }
+  }
+
   return EFI_SUCCESS;
 }
 
-EFI_STATUS
+VOID
 EFIAPI
-CheckIfSelIsFull (
-  VOID
+CheckIfSelIsFullDone (
+  IN IPMI_COMMAND_REQUEST  *Request
   )
 /*++
 
   Routine Description:
-    This function verifies the BMC SEL is full and When it is reports the error to the Error Manager.
+    Completion of the Get SEL Info command queued by CheckIfSelIsFull.
 
   Arguments:
-    None
+    Request     - The completed request
 
   Returns:
-    EFI_SUCCESS
-    EFI_DEVICE_ERROR
+    None
 
 --*/
 {
-  EFI_STATUS                  Status;
   UINT8                       SelIsFull;
-  IPMI_GET_SEL_INFO_RESPONSE  SelInfo;
 
-  Status = IpmiGetSelInfo (&SelInfo);
-  if (EFI_ERROR (Status)) {
-    return EFI_DEVICE_ERROR;
+  if (EFI_ERROR (Request->Status)) {
+    return;
   }
 
   //
   // Check the Bit7 of the OperationByte if SEL is OverFlow.
   //
-  SelIsFull = (SelInfo.OperationSupport & 0x80);
+  SelIsFull = (mSelInfo.OperationSupport & 0x80);
   DEBUG ((DEBUG_INFO, "SelIsFull - 0x%x\n", SelIsFull));
+}
+
+EFI_STATUS
+EFIAPI
+CheckIfSelIsFull (
+  VOID
+  )
+/*++
+
+  Routine Description:
+    This function verifies the BMC SEL is full and When it is reports the error to the Error Manager.
+    The check completes asynchronously in CheckIfSelIsFullDone.
+
+  Arguments:
+    None
+
+  Returns:
+    EFI_SUCCESS
+
+--*/
+{
+  mGetSelInfoRequest.NetFunction        = IPMI_NETFN_STORAGE;
+  mGetSelInfoRequest.Command            = IPMI_STORAGE_GET_SEL_INFO;
+  mGetSelInfoRequest.ResponseData       = &mSelInfo;
+  mGetSelInfoRequest.ResponseBufferSize = sizeof(mSelInfo);
+  mGetSelInfoRequest.Timeout            = BMC_ELOG_TIMEOUT;
+  mGetSelInfoRequest.Completion         = CheckIfSelIsFullDone;
+  IpmiQueueCommand (&mBmcElogQueue, &mGetSelInfoRequest);
 
   return EFI_SUCCESS;
 }
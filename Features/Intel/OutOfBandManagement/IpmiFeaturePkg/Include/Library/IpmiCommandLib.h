@@ -232,4 +232,66 @@ IpmiGetSdr (
   IN OUT UINT32                     *GetSdrResponseSize
   );
 
+//
+// Command queue (DxeIpmiCommandLib only)
+//
+// Requests are sent by IpmiRunCommandQueue (), which the caller drives, e.g.
+// from a periodic timer event. Each call sends at most one command, through
+// IpmiSubmitCommand () like the synchronous commands above, so the platform
+// IPMI transport carries out the transfer. Retry delays and deadlines are
+// counted between calls, so they do not hold up the boot flow.
+//
+typedef struct _IPMI_COMMAND_REQUEST IPMI_COMMAND_REQUEST;
+
+typedef
+VOID
+(EFIAPI *IPMI_COMMAND_COMPLETION) (
+  IN IPMI_COMMAND_REQUEST           *Request
+  );
+
+struct _IPMI_COMMAND_REQUEST {
+  LIST_ENTRY                        Link;
+  UINT8                             NetFunction;
+  UINT8                             Command;
+  VOID                              *RequestData;
+  UINT32                            RequestDataSize;
+  VOID                              *ResponseData;
+  UINT32                            ResponseBufferSize;
+  UINT32                            ResponseDataSize;   ///< Bytes returned by the BMC
+  UINT32                            Retries;            ///< Attempts left after a failure
+  UINT32                            RetryInterval;      ///< Queue steps between attempts
+  UINT64                            Timeout;            ///< [us] Time allowed from queueing to completion, 0 for no limit
+  EFI_EVENT                         Event;              ///< Signalled on completion, optional
+  IPMI_COMMAND_COMPLETION           Completion;         ///< Called on completion, optional
+  VOID                              *Context;
+  EFI_STATUS                        Status;
+  UINT32                            Delay;
+  UINT64                            Deadline;
+};
+
+typedef struct {
+  LIST_ENTRY                        Pending;
+  UINT64                            Now;                ///< [ns] Time since the queue was initialized
+  UINT64                            Counter;
+} IPMI_COMMAND_QUEUE;
+
+VOID
+EFIAPI
+IpmiInitializeCommandQueue (
+  OUT IPMI_COMMAND_QUEUE            *Queue
+  );
+
+VOID
+EFIAPI
+IpmiQueueCommand (
+  IN IPMI_COMMAND_QUEUE             *Queue,
+  IN IPMI_COMMAND_REQUEST           *Request
+  );
+
+BOOLEAN
+EFIAPI
+IpmiRunCommandQueue (
+  IN IPMI_COMMAND_QUEUE             *Queue
+  );
+
 #endif
@@ -10,108 +10,132 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
 #include <Library/IpmiCommandLib.h>
 
 #define BMC_TIMEOUT          30  // [s] How long shall BIOS wait for BMC
 #define BMC_KCS_TIMEOUT      5   // [s] Single KSC request timeout
+#define BMC_QUEUE_TICK       1   // [ms] Period of the IPMI command queue, one command per tick
+#define BMC_RETRY_INTERVAL   50  // [ticks] Delay between Get Device ID retries
 
-EFI_STATUS
-GetSelfTest (
-  VOID
+STATIC IPMI_COMMAND_QUEUE              mIpmiQueue;
+STATIC IPMI_COMMAND_REQUEST            mGetDeviceIdRequest;
+STATIC IPMI_COMMAND_REQUEST            mGetSelfTestRequest;
+STATIC IPMI_GET_DEVICE_ID_RESPONSE     mBmcInfo;
+STATIC IPMI_SELF_TEST_RESULT_RESPONSE  mTestResult;
+
+VOID
+EFIAPI
+GetSelfTestDone (
+  IN IPMI_COMMAND_REQUEST  *Request
   )
 /*++
 
 Routine Description:
 
-  Execute the Get Self Test results command to determine whether or not the BMC self tests
-  have passed
+  Completion of the Get Self Test results command, which determines whether or not the BMC
+  self tests have passed
 
 Arguments:
 
-  mIpmiInstance   - Data structure describing BMC variables and used for sending commands
-  StatusCodeValue - An array used to accumulate error codes for later reporting.
-  ErrorCount      - Counter used to keep track of error codes in StatusCodeValue
+  Request         - The completed Get Self Test results request
 
 Returns:
 
-  EFI_SUCCESS       - BMC Self test results are retrieved and saved into BmcStatus
-  EFI_DEVICE_ERROR  - BMC failed to return self test results.
+  None
 
 --*/
 {
-  EFI_STATUS                       Status;
-  IPMI_SELF_TEST_RESULT_RESPONSE   TestResult;
-
-  //
-  // Get the SELF TEST Results.
-  //
-  Status = IpmiGetSelfTestResult (&TestResult);
-  if (EFI_ERROR(Status)) {
-    DEBUG((DEBUG_ERROR, "\n[IPMI] BMC does not respond (status: %r)!\n\n", Status));
-    return Status;
+  if (EFI_ERROR(Request->Status)) {
+    DEBUG((DEBUG_ERROR, "\n[IPMI] BMC does not respond (status: %r)!\n\n", Request->Status));
+    return;
   }
 
-  DEBUG((DEBUG_INFO, "[IPMI] BMC self-test result: %02X-%02X\n", TestResult.Result, TestResult.Param));
-
-  return EFI_SUCCESS;
+  DEBUG((DEBUG_INFO, "[IPMI] BMC self-test result: %02X-%02X\n", mTestResult.Result, mTestResult.Param));
 }
 
-EFI_STATUS
-GetDeviceId (
-  OUT BOOLEAN *UpdateMode
+VOID
+EFIAPI
+GetDeviceIdDone (
+  IN IPMI_COMMAND_REQUEST  *Request
   )
 /*++
 
 Routine Description:
-  Execute the Get Device ID command to determine whether or not the BMC is in Force Update
-  Mode.  If it is, then report it to the error manager.
+  Completion of the Get Device ID command, which determines whether or not the BMC is in
+  Force Update Mode. If it is not, queue the Get Self Test results command.
 
 Arguments:
+  Request         - The completed Get Device ID request
 
 Returns:
-  Status
+  None
 
 --*/
 {
-  EFI_STATUS                   Status;
-  IPMI_GET_DEVICE_ID_RESPONSE  BmcInfo;
-  UINT32                       Retries;
+  if (EFI_ERROR(Request->Status)) {
+    DEBUG ((DEBUG_ERROR, "[IPMI] BMC does not respond (status: %r)\n", Request->Status));
+    return;
+  }
+
+  DEBUG((
+    DEBUG_INFO,
+    "[IPMI] BMC Device ID: 0x%02X, firmware version: %d.%02X\n",
+    mBmcInfo.DeviceId,
+    mBmcInfo.FirmwareRev1.Bits.MajorFirmwareRev,
+    mBmcInfo.MinorFirmwareRev
+    ));
 
   //
-  // Set up a loop to retry for up to 30 seconds. Calculate retries not timeout
-  // so that in case KCS is not enabled and EfiIpmiSendCommand() returns
-  // immediately we will not wait all the 30 seconds.
+  // Do not continue initialization if the BMC is in Force Update Mode.
   //
-  Retries = BMC_TIMEOUT / BMC_KCS_TIMEOUT + 1;
+  if (mBmcInfo.FirmwareRev1.Bits.UpdateMode) {
+    return;
+  }
+
   //
-  // Get the device ID information for the BMC.
+  // Get the SELF TEST Results.
   //
-  do {
-    Status = IpmiGetDeviceId (&BmcInfo);
-    if (!EFI_ERROR(Status)) {
-      break;
-    }
-    DEBUG ((DEBUG_ERROR, "[IPMI] BMC does not respond (status: %r), %d retries left\n", Status, Retries));
-    MicroSecondDelay(50 * 1000);
-    if (Retries-- == 0) {
-      return Status;
-    }
-  } while (TRUE);
+  mGetSelfTestRequest.NetFunction        = IPMI_NETFN_APP;
+  mGetSelfTestRequest.Command            = IPMI_APP_GET_SELFTEST_RESULTS;
+  mGetSelfTestRequest.ResponseData       = &mTestResult;
+  mGetSelfTestRequest.ResponseBufferSize = sizeof (mTestResult);
+  mGetSelfTestRequest.Timeout            = BMC_KCS_TIMEOUT * 1000000;
+  mGetSelfTestRequest.Completion         = GetSelfTestDone;
+  IpmiQueueCommand (&mIpmiQueue, &mGetSelfTestRequest);
+}
 
-  DEBUG((
-    DEBUG_INFO,
-    "[IPMI] BMC Device ID: 0x%02X, firmware version: %d.%02X\n",
-    BmcInfo.DeviceId,
-    BmcInfo.FirmwareRev1.Bits.MajorFirmwareRev,
-    BmcInfo.MinorFirmwareRev
-    ));
-  *UpdateMode = (BOOLEAN)BmcInfo.FirmwareRev1.Bits.UpdateMode;
-  return Status;
+VOID
+EFIAPI
+IpmiQueueTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+/*++
+
+Routine Description:
+  Advance the IPMI command queue, and stop the timer once it is empty.
+
+Arguments:
+  Event           - The timer event
+  Context         - Not used
+
+Returns:
+  None
+
+--*/
+{
+  if (IpmiRunCommandQueue (&mIpmiQueue)) {
+    gBS->CloseEvent (Event);
+  }
 }
 
 /**
   The entry point of the Ipmi DXE.
 
+  BMC discovery runs from a timer event, so the rest of DXE does not wait
+  for the BMC to respond.
+
 @param[in] ImageHandle - Handle of this driver image
 @param[in] SystemTable - Table containing standard EFI services
 
@@ -125,26 +149,54 @@ IpmiInterfaceInit (
   IN EFI_SYSTEM_TABLE       *SystemTable
   )
 {
-  BOOLEAN      UpdateMode;
   EFI_STATUS   Status;
+  EFI_EVENT    QueueEvent;
 
   DEBUG((DEBUG_ERROR,"IPMI Dxe:Get BMC Device Id\n"));
 
+  IpmiInitializeCommandQueue (&mIpmiQueue);
+
   //
   // Get the Device ID and check if the system is in Force Update mode.
   //
-  Status = GetDeviceId (&UpdateMode);
-  //
-  // Do not continue initialization if the BMC is in Force Update Mode.
+  // Wait for up to 30 seconds, retrying a command that fails every 50 ms.
   //
-  if (!EFI_ERROR(Status) && !UpdateMode) {
+  mGetDeviceIdRequest.NetFunction        = IPMI_NETFN_APP;
+  mGetDeviceIdRequest.Command            = IPMI_APP_GET_DEVICE_ID;
+  mGetDeviceIdRequest.ResponseData       = &mBmcInfo;
+  mGetDeviceIdRequest.ResponseBufferSize = sizeof (mBmcInfo);
+  mGetDeviceIdRequest.Retries            = BMC_TIMEOUT / BMC_KCS_TIMEOUT + 1;
+  mGetDeviceIdRequest.RetryInterval      = BMC_RETRY_INTERVAL;
+  mGetDeviceIdRequest.Timeout            = BMC_TIMEOUT * 1000000;
+  mGetDeviceIdRequest.Completion         = GetDeviceIdDone;
+  IpmiQueueCommand (&mIpmiQueue, &mGetDeviceIdRequest);
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  IpmiQueueTimer,
+                  NULL,
+                  &QueueEvent
+                  );
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->SetTimer (
+                    QueueEvent,
+                    TimerPeriodic,
+                    EFI_TIMER_PERIOD_MILLISECONDS (BMC_QUEUE_TICK)
+                    );
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (QueueEvent);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
     //
-    // Get the SELF TEST Results.
+    // No timer, drain the queue here.
     //
-    GetSelfTest ();
+    while (!IpmiRunCommandQueue (&mIpmiQueue)) {
+      MicroSecondDelay (BMC_QUEUE_TICK * 1000);
+    }
   }
 
   return EFI_SUCCESS;
 }
-
-
@@ -0,0 +1,75 @@
+/** @file
+  IPMI Command - command submission for the DXE instance of the library.
+
+  Commands of the queue are sent from timer events, so they could otherwise
+  interrupt a synchronous command half way through its transfer, or be
+  interrupted by one sent from a higher TPL. Every command is therefore sent
+  at IPMI_SUBMIT_TPL, where none of them can interrupt another. IPMI
+  transports already have to work at that TPL, as commands are sent from
+  TPL_NOTIFY handlers, e.g. the FRB-2 and OS watchdog ones.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/IpmiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "IpmiCommandLibInternal.h"
+
+#define IPMI_SUBMIT_TPL  TPL_NOTIFY
+
+/**
+  Send a command to the BMC and wait for its response.
+
+  A command that is in progress, queued or not, always completes before this
+  one starts, and no other command starts before this one has completed.
+
+  @param[in]      NetFunction       Net function of the command.
+  @param[in]      Command           IPMI command number.
+  @param[in]      RequestData       Command request buffer.
+  @param[in]      RequestDataSize   Size of the command request buffer.
+  @param[out]     ResponseData      Command response buffer.
+  @param[in, out] ResponseDataSize  Size of the command response buffer.
+
+  @return Status returned by IpmiSubmitCommand ().
+**/
+EFI_STATUS
+IpmiCommandLibSubmit (
+  IN     UINT8                      NetFunction,
+  IN     UINT8                      Command,
+  IN     UINT8                      *RequestData,
+  IN     UINT32                     RequestDataSize,
+     OUT UINT8                      *ResponseData,
+  IN OUT UINT32                     *ResponseDataSize
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_TPL                           Tpl;
+
+  //
+  // Only raise the TPL, callers above IPMI_SUBMIT_TPL cannot be interrupted
+  // by a queue anyway.
+  //
+  Tpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (Tpl);
+  if (Tpl < IPMI_SUBMIT_TPL) {
+    gBS->RaiseTPL (IPMI_SUBMIT_TPL);
+  }
+
+  Status = IpmiSubmitCommand (
+             NetFunction,
+             Command,
+             RequestData,
+             RequestDataSize,
+             ResponseData,
+             ResponseDataSize
+             );
+
+  if (Tpl < IPMI_SUBMIT_TPL) {
+    gBS->RestoreTPL (Tpl);
+  }
+  return Status;
+}
@@ -0,0 +1,37 @@
+/** @file
+  IPMI Command Library internal definitions.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _IPMI_COMMAND_LIB_INTERNAL_H_
+#define _IPMI_COMMAND_LIB_INTERNAL_H_
+
+#include <Library/IpmiCommandLib.h>
+
+/**
+  Send a command to the BMC and wait for its response. The DXE instance keeps
+  it from interleaving with any other command on the BMC interface.
+
+  @param[in]      NetFunction       Net function of the command.
+  @param[in]      Command           IPMI command number.
+  @param[in]      RequestData       Command request buffer.
+  @param[in]      RequestDataSize   Size of the command request buffer.
+  @param[out]     ResponseData      Command response buffer.
+  @param[in, out] ResponseDataSize  Size of the command response buffer.
+
+  @return Status returned by IpmiSubmitCommand ().
+**/
+EFI_STATUS
+IpmiCommandLibSubmit (
+  IN     UINT8                      NetFunction,
+  IN     UINT8                      Command,
+  IN     UINT8                      *RequestData,
+  IN     UINT32                     RequestDataSize,
+     OUT UINT8                      *ResponseData,
+  IN OUT UINT32                     *ResponseDataSize
+  );
+
+#endif
@@ -0,0 +1,226 @@
+/** @file
+  IPMI Command - asynchronous command queue.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#include "IpmiCommandLibInternal.h"
+
+#define IPMI_COMMAND_REQUEST_FROM_LINK(a) \
+  BASE_CR (a, IPMI_COMMAND_REQUEST, Link)
+
+/**
+  Bring the time of a queue up to date.
+
+  The performance counter may wrap, so only the time since the previous update
+  is taken from it. Queues are stepped much more often than the counter wraps.
+
+  @param[in, out] Queue  The queue.
+**/
+STATIC
+VOID
+UpdateQueueTime (
+  IN OUT IPMI_COMMAND_QUEUE *Queue
+  )
+{
+  UINT64                    Counter;
+  UINT64                    Start;
+  UINT64                    End;
+  UINT64                    Delta;
+
+  Counter = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&Start, &End);
+  if (Start < End) {
+    if (Counter >= Queue->Counter) {
+      Delta = Counter - Queue->Counter;
+    } else {
+      Delta = (End - Queue->Counter) + (Counter - Start);
+    }
+  } else {
+    if (Counter <= Queue->Counter) {
+      Delta = Queue->Counter - Counter;
+    } else {
+      Delta = (Queue->Counter - End) + (Start - Counter);
+    }
+  }
+  Queue->Counter = Counter;
+  Queue->Now    += GetTimeInNanoSecond (Delta);
+}
+
+/**
+  Hand a request that leaves the queue back to its owner.
+
+  @param[in] Request  The request, with its final Status.
+**/
+STATIC
+VOID
+CompleteRequest (
+  IN IPMI_COMMAND_REQUEST   *Request
+  )
+{
+  if (EFI_ERROR (Request->Status)) {
+    DEBUG ((
+      DEBUG_INFO,
+      "[IPMI] NetFn 0x%02x Cmd 0x%02x failed (status: %r)\n",
+      Request->NetFunction,
+      Request->Command,
+      Request->Status
+      ));
+  }
+  if (Request->Event != NULL) {
+    gBS->SignalEvent (Request->Event);
+  }
+  if (Request->Completion != NULL) {
+    Request->Completion (Request);
+  }
+}
+
+/**
+  Initialize an empty IPMI command queue.
+
+  @param[out] Queue  The queue to initialize.
+**/
+VOID
+EFIAPI
+IpmiInitializeCommandQueue (
+  OUT IPMI_COMMAND_QUEUE    *Queue
+  )
+{
+  InitializeListHead (&Queue->Pending);
+  Queue->Now     = 0;
+  Queue->Counter = GetPerformanceCounter ();
+}
+
+/**
+  Append a request to an IPMI command queue.
+
+  The request is issued by later IpmiRunCommandQueue () calls, and must stay
+  valid until it has completed. Its deadline starts now.
+
+  @param[in] Queue    The queue.
+  @param[in] Request  The request to issue.
+**/
+VOID
+EFIAPI
+IpmiQueueCommand (
+  IN IPMI_COMMAND_QUEUE     *Queue,
+  IN IPMI_COMMAND_REQUEST   *Request
+  )
+{
+  ASSERT (Request->ResponseData != NULL || Request->ResponseBufferSize == 0);
+  ASSERT (Request->RequestData != NULL || Request->RequestDataSize == 0);
+
+  UpdateQueueTime (Queue);
+
+  Request->Delay            = 0;
+  Request->Deadline         = (Request->Timeout == 0) ? MAX_UINT64 : Queue->Now + MultU64x32 (Request->Timeout, 1000);
+  Request->ResponseDataSize = 0;
+  Request->Status           = EFI_NOT_READY;
+  InsertTailList (&Queue->Pending, &Request->Link);
+}
+
+/**
+  Advance an IPMI command queue by one step.
+
+  Sends the first request that is not waiting for a retry, if any, through
+  IpmiSubmitCommand (). No other state is kept between steps, so the BMC
+  interface is free for any other command as soon as this returns. A request
+  that fails is retried after RetryInterval further steps while it has
+  retries left. A request that completes, runs out of retries or passes its
+  deadline leaves the queue, its Event is signalled and its Completion routine
+  is called, which may queue follow-up requests.
+
+  @param[in] Queue  The queue.
+
+  @retval TRUE   The queue is empty.
+  @retval FALSE  Requests are still pending.
+**/
+BOOLEAN
+EFIAPI
+IpmiRunCommandQueue (
+  IN IPMI_COMMAND_QUEUE     *Queue
+  )
+{
+  LIST_ENTRY                *Link;
+  LIST_ENTRY                *NextLink;
+  IPMI_COMMAND_REQUEST      *Request;
+  UINT32                    ResponseDataSize;
+  EFI_STATUS                Status;
+
+  UpdateQueueTime (Queue);
+
+  //
+  // Expire waiting requests and count down their retry delays.
+  //
+  for (Link = GetFirstNode (&Queue->Pending);
+       !IsNull (&Queue->Pending, Link);
+       Link = NextLink) {
+    NextLink = GetNextNode (&Queue->Pending, Link);
+    Request  = IPMI_COMMAND_REQUEST_FROM_LINK (Link);
+    if (Queue->Now >= Request->Deadline) {
+      RemoveEntryList (&Request->Link);
+      Request->Status = EFI_TIMEOUT;
+      CompleteRequest (Request);
+    } else if (Request->Delay > 0) {
+      Request->Delay--;
+    }
+  }
+
+  Request = NULL;
+  for (Link = GetFirstNode (&Queue->Pending);
+       !IsNull (&Queue->Pending, Link);
+       Link = GetNextNode (&Queue->Pending, Link)) {
+    if (IPMI_COMMAND_REQUEST_FROM_LINK (Link)->Delay == 0) {
+      Request = IPMI_COMMAND_REQUEST_FROM_LINK (Link);
+      break;
+    }
+  }
+  if (Request == NULL) {
+    return (BOOLEAN)(IsListEmpty (&Queue->Pending));
+  }
+  RemoveEntryList (&Request->Link);
+
+  ResponseDataSize = Request->ResponseBufferSize;
+  Status = IpmiCommandLibSubmit (
+             Request->NetFunction,
+             Request->Command,
+             Request->RequestData,
+             Request->RequestDataSize,
+             Request->ResponseData,
+             &ResponseDataSize
+             );
+  Request->ResponseDataSize = ResponseDataSize;
+  Request->Status           = Status;
+
+  //
+  // A response that did not fit will not fit next time either.
+  //
+  if (EFI_ERROR (Status) && Status != EFI_BUFFER_TOO_SMALL && Request->Retries > 0) {
+    DEBUG ((
+      DEBUG_INFO,
+      "[IPMI] NetFn 0x%02x Cmd 0x%02x failed (status: %r), %d retries left\n",
+      Request->NetFunction,
+      Request->Command,
+      Status,
+      Request->Retries
+      ));
+    //
+    // Requeue at the tail so that other ready requests get their turn.
+    //
+    Request->Retries--;
+    Request->Delay = Request->RetryInterval;
+    InsertTailList (&Queue->Pending, &Request->Link);
+  } else {
+    CompleteRequest (Request);
+  }
+
+  return (BOOLEAN)(IsListEmpty (&Queue->Pending));
+}
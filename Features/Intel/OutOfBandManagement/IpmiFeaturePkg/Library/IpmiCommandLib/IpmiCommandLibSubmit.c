@@ -0,0 +1,46 @@
+/** @file
+  IPMI Command - command submission without a transport lock.
+
+  PEI has no queued transfers, so commands go straight to IpmiLib.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+#include <Library/IpmiLib.h>
+
+#include "IpmiCommandLibInternal.h"
+
+/**
+  Send a command to the BMC and wait for its response.
+
+  @param[in]      NetFunction       Net function of the command.
+  @param[in]      Command           IPMI command number.
+  @param[in]      RequestData       Command request buffer.
+  @param[in]      RequestDataSize   Size of the command request buffer.
+  @param[out]     ResponseData      Command response buffer.
+  @param[in, out] ResponseDataSize  Size of the command response buffer.
+
+  @return Status returned by IpmiSubmitCommand ().
+**/
+EFI_STATUS
+IpmiCommandLibSubmit (
+  IN     UINT8                      NetFunction,
+  IN     UINT8                      Command,
+  IN     UINT8                      *RequestData,
+  IN     UINT32                     RequestDataSize,
+     OUT UINT8                      *ResponseData,
+  IN OUT UINT32                     *ResponseDataSize
+  )
+{
+  return IpmiSubmitCommand (
+           NetFunction,
+           Command,
+           RequestData,
+           RequestDataSize,
+           ResponseData,
+           ResponseDataSize
+           );
+}
@@ -0,0 +1,440 @@
+/** @file
+  Unit tests of the IPMI command queue of DxeIpmiCommandLib.
+
+  MockIpmiLib takes the place of the IPMI transport, and a simulated BMC
+  answers the commands. It notes the order of the commands, the TPL they are
+  sent at, and any command that starts while another one is in progress.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IpmiCommandLib.h>
+#include <Library/MockIpmiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME      "IPMI Command Queue Unit Tests"
+#define UNIT_TEST_APP_VERSION   "1.0"
+
+#define TEST_REQUEST_COUNT      20
+#define TEST_QUEUE_TICK         1         // [ms] Period of the queue timer
+#define TEST_QUEUE_LIMIT        5000000   // [us] Time allowed to drain a queue from its timer
+#define TEST_STEP_LIMIT         10000     // Steps allowed to drain a queue inline
+
+typedef struct {
+  UINT32                        Submits;
+  UINT32                        FailuresLeft;   ///< Commands that fail before the BMC answers, MAX_UINT32 for all
+  EFI_STATUS                    FailStatus;
+  UINTN                         Busy;           ///< [us] Time each command takes
+  BOOLEAN                       InFlight;
+  UINT32                        Overlaps;       ///< Commands started while another one was in progress
+  EFI_TPL                       LowestTpl;
+  UINT8                         Commands[TEST_REQUEST_COUNT];
+} TEST_BMC;
+
+TEST_BMC                        mBmc;
+IPMI_COMMAND_QUEUE              mQueue;
+IPMI_COMMAND_REQUEST            mRequests[TEST_REQUEST_COUNT];
+UINT8                           mResponses[TEST_REQUEST_COUNT][sizeof (IPMI_GET_DEVICE_ID_RESPONSE)];
+UINT32                          mCompletions;
+BOOLEAN                         mQueueDrained;
+
+/**
+  Get the current TPL.
+**/
+EFI_TPL
+GetCurrentTpl (
+  VOID
+  )
+{
+  EFI_TPL                       Tpl;
+
+  Tpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (Tpl);
+  return Tpl;
+}
+
+/**
+  Answer a command in place of the BMC. Every response is the normal
+  completion code followed by zeroes.
+**/
+EFI_STATUS
+EFIAPI
+TestBmcRespond (
+  IN     VOID                   *Context,
+  IN     UINT8                  NetFunction,
+  IN     UINT8                  Command,
+  IN     UINT8                  *RequestData,
+  IN     UINT32                 RequestDataSize,
+     OUT UINT8                  *ResponseData,
+  IN OUT UINT32                 *ResponseDataSize
+  )
+{
+  TEST_BMC                      *Bmc;
+  EFI_STATUS                    Status;
+
+  Bmc            = (TEST_BMC *) Context;
+  Bmc->LowestTpl = MIN (Bmc->LowestTpl, GetCurrentTpl ());
+  if (Bmc->InFlight) {
+    Bmc->Overlaps++;
+  }
+  Bmc->InFlight = TRUE;
+
+  if (Bmc->Busy > 0) {
+    gBS->Stall (Bmc->Busy);
+  }
+  if (Bmc->Submits < TEST_REQUEST_COUNT) {
+    Bmc->Commands[Bmc->Submits] = Command;
+  }
+  Bmc->Submits++;
+
+  if (Bmc->FailuresLeft > 0) {
+    if (Bmc->FailuresLeft != MAX_UINT32) {
+      Bmc->FailuresLeft--;
+    }
+    Status = Bmc->FailStatus;
+  } else {
+    ZeroMem (ResponseData, *ResponseDataSize);
+    if (*ResponseDataSize > 0) {
+      ResponseData[0] = IPMI_COMP_CODE_NORMAL;
+    }
+    Status = EFI_SUCCESS;
+  }
+
+  Bmc->InFlight = FALSE;
+  return Status;
+}
+
+/**
+  Count the completion of a request.
+**/
+VOID
+EFIAPI
+CountCompletion (
+  IN IPMI_COMMAND_REQUEST       *Request
+  )
+{
+  mCompletions++;
+}
+
+/**
+  Queue Get Self Test results once Get Device ID has completed.
+**/
+VOID
+EFIAPI
+QueueSelfTest (
+  IN IPMI_COMMAND_REQUEST       *Request
+  )
+{
+  mCompletions++;
+  IpmiQueueCommand (&mQueue, &mRequests[1]);
+}
+
+/**
+  Set up a request for a command without request data.
+**/
+VOID
+InitRequest (
+  IN UINTN                      Index,
+  IN UINT8                      NetFunction,
+  IN UINT8                      Command
+  )
+{
+  ZeroMem (&mRequests[Index], sizeof (mRequests[Index]));
+  mRequests[Index].NetFunction        = NetFunction;
+  mRequests[Index].Command            = Command;
+  mRequests[Index].ResponseData       = mResponses[Index];
+  mRequests[Index].ResponseBufferSize = sizeof (mResponses[Index]);
+  mRequests[Index].Completion         = CountCompletion;
+}
+
+/**
+  Drain the queue inline, waiting StepTime between steps.
+
+  @return The number of steps it took, TEST_STEP_LIMIT if it did not drain.
+**/
+UINT32
+RunQueue (
+  IN UINTN                      StepTime
+  )
+{
+  UINT32                        Steps;
+
+  for (Steps = 1; Steps < TEST_STEP_LIMIT; Steps++) {
+    if (IpmiRunCommandQueue (&mQueue)) {
+      break;
+    }
+    if (StepTime > 0) {
+      gBS->Stall (StepTime);
+    }
+  }
+  return Steps;
+}
+
+VOID
+EFIAPI
+RunQueueTimer (
+  IN EFI_EVENT                  Event,
+  IN VOID                       *Context
+  )
+{
+  if (IpmiRunCommandQueue (&mQueue)) {
+    mQueueDrained = TRUE;
+  }
+}
+
+/**
+  Start every test with an empty queue and a BMC that answers right away.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetTestBmc (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  ZeroMem (&mBmc, sizeof (mBmc));
+  mBmc.LowestTpl = TPL_HIGH_LEVEL;
+  MockIpmiSetResponder (TestBmcRespond, &mBmc);
+  IpmiInitializeCommandQueue (&mQueue);
+  mCompletions  = 0;
+  mQueueDrained = FALSE;
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+QueuedCommandCompletes (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  EFI_EVENT                     Event;
+
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Event));
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  mRequests[0].Event = Event;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+
+  UT_ASSERT_EQUAL (RunQueue (0), 1);
+  UT_ASSERT_STATUS_EQUAL (mRequests[0].Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (mRequests[0].ResponseDataSize, sizeof (mResponses[0]));
+  UT_ASSERT_EQUAL (mCompletions, 1);
+  UT_ASSERT_STATUS_EQUAL (gBS->CheckEvent (Event), EFI_SUCCESS);
+  UT_ASSERT_EQUAL (mBmc.Submits, 1);
+  UT_ASSERT_TRUE (mBmc.LowestTpl >= TPL_NOTIFY);
+
+  gBS->CloseEvent (Event);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+CommandsRunInOrder (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  InitRequest (1, IPMI_NETFN_APP, IPMI_APP_GET_SELFTEST_RESULTS);
+  InitRequest (2, IPMI_NETFN_STORAGE, IPMI_STORAGE_GET_SEL_INFO);
+  mRequests[0].Completion = QueueSelfTest;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+  IpmiQueueCommand (&mQueue, &mRequests[2]);
+
+  //
+  // The follow-up queued from the completion routine goes last.
+  //
+  UT_ASSERT_EQUAL (RunQueue (0), 3);
+  UT_ASSERT_EQUAL (mCompletions, 3);
+  UT_ASSERT_EQUAL (mBmc.Submits, 3);
+  UT_ASSERT_EQUAL (mBmc.Commands[0], IPMI_APP_GET_DEVICE_ID);
+  UT_ASSERT_EQUAL (mBmc.Commands[1], IPMI_STORAGE_GET_SEL_INFO);
+  UT_ASSERT_EQUAL (mBmc.Commands[2], IPMI_APP_GET_SELFTEST_RESULTS);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+FailedCommandIsRetried (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  mBmc.FailuresLeft = 2;
+  mBmc.FailStatus   = EFI_DEVICE_ERROR;
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  mRequests[0].Retries       = 3;
+  mRequests[0].RetryInterval = 2;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+
+  //
+  // Each retry is sent RetryInterval steps after the failure.
+  //
+  UT_ASSERT_EQUAL (RunQueue (0), 1 + 2 * 2);
+  UT_ASSERT_EQUAL (mBmc.Submits, 3);
+  UT_ASSERT_STATUS_EQUAL (mRequests[0].Status, EFI_SUCCESS);
+  UT_ASSERT_EQUAL (mRequests[0].Retries, 1);
+  UT_ASSERT_EQUAL (mCompletions, 1);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RetriesRunOut (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  mBmc.FailuresLeft = MAX_UINT32;
+  mBmc.FailStatus   = EFI_DEVICE_ERROR;
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  mRequests[0].Retries = 2;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+
+  UT_ASSERT_EQUAL (RunQueue (0), 3);
+  UT_ASSERT_EQUAL (mBmc.Submits, 3);
+  UT_ASSERT_STATUS_EQUAL (mRequests[0].Status, EFI_DEVICE_ERROR);
+  UT_ASSERT_EQUAL (mCompletions, 1);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ShortBufferIsNotRetried (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  mBmc.FailuresLeft = MAX_UINT32;
+  mBmc.FailStatus   = EFI_BUFFER_TOO_SMALL;
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  mRequests[0].Retries = 3;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+
+  UT_ASSERT_EQUAL (RunQueue (0), 1);
+  UT_ASSERT_EQUAL (mBmc.Submits, 1);
+  UT_ASSERT_STATUS_EQUAL (mRequests[0].Status, EFI_BUFFER_TOO_SMALL);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+DeadlineEndsRetries (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  mBmc.FailuresLeft = MAX_UINT32;
+  mBmc.FailStatus   = EFI_DEVICE_ERROR;
+  InitRequest (0, IPMI_NETFN_APP, IPMI_APP_GET_DEVICE_ID);
+  mRequests[0].Retries = MAX_UINT32;
+  mRequests[0].Timeout = 10000;
+  IpmiQueueCommand (&mQueue, &mRequests[0]);
+
+  //
+  // 1 ms steps, the 10 ms deadline ends the request well before the limit.
+  //
+  UT_ASSERT_TRUE (RunQueue (1000) < 100);
+  UT_ASSERT_STATUS_EQUAL (mRequests[0].Status, EFI_TIMEOUT);
+  UT_ASSERT_TRUE (mBmc.Submits >= 1);
+  UT_ASSERT_EQUAL (mCompletions, 1);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Send synchronous commands while the queue runs from a timer, first from
+  TPL_NOTIFY, like the FRB-2 and OS watchdog drivers, then from
+  TPL_APPLICATION. None of them may fail, and no command may start while
+  another one is in progress.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SynchronousCommandsShareTheBmc (
+  IN UNIT_TEST_CONTEXT          Context
+  )
+{
+  EFI_EVENT                     Timer;
+  EFI_TPL                       Tpl;
+  IPMI_GET_DEVICE_ID_RESPONSE   DeviceId;
+  UINT32                        Index;
+  UINT32                        SyncCommands;
+  UINTN                         Waited;
+
+  mBmc.Busy = 500;
+  for (Index = 0; Index < TEST_REQUEST_COUNT; Index++) {
+    InitRequest (Index, IPMI_NETFN_APP, IPMI_APP_GET_SELFTEST_RESULTS);
+    IpmiQueueCommand (&mQueue, &mRequests[Index]);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, RunQueueTimer, NULL, &Timer));
+  UT_ASSERT_NOT_EFI_ERROR (gBS->SetTimer (Timer, TimerPeriodic, EFI_TIMER_PERIOD_MILLISECONDS (TEST_QUEUE_TICK)));
+
+  //
+  // Let the queue start before sending from TPL_NOTIFY.
+  //
+  for (Waited = 0; mCompletions == 0 && Waited < TEST_QUEUE_LIMIT; Waited += 100) {
+    gBS->Stall (100);
+  }
+  Tpl = gBS->RaiseTPL (TPL_NOTIFY);
+  UT_ASSERT_STATUS_EQUAL (IpmiGetDeviceId (&DeviceId), EFI_SUCCESS);
+  gBS->RestoreTPL (Tpl);
+
+  SyncCommands = 0;
+  for (Waited = 0; !mQueueDrained && Waited < TEST_QUEUE_LIMIT; Waited += 100) {
+    UT_ASSERT_STATUS_EQUAL (IpmiGetDeviceId (&DeviceId), EFI_SUCCESS);
+    SyncCommands++;
+    gBS->Stall (100);
+  }
+  gBS->CloseEvent (Timer);
+
+  UT_ASSERT_TRUE (mQueueDrained);
+  UT_ASSERT_EQUAL (mCompletions, TEST_REQUEST_COUNT);
+  for (Index = 0; Index < TEST_REQUEST_COUNT; Index++) {
+    UT_ASSERT_STATUS_EQUAL (mRequests[Index].Status, EFI_SUCCESS);
+  }
+  UT_ASSERT_TRUE (SyncCommands > 0);
+  UT_ASSERT_EQUAL (mBmc.Overlaps, 0);
+  UT_ASSERT_TRUE (mBmc.LowestTpl >= TPL_NOTIFY);
+  return UNIT_TEST_PASSED;
+}
+
+EFI_STATUS
+EFIAPI
+IpmiCommandQueueUnitTestEntrypoint (
+  IN EFI_HANDLE                 ImageHandle,
+  IN EFI_SYSTEM_TABLE           *SystemTable
+  )
+{
+  EFI_STATUS                    Status;
+  UNIT_TEST_FRAMEWORK_HANDLE    Framework;
+  UNIT_TEST_SUITE_HANDLE        Suite;
+
+  Framework = NULL;
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  Status = CreateUnitTestSuite (&Suite, Framework, "IPMI Command Queue", "IpmiFeaturePkg.IpmiCommandLib.Queue", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  AddTestCase (Suite, "Queued command completes", "Complete", QueuedCommandCompletes, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Commands run in queue order", "Order", CommandsRunInOrder, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Failed command is retried after its interval", "Retry", FailedCommandIsRetried, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Retries run out", "RetriesRunOut", RetriesRunOut, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Short response buffer is not retried", "ShortBuffer", ShortBufferIsNotRetried, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Deadline ends retries", "Deadline", DeadlineEndsRetries, ResetTestBmc, NULL, NULL);
+  AddTestCase (Suite, "Synchronous commands share the BMC with the queue", "Shared", SynchronousCommandsShareTheBmc, ResetTestBmc, NULL, NULL);
+
+  Status = RunAllTestSuites (Framework);
+
+Done:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+  MockIpmiSetResponder (NULL, NULL);
+  return Status;
+}
@@ -0,0 +1,53 @@
+/** @file
+  IpmiLib instance for unit tests, which hands every command to a responder
+  that the test installs in place of a BMC.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MOCK_IPMI_LIB_H_
+#define _MOCK_IPMI_LIB_H_
+
+#include <Library/IpmiLib.h>
+
+/**
+  Answer an IPMI command in place of the BMC.
+
+  @param[in]      Context           The context passed to MockIpmiSetResponder ().
+  @param[in]      NetFunction       Net function of the command.
+  @param[in]      Command           IPMI command number.
+  @param[in]      RequestData       Command request buffer.
+  @param[in]      RequestDataSize   Size of the command request buffer.
+  @param[out]     ResponseData      Command response buffer.
+  @param[in, out] ResponseDataSize  Size of the command response buffer.
+
+  @return The status IpmiSubmitCommand () returns.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MOCK_IPMI_RESPONDER) (
+  IN     VOID                       *Context,
+  IN     UINT8                      NetFunction,
+  IN     UINT8                      Command,
+  IN     UINT8                      *RequestData,
+  IN     UINT32                     RequestDataSize,
+     OUT UINT8                      *ResponseData,
+  IN OUT UINT32                     *ResponseDataSize
+  );
+
+/**
+  Install the responder that answers IpmiSubmitCommand ().
+
+  @param[in] Responder  The responder, NULL to fail every command.
+  @param[in] Context    Passed to the responder.
+**/
+VOID
+EFIAPI
+MockIpmiSetResponder (
+  IN MOCK_IPMI_RESPONDER            Responder,
+  IN VOID                           *Context
+  );
+
+#endif
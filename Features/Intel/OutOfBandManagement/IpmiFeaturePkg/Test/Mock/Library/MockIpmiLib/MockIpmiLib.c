@@ -0,0 +1,70 @@
+/** @file
+  IpmiLib instance for unit tests, which hands every command to a responder
+  that the test installs in place of a BMC.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/MockIpmiLib.h>
+
+STATIC MOCK_IPMI_RESPONDER  mResponder;
+STATIC VOID                 *mResponderContext;
+
+/**
+  Install the responder that answers IpmiSubmitCommand ().
+
+  @param[in] Responder  The responder, NULL to fail every command.
+  @param[in] Context    Passed to the responder.
+**/
+VOID
+EFIAPI
+MockIpmiSetResponder (
+  IN MOCK_IPMI_RESPONDER            Responder,
+  IN VOID                           *Context
+  )
+{
+  mResponder        = Responder;
+  mResponderContext = Context;
+}
+
+/**
+  This service enables submitting commands via Ipmi.
+
+  @param[in]         NetFunction       Net function of the command.
+  @param[in]         Command           IPMI Command.
+  @param[in]         RequestData       Command Request Data.
+  @param[in]         RequestDataSize   Size of Command Request Data.
+  @param[out]        ResponseData      Command Response Data. The completion code is the first byte of response data.
+  @param[in, out]    ResponseDataSize  Size of Command Response Data.
+
+  @retval EFI_SUCCESS            The responder answered the command.
+  @retval EFI_NOT_FOUND          No responder is installed.
+  @retval Others                 Status returned by the responder.
+**/
+EFI_STATUS
+EFIAPI
+IpmiSubmitCommand (
+  IN     UINT8                      NetFunction,
+  IN     UINT8                      Command,
+  IN     UINT8                      *RequestData,
+  IN     UINT32                     RequestDataSize,
+     OUT UINT8                      *ResponseData,
+  IN OUT UINT32                     *ResponseDataSize
+  )
+{
+  if (mResponder == NULL) {
+    return EFI_NOT_FOUND;
+  }
+  return mResponder (
+           mResponderContext,
+           NetFunction,
+           Command,
+           RequestData,
+           RequestDataSize,
+           ResponseData,
+           ResponseDataSize
+           );
+}
@@ -62,6 +62,26 @@ EFI_CPU_ID_ORDER_MAP        mCpuApicIdOrderTable[MAX_CPU_NUM];
 UINTN                       mNumberOfCPUs = 0;
 UINTN                       mNumberOfEnabledCPUs = 0;
 
+//
+// The MADT and MCFG generated on a previous boot are kept in a variable and are
+// installed directly when the CPU topology and platform configuration did not change.
+//
+#define ACPI_TABLE_CACHE_VARIABLE_NAME  L"AcpiTableCache"
+#define ACPI_TABLE_CACHE_VERSION        2
+#define ACPI_TABLE_CACHE_TABLE_COUNT    2
+
+typedef struct {
+  UINT32   Version;
+  UINT32   Key;         // CRC32 of the inputs the cached tables are generated from
+  UINT32   TableCount;
+  UINT32   Size;        // Size of the cache including this header
+//UINT8    Tables[];    // ACPI tables, each one sized by its header Length
+} ACPI_TABLE_CACHE_HEADER;
+
+BOOLEAN                     mAcpiTableCacheKeyValid;
+UINT32                      mAcpiTableCacheKey;
+ACPI_TABLE_CACHE_HEADER     *mAcpiTableCache;
+
 // following are possible APICID Map for SKX
 static const UINT32 ApicIdMapA[] = {  //for SKUs have number of core > 16
   //it is 14 + 14 + 14 + 14 format
@@ -271,6 +291,23 @@ AppendCpuMapTableEntry (
 
 }
 
+/**
+  Get the APIC ID of the BSP.
+
+  @return  The x2APIC ID in x2APIC mode, the xAPIC ID otherwise.
+**/
+UINT32
+GetBspApicId (
+  VOID
+  )
+{
+  if(mX2ApicEnabled) {
+    return (UINT32)AsmReadMsr64(0x802);
+  } else {
+    return (*(volatile UINT32 *)(UINTN)0xFEE00020) >> 24;
+  }
+}
+
 EFI_STATUS
 SortCpuLocalApicInTable (
   VOID
@@ -341,11 +378,7 @@ SortCpuLocalApicInTable (
     DebugDisplayReOrderTable();
 
     //make sure 1st entry is BSP
-    if(mX2ApicEnabled) {
-      BspApicId = (UINT32)AsmReadMsr64(0x802);
-    } else {
-      BspApicId = (*(volatile UINT32 *)(UINTN)0xFEE00020) >> 24;
-    }
+    BspApicId = GetBspApicId ();
     DEBUG ((EFI_D_INFO, "BspApicId - 0x%x\n", BspApicId));
 
     if(mCpuApicIdOrderTable[0].ApicId != BspApicId) {
@@ -837,6 +870,44 @@ BuildAcpiTable (
   return EFI_SUCCESS;
 }
 
+/**
+  Append a generated table to the ACPI table cache.
+
+  @param[in] Table              The table which was installed.
+**/
+VOID
+AddToAcpiTableCache (
+  IN EFI_ACPI_DESCRIPTION_HEADER  *Table
+  )
+{
+  ACPI_TABLE_CACHE_HEADER  *NewCache;
+  UINTN                    OldSize;
+
+  if (!mAcpiTableCacheKeyValid) {
+    return;
+  }
+
+  OldSize = (mAcpiTableCache == NULL) ? 0 : mAcpiTableCache->Size;
+  NewCache = ReallocatePool (
+               OldSize,
+               MAX (OldSize, sizeof (ACPI_TABLE_CACHE_HEADER)) + Table->Length,
+               mAcpiTableCache
+               );
+  if (NewCache == NULL) {
+    return;
+  }
+  if (OldSize == 0) {
+    NewCache->Version    = ACPI_TABLE_CACHE_VERSION;
+    NewCache->Key        = mAcpiTableCacheKey;
+    NewCache->TableCount = 0;
+    NewCache->Size       = sizeof (ACPI_TABLE_CACHE_HEADER);
+  }
+  CopyMem ((UINT8 *) NewCache + NewCache->Size, Table, Table->Length);
+  NewCache->Size += Table->Length;
+  NewCache->TableCount++;
+  mAcpiTableCache = NewCache;
+}
+
 /**
   Build from scratch and install the MADT.
 
@@ -1118,6 +1189,9 @@ InstallMadtFromScratch (
     NewMadtTable->Header.Length,
     &TableHandle
     );
+  if (!EFI_ERROR (Status)) {
+    AddToAcpiTableCache (&NewMadtTable->Header);
+  }
 
 Done:
   //
@@ -1197,10 +1271,337 @@ InstallMcfgFromScratch (
     McfgTable->Header.Length,
     &TableHandle
     );
+  if (!EFI_ERROR (Status)) {
+    AddToAcpiTableCache (&McfgTable->Header);
+  }
+  FreePool (McfgTable);
+
+  return Status;
+}
+
+/**
+  Identify the firmware build this driver belongs to, so that a cache written by
+  another build is never used: the firmware revision and vendor from the system
+  table, and the CRC32 of this driver's PE32 section as stored in its firmware
+  volume. The latter changes whenever the table generation code or a fixed PCD
+  it was built with changes.
+
+  @param[out] Revision          The firmware revision.
+  @param[out] VendorCrc         The CRC32 of the firmware vendor string.
+  @param[out] ImageCrc          The CRC32 of this driver's PE32 section.
+
+  @retval EFI_SUCCESS           The firmware identity is returned.
+  @retval Others                This driver could not be read from its firmware volume.
+**/
+EFI_STATUS
+GetFirmwareIdentity (
+  OUT UINT32  *Revision,
+  OUT UINT32  *VendorCrc,
+  OUT UINT32  *ImageCrc
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_LOADED_IMAGE_PROTOCOL      *LoadedImage;
+  EFI_FIRMWARE_VOLUME2_PROTOCOL  *Fv;
+  VOID                           *Image;
+  UINTN                          ImageSize;
+  UINT32                         AuthenticationStatus;
+
+  *Revision  = gST->FirmwareRevision;
+  *VendorCrc = 0;
+  if (gST->FirmwareVendor != NULL) {
+    gBS->CalculateCrc32 (gST->FirmwareVendor, StrSize (gST->FirmwareVendor), VendorCrc);
+  }
+
+  Status = gBS->HandleProtocol (gImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **) &LoadedImage);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = gBS->HandleProtocol (LoadedImage->DeviceHandle, &gEfiFirmwareVolume2ProtocolGuid, (VOID **) &Fv);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Image     = NULL;
+  ImageSize = 0;
+  Status = Fv->ReadSection (
+                 Fv,
+                 &gEfiCallerIdGuid,
+                 EFI_SECTION_PE32,
+                 0,
+                 &Image,
+                 &ImageSize,
+                 &AuthenticationStatus
+                 );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gBS->CalculateCrc32 (Image, ImageSize, ImageCrc);
+  FreePool (Image);
+  return Status;
+}
+
+/**
+  Calculate the key of the ACPI table cache.
+
+  The key covers everything the MADT and MCFG are generated from: the firmware
+  build, the CPU topology reported by MP services, the BSP, the APIC related PCDs,
+  the table header fields and the PCI segments.
+
+  @param[out] Key               The CRC32 of the inputs.
+
+  @retval EFI_SUCCESS           The key is calculated.
+  @retval EFI_OUT_OF_RESOURCES  Could not allocate the key buffer.
+**/
+EFI_STATUS
+GetAcpiTableCacheKey (
+  OUT UINT32  *Key
+  )
+{
+  EFI_STATUS                                          Status;
+  EFI_ACPI_4_0_MULTIPLE_APIC_DESCRIPTION_TABLE_HEADER MadtTableHeader;
+  EFI_PROCESSOR_INFORMATION                           ProcessorInfoBuffer;
+  PCI_SEGMENT_INFO                                    *PciSegmentInfo;
+  UINTN                                               SegmentCount;
+  UINT64                                              *KeyData;
+  UINTN                                               KeyCount;
+  UINTN                                               Index;
+  UINTN                                               CurrProcessor;
+  UINTN                                               SegmentIndex;
+  UINT32                                              FirmwareRevision;
+  UINT32                                              VendorCrc;
+  UINT32                                              ImageCrc;
+
+  Status = GetFirmwareIdentity (&FirmwareRevision, &VendorCrc, &ImageCrc);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "GetFirmwareIdentity failed: %r\n", Status));
+    return Status;
+  }
+
+  Status = InitializeMadtHeader (&MadtTableHeader);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  PciSegmentInfo = GetPciSegmentInfo (&SegmentCount);
 
+  //
+  // MADT header, 18 platform values, 5 values per processor and 4 per segment
+  //
+  Index    = (sizeof (MadtTableHeader) + sizeof (UINT64) - 1) / sizeof (UINT64);
+  KeyCount = Index + 18 + mNumberOfCPUs * 5 + SegmentCount * 4;
+  KeyData = AllocateZeroPool (KeyCount * sizeof (UINT64));
+  if (KeyData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  CopyMem (KeyData, &MadtTableHeader, sizeof (MadtTableHeader));
+
+  KeyData[Index++] = ACPI_TABLE_CACHE_VERSION;
+  KeyData[Index++] = FirmwareRevision;
+  KeyData[Index++] = VendorCrc;
+  KeyData[Index++] = ImageCrc;
+  KeyData[Index++] = MAX_CPU_NUM;
+  KeyData[Index++] = mNumberOfCPUs;
+  KeyData[Index++] = mNumberOfEnabledCPUs;
+  KeyData[Index++] = mNumOfBitShift;
+  KeyData[Index++] = mX2ApicEnabled;
+  KeyData[Index++] = mForceX2ApicId;
+  KeyData[Index++] = GetBspApicId ();
+  KeyData[Index++] = PcdGet32 (PcdIoApicAddress);
+  KeyData[Index++] = PcdGet8 (PcdIoApicId);
+  KeyData[Index++] = PcdGet32 (PcdPcIoApicEnable);
+  KeyData[Index++] = PcdGet8 (PcdPcIoApicCount);
+  KeyData[Index++] = PcdGet8 (PcdPcIoApicIdBase);
+  KeyData[Index++] = PcdGet32 (PcdPcIoApicAddressBase);
+  KeyData[Index++] = SegmentCount;
+
+  for (CurrProcessor = 0; CurrProcessor < mNumberOfCPUs; CurrProcessor++) {
+    Status = mMpService->GetProcessorInfo (
+                                          mMpService,
+                                          CurrProcessor,
+                                          &ProcessorInfoBuffer
+                                          );
+    if (EFI_ERROR (Status)) {
+      FreePool (KeyData);
+      return Status;
+    }
+    KeyData[Index++] = ProcessorInfoBuffer.ProcessorId;
+    KeyData[Index++] = ProcessorInfoBuffer.StatusFlag;
+    KeyData[Index++] = ProcessorInfoBuffer.Location.Package;
+    KeyData[Index++] = ProcessorInfoBuffer.Location.Core;
+    KeyData[Index++] = ProcessorInfoBuffer.Location.Thread;
+  }
+
+  for (SegmentIndex = 0; SegmentIndex < SegmentCount; SegmentIndex++) {
+    KeyData[Index++] = PciSegmentInfo[SegmentIndex].SegmentNumber;
+    KeyData[Index++] = PciSegmentInfo[SegmentIndex].BaseAddress;
+    KeyData[Index++] = PciSegmentInfo[SegmentIndex].StartBusNumber;
+    KeyData[Index++] = PciSegmentInfo[SegmentIndex].EndBusNumber;
+  }
+  ASSERT (Index == KeyCount);
+
+  Status = gBS->CalculateCrc32 (KeyData, Index * sizeof (UINT64), Key);
+  FreePool (KeyData);
   return Status;
 }
 
+/**
+  Make the ACPI table cache read-only for the rest of this boot, once EndOfDxe
+  is signaled, so that nothing after the platform code can plant tables for the
+  next boot.
+**/
+VOID
+LockAcpiTableCache (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+  EDKII_VARIABLE_LOCK_PROTOCOL  *VariableLock;
+
+  Status = gBS->LocateProtocol (&gEdkiiVariableLockProtocolGuid, NULL, (VOID **) &VariableLock);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Status = VariableLock->RequestToLock (VariableLock, ACPI_TABLE_CACHE_VARIABLE_NAME, &gAcpiPlatformTableCacheGuid);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Lock ACPI table cache - %r\n", Status));
+  }
+}
+
+/**
+  Save the tables generated on this boot for the next one.
+**/
+VOID
+SaveAcpiTableCache (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mAcpiTableCache == NULL) {
+    return;
+  }
+
+  if (mAcpiTableCache->TableCount == ACPI_TABLE_CACHE_TABLE_COUNT) {
+    Status = gRT->SetVariable (
+                    ACPI_TABLE_CACHE_VARIABLE_NAME,
+                    &gAcpiPlatformTableCacheGuid,
+                    EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                    mAcpiTableCache->Size,
+                    mAcpiTableCache
+                    );
+    DEBUG ((DEBUG_INFO, "Save ACPI table cache (0x%x bytes) - %r\n", mAcpiTableCache->Size, Status));
+  }
+
+  FreePool (mAcpiTableCache);
+  mAcpiTableCache = NULL;
+}
+
+/**
+  Install the MADT and MCFG from the ACPI table cache.
+
+  Either all cached tables are installed or none is: if one fails to install,
+  those installed before it are uninstalled again, so that the caller can build
+  all of them from scratch.
+
+  @retval EFI_SUCCESS           The cached tables were installed.
+  @retval EFI_NOT_FOUND         There is no valid cache for the current configuration,
+                                or it could not be installed.
+**/
+EFI_STATUS
+InstallAcpiTablesFromCache (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+  ACPI_TABLE_CACHE_HEADER       *Cache;
+  UINTN                         CacheSize;
+  EFI_ACPI_DESCRIPTION_HEADER   *Table;
+  UINTN                         Offset;
+  UINTN                         Index;
+  UINTN                         TableHandle[ACPI_TABLE_CACHE_TABLE_COUNT];
+
+  Status = GetAcpiTableCacheKey (&mAcpiTableCacheKey);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "GetAcpiTableCacheKey failed: %r\n", Status));
+    return EFI_NOT_FOUND;
+  }
+  mAcpiTableCacheKeyValid = TRUE;
+
+  Status = GetVariable2 (
+             ACPI_TABLE_CACHE_VARIABLE_NAME,
+             &gAcpiPlatformTableCacheGuid,
+             (VOID **) &Cache,
+             &CacheSize
+             );
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Check the whole cache before installing any table
+  //
+  Status = EFI_SUCCESS;
+  if ((CacheSize < sizeof (ACPI_TABLE_CACHE_HEADER)) ||
+      (Cache->Version != ACPI_TABLE_CACHE_VERSION) ||
+      (Cache->Key != mAcpiTableCacheKey) ||
+      (Cache->Size != CacheSize) ||
+      (Cache->TableCount != ACPI_TABLE_CACHE_TABLE_COUNT)) {
+    Status = EFI_NOT_FOUND;
+  }
+  Offset = sizeof (ACPI_TABLE_CACHE_HEADER);
+  for (Index = 0; !EFI_ERROR (Status) && Index < Cache->TableCount; Index++) {
+    Table = (EFI_ACPI_DESCRIPTION_HEADER *) ((UINT8 *) Cache + Offset);
+    if ((Offset + sizeof (EFI_ACPI_DESCRIPTION_HEADER) > CacheSize) ||
+        (Table->Length < sizeof (EFI_ACPI_DESCRIPTION_HEADER)) ||
+        (Table->Length > CacheSize - Offset)) {
+      Status = EFI_NOT_FOUND;
+      break;
+    }
+    Offset += Table->Length;
+  }
+  if (!EFI_ERROR (Status) && (Offset != CacheSize)) {
+    Status = EFI_NOT_FOUND;
+  }
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_INFO, "ACPI table cache miss (key 0x%08x)\n", mAcpiTableCacheKey));
+    FreePool (Cache);
+    return Status;
+  }
+
+  Offset = sizeof (ACPI_TABLE_CACHE_HEADER);
+  for (Index = 0; Index < Cache->TableCount; Index++) {
+    Table = (EFI_ACPI_DESCRIPTION_HEADER *) ((UINT8 *) Cache + Offset);
+    TableHandle[Index] = 0;
+    Status = mAcpiTable->InstallAcpiTable (
+                           mAcpiTable,
+                           Table,
+                           Table->Length,
+                           &TableHandle[Index]
+                           );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "Install cached ACPI table %d failed: %r\n", Index, Status));
+      break;
+    }
+    Offset += Table->Length;
+  }
+  FreePool (Cache);
+
+  if (EFI_ERROR (Status)) {
+    //
+    // Take back the cached tables already installed, they are all rebuilt
+    //
+    while (Index-- > 0) {
+      mAcpiTable->UninstallAcpiTable (mAcpiTable, TableHandle[Index]);
+    }
+    return EFI_NOT_FOUND;
+  }
+
+  DEBUG ((DEBUG_INFO, "ACPI table cache hit (key 0x%08x)\n", mAcpiTableCacheKey));
+  return EFI_SUCCESS;
+}
+
 /**
   This function will update any runtime platform specific information.
   This currently includes:
@@ -1568,8 +1969,13 @@ InstallAcpiPlatform (
 
   UpdateLocalTable ();
 
-  InstallMadtFromScratch ();
-  InstallMcfgFromScratch ();
+  Status = InstallAcpiTablesFromCache ();
+  if (EFI_ERROR (Status)) {
+    InstallMadtFromScratch ();
+    InstallMcfgFromScratch ();
+    SaveAcpiTableCache ();
+  }
+  LockAcpiTableCache ();
 
   return EFI_SUCCESS;
 }
@@ -39,6 +39,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/AcpiTable.h>
 #include <Protocol/MpService.h>
 #include <Protocol/PciIo.h>
+#include <Protocol/LoadedImage.h>
+#include <Protocol/FirmwareVolume2.h>
+#include <Protocol/VariableLock.h>
 
 #include <Register/Cpuid.h>
 
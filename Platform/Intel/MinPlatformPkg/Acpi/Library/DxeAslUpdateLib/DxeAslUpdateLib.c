@@ -6,6 +6,12 @@
 
   This library uses the ACPI Support protocol.
 
+  The DSDT is scanned only once: the offset of every Name() object is kept in a
+  hash index keyed by its NameSeg. Updates are written straight into the installed
+  DSDT, and its checksum is adjusted by the difference of the patched bytes. Every
+  module linked with this library patches the same table, so none of them can undo
+  the updates of another, and the DSDT is up to date as soon as an update returns.
+
 Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
 SPDX-License-Identifier: BSD-2-Clause-Patent
 
@@ -13,6 +19,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Base.h>
 #include <Uefi/UefiBaseType.h>
 #include <Uefi/UefiSpec.h>
+#include <Library/BaseLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiLib.h>
@@ -27,6 +34,25 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 static EFI_ACPI_SDT_PROTOCOL      *mAcpiSdt = NULL;
 static EFI_ACPI_TABLE_PROTOCOL    *mAcpiTable = NULL;
 
+///
+/// Name index entry, an Offset of 0 marks a free slot.
+///
+typedef struct {
+  UINT32                          Signature;
+  UINT32                          Offset;
+} ASL_NAME_INDEX_ENTRY;
+
+#define ASL_NAME_INDEX_MIN_SIZE   64
+
+///
+/// The installed DSDT the name index was built from
+///
+static EFI_ACPI_DESCRIPTION_HEADER  *mDsdtTable = NULL;
+static UINTN                        mDsdtHandle = 0;
+static UINT32                       mDsdtLength = 0;
+static ASL_NAME_INDEX_ENTRY         *mNameIndex = NULL;
+static UINTN                        mNameIndexSize = 0;
+
 /**
   Initialize the ASL update library state.
   This must be called prior to invoking other library functions.
@@ -50,6 +76,196 @@ InitializeAslUpdateLib (
   return Status;
 }
 
+/**
+  Get the first index slot to probe for a NameSeg.
+
+  @param[in] Signature         - The NameSeg.
+
+  @retval The slot index.
+**/
+static
+UINTN
+AslNameIndexHash (
+  IN     UINT32                        Signature
+  )
+{
+  return (UINTN) (((Signature * 0x9E3779B1) >> 16) & (mNameIndexSize - 1));
+}
+
+/**
+  Find a NameSeg in the name index.
+
+  @param[in] Signature         - The NameSeg to look for.
+
+  @retval The offset of the NameSeg in the DSDT, or 0 if it is not found.
+**/
+static
+UINT32
+LookupAslName (
+  IN     UINT32                        Signature
+  )
+{
+  UINTN                       Slot;
+
+  if (mNameIndex == NULL) {
+    return 0;
+  }
+
+  Slot = AslNameIndexHash (Signature);
+  while (mNameIndex[Slot].Offset != 0) {
+    if (mNameIndex[Slot].Signature == Signature) {
+      return mNameIndex[Slot].Offset;
+    }
+    Slot = (Slot + 1) & (mNameIndexSize - 1);
+  }
+  return 0;
+}
+
+/**
+  Walk the AML once and record the offset of each NameSeg that follows a NameOp.
+  Only the first occurrence of a NameSeg is recorded, which is the one a byte scan
+  of the table would find.
+
+  @param[in] Table             - The DSDT.
+
+  @retval EFI_SUCCESS          - The index is built.
+  @retval EFI_OUT_OF_RESOURCES - There is not enough memory for the index.
+**/
+static
+EFI_STATUS
+BuildAslNameIndex (
+  IN     EFI_ACPI_DESCRIPTION_HEADER   *Table
+  )
+{
+  UINT8                       *Aml;
+  UINT32                      Offset;
+  UINT32                      Signature;
+  UINT32                      Count;
+  UINTN                       Slot;
+
+  if (mNameIndex != NULL) {
+    FreePool (mNameIndex);
+    mNameIndex = NULL;
+  }
+
+  ///
+  /// Size the index for a load factor of at most one half
+  ///
+  Aml   = (UINT8 *) Table;
+  Count = 0;
+  for (Offset = sizeof (EFI_ACPI_DESCRIPTION_HEADER) + 1; Offset + 5 <= Table->Length; Offset++) {
+    if (Aml[Offset - 1] == AML_NAME_OP) {
+      Count++;
+    }
+  }
+  mNameIndexSize = ASL_NAME_INDEX_MIN_SIZE;
+  while (mNameIndexSize < Count * 2) {
+    mNameIndexSize <<= 1;
+  }
+  mNameIndex = AllocateZeroPool (mNameIndexSize * sizeof (ASL_NAME_INDEX_ENTRY));
+  if (mNameIndex == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Offset = sizeof (EFI_ACPI_DESCRIPTION_HEADER) + 1; Offset + 5 <= Table->Length; Offset++) {
+    if (Aml[Offset - 1] != AML_NAME_OP) {
+      continue;
+    }
+    Signature = ReadUnaligned32 ((UINT32 *) (Aml + Offset));
+    Slot = AslNameIndexHash (Signature);
+    while (mNameIndex[Slot].Offset != 0 && mNameIndex[Slot].Signature != Signature) {
+      Slot = (Slot + 1) & (mNameIndexSize - 1);
+    }
+    if (mNameIndex[Slot].Offset == 0) {
+      mNameIndex[Slot].Signature = Signature;
+      mNameIndex[Slot].Offset    = Offset;
+    }
+  }
+
+  DEBUG ((DEBUG_INFO, "AslUpdateLib: indexed %d names in DSDT (%d bytes)\n", Count, Table->Length));
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the installed DSDT without copying it.
+
+  @param[out] Table            - Pointer to the installed table
+  @param[out] Handle           - AcpiSupport protocol table handle for the table found
+
+  @retval EFI_SUCCESS          - The function completed successfully.
+**/
+static
+EFI_STATUS
+GetInstalledDsdt (
+  OUT    EFI_ACPI_DESCRIPTION_HEADER   **Table,
+  OUT    UINTN                         *Handle
+  )
+{
+  EFI_STATUS                  Status;
+  INTN                        Index;
+  EFI_ACPI_TABLE_VERSION      Version;
+
+  Version = 0;
+  Index = 0;
+  do {
+    Status = mAcpiSdt->GetAcpiTable (Index, (EFI_ACPI_SDT_HEADER **) Table, &Version, Handle);
+    if (Status == EFI_NOT_FOUND) {
+      break;
+    }
+    ASSERT_EFI_ERROR (Status);
+    Index++;
+  } while ((*Table)->Signature != EFI_ACPI_3_0_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE);
+
+  return Status;
+}
+
+/**
+  Make sure the name index was built from the installed DSDT, and rebuild it
+  if it was not. Updates only change the values of Name() objects, so the index
+  stays valid across updates made by this or any other module, until the DSDT
+  is replaced.
+
+  @retval EFI_SUCCESS          - mDsdtTable and mNameIndex are valid.
+**/
+static
+EFI_STATUS
+SyncDsdtIndex (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_ACPI_DESCRIPTION_HEADER *Table;
+  UINTN                       Handle;
+
+  if (mAcpiSdt == NULL) {
+    InitializeAslUpdateLib ();
+    if (mAcpiSdt == NULL) {
+      return EFI_NOT_READY;
+    }
+  }
+
+  Status = GetInstalledDsdt (&Table, &Handle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((mNameIndex != NULL) &&
+      (Table == mDsdtTable) &&
+      (Handle == mDsdtHandle) &&
+      (Table->Length == mDsdtLength)) {
+    return EFI_SUCCESS;
+  }
+
+  mDsdtTable  = NULL;
+  Status = BuildAslNameIndex (Table);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  mDsdtTable  = Table;
+  mDsdtHandle = Handle;
+  mDsdtLength = Table->Length;
+  return EFI_SUCCESS;
+}
 
 /**
   This procedure will update immediate value assigned to a Name
@@ -68,12 +284,12 @@ UpdateNameAslCode (
   )
 {
   EFI_STATUS                  Status;
-  EFI_ACPI_DESCRIPTION_HEADER *Table;
-  UINT8                       *CurrPtr;
-  UINT32                      *Signature;
   UINT8                       *DsdtPointer;
-  UINTN                       Handle;
+  UINT8                       *Patch;
+  UINT32                      Offset;
   UINT8                       DataSize;
+  UINTN                       Index;
+  UINT8                       Sum;
 
   if (mAcpiTable == NULL) {
     InitializeAslUpdateLib ();
@@ -82,73 +298,50 @@ UpdateNameAslCode (
     }
   }
 
-  ///
-  /// Locate table with matching ID
-  ///
-  Handle = 0;
-  Status = LocateAcpiTableBySignature (
-             EFI_ACPI_3_0_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE,
-             (EFI_ACPI_DESCRIPTION_HEADER **) &Table,
-             &Handle
-             );
+  Status = SyncDsdtIndex ();
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
   ///
-  /// Point to the beginning of the DSDT table
+  /// Look up the Name encoding of the signature
   ///
-  CurrPtr = (UINT8 *) Table;
+  Offset = LookupAslName (AslSignature);
+  if (Offset == 0) {
+    return EFI_NOT_FOUND;
+  }
+  DsdtPointer = (UINT8 *) mDsdtTable + Offset;
 
   ///
-  /// Loop through the ASL looking for values that we must fix up.
+  /// Check if size of new and old data is the same
   ///
-  for (DsdtPointer = CurrPtr; DsdtPointer <= (CurrPtr + ((EFI_ACPI_COMMON_HEADER *) CurrPtr)->Length); DsdtPointer++) {
-    ///
-    /// Get a pointer to compare for signature
-    ///
-    Signature = (UINT32 *) DsdtPointer;
-    ///
-    /// Check if this is the Device Object signature we are looking for
-    ///
-    if ((*Signature) == AslSignature) {
-      ///
-      /// Look for Name Encoding
-      ///
-      if (*(DsdtPointer-1) == AML_NAME_OP) {
-        ///
-        /// Check if size of new and old data is the same
-        ///
-        DataSize = *(DsdtPointer+4);
-        if ((Length == 1 && DataSize == 0xA) ||
-            (Length == 2 && DataSize == 0xB) ||
-            (Length == 4 && DataSize == 0xC)) {
-          CopyMem (DsdtPointer+5, Buffer, Length);
-        } else if (Length == 1 && ((*(UINT8*) Buffer) == 0 || (*(UINT8*) Buffer) == 1) && (DataSize == 0 || DataSize == 1)) {
-          CopyMem (DsdtPointer+4, Buffer, Length);
-        } else {
-          FreePool (Table);
-          return EFI_BAD_BUFFER_SIZE;
-        }
-        Status = mAcpiTable->UninstallAcpiTable (
-                               mAcpiTable,
-                               Handle
-                               );
-        Handle = 0;
-        Status = mAcpiTable->InstallAcpiTable (
-                               mAcpiTable,
-                               Table,
-                               Table->Length,
-                               &Handle
-                               );
-        FreePool (Table);
-        return Status;
-      }
+  DataSize = *(DsdtPointer+4);
+  if ((Length == 1 && DataSize == 0xA) ||
+      (Length == 2 && DataSize == 0xB) ||
+      (Length == 4 && DataSize == 0xC)) {
+    if (Offset + 5 + Length > mDsdtTable->Length) {
+      return EFI_BAD_BUFFER_SIZE;
     }
+    Patch = DsdtPointer + 5;
+  } else if (Length == 1 && ((*(UINT8*) Buffer) == 0 || (*(UINT8*) Buffer) == 1) && (DataSize == 0 || DataSize == 1)) {
+    Patch = DsdtPointer + 4;
+  } else {
+    return EFI_BAD_BUFFER_SIZE;
   }
-  return EFI_NOT_FOUND;
-}
 
+  ///
+  /// Patch the installed table, and adjust its checksum by the difference of the
+  /// patched bytes instead of summing the whole table again.
+  ///
+  Sum = 0;
+  for (Index = 0; Index < Length; Index++) {
+    Sum = (UINT8) (Sum + ((UINT8 *) Buffer)[Index] - Patch[Index]);
+  }
+  CopyMem (Patch, Buffer, Length);
+  mDsdtTable->Checksum = (UINT8) (mDsdtTable->Checksum - Sum);
+
+  return EFI_SUCCESS;
+}
 
 /**
   This function uses the ACPI SDT protocol to locate an ACPI table.
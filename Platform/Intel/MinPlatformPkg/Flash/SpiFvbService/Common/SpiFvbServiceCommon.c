@@ -183,6 +183,36 @@ FvbGetLbaAddress (
   }
 }
 
+/**
+  Set up a write-through block cache for a FV.
+
+  Blocks are read from flash into the cache on first access. FvbWriteBlock ()
+  and FvbEraseBlock () keep the cached blocks coherent, so the cache must only
+  be enabled for a FV that is not written behind the back of this driver.
+
+  @param[in]  FvbInstance     The pointer to the EFI_FVB_INSTANCE.
+
+**/
+VOID
+FvbInitializeCache (
+  IN EFI_FVB_INSTANCE                     *FvbInstance
+  )
+{
+  FvbInstance->Cache      = AllocatePool ((UINTN) FvbInstance->FvHeader.FvLength);
+  FvbInstance->CacheValid = AllocateZeroPool (FvbInstance->NumOfBlocks * sizeof (BOOLEAN));
+  if (FvbInstance->Cache == NULL || FvbInstance->CacheValid == NULL) {
+    DEBUG ((DEBUG_WARN, "FvbInitializeCache: No cache for FV at 0x%lx\n", (UINT64) FvbInstance->FvBase));
+    if (FvbInstance->Cache != NULL) {
+      FreePool (FvbInstance->Cache);
+    }
+    if (FvbInstance->CacheValid != NULL) {
+      FreePool (FvbInstance->CacheValid);
+    }
+    FvbInstance->Cache      = NULL;
+    FvbInstance->CacheValid = NULL;
+  }
+}
+
 /**
   Reads specified number of bytes into a buffer from the specified block.
 
@@ -220,6 +250,7 @@ FvbReadBlock (
   UINTN                                   LbaAddress;
   UINTN                                   LbaLength;
   EFI_STATUS                              Status;
+  UINT32                                  CacheLength;
   BOOLEAN                                 BadBufferSize = FALSE;
 
   if ((NumBytes == NULL) || (Buffer == NULL)) {
@@ -254,7 +285,27 @@ FvbReadBlock (
     BadBufferSize = TRUE;
   }
 
-  Status = SpiFlashRead (LbaAddress + BlockOffset, (UINT32 *)NumBytes, Buffer);
+  if (FvbInstance->Cache != NULL) {
+    CacheLength = (UINT32) LbaLength;
+    Status      = EFI_SUCCESS;
+    if (!FvbInstance->CacheValid[Lba]) {
+      Status = SpiFlashRead (
+                 LbaAddress,
+                 &CacheLength,
+                 FvbInstance->Cache + (LbaAddress - FvbInstance->FvBase)
+                 );
+      if (!EFI_ERROR (Status) && CacheLength == LbaLength) {
+        FvbInstance->CacheValid[Lba] = TRUE;
+      }
+    }
+    if (FvbInstance->CacheValid[Lba]) {
+      CopyMem (Buffer, FvbInstance->Cache + (LbaAddress - FvbInstance->FvBase) + BlockOffset, *NumBytes);
+    } else {
+      Status = SpiFlashRead (LbaAddress + BlockOffset, (UINT32 *)NumBytes, Buffer);
+    }
+  } else {
+    Status = SpiFlashRead (LbaAddress + BlockOffset, (UINT32 *)NumBytes, Buffer);
+  }
 
   if (!EFI_ERROR (Status) && BadBufferSize) {
     return EFI_BAD_BUFFER_SIZE;
@@ -297,6 +348,8 @@ FvbWriteBlock (
   UINTN                                   LbaAddress;
   UINTN                                   LbaLength;
   EFI_STATUS                              Status;
+  UINT32                                  CacheLength;
+  BOOLEAN                                 CacheValid;
   BOOLEAN                                 BadBufferSize = FALSE;
 
   if ((NumBytes == NULL) || (Buffer == NULL)) {
@@ -336,6 +389,16 @@ FvbWriteBlock (
     BadBufferSize = TRUE;
   }
 
+  //
+  // Drop the cached block until the write is known to have completed, a
+  // partial write leaves the flash contents unknown.
+  //
+  CacheValid = FALSE;
+  if (FvbInstance->Cache != NULL) {
+    CacheValid = FvbInstance->CacheValid[Lba];
+    FvbInstance->CacheValid[Lba] = FALSE;
+  }
+
   Status = SpiFlashWrite (LbaAddress + BlockOffset, (UINT32 *)NumBytes, Buffer);
   if (EFI_ERROR (Status)) {
     return Status;
@@ -348,6 +411,23 @@ FvbWriteBlock (
 
   WriteBackInvalidateDataCacheRange ((VOID *) (LbaAddress + BlockOffset), *NumBytes);
 
+  //
+  // Refresh the written range from flash rather than from Buffer, as NOR
+  // programming can only clear bits.
+  //
+  if (CacheValid) {
+    CacheLength = (UINT32) *NumBytes;
+    Status = SpiFlashRead (
+               LbaAddress + BlockOffset,
+               &CacheLength,
+               FvbInstance->Cache + (LbaAddress - FvbInstance->FvBase) + BlockOffset
+               );
+    if (!EFI_ERROR (Status) && CacheLength == *NumBytes) {
+      FvbInstance->CacheValid[Lba] = TRUE;
+    }
+    Status = EFI_SUCCESS;
+  }
+
   if (!EFI_ERROR (Status) && BadBufferSize) {
     return EFI_BAD_BUFFER_SIZE;
   } else {
@@ -400,6 +480,10 @@ FvbEraseBlock (
     return Status;
   }
 
+  if (FvbInstance->Cache != NULL) {
+    FvbInstance->CacheValid[Lba] = FALSE;
+  }
+
   Status = SpiFlashBlockErase (LbaAddress, &LbaLength);
   if (EFI_ERROR (Status)) {
     return Status;
@@ -412,6 +496,15 @@ FvbEraseBlock (
 
   WriteBackInvalidateDataCacheRange ((VOID *) LbaAddress, LbaLength);
 
+  if (FvbInstance->Cache != NULL) {
+    SetMem (
+      FvbInstance->Cache + (LbaAddress - FvbInstance->FvBase),
+      LbaLength,
+      ((Attributes & EFI_FVB2_ERASE_POLARITY) != 0) ? 0xFF : 0
+      );
+    FvbInstance->CacheValid[Lba] = TRUE;
+  }
+
   return Status;
 }
 
@@ -51,6 +51,8 @@ typedef struct {
   UINTN                                 NumOfBlocks;
   EFI_DEVICE_PATH_PROTOCOL              *DevicePath;
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL    FvbProtocol;
+  UINT8                                 *Cache;       ///< Copy of the FV, NULL if not cached
+  BOOLEAN                               *CacheValid;  ///< Per LBA, TRUE if Cache holds the block
   EFI_FIRMWARE_VOLUME_HEADER            FvHeader;
 } EFI_FVB_INSTANCE;
 
@@ -145,6 +147,11 @@ IsFvHeaderValid (
   IN CONST EFI_FIRMWARE_VOLUME_HEADER    *FwVolHeader
   );
 
+VOID
+FvbInitializeCache (
+  IN EFI_FVB_INSTANCE              *FvbInstance
+  );
+
 EFI_STATUS
 GetFvbInfo (
   IN  EFI_PHYSICAL_ADDRESS         FvBaseAddress,
@@ -261,6 +261,14 @@ FvbInitialize (
         FvbInstance->NumOfBlocks += PtrBlockMapEntry->NumBlocks;
       }
 
+      //
+      // The variable store is read far more often than it is written, and
+      // all of its writes go through this driver.
+      //
+      if (BaseAddress == PcdGet32 (PcdFlashNvStorageVariableBase)) {
+        FvbInitializeCache (FvbInstance);
+      }
+
       //
       // Add a FVB Protocol Instance
       //
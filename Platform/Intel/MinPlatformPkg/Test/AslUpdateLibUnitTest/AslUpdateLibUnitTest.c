@@ -0,0 +1,300 @@
+/** @file
+  Unit tests of DxeAslUpdateLib against the installed DSDT.
+
+  The first integer Name() of the DSDT is inverted with UpdateNameAslCode(),
+  and its original value is written back after each test, so the DSDT is
+  left as it was found.
+
+Copyright (c) 2017, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiDxe.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+#include <Library/AslUpdateLib.h>
+
+#define UNIT_TEST_APP_NAME      "AslUpdateLib Unit Tests"
+#define UNIT_TEST_APP_VERSION   "1.0"
+
+typedef struct {
+  EFI_ACPI_DESCRIPTION_HEADER   *Original;
+  UINTN                         Handle;
+  UINT32                        Signature;
+  UINT32                        Offset;
+  UINT32                        OldValue;
+  UINT32                        NewValue;
+} ASL_UPDATE_TEST_CONTEXT;
+
+EFI_ACPI_SDT_PROTOCOL         *mAcpiSdt;
+ASL_UPDATE_TEST_CONTEXT       mTestContext;
+
+EFI_STATUS
+GetInstalledDsdt (
+  OUT EFI_ACPI_DESCRIPTION_HEADER   **Table,
+  OUT UINTN                         *Handle
+  )
+{
+  EFI_STATUS                  Status;
+  INTN                        Index;
+  EFI_ACPI_TABLE_VERSION      Version;
+
+  for (Index = 0; ; Index++) {
+    Status = mAcpiSdt->GetAcpiTable (Index, (EFI_ACPI_SDT_HEADER **) Table, &Version, Handle);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+    if ((*Table)->Signature == EFI_ACPI_3_0_DIFFERENTIATED_SYSTEM_DESCRIPTION_TABLE_SIGNATURE) {
+      return EFI_SUCCESS;
+    }
+  }
+}
+
+/**
+  Find the first Name() of the DSDT that holds a DWORD and is the first Name()
+  with its NameSeg, so that it is the one UpdateNameAslCode() patches.
+**/
+UINT32
+FindDwordName (
+  IN  EFI_ACPI_DESCRIPTION_HEADER   *Table,
+  OUT UINT32                        *Signature
+  )
+{
+  UINT8                       *Aml;
+  UINT32                      Offset;
+  UINT32                      Earlier;
+
+  Aml = (UINT8 *) Table;
+  for (Offset = sizeof (EFI_ACPI_DESCRIPTION_HEADER) + 1; Offset + 9 <= Table->Length; Offset++) {
+    if (Aml[Offset - 1] != AML_NAME_OP || Aml[Offset + 4] != AML_DWORD_PREFIX) {
+      continue;
+    }
+    *Signature = ReadUnaligned32 ((UINT32 *) (Aml + Offset));
+    for (Earlier = sizeof (EFI_ACPI_DESCRIPTION_HEADER) + 1; Earlier < Offset; Earlier++) {
+      if (Aml[Earlier - 1] == AML_NAME_OP && ReadUnaligned32 ((UINT32 *) (Aml + Earlier)) == *Signature) {
+        break;
+      }
+    }
+    if (Earlier == Offset) {
+      return Offset;
+    }
+  }
+  return 0;
+}
+
+/**
+  Write the original value back, whatever the test left behind.
+**/
+VOID
+EFIAPI
+RestoreOriginalValue (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+  UpdateNameAslCode (Test->Signature, &Test->OldValue, sizeof (Test->OldValue));
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+UnknownNameIsNotFound (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+
+  //
+  // Lower case is not valid in a NameSeg, so this name cannot exist
+  //
+  UT_ASSERT_STATUS_EQUAL (
+    UpdateNameAslCode (SIGNATURE_32 ('a', 's', 'l', 't'), &Test->NewValue, sizeof (Test->NewValue)),
+    EFI_NOT_FOUND
+    );
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+SizeMismatchIsRejected (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+  EFI_ACPI_DESCRIPTION_HEADER *Installed;
+  UINTN                       Handle;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+  UT_ASSERT_STATUS_EQUAL (
+    UpdateNameAslCode (Test->Signature, &Test->NewValue, sizeof (UINT16)),
+    EFI_BAD_BUFFER_SIZE
+    );
+
+  UT_ASSERT_NOT_EFI_ERROR (GetInstalledDsdt (&Installed, &Handle));
+  UT_ASSERT_EQUAL (Installed->Length, Test->Original->Length);
+  UT_ASSERT_MEM_EQUAL (Installed, Test->Original, Test->Original->Length);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+UpdateIsWrittenInPlace (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+  EFI_ACPI_DESCRIPTION_HEADER *Installed;
+  UINTN                       Handle;
+  UINT32                      Index;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+  UT_ASSERT_NOT_EFI_ERROR (UpdateNameAslCode (Test->Signature, &Test->NewValue, sizeof (Test->NewValue)));
+
+  //
+  // The update is visible right away, in the table installed under the same handle
+  //
+  UT_ASSERT_NOT_EFI_ERROR (GetInstalledDsdt (&Installed, &Handle));
+  UT_ASSERT_EQUAL (Handle, Test->Handle);
+  UT_ASSERT_EQUAL (Installed->Length, Test->Original->Length);
+  UT_ASSERT_EQUAL (ReadUnaligned32 ((UINT32 *) ((UINT8 *) Installed + Test->Offset + 5)), Test->NewValue);
+  UT_ASSERT_EQUAL (CalculateSum8 ((UINT8 *) Installed, Installed->Length), 0);
+
+  for (Index = 0; Index < Installed->Length; Index++) {
+    if (Index == OFFSET_OF (EFI_ACPI_DESCRIPTION_HEADER, Checksum) ||
+        (Index >= Test->Offset + 5 && Index < Test->Offset + 9)) {
+      continue;
+    }
+    UT_ASSERT_EQUAL (((UINT8 *) Installed)[Index], ((UINT8 *) Test->Original)[Index]);
+  }
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+RepeatedUpdateKeepsChecksum (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+  EFI_ACPI_DESCRIPTION_HEADER *Installed;
+  UINTN                       Handle;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+  UT_ASSERT_NOT_EFI_ERROR (UpdateNameAslCode (Test->Signature, &Test->NewValue, sizeof (Test->NewValue)));
+  UT_ASSERT_NOT_EFI_ERROR (UpdateNameAslCode (Test->Signature, &Test->NewValue, sizeof (Test->NewValue)));
+
+  UT_ASSERT_NOT_EFI_ERROR (GetInstalledDsdt (&Installed, &Handle));
+  UT_ASSERT_EQUAL (ReadUnaligned32 ((UINT32 *) ((UINT8 *) Installed + Test->Offset + 5)), Test->NewValue);
+  UT_ASSERT_EQUAL (CalculateSum8 ((UINT8 *) Installed, Installed->Length), 0);
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+OriginalValueIsRestored (
+  IN UNIT_TEST_CONTEXT        Context
+  )
+{
+  ASL_UPDATE_TEST_CONTEXT     *Test;
+  EFI_ACPI_DESCRIPTION_HEADER *Installed;
+  UINTN                       Handle;
+
+  Test = (ASL_UPDATE_TEST_CONTEXT *) Context;
+  UT_ASSERT_NOT_EFI_ERROR (UpdateNameAslCode (Test->Signature, &Test->NewValue, sizeof (Test->NewValue)));
+  UT_ASSERT_NOT_EFI_ERROR (UpdateNameAslCode (Test->Signature, &Test->OldValue, sizeof (Test->OldValue)));
+
+  UT_ASSERT_NOT_EFI_ERROR (GetInstalledDsdt (&Installed, &Handle));
+  UT_ASSERT_EQUAL (Installed->Length, Test->Original->Length);
+  UT_ASSERT_MEM_EQUAL (Installed, Test->Original, Test->Original->Length);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Find the Name() to test with, and keep a copy of the DSDT to compare with.
+**/
+EFI_STATUS
+InitializeTestContext (
+  OUT ASL_UPDATE_TEST_CONTEXT   *Test
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_ACPI_DESCRIPTION_HEADER *Installed;
+
+  Status = gBS->LocateProtocol (&gEfiAcpiSdtProtocolGuid, NULL, (VOID **) &mAcpiSdt);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = InitializeAslUpdateLib ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = GetInstalledDsdt (&Installed, &Test->Handle);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Test->Offset = FindDwordName (Installed, &Test->Signature);
+  if (Test->Offset == 0) {
+    return EFI_NOT_FOUND;
+  }
+  Test->Original = AllocateCopyPool (Installed->Length, Installed);
+  if (Test->Original == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Test->OldValue = ReadUnaligned32 ((UINT32 *) ((UINT8 *) Installed + Test->Offset + 5));
+  Test->NewValue = ~Test->OldValue;
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+AslUpdateLibUnitTestEntrypoint (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      Suite;
+
+  Framework = NULL;
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitializeTestContext (&mTestContext);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "No DSDT DWORD Name() to test with - %r\n", Status));
+    return Status;
+  }
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  Status = CreateUnitTestSuite (&Suite, Framework, "UpdateNameAslCode", "MinPlatformPkg.AslUpdateLib", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  AddTestCase (Suite, "Unknown name is not found", "UnknownName", UnknownNameIsNotFound, NULL, NULL, &mTestContext);
+  AddTestCase (Suite, "Size mismatch is rejected", "SizeMismatch", SizeMismatchIsRejected, NULL, RestoreOriginalValue, &mTestContext);
+  AddTestCase (Suite, "Update is written to the installed DSDT", "InPlace", UpdateIsWrittenInPlace, NULL, RestoreOriginalValue, &mTestContext);
+  AddTestCase (Suite, "Repeated update keeps the checksum valid", "Repeated", RepeatedUpdateKeepsChecksum, NULL, RestoreOriginalValue, &mTestContext);
+  AddTestCase (Suite, "Original value is restored", "Restore", OriginalValueIsRestored, NULL, RestoreOriginalValue, &mTestContext);
+
+  Status = RunAllTestSuites (Framework);
+
+Done:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+  FreePool (mTestContext.Original);
+  return Status;
+}
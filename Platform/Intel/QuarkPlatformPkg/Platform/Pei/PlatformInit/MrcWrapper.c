@@ -118,6 +118,8 @@ MrcConfigureFromInfoHob (
   MrcData->address_mode        = ItemData->AddrMode;
   // Enable scrambling if requested.
   MrcData->scrambling_enables  = (ItemData->Flags & PDAT_MRC_FLAG_SCRAMBLE_EN) != 0;
+  // Use the coarse-then-fine edge search in training if requested.
+  MrcData->adaptive_search     = (ItemData->Flags & PDAT_MRC_FLAG_ADAPTIVE_SEARCH_EN) != 0;
   MrcData->ddr_type            = ItemData->DramType;
   MrcData->dram_width          = ItemData->DramWidth;
   MrcData->ddr_speed           = ItemData->DramSpeed;
@@ -139,8 +141,9 @@ MrcConfigureFromInfoHob (
   DEBUG ((EFI_D_INFO, "MRC dram_width %d\n",  MrcData->dram_width));
   DEBUG ((EFI_D_INFO, "MRC rank_enables %d\n",MrcData->rank_enables));
   DEBUG ((EFI_D_INFO, "MRC ddr_speed %d\n",   MrcData->ddr_speed));
-  DEBUG ((EFI_D_INFO, "MRC flags: %s\n",
-    (MrcData->scrambling_enables) ? L"SCRAMBLE_EN" : L""
+  DEBUG ((EFI_D_INFO, "MRC flags: %s %s\n",
+    (MrcData->scrambling_enables) ? L"SCRAMBLE_EN" : L"",
+    (MrcData->adaptive_search) ? L"ADAPTIVE_SEARCH_EN" : L""
     ));
 
   DEBUG ((EFI_D_INFO, "MRC density=%d tCL=%d tRAS=%d tWTR=%d tRRD=%d tFAW=%d\n",
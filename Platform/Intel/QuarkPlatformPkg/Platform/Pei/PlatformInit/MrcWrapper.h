@@ -87,6 +87,7 @@ typedef struct {
 #define PDAT_MRC_FLAG_MEMTEST_EN        BIT2
 #define PDAT_MRC_FLAG_TOP_TREE_EN       BIT3  ///< 0b DDR "fly-by" topology else 1b DDR "tree" topology.
 #define PDAT_MRC_FLAG_WR_ODT_EN         BIT4  ///< If set ODR signal is asserted to DRAM devices on writes.
+#define PDAT_MRC_FLAG_ADAPTIVE_SEARCH_EN BIT5 ///< If set training uses the coarse-then-fine edge search, else the linear one.
 
 ///
 /// MRC Params Platform Data.
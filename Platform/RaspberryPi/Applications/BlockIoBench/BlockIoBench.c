@@ -0,0 +1,223 @@
+/** @file
+ *
+ *  Measure SD/MMC read throughput.
+ *
+ *  BlockIoBench reads the first BENCH_DEVICE_SIZE bytes of every BlockIo
+ *  device with media present, at several transfer sizes, and prints MB/s
+ *  for each. BlockIoBench <file> reads the file through the file system,
+ *  and so through the BlockIo device under it, and prints MB/s.
+ *
+ *  SPDX-License-Identifier: BSD-2-Clause-Patent
+ *
+ **/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/ShellLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/ShellParameters.h>
+
+#define BENCH_DEVICE_SIZE   SIZE_64MB
+#define BENCH_FILE_CHUNK    SIZE_1MB
+
+STATIC CONST UINTN mTransferSizes[] = { SIZE_4KB, SIZE_64KB, SIZE_512KB, SIZE_4MB };
+
+STATIC
+UINT64
+ElapsedNs (
+  IN UINT64 Start
+  )
+{
+  UINT64 End;
+  UINT64 CounterStart;
+  UINT64 CounterEnd;
+
+  End = GetPerformanceCounter ();
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart > CounterEnd) {
+    return GetTimeInNanoSecond (Start - End);
+  }
+  return GetTimeInNanoSecond (End - Start);
+}
+
+STATIC
+VOID
+PrintRate (
+  IN CONST CHAR16 *Label,
+  IN UINT64       Bytes,
+  IN UINT64       Ns
+  )
+{
+  UINT64 KBps;
+
+  if (Ns == 0) {
+    Ns = 1;
+  }
+
+  //
+  // Bytes per ns * 10^6 is KB/s, printed as MB/s with two decimals.
+  //
+  KBps = DivU64x64Remainder (MultU64x32 (Bytes, 1000000), Ns, NULL);
+  Print (L"  %-12s %8ld KB in %8ld us: %5ld.%02ld MB/s\n",
+    Label,
+    DivU64x32 (Bytes, SIZE_1KB),
+    DivU64x32 (Ns, 1000),
+    DivU64x32 (KBps, 1000),
+    DivU64x32 (ModU64x32 (KBps, 1000), 10));
+}
+
+/**
+   Read the start of a BlockIo device at each of mTransferSizes.
+**/
+STATIC
+EFI_STATUS
+BenchBlockIo (
+  IN EFI_BLOCK_IO_PROTOCOL *BlockIo,
+  IN UINTN                 Index
+  )
+{
+  EFI_STATUS    Status;
+  EFI_BLOCK_IO_MEDIA *Media;
+  VOID          *Buffer;
+  UINT64        Size;
+  UINT64        Offset;
+  UINT64        Start;
+  UINTN         TransferSize;
+  UINTN         SizeIndex;
+  CHAR16        Label[16];
+
+  Media = BlockIo->Media;
+  Size = MultU64x32 (Media->LastBlock + 1, Media->BlockSize);
+  Size = MIN (Size, BENCH_DEVICE_SIZE);
+
+  Print (L"BlockIo device %d: %s, block size %d, reading %ld KB\n",
+    (UINT32)Index, Media->RemovableMedia ? L"removable" : L"fixed",
+    Media->BlockSize, DivU64x32 (Size, SIZE_1KB));
+
+  Buffer = AllocatePages (EFI_SIZE_TO_PAGES (mTransferSizes[ARRAY_SIZE (mTransferSizes) - 1]));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  for (SizeIndex = 0; SizeIndex < ARRAY_SIZE (mTransferSizes); SizeIndex++) {
+    TransferSize = mTransferSizes[SizeIndex];
+    if (TransferSize % Media->BlockSize != 0 || TransferSize > Size) {
+      continue;
+    }
+
+    Start = GetPerformanceCounter ();
+    for (Offset = 0; Offset + TransferSize <= Size; Offset += TransferSize) {
+      Status = BlockIo->ReadBlocks (BlockIo, Media->MediaId,
+                 DivU64x32 (Offset, Media->BlockSize), TransferSize, Buffer);
+      if (EFI_ERROR (Status)) {
+        Print (L"  ReadBlocks at LBA 0x%lx: %r\n", DivU64x32 (Offset, Media->BlockSize), Status);
+        goto Exit;
+      }
+    }
+
+    UnicodeSPrint (Label, sizeof (Label), L"%d KB", (UINT32)(TransferSize / SIZE_1KB));
+    PrintRate (Label, Offset, ElapsedNs (Start));
+  }
+
+Exit:
+  FreePages (Buffer, EFI_SIZE_TO_PAGES (mTransferSizes[ARRAY_SIZE (mTransferSizes) - 1]));
+  return Status;
+}
+
+/**
+   Read a whole file through the file system in BENCH_FILE_CHUNK pieces.
+**/
+STATIC
+EFI_STATUS
+BenchFile (
+  IN CONST CHAR16 *Path
+  )
+{
+  EFI_STATUS        Status;
+  SHELL_FILE_HANDLE File;
+  VOID              *Buffer;
+  UINTN             Length;
+  UINT64            Total;
+  UINT64            Start;
+
+  Status = ShellOpenFileByName (Path, &File, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot open %s: %r\n", Path, Status);
+    return Status;
+  }
+
+  Buffer = AllocatePool (BENCH_FILE_CHUNK);
+  if (Buffer == NULL) {
+    ShellCloseFile (&File);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Print (L"Reading %s\n", Path);
+  Total = 0;
+  Start = GetPerformanceCounter ();
+  do {
+    Length = BENCH_FILE_CHUNK;
+    Status = ShellReadFile (File, &Length, Buffer);
+    Total += Length;
+  } while (!EFI_ERROR (Status) && Length != 0);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"  Read failed after %ld bytes: %r\n", Total, Status);
+  } else {
+    PrintRate (L"file", Total, ElapsedNs (Start));
+  }
+
+  FreePool (Buffer);
+  ShellCloseFile (&File);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+BlockIoBenchMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                    Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL *Parameters;
+  EFI_BLOCK_IO_PROTOCOL         *BlockIo;
+  EFI_HANDLE                    *Handles;
+  UINTN                         HandleCount;
+  UINTN                         Index;
+
+  Status = gBS->HandleProtocol (ImageHandle, &gEfiShellParametersProtocolGuid,
+                  (VOID **)&Parameters);
+  if (!EFI_ERROR (Status) && Parameters->Argc > 1) {
+    return BenchFile (Parameters->Argv[1]);
+  }
+
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiBlockIoProtocolGuid, NULL,
+                  &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    Print (L"No BlockIo devices: %r\n", Status);
+    return Status;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiBlockIoProtocolGuid,
+                    (VOID **)&BlockIo);
+    if (EFI_ERROR (Status) ||
+        BlockIo->Media->LogicalPartition ||
+        !BlockIo->Media->MediaPresent) {
+      continue;
+    }
+
+    BenchBlockIo (BlockIo, Index);
+  }
+
+  FreePool (Handles);
+  return EFI_SUCCESS;
+}
@@ -16,6 +16,21 @@ UINT32 LastExecutedCommand = (UINT32) -1;
 
 STATIC RASPBERRY_PI_FIRMWARE_PROTOCOL *mFwProtocol;
 
+//
+// ADMA2 state. mAdmaDescTable is NULL when transfers use PIO.
+//
+STATIC ADMA2_DESCRIPTOR     *mAdmaDescTable;
+STATIC EFI_PHYSICAL_ADDRESS mAdmaDescTableAddress;
+STATIC VOID                 *mAdmaDescTableMapping;
+
+//
+// Block read/write command held back by MMCSendCommand until the
+// data buffer is known, so the ADMA2 transfer can be set up first.
+//
+STATIC BOOLEAN mIsDataCmdPending;
+STATIC UINT32  mPendingDataCmd;
+STATIC UINT32  mPendingDataArg;
+
 /**
    These SD commands are optional, according to the SD Spec
 **/
@@ -275,32 +290,29 @@ MMCBuildDevicePath (
   return EFI_SUCCESS;
 }
 
+/**
+   Sends an already translated command and waits for its completion.
+   A non-zero DmaBlockCount turns a block read/write into an ADMA2
+   transfer of that many blocks, using the descriptor table at
+   mAdmaDescTableAddress.
+**/
+STATIC
 EFI_STATUS
-MMCSendCommand (
-  IN EFI_MMC_HOST_PROTOCOL    *This,
-  IN MMC_CMD                  MmcCmd,
-  IN UINT32                   Argument
+IssueCommand (
+  IN UINT32                   MmcCmd,
+  IN UINT32                   Argument,
+  IN UINTN                    DmaBlockCount
   )
 {
   UINTN MmcStatus;
   UINTN RetryCount = 0;
   UINTN CmdSendOKMask;
+  UINT32 CmdFlags = 0;
   EFI_STATUS Status = EFI_SUCCESS;
   BOOLEAN IsAppCmd = (LastExecutedCommand == CMD55);
   BOOLEAN IsDATCmd = FALSE;
   BOOLEAN IsADTCCmd = FALSE;
 
-  DEBUG ((DEBUG_MMCHOST_SD, "ArasanMMCHost: MMCSendCommand(MmcCmd: %08x, Argument: %08x)\n", MmcCmd, Argument));
-
-  if (IgnoreCommand (MmcCmd)) {
-    return EFI_SUCCESS;
-  }
-
-  MmcCmd = TranslateCommand (MmcCmd, Argument);
-  if (MmcCmd == 0xffffffff) {
-    return EFI_UNSUPPORTED;
-  }
-
   if ((MmcCmd & CMD_R1_ADTC) == CMD_R1_ADTC) {
     IsADTCCmd = TRUE;
   }
@@ -337,6 +349,9 @@ MMCSendCommand (
     MmioWrite32 (MMCHS_BLK, 8);
   } else if (!IsAppCmd && MmcCmd == CMD6) {
     MmioWrite32 (MMCHS_BLK, 64);
+  } else if (IsADTCCmd && DmaBlockCount != 0) {
+    MmioWrite32 (MMCHS_BLK, BLEN_512BYTES | (UINT32)(DmaBlockCount << BLOCK_COUNT_SHIFT));
+    CmdFlags = DE_ENABLE | BCE_ENABLE;
   } else if (IsADTCCmd) {
     MmioWrite32 (MMCHS_BLK, BLEN_512BYTES);
   }
@@ -354,7 +369,7 @@ MMCSendCommand (
   MmioWrite32 (MMCHS_ARG, Argument);
 
   // Send the command
-  MmioWrite32 (MMCHS_CMD, MmcCmd);
+  MmioWrite32 (MMCHS_CMD, MmcCmd | CmdFlags);
 
   // Check for the command status.
   while (RetryCount < MAX_RETRY_COUNT) {
@@ -406,6 +421,204 @@ Exit:
   return Status;
 }
 
+STATIC
+BOOLEAN
+IsBlockDataCommand (
+  IN UINT32 MmcCmd
+  )
+{
+  return MmcCmd == CMD_READ_SINGLE_BLOCK ||
+         MmcCmd == CMD_READ_MULTIPLE_BLOCK ||
+         MmcCmd == CMD_WRITE_SINGLE_BLOCK ||
+         MmcCmd == CMD_WRITE_MULTIPLE_BLOCK;
+}
+
+EFI_STATUS
+MMCSendCommand (
+  IN EFI_MMC_HOST_PROTOCOL    *This,
+  IN MMC_CMD                  MmcCmd,
+  IN UINT32                   Argument
+  )
+{
+  DEBUG ((DEBUG_MMCHOST_SD, "ArasanMMCHost: MMCSendCommand(MmcCmd: %08x, Argument: %08x)\n", MmcCmd, Argument));
+
+  if (IgnoreCommand (MmcCmd)) {
+    return EFI_SUCCESS;
+  }
+
+  MmcCmd = TranslateCommand (MmcCmd, Argument);
+  if (MmcCmd == 0xffffffff) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (mAdmaDescTable != NULL &&
+      LastExecutedCommand != CMD55 &&
+      IsBlockDataCommand (MmcCmd)) {
+    //
+    // Issued from MMCReadBlockData/MMCWriteBlockData.
+    //
+    mIsDataCmdPending = TRUE;
+    mPendingDataCmd = MmcCmd;
+    mPendingDataArg = Argument;
+    LastExecutedCommand = MmcCmd;
+    return EFI_SUCCESS;
+  }
+
+  return IssueCommand (MmcCmd, Argument, 0);
+}
+
+/**
+   Issues the pending block command as an ADMA2 transfer of Buffer and
+   waits for it to complete. Returns EFI_UNSUPPORTED, without touching
+   the controller, when the buffer cannot be used for DMA; the caller
+   then falls back to PIO.
+**/
+STATIC
+EFI_STATUS
+DmaTransferData (
+  IN DMA_MAP_OPERATION        Operation,
+  IN UINTN                    Length,
+  IN VOID                     *Buffer
+  )
+{
+  EFI_STATUS Status;
+  EFI_PHYSICAL_ADDRESS DeviceAddress;
+  VOID *Mapping;
+  UINTN MappedLength;
+  UINTN BlockCount;
+  UINTN Index;
+  UINTN Offset;
+  UINTN Chunk;
+  UINTN RetryCount;
+  UINTN MmcStatus;
+
+  BlockCount = Length / BLEN_512BYTES;
+  if ((Length % BLEN_512BYTES) != 0 ||
+      BlockCount == 0 ||
+      BlockCount > ADMA2_MAX_BLOCK_COUNT ||
+      ((UINTN)Buffer & (sizeof (UINT32) - 1)) != 0) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // DmaMap bounces buffers that are not cache line aligned or that the
+  // controller cannot reach.
+  //
+  MappedLength = Length;
+  Status = DmaMap (Operation, Buffer, &MappedLength, &DeviceAddress, &Mapping);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_MMCHOST_SD, "%a(%u): DmaMap: %r\n", __FUNCTION__, __LINE__, Status));
+    return EFI_UNSUPPORTED;
+  }
+
+  if (MappedLength != Length ||
+      DeviceAddress + Length > SIZE_4GB) {
+    DmaUnmap (Mapping);
+    return EFI_UNSUPPORTED;
+  }
+
+  for (Index = 0, Offset = 0; Offset < Length; Index++, Offset += Chunk) {
+    Chunk = MIN (Length - Offset, ADMA2_MAX_DESC_LENGTH);
+    mAdmaDescTable[Index].Attributes = ADMA2_DESC_VALID | ADMA2_DESC_ACT_TRAN;
+    mAdmaDescTable[Index].Length = (UINT16)Chunk;
+    mAdmaDescTable[Index].Address = (UINT32)(DeviceAddress + Offset);
+  }
+  mAdmaDescTable[Index - 1].Attributes |= ADMA2_DESC_END;
+
+  MmioWrite32 (MMCHS_ADMA_SAL, (UINT32)mAdmaDescTableAddress);
+  MmioAndThenOr32 (MMCHS_HCTL, (UINT32) ~DMAS_MASK, DMAS_ADMA2);
+
+  mFwProtocol->SetLed (TRUE);
+
+  MmcStatus = 0;
+  Status = IssueCommand (mPendingDataCmd, mPendingDataArg, BlockCount);
+  if (!EFI_ERROR (Status)) {
+    RetryCount = 0;
+    while (RetryCount < MAX_RETRY_COUNT * BlockCount) {
+      MmcStatus = MmioRead32 (MMCHS_INT_STAT);
+      if ((MmcStatus & ADMAE) != 0) {
+        DEBUG ((DEBUG_ERROR, "%a(%u): MMC_CMD%u ADMA error MmcStatus 0x%x AdmaStatus 0x%x\n",
+          __FUNCTION__, __LINE__, MMC_CMD_NUM (mPendingDataCmd), MmcStatus,
+          MmioRead32 (MMCHS_ADMA_ES)));
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      if ((MmcStatus & ERRI) != 0) {
+        DEBUG ((DEBUG_ERROR, "%a(%u): MMC_CMD%u ERRI MmcStatus 0x%x\n",
+          __FUNCTION__, __LINE__, MMC_CMD_NUM (mPendingDataCmd), MmcStatus));
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+
+      if ((MmcStatus & TC) != 0) {
+        break;
+      }
+
+      gBS->Stall (STALL_AFTER_RETRY_US);
+      RetryCount++;
+    }
+
+    if (RetryCount == MAX_RETRY_COUNT * BlockCount) {
+      DEBUG ((DEBUG_ERROR, "%a(%u): MMC_CMD%u transfer TIMEOUT PresState 0x%x MmcStatus 0x%x\n",
+        __FUNCTION__, __LINE__, MMC_CMD_NUM (mPendingDataCmd),
+        MmioRead32 (MMCHS_PRES_STATE), MmcStatus));
+      Status = EFI_TIMEOUT;
+    }
+
+    MmioWrite32 (MMCHS_INT_STAT, ALL_EN & ~(CARD_INS));
+  }
+
+  if (EFI_ERROR (Status)) {
+    //
+    // The DMA engine may still own the data line, and a failed command
+    // leaves the command line inhibited. Reset them, and wait for the
+    // resets to self-clear, before the buffer is unmapped and the next
+    // command is issued.
+    //
+    if ((MmcStatus & CMD_ERRORS) != 0) {
+      SoftReset (SRC);
+    }
+    SoftReset (SRD);
+  }
+
+  mFwProtocol->SetLed (FALSE);
+
+  MmioAnd32 (MMCHS_HCTL, (UINT32) ~DMAS_MASK);
+  DmaUnmap (Mapping);
+  return Status;
+}
+
+/**
+   Issues the pending block command (if any) for Buffer, by DMA when
+   possible. *DmaDone is set when the data has already been moved.
+**/
+STATIC
+EFI_STATUS
+StartDataCommand (
+  IN DMA_MAP_OPERATION        Operation,
+  IN UINTN                    Length,
+  IN VOID                     *Buffer,
+  OUT BOOLEAN                 *DmaDone
+  )
+{
+  EFI_STATUS Status;
+
+  *DmaDone = FALSE;
+  if (!mIsDataCmdPending) {
+    return EFI_SUCCESS;
+  }
+
+  mIsDataCmdPending = FALSE;
+  Status = DmaTransferData (Operation, Length, Buffer);
+  if (Status != EFI_UNSUPPORTED) {
+    *DmaDone = TRUE;
+    return Status;
+  }
+
+  return IssueCommand (mPendingDataCmd, mPendingDataArg, 0);
+}
+
 EFI_STATUS
 MMCNotifyState (
   IN EFI_MMC_HOST_PROTOCOL    *This,
@@ -539,6 +752,8 @@ MMCReadBlockData (
   IN UINT32*                  Buffer
   )
 {
+  EFI_STATUS Status;
+  BOOLEAN DmaDone;
   UINTN MmcStatus;
   UINTN RemLength;
   UINTN Count;
@@ -556,6 +771,11 @@ MMCReadBlockData (
     return EFI_INVALID_PARAMETER;
   }
 
+  Status = StartDataCommand (MapOperationBusMasterWrite, Length, Buffer, &DmaDone);
+  if (EFI_ERROR (Status) || DmaDone) {
+    return Status;
+  }
+
   RemLength = Length;
   while (RemLength != 0) {
     UINTN RetryCount = 0;
@@ -603,6 +823,8 @@ MMCWriteBlockData (
   IN UINT32*                  Buffer
   )
 {
+  EFI_STATUS Status;
+  BOOLEAN DmaDone;
   UINTN MmcStatus;
   UINTN RemLength;
   UINTN Count;
@@ -620,6 +842,11 @@ MMCWriteBlockData (
     return EFI_INVALID_PARAMETER;
   }
 
+  Status = StartDataCommand (MapOperationBusMasterRead, Length, Buffer, &DmaDone);
+  if (EFI_ERROR (Status) || DmaDone) {
+    return Status;
+  }
+
   RemLength = Length;
   while (RemLength != 0) {
     UINTN RetryCount = 0;
@@ -682,6 +909,52 @@ EFI_MMC_HOST_PROTOCOL gMMCHost =
   MMCIsMultiBlock
 };
 
+/**
+   Sets up the ADMA2 descriptor table. On failure the driver keeps using PIO.
+**/
+STATIC
+VOID
+InitializeAdma (
+  VOID
+  )
+{
+  EFI_STATUS Status;
+  VOID *Table;
+  UINTN Pages;
+  UINTN TableSize;
+
+  if ((MmioRead32 (MMCHS_CAPA) & ADMA2S) == 0) {
+    DEBUG ((DEBUG_INFO, "ArasanMMCHost: no ADMA2 support, using PIO\n"));
+    return;
+  }
+
+  Pages = EFI_SIZE_TO_PAGES (ADMA2_DESC_COUNT * sizeof (ADMA2_DESCRIPTOR));
+  Status = DmaAllocateBuffer (EfiBootServicesData, Pages, &Table);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "ArasanMMCHost: DmaAllocateBuffer: %r\n", Status));
+    return;
+  }
+
+  TableSize = EFI_PAGES_TO_SIZE (Pages);
+  Status = DmaMap (MapOperationBusMasterCommonBuffer, Table, &TableSize,
+             &mAdmaDescTableAddress, &mAdmaDescTableMapping);
+  if (!EFI_ERROR (Status) &&
+      mAdmaDescTableAddress + TableSize > SIZE_4GB) {
+    DmaUnmap (mAdmaDescTableMapping);
+    Status = EFI_UNSUPPORTED;
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "ArasanMMCHost: DmaMap: %r\n", Status));
+    DmaFreeBuffer (Pages, Table);
+    return;
+  }
+
+  ZeroMem (Table, TableSize);
+  mAdmaDescTable = Table;
+  DEBUG ((DEBUG_INFO, "ArasanMMCHost: using ADMA2\n"));
+}
+
 EFI_STATUS
 MMCInitialize (
   IN EFI_HANDLE          ImageHandle,
@@ -705,6 +978,10 @@ MMCInitialize (
     return Status;
   }
 
+  if (PcdGet32 (PcdMmcEnableDma)) {
+    InitializeAdma ();
+  }
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Handle,
                   &gRaspberryPiMmcHostProtocolGuid,
@@ -41,4 +41,28 @@
 
 #define MAX_DIVISOR_VALUE 1023
 
+// Errors that leave the command line in need of a reset
+#define CMD_ERRORS (CTO | CCRC | CEB | CIE)
+
+//
+// ADMA2 descriptor table (32-bit addressing). A single table covers the
+// largest transfer the 16-bit block count register allows.
+//
+#define ADMA2_DESC_VALID        BIT0
+#define ADMA2_DESC_END          BIT1
+#define ADMA2_DESC_INT          BIT2
+#define ADMA2_DESC_ACT_TRAN     (0x2 << 4)
+
+#define ADMA2_MAX_DESC_LENGTH   SIZE_32KB
+#define ADMA2_MAX_BLOCK_COUNT   0xFFFF
+#define ADMA2_DESC_COUNT        (((ADMA2_MAX_BLOCK_COUNT * BLEN_512BYTES) / ADMA2_MAX_DESC_LENGTH) + 1)
+
+#pragma pack(1)
+typedef struct {
+  UINT16 Attributes;
+  UINT16 Length;
+  UINT32 Address;
+} ADMA2_DESCRIPTOR;
+#pragma pack()
+
 #endif
@@ -15,6 +15,27 @@
  */
 #define DW_HC_RESET_TIMEOUT_MS (10000)
 
+/*
+ * Time to wait for a channel to halt when cancelling a transfer.
+ */
+#define DW_HC_HALT_TIMEOUT_US (1000)
+
+/*
+ * Channels that async interrupt transfers may not claim, so
+ * that control and bulk transfers always find a free one.
+ */
+#define DW_HC_SYNC_CHANNELS (2)
+
+/*
+ * Every host channel owns a DWC2_DATA_BUF_SIZE slice of the
+ * DMA buffer, so transfers on different channels can be on
+ * the wire at the same time.
+ */
+#define DW_HC_CHANNEL_BUFFER(DwHc, Channel)                     \
+  ((DwHc)->AlignedBuffer + (Channel) * DWC2_DATA_BUF_SIZE)
+#define DW_HC_CHANNEL_BUS_ADDRESS(DwHc, Channel)                \
+  ((DwHc)->AlignedBufferBusAddress + (Channel) * DWC2_DATA_BUF_SIZE)
+
   /*
    * TimerPeriodic to account for timeout processing
    * within DwHcTransfer.
@@ -35,12 +56,6 @@ typedef enum {
   XFER_DONE
 } CHANNEL_HALT_REASON;
 
-typedef struct {
-  BOOLEAN Splitting;
-  BOOLEAN SplitStart;
-  UINT32 Tries;
-} SPLIT_CONTROL;
-
 EFI_STATUS
 DwHcInit (
   IN DWUSB_OTGHC_DEV *DwHc,
@@ -77,10 +92,10 @@ Wait4Bit (
   return EFI_TIMEOUT;
 }
 
+STATIC
 CHANNEL_HALT_REASON
-Wait4Chhltd (
+DwHcHaltReason (
   IN  DWUSB_OTGHC_DEV *DwHc,
-  IN  EFI_EVENT       Timeout,
   IN  UINT32          Channel,
   IN  UINT32          *Sub,
   IN  UINT32          *Toggle,
@@ -88,18 +103,9 @@ Wait4Chhltd (
   IN  SPLIT_CONTROL   *Split
   )
 {
-  EFI_STATUS Status;
   UINT32  Hcint, Hctsiz;
   UINT32  HcintCompHltAck = DWC2_HCINT_XFERCOMP;
 
-  MicroSecondDelay (100);
-  Status = Wait4Bit (Timeout, DwHc->DwUsbBase + HCINT (Channel),
-                     DWC2_HCINT_CHHLTD, 1);
-  if (EFI_ERROR (Status)) {
-    return XFER_NOT_HALTED;
-  }
-
-  MicroSecondDelay (100);
   Hcint = MmioRead32 (DwHc->DwUsbBase + HCINT (Channel));
 
   ASSERT ((Hcint & DWC2_HCINT_CHHLTD) != 0);
@@ -156,6 +162,30 @@ Wait4Chhltd (
   return XFER_DONE;
 }
 
+CHANNEL_HALT_REASON
+Wait4Chhltd (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  IN  EFI_EVENT       Timeout,
+  IN  UINT32          Channel,
+  IN  UINT32          *Sub,
+  IN  UINT32          *Toggle,
+  IN  BOOLEAN         IgnoreAck,
+  IN  SPLIT_CONTROL   *Split
+  )
+{
+  EFI_STATUS Status;
+
+  MicroSecondDelay (100);
+  Status = Wait4Bit (Timeout, DwHc->DwUsbBase + HCINT (Channel),
+                     DWC2_HCINT_CHHLTD, 1);
+  if (EFI_ERROR (Status)) {
+    return XFER_NOT_HALTED;
+  }
+
+  MicroSecondDelay (100);
+  return DwHcHaltReason (DwHc, Channel, Sub, Toggle, IgnoreAck, Split);
+}
+
 VOID
 DwOtgHcInit (
   IN  DWUSB_OTGHC_DEV    *DwHc,
@@ -195,6 +225,163 @@ DwOtgHcInit (
   MmioWrite32 (DwHc->DwUsbBase + HCSPLT (HcNum), Split);
 }
 
+STATIC
+UINT32
+DwHcAllocateChannel (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  IN  UINT32          Reserve
+  )
+{
+  EFI_TPL Tpl;
+  UINT32  Channel;
+  UINT32  Free;
+  UINT32  Count;
+
+  Tpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  Count = 0;
+  for (Free = DwHc->FreeChannels; Free != 0; Free &= Free - 1) {
+    Count++;
+  }
+
+  Channel = DWC2_HC_CHANNEL_NONE;
+  if (Count > Reserve) {
+    Channel = (UINT32)LowBitSet32 (DwHc->FreeChannels);
+    DwHc->FreeChannels &= ~(1U << Channel);
+  }
+
+  gBS->RestoreTPL (Tpl);
+
+  return Channel;
+}
+
+STATIC
+VOID
+DwHcFreeChannel (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  IN  UINT32          Channel
+  )
+{
+  EFI_TPL Tpl;
+
+  Tpl = gBS->RaiseTPL (TPL_NOTIFY);
+  DwHc->FreeChannels |= 1U << Channel;
+  gBS->RestoreTPL (Tpl);
+}
+
+STATIC
+VOID
+DwHcHaltChannel (
+  IN  DWUSB_OTGHC_DEV *DwHc,
+  IN  UINT32          Channel
+  )
+{
+  UINTN Timeout;
+
+  if ((MmioRead32 (DwHc->DwUsbBase + HCCHAR (Channel)) &
+       DWC2_HCCHAR_CHEN) != 0) {
+    MmioOr32 (DwHc->DwUsbBase + HCCHAR (Channel), DWC2_HCCHAR_CHDIS);
+
+    for (Timeout = DW_HC_HALT_TIMEOUT_US; Timeout > 0; Timeout--) {
+      if ((MmioRead32 (DwHc->DwUsbBase + HCINT (Channel)) &
+           DWC2_HCINT_CHHLTD) != 0) {
+        break;
+      }
+      MicroSecondDelay (1);
+    }
+
+    if (Timeout == 0) {
+      DEBUG ((DEBUG_ERROR, "Channel %u did not halt\n", Channel));
+    }
+  }
+
+  MmioWrite32 (DwHc->DwUsbBase + HCINTMSK (Channel), 0);
+  MmioWrite32 (DwHc->DwUsbBase + HCINT (Channel), 0xFFFFFFFF);
+}
+
+/*
+ * Sizes the next chunk of a transfer: as many packets as the
+ * channel and its DMA buffer slice take in one go, or a single
+ * packet for a split transaction.
+ */
+STATIC
+UINT32
+DwHcChunkLength (
+  IN  UINTN          Remaining,
+  IN  UINTN          MaximumPacketLength,
+  IN  UINT32         TransferDirection,
+  IN  SPLIT_CONTROL  *Split,
+  OUT UINT32         *NumPackets
+  )
+{
+  UINTN TxferLen;
+
+  TxferLen = Remaining;
+
+  if (TxferLen > DWC2_MAX_TRANSFER_SIZE) {
+    TxferLen = DWC2_MAX_TRANSFER_SIZE - MaximumPacketLength + 1;
+  }
+
+  if (TxferLen > DWC2_DATA_BUF_SIZE) {
+    TxferLen = DWC2_DATA_BUF_SIZE - MaximumPacketLength + 1;
+  }
+
+  if (Split->Splitting || TxferLen == 0) {
+    *NumPackets = 1;
+  } else {
+    *NumPackets = (TxferLen + MaximumPacketLength - 1) / MaximumPacketLength;
+    if (*NumPackets > DWC2_MAX_PACKET_COUNT) {
+      *NumPackets = DWC2_MAX_PACKET_COUNT;
+      TxferLen = *NumPackets * MaximumPacketLength;
+    }
+  }
+
+  if (TransferDirection) { // in
+    TxferLen = *NumPackets * MaximumPacketLength;
+  }
+
+  return (UINT32)TxferLen;
+}
+
+STATIC
+VOID
+DwHcStartChannel (
+  IN  DWUSB_OTGHC_DEV                    *DwHc,
+  IN  UINT32                             Channel,
+  IN  EFI_USB2_HC_TRANSACTION_TRANSLATOR *Translator,
+  IN  UINT8                              DeviceSpeed,
+  IN  UINT8                              DeviceAddress,
+  IN  UINTN                              MaximumPacketLength,
+  IN  UINT32                             Pid,
+  IN  UINT32                             TransferDirection,
+  IN  UINT32                             TxferLen,
+  IN  UINT32                             NumPackets,
+  IN  UINT32                             EpAddress,
+  IN  UINT32                             EpType,
+  IN  SPLIT_CONTROL                      *Split
+  )
+{
+  MmioWrite32 (DwHc->DwUsbBase + HCDMA (Channel),
+    (UINTN)DW_HC_CHANNEL_BUS_ADDRESS (DwHc, Channel));
+
+  DwOtgHcInit (DwHc, Channel, Translator, DeviceSpeed,
+    DeviceAddress, EpAddress,
+    TransferDirection, EpType,
+    MaximumPacketLength, Split);
+
+  MmioWrite32 (DwHc->DwUsbBase + HCTSIZ (Channel),
+    (TxferLen << DWC2_HCTSIZ_XFERSIZE_OFFSET) |
+    (NumPackets << DWC2_HCTSIZ_PKTCNT_OFFSET) |
+    (Pid << DWC2_HCTSIZ_PID_OFFSET));
+
+  MmioAndThenOr32 (DwHc->DwUsbBase + HCCHAR (Channel),
+    ~(DWC2_HCCHAR_MULTICNT_MASK |
+      DWC2_HCCHAR_CHEN |
+      DWC2_HCCHAR_CHDIS),
+      ((1 << DWC2_HCCHAR_MULTICNT_OFFSET) |
+        DWC2_HCCHAR_CHEN));
+}
+
 EFI_STATUS
 DwCoreReset (
   IN  DWUSB_OTGHC_DEV *DwHc,
@@ -249,9 +436,9 @@ DwHcTransfer (
   UINT32                          StopTransfer = 0;
   EFI_STATUS                      Status = EFI_SUCCESS;
   SPLIT_CONTROL                   Split = { 0 };
+  UINT8                           *Buffer;
 
-  EFI_TPL Tpl = gBS->RaiseTPL (TPL_NOTIFY);
-
+  Buffer = DW_HC_CHANNEL_BUFFER (DwHc, Channel);
   *TransferResult = EFI_USB_NOERROR;
 
   do {
@@ -263,53 +450,19 @@ DwHcTransfer (
       Split.Tries = 0;
     }
 
-    TxferLen = *DataLength - Done;
-
-    if (TxferLen > DWC2_MAX_TRANSFER_SIZE) {
-      TxferLen = DWC2_MAX_TRANSFER_SIZE - MaximumPacketLength + 1;
-    }
-
-    if (TxferLen > DWC2_DATA_BUF_SIZE) {
-      TxferLen = DWC2_DATA_BUF_SIZE - MaximumPacketLength + 1;
-    }
-
-    if (Split.Splitting || TxferLen == 0) {
-      NumPackets = 1;
-    } else {
-      NumPackets = (TxferLen + MaximumPacketLength - 1) / MaximumPacketLength;
-      if (NumPackets > DWC2_MAX_PACKET_COUNT) {
-        NumPackets = DWC2_MAX_PACKET_COUNT;
-        TxferLen = NumPackets * MaximumPacketLength;
-      }
-    }
+    TxferLen = DwHcChunkLength (*DataLength - Done, MaximumPacketLength,
+                 TransferDirection, &Split, &NumPackets);
 
-    if (TransferDirection) { // in
-      TxferLen = NumPackets * MaximumPacketLength;
-    } else {
-      CopyMem (DwHc->AlignedBuffer, Data + Done, TxferLen);
+    if (!TransferDirection) { // out
+      CopyMem (Buffer, Data + Done, TxferLen);
       ArmDataSynchronizationBarrier ();
     }
 
   RestartChannel:
-    MmioWrite32 (DwHc->DwUsbBase + HCDMA (Channel),
-      (UINTN)DwHc->AlignedBufferBusAddress);
-
-    DwOtgHcInit (DwHc, Channel, Translator, DeviceSpeed,
-      DeviceAddress, EpAddress,
-      TransferDirection, EpType,
-      MaximumPacketLength, &Split);
-
-    MmioWrite32 (DwHc->DwUsbBase + HCTSIZ (Channel),
-      (TxferLen << DWC2_HCTSIZ_XFERSIZE_OFFSET) |
-      (NumPackets << DWC2_HCTSIZ_PKTCNT_OFFSET) |
-      (*Pid << DWC2_HCTSIZ_PID_OFFSET));
-
-    MmioAndThenOr32 (DwHc->DwUsbBase + HCCHAR (Channel),
-      ~(DWC2_HCCHAR_MULTICNT_MASK |
-        DWC2_HCCHAR_CHEN |
-        DWC2_HCCHAR_CHDIS),
-        ((1 << DWC2_HCCHAR_MULTICNT_OFFSET) |
-          DWC2_HCCHAR_CHEN));
+    DwHcStartChannel (DwHc, Channel, Translator, DeviceSpeed,
+      DeviceAddress, MaximumPacketLength, *Pid,
+      TransferDirection, TxferLen, NumPackets,
+      EpAddress, EpType, &Split);
 
     Ret = Wait4Chhltd (DwHc, Timeout, Channel, &Sub, Pid, IgnoreAck, &Split);
 
@@ -367,7 +520,7 @@ DwHcTransfer (
     if (TransferDirection) { // in
       ArmDataSynchronizationBarrier ();
       TxferLen -= Sub;
-      CopyMem (Data + Done, DwHc->AlignedBuffer, TxferLen);
+      CopyMem (Data + Done, Buffer, TxferLen);
       if (Sub) {
         StopTransfer = 1;
       }
@@ -381,8 +534,6 @@ DwHcTransfer (
 
   *DataLength = Done;
 
-  gBS->RestoreTPL (Tpl);
-
   ASSERT (!EFI_ERROR (Status) || *TransferResult != EFI_USB_NOERROR);
 
   return Status;
@@ -413,51 +564,139 @@ DwHcFindDeferredTransfer (
 
 STATIC
 VOID
-DwHcDeferredTransfer (
+DwHcStartDeferredChunk (
   IN  DWUSB_DEFERRED_REQ *Req
   )
 {
-  EFI_STATUS Status;
-  EFI_EVENT TimeoutEvt = NULL;
-
-  Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &TimeoutEvt);
-  ASSERT_EFI_ERROR (Status);
-  if (EFI_ERROR (Status)) {
-    goto Exit;
+  if (Req->DeviceSpeed == EFI_USB_SPEED_LOW ||
+      Req->DeviceSpeed == EFI_USB_SPEED_FULL) {
+    Req->Split.Splitting = TRUE;
+    Req->Split.SplitStart = TRUE;
+    Req->Split.Tries = 0;
   }
 
-  Status = gBS->SetTimer (TimeoutEvt, TimerForTransfer,
-                  EFI_TIMER_PERIOD_MILLISECONDS (Req->TimeOut));
-  ASSERT_EFI_ERROR (Status);
-  if (EFI_ERROR (Status)) {
-    goto Exit;
-  }
+  /*
+   * Async interrupt transfers are IN only, so there is
+   * nothing to copy into the channel buffer.
+   */
+  Req->TxferLen = DwHcChunkLength (Req->DataLength - Req->Done,
+                    Req->MaximumPacketLength, Req->TransferDirection,
+                    &Req->Split, &Req->NumPackets);
+
+  DwHcStartChannel (Req->DwHc, Req->Channel, Req->Translator,
+    Req->DeviceSpeed, Req->DeviceAddress, Req->MaximumPacketLength,
+    Req->Pid, Req->TransferDirection, Req->TxferLen, Req->NumPackets,
+    Req->EpAddress, Req->EpType, &Req->Split);
+}
 
+STATIC
+VOID
+DwHcStartDeferredTransfer (
+  IN  DWUSB_DEFERRED_REQ *Req
+  )
+{
   Req->TransferResult = EFI_USB_NOERROR;
-  Status = DwHcTransfer (Req->DwHc, TimeoutEvt,
-             Req->Channel, Req->Translator,
-             Req->DeviceSpeed, Req->DeviceAddress,
-             Req->MaximumPacketLength, &Req->Pid,
-             Req->TransferDirection, Req->Data, &Req->DataLength,
-             Req->EpAddress, Req->EpType, &Req->TransferResult,
-             Req->IgnoreAck);
-
-  if (Req->EpType == DWC2_HCCHAR_EPTYPE_INTR &&
-      Status == EFI_DEVICE_ERROR &&
-      Req->TransferResult == EFI_USB_ERR_NAK) {
+  Req->Done = 0;
+  Req->TimeoutFrame = Req->DwHc->CurrentFrame + Req->TimeOut;
+  Req->InFlight = TRUE;
+
+  DwHcStartDeferredChunk (Req);
+}
+
+/*
+ * Called from DwHcPeriodicHandler for a transfer on the wire,
+ * instead of spinning on the channel until it halts.
+ */
+STATIC
+VOID
+DwHcPollDeferredTransfer (
+  IN  DWUSB_DEFERRED_REQ *Req
+  )
+{
+  DWUSB_OTGHC_DEV     *DwHc;
+  CHANNEL_HALT_REASON Ret;
+  UINT32              Sub;
+  UINTN               TxferLen;
+
+  DwHc = Req->DwHc;
+
+  if ((MmioRead32 (DwHc->DwUsbBase + HCINT (Req->Channel)) &
+       DWC2_HCINT_CHHLTD) == 0) {
+    if (DwHc->CurrentFrame < Req->TimeoutFrame) {
+      return;
+    }
+
+    DwHcHaltChannel (DwHc, Req->Channel);
+    Req->TransferResult = EFI_USB_ERR_TIMEOUT;
+    goto Complete;
+  }
+
+  Ret = DwHcHaltReason (DwHc, Req->Channel, &Sub, &Req->Pid,
+          Req->IgnoreAck, &Req->Split);
+
+  switch (Ret) {
+  case XFER_CSPLIT:
+    ASSERT (Req->Split.Splitting);
+
+    if (Req->Split.Tries++ < 3) {
+      DwHcStartChannel (DwHc, Req->Channel, Req->Translator,
+        Req->DeviceSpeed, Req->DeviceAddress, Req->MaximumPacketLength,
+        Req->Pid, Req->TransferDirection, Req->TxferLen, Req->NumPackets,
+        Req->EpAddress, Req->EpType, &Req->Split);
+      return;
+    }
+
+    DwHcStartDeferredChunk (Req);
+    return;
+  case XFER_FRMOVRUN:
+    DwHcStartChannel (DwHc, Req->Channel, Req->Translator,
+      Req->DeviceSpeed, Req->DeviceAddress, Req->MaximumPacketLength,
+      Req->Pid, Req->TransferDirection, Req->TxferLen, Req->NumPackets,
+      Req->EpAddress, Req->EpType, &Req->Split);
+    return;
+  case XFER_NAK:
     /*
      * Swallow the NAK, the upper layer expects us to resubmit automatically.
      */
-    goto Exit;
+    Req->InFlight = FALSE;
+    return;
+  case XFER_STALL:
+    Req->TransferResult = EFI_USB_ERR_STALL;
+    goto Complete;
+  case XFER_DONE:
+    break;
+  default:
+    Req->TransferResult =
+      EFI_USB_ERR_CRC |
+      EFI_USB_ERR_TIMEOUT |
+      EFI_USB_ERR_BITSTUFF |
+      EFI_USB_ERR_SYSTEM;
+    goto Complete;
+  }
+
+  ArmDataSynchronizationBarrier ();
+  TxferLen = MIN (Req->TxferLen - Sub, Req->DataLength - Req->Done);
+  CopyMem ((UINT8 *)Req->Data + Req->Done,
+    DW_HC_CHANNEL_BUFFER (DwHc, Req->Channel), TxferLen);
+  Req->Done += TxferLen;
+
+  if (Sub == 0 && Req->Done < Req->DataLength) {
+    DwHcStartDeferredChunk (Req);
+    return;
   }
 
-  Req->CallbackFunction (Req->Data, Req->DataLength,
+Complete:
+  MmioWrite32 (DwHc->DwUsbBase + HCINTMSK (Req->Channel), 0);
+  MmioWrite32 (DwHc->DwUsbBase + HCINT (Req->Channel), 0xFFFFFFFF);
+  Req->InFlight = FALSE;
+
+  /*
+   * The callback may cancel the transfer, so Req must not
+   * be touched after it.
+   */
+  Req->CallbackFunction (Req->Data, Req->Done,
          Req->CallbackContext,
          Req->TransferResult);
-Exit:
-  if (TimeoutEvt != NULL) {
-    gBS->CloseEvent (TimeoutEvt);
-  }
 }
 
 /**
@@ -801,6 +1040,7 @@ DwHcControlTransfer (
   UINTN                   Length;
   EFI_USB_DATA_DIRECTION  StatusDirection;
   UINT32                  Direction;
+  UINT32                  Channel = DWC2_HC_CHANNEL_NONE;
   EFI_EVENT TimeoutEvt = NULL;
 
   if ((Request == NULL) || (TransferResult == NULL)) {
@@ -834,6 +1074,13 @@ DwHcControlTransfer (
 
   DwHc = DWHC_FROM_THIS (This);
 
+  Channel = DwHcAllocateChannel (DwHc, 0);
+  if (Channel == DWC2_HC_CHANNEL_NONE) {
+    *TransferResult = EFI_USB_ERR_SYSTEM;
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
   Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &TimeoutEvt);
   ASSERT_EFI_ERROR (Status);
   if (EFI_ERROR (Status)) {
@@ -850,7 +1097,7 @@ DwHcControlTransfer (
   Pid = DWC2_HC_PID_SETUP;
   Length = 8;
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+             Channel, Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid, 0,
              Request, &Length, 0, DWC2_HCCHAR_EPTYPE_CONTROL,
              TransferResult, 1);
@@ -871,7 +1118,7 @@ DwHcControlTransfer (
     }
 
     Status = DwHcTransfer (DwHc, TimeoutEvt,
-               DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+               Channel, Translator, DeviceSpeed,
                DeviceAddress, MaximumPacketLength, &Pid,
                Direction, Data, DataLength, 0,
                DWC2_HCCHAR_EPTYPE_CONTROL,
@@ -894,7 +1141,7 @@ DwHcControlTransfer (
   Pid = DWC2_HC_PID_DATA1;
   Length = 0;
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL, Translator, DeviceSpeed,
+             Channel, Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid,
              StatusDirection, DwHc->StatusBuffer, &Length, 0,
              DWC2_HCCHAR_EPTYPE_CONTROL, TransferResult, 1);
@@ -910,6 +1157,10 @@ Exit:
     gBS->CloseEvent (TimeoutEvt);
   }
 
+  if (Channel != DWC2_HC_CHANNEL_NONE) {
+    DwHcFreeChannel (DwHc, Channel);
+  }
+
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "RequestType 0x%x\n", Request->RequestType));
     DEBUG ((DEBUG_ERROR, "Request 0x%x\n", Request->Request));
@@ -942,6 +1193,7 @@ DwHcBulkTransfer (
   UINT8                   TransferDirection;
   UINT8                   EpAddress;
   UINT32                  Pid;
+  UINT32                  Channel = DWC2_HC_CHANNEL_NONE;
   EFI_EVENT TimeoutEvt = NULL;
 
   if ((Data == NULL) || (Data[0] == NULL) ||
@@ -965,6 +1217,13 @@ DwHcBulkTransfer (
 
   DwHc = DWHC_FROM_THIS (This);
 
+  Channel = DwHcAllocateChannel (DwHc, 0);
+  if (Channel == DWC2_HC_CHANNEL_NONE) {
+    *TransferResult = EFI_USB_ERR_SYSTEM;
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
   Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &TimeoutEvt);
   ASSERT_EFI_ERROR (Status);
   if (EFI_ERROR (Status)) {
@@ -984,7 +1243,7 @@ DwHcBulkTransfer (
   Pid = (*DataToggle << 1);
 
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL_BULK, Translator, DeviceSpeed,
+             Channel, Translator, DeviceSpeed,
              DeviceAddress, MaximumPacketLength, &Pid,
              TransferDirection, Data[0], DataLength, EpAddress,
              DWC2_HCCHAR_EPTYPE_BULK, TransferResult, 1);
@@ -996,6 +1255,10 @@ Exit:
     gBS->CloseEvent (TimeoutEvt);
   }
 
+  if (Channel != DWC2_HC_CHANNEL_NONE) {
+    DwHcFreeChannel (DwHc, Channel);
+  }
+
   return Status;
 }
 
@@ -1066,6 +1329,11 @@ DwHcAsyncInterruptTransfer (
       goto Done;
     }
 
+    if (FoundReq->InFlight) {
+      DwHcHaltChannel (DwHc, FoundReq->Channel);
+    }
+    DwHcFreeChannel (DwHc, FoundReq->Channel);
+
     *DataToggle = FoundReq->Pid >> 1;
     FreePool (FoundReq->Data);
 
@@ -1090,6 +1358,13 @@ DwHcAsyncInterruptTransfer (
     goto Done;
   }
 
+  NewReq->Channel = DwHcAllocateChannel (DwHc, DW_HC_SYNC_CHANNELS);
+  if (NewReq->Channel == DWC2_HC_CHANNEL_NONE) {
+    DEBUG ((DEBUG_ERROR, "DwHcAsyncInterruptTransfer: no free channel\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
   InitializeListHead (&NewReq->List);
 
   NewReq->FrameInterval = PollingInterval;
@@ -1097,7 +1372,6 @@ DwHcAsyncInterruptTransfer (
     NewReq->FrameInterval;
 
   NewReq->DwHc = DwHc;
-  NewReq->Channel = DWC2_HC_CHANNEL_ASYNC;
   NewReq->Translator = Translator;
   NewReq->DeviceSpeed = DeviceSpeed;
   NewReq->DeviceAddress = DeviceAddress;
@@ -1154,6 +1428,7 @@ DwHcSyncInterruptTransfer (
   UINT8 TransferDirection;
   UINT8 EpAddress;
   UINT32 Pid;
+  UINT32 Channel;
 
   DwHc = DWHC_FROM_THIS (This);
 
@@ -1183,11 +1458,18 @@ DwHcSyncInterruptTransfer (
     goto Exit;
   }
 
+  Channel = DwHcAllocateChannel (DwHc, 0);
+  if (Channel == DWC2_HC_CHANNEL_NONE) {
+    *TransferResult = EFI_USB_ERR_SYSTEM;
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
   TransferDirection = (EndPointAddress >> 7) & 0x01;
   EpAddress = EndPointAddress & 0x0F;
   Pid = (*DataToggle << 1);
   Status = DwHcTransfer (DwHc, TimeoutEvt,
-             DWC2_HC_CHANNEL_SYNC, Translator,
+             Channel, Translator,
              DeviceSpeed, DeviceAddress,
              MaximumPacketLength,
              &Pid, TransferDirection, Data,
@@ -1196,6 +1478,8 @@ DwHcSyncInterruptTransfer (
              TransferResult, 0);
   *DataToggle = (Pid >> 1);
 
+  DwHcFreeChannel (DwHc, Channel);
+
 Exit:
   if (TimeoutEvt != NULL) {
     gBS->CloseEvent (TimeoutEvt);
@@ -1306,6 +1590,8 @@ DwHcInit (
   UINT32 pTxFifoSz = 0;
   UINT32 Hprt0 = 0;
   INT32  i, Status, NumChannels;
+  EFI_TPL PreviousTpl;
+  LIST_ENTRY *Entry;
 
   MmioWrite32 (DwHc->DwUsbBase + PCGCCTL, 0);
 
@@ -1333,6 +1619,21 @@ DwHcInit (
   NumChannels += 1;
   DEBUG ((DEBUG_INFO, "Host has %u channels\n", NumChannels));
 
+  /*
+   * Channels owned by async interrupt transfers stay
+   * theirs across a reset, but need to be restarted.
+   */
+  PreviousTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  DwHc->NumChannels = MIN (NumChannels, DWC2_HC_CHANNELS);
+  DwHc->FreeChannels = (1U << DwHc->NumChannels) - 1;
+  EFI_LIST_FOR_EACH (Entry, &DwHc->DeferredList) {
+    DWUSB_DEFERRED_REQ *Req = EFI_LIST_CONTAINER (Entry, DWUSB_DEFERRED_REQ, List);
+
+    Req->InFlight = FALSE;
+    DwHc->FreeChannels &= ~(1U << Req->Channel);
+  }
+  gBS->RestoreTPL (PreviousTpl);
+
   for (i = 0; i < NumChannels; i++)
     MmioAndThenOr32 (DwHc->DwUsbBase + HCCHAR (i),
       ~(DWC2_HCCHAR_CHEN | DWC2_HCCHAR_EPDIR),
@@ -1434,7 +1735,7 @@ DestroyDwUsbHc (
     gBS->CloseEvent (DwHc->ExitBootServiceEvent);
   }
 
-  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE);
+  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE * DWC2_HC_CHANNELS);
   DmaUnmap (DwHc->AlignedBufferMapping);
   DmaFreeBuffer (Pages, DwHc->AlignedBuffer);
 
@@ -1510,9 +1811,11 @@ DwHcPeriodicHandler (
     &DwHc->DeferredList) {
     DWUSB_DEFERRED_REQ *Req = EFI_LIST_CONTAINER (Entry, DWUSB_DEFERRED_REQ, List);
 
-    if (Frame >= Req->TargetFrame) {
+    if (Req->InFlight) {
+      DwHcPollDeferredTransfer (Req);
+    } else if (Frame >= Req->TargetFrame) {
       Req->TargetFrame = Frame + Req->FrameInterval;
-      DwHcDeferredTransfer (Req);
+      DwHcStartDeferredTransfer (Req);
     }
   }
 }
@@ -1557,7 +1860,7 @@ CreateDwUsbHc (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE);
+  Pages = EFI_SIZE_TO_PAGES (DWC2_DATA_BUF_SIZE * DWC2_HC_CHANNELS);
   Status = DmaAllocateBuffer (EfiBootServicesData, Pages, (VOID**)&DwHc->AlignedBuffer);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "CreateDwUsbHc: DmaAllocateBuffer: %r\n", Status));
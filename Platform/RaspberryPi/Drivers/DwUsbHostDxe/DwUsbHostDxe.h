@@ -70,6 +70,12 @@ typedef struct {
   EFI_DEVICE_PATH_PROTOCOL      EndDevicePath;
 } EFI_DW_DEVICE_PATH;
 
+typedef struct {
+  BOOLEAN Splitting;
+  BOOLEAN SplitStart;
+  UINT32 Tries;
+} SPLIT_CONTROL;
+
 typedef struct _DWUSB_DEFERRED_REQ {
   IN OUT LIST_ENTRY                         List;
   IN     struct _DWUSB_OTGHC_DEV            *DwHc;
@@ -91,6 +97,16 @@ typedef struct _DWUSB_DEFERRED_REQ {
   IN     EFI_ASYNC_USB_TRANSFER_CALLBACK    CallbackFunction;
   IN     VOID                               *CallbackContext;
   IN     UINTN                              TimeOut;
+  /*
+   * State of the transfer while it is on the wire, advanced
+   * from DwHcPeriodicHandler.
+   */
+         BOOLEAN                            InFlight;
+         SPLIT_CONTROL                      Split;
+         UINTN                              Done;
+         UINT32                             TxferLen;
+         UINT32                             NumPackets;
+         UINTN                              TimeoutFrame;
 } DWUSB_DEFERRED_REQ;
 
 typedef struct _DWUSB_OTGHC_DEV {
@@ -111,6 +127,12 @@ typedef struct _DWUSB_OTGHC_DEV {
   VOID *                          AlignedBufferMapping;
   UINTN                           AlignedBufferBusAddress;
   LIST_ENTRY                      DeferredList;
+  /*
+   * Host channels in use by the driver, and a bitmap
+   * of those not owned by any transfer.
+   */
+  UINT32                          NumChannels;
+  UINT32                          FreeChannels;
   /*
    * 1ms frames.
    */
@@ -756,10 +756,8 @@
 #define DWC2_MAX_TRANSFER_SIZE           65535
 #define DWC2_MAX_PACKET_COUNT            511
 
-#define DWC2_HC_CHANNEL                 0
-#define DWC2_HC_CHANNEL_ASYNC           1
-#define DWC2_HC_CHANNEL_SYNC            2
-#define DWC2_HC_CHANNEL_BULK            3
+#define DWC2_HC_CHANNELS                8       /* Max # of channels used */
+#define DWC2_HC_CHANNEL_NONE            MAX_UINT32
 #define DWC2_HC_PORT                    0
 
 #define DWC2_STATUS_BUF_SIZE            64
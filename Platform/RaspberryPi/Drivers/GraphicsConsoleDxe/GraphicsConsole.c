@@ -37,6 +37,7 @@ GRAPHICS_CONSOLE_DEV mGraphicsConsoleDevTemplate = {
   },
   (GRAPHICS_CONSOLE_MODE_DATA*)NULL,
   (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)NULL,
+  (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)NULL,
   {
     (EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL*)NULL,
     (EFI_GRAPHICS_OUTPUT_PROTOCOL*)NULL,
@@ -92,6 +93,17 @@ EFI_NARROW_GLYPH mCursorGlyph = {
 
 CHAR16 SpaceStr[] = { NARROW_CHAR, ' ', 0 };
 
+//
+// Open addressed hash of gUsStdNarrowGlyphData, mapping a Unicode weight
+// to its glyph index plus one, and the rendered glyphs for the most
+// recently used colour pairs.
+//
+UINT16               *mGlyphIndex;
+UINTN                mGlyphIndexSize;
+UINTN                mGlyphCount;
+GLYPH_CACHE_SLOT     mGlyphCache[GLYPH_CACHE_SLOTS];
+UINTN                mGlyphCacheTick;
+
 EFI_DRIVER_BINDING_PROTOCOL gGraphicsConsoleDriverBinding = {
   GraphicsConsoleControllerDriverSupported,
   GraphicsConsoleControllerDriverStart,
@@ -538,6 +550,10 @@ Error:
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->ShadowBuffer != NULL) {
+      FreePool (Private->ShadowBuffer);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -619,6 +635,10 @@ GraphicsConsoleControllerDriverStop (
       FreePool (Private->LineBuffer);
     }
 
+    if (Private->ShadowBuffer != NULL) {
+      FreePool (Private->ShadowBuffer);
+    }
+
     if (Private->ModeData != NULL) {
       FreePool (Private->ModeData);
     }
@@ -809,8 +829,8 @@ GraphicsConsoleConOutOutputString (
   UINTN                 Delta;
   EFI_STATUS            Status;
   BOOLEAN               Warning;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Foreground;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL  Background;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Foreground;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  Background;
   UINTN                 DeltaX;
   UINTN                 DeltaY;
   UINTN                 Count;
@@ -846,7 +866,7 @@ GraphicsConsoleConOutOutputString (
   //
   // The Attributes won't change when during the time OutputString is called
   //
-  GetTextColors (This, &Foreground, &Background);
+  GetTextColors (This, &Foreground.Pixel, &Background.Pixel);
 
   FlushCursor (This);
 
@@ -892,34 +912,31 @@ GraphicsConsoleConOutOutputString (
       //
       if (This->Mode->CursorRow == (INT32)(MaxRow - 1)) {
         //
-        // Scroll Screen Up One Row
+        // Scroll the shadow buffer up one row and blank the last row, then
+        // write the text area out in one go rather than moving it within
+        // the uncached frame buffer.
         //
-        GraphicsOutput->Blt (
-                          GraphicsOutput,
-                          NULL,
-                          EfiBltVideoToVideo,
-                          DeltaX,
-                          DeltaY + EFI_GLYPH_HEIGHT,
-                          DeltaX,
-                          DeltaY,
-                          Width,
-                          Height,
-                          Delta
-                        );
+        CopyMem (
+          Private->ShadowBuffer,
+          Private->ShadowBuffer + Width * EFI_GLYPH_HEIGHT,
+          Height * Delta
+          );
+        SetMem32 (
+          Private->ShadowBuffer + Width * Height,
+          EFI_GLYPH_HEIGHT * Delta,
+          Background.Raw
+          );
 
-        //
-        // Print Blank Line at last line
-        //
         GraphicsOutput->Blt (
                           GraphicsOutput,
-                          &Background,
-                          EfiBltVideoFill,
+                          Private->ShadowBuffer,
+                          EfiBltBufferToVideo,
                           0,
                           0,
                           DeltaX,
-                          DeltaY + Height,
+                          DeltaY,
                           Width,
-                          EFI_GLYPH_HEIGHT,
+                          Height + EFI_GLYPH_HEIGHT,
                           Delta
                         );
       } else {
@@ -1164,6 +1181,7 @@ GraphicsConsoleConOutSetMode (
   GRAPHICS_CONSOLE_DEV            *Private;
   GRAPHICS_CONSOLE_MODE_DATA      *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *NewLineBuffer;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL   *NewShadowBuffer;
   EFI_GRAPHICS_OUTPUT_PROTOCOL    *GraphicsOutput;
   EFI_TPL                         OldTpl;
 
@@ -1210,6 +1228,14 @@ GraphicsConsoleConOutSetMode (
     FlushCursor (This);
 
     FreePool (Private->LineBuffer);
+    Private->LineBuffer = NULL;
+    FreePool (Private->ShadowBuffer);
+    Private->ShadowBuffer = NULL;
+
+    //
+    // There is no shadow buffer until the new mode is committed below.
+    //
+    This->Mode->Mode = -1;
   }
 
   //
@@ -1226,10 +1252,24 @@ GraphicsConsoleConOutSetMode (
     goto Done;
   }
 
+  //
+  // The display is cleared to black below, which is what a zeroed shadow
+  // buffer holds.
+  //
+  NewShadowBuffer = AllocateZeroPool (sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) *
+                      ModeData->Columns * EFI_GLYPH_WIDTH *
+                      ModeData->Rows * EFI_GLYPH_HEIGHT);
+  if (NewShadowBuffer == NULL) {
+    FreePool (NewLineBuffer);
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
   //
   // Assign the current line buffer to the newly allocated line buffer
   //
   Private->LineBuffer = NewLineBuffer;
+  Private->ShadowBuffer = NewShadowBuffer;
 
   if (ModeData->GopModeNumber != GraphicsOutput->Mode->Mode) {
     //
@@ -1352,8 +1392,8 @@ GraphicsConsoleConOutClearScreen (
   GRAPHICS_CONSOLE_DEV          *Private;
   GRAPHICS_CONSOLE_MODE_DATA    *ModeData;
   EFI_GRAPHICS_OUTPUT_PROTOCOL  *GraphicsOutput;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Foreground;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL Background;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Foreground;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Background;
   EFI_TPL                       OldTpl;
 
   if (This->Mode->Mode == -1) {
@@ -1369,10 +1409,16 @@ GraphicsConsoleConOutClearScreen (
   GraphicsOutput = Private->GraphicsOutput;
   ModeData = &(Private->ModeData[This->Mode->Mode]);
 
-  GetTextColors (This, &Foreground, &Background);
+  GetTextColors (This, &Foreground.Pixel, &Background.Pixel);
+  SetMem32 (
+    Private->ShadowBuffer,
+    sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) *
+    ModeData->Columns * EFI_GLYPH_WIDTH * ModeData->Rows * EFI_GLYPH_HEIGHT,
+    Background.Raw
+    );
   Status = GraphicsOutput->Blt (
                              GraphicsOutput,
-                             &Background,
+                             &Background.Pixel,
                              EfiBltVideoFill,
                              0,
                              0,
@@ -1534,42 +1580,187 @@ GetTextColors (
 }
 
 /**
-  Draw Unicode string on the Graphics Console device's screen.
+  Build the lookup table used by GetCachedGlyph () from the narrow glyphs
+  of gUsStdNarrowGlyphData.
+
+**/
+VOID
+InitializeGlyphCache (
+  VOID
+  )
+{
+  UINTN     Index;
+  UINTN     Slot;
+  CHAR16    UnicodeWeight;
+
+  //
+  // The last entry only terminates the list.
+  //
+  mGlyphCount = mNarrowFontSize / sizeof (EFI_NARROW_GLYPH) - 1;
+
+  mGlyphIndexSize = 1;
+  while (mGlyphIndexSize < 2 * mGlyphCount) {
+    mGlyphIndexSize <<= 1;
+  }
+
+  mGlyphIndex = AllocateZeroPool (mGlyphIndexSize * sizeof (UINT16));
+  if (mGlyphIndex == NULL) {
+    //
+    // Every character will be drawn through the HII font protocol.
+    //
+    return;
+  }
+
+  for (Index = 0; Index < mGlyphCount; Index++) {
+    UnicodeWeight = gUsStdNarrowGlyphData[Index].UnicodeWeight;
+    for (Slot = UnicodeWeight & (mGlyphIndexSize - 1);
+         mGlyphIndex[Slot] != 0;
+         Slot = (Slot + 1) & (mGlyphIndexSize - 1)) {
+      if (gUsStdNarrowGlyphData[mGlyphIndex[Slot] - 1].UnicodeWeight == UnicodeWeight) {
+        break;
+      }
+    }
+    if (mGlyphIndex[Slot] == 0) {
+      mGlyphIndex[Slot] = (UINT16)(Index + 1);
+    }
+  }
+}
+
+/**
+  Get a narrow glyph of gUsStdNarrowGlyphData rendered in the colours of
+  the given text attribute, rendering it first if needed.
+
+  @param  UnicodeWeight         The character to look up.
+  @param  Attribute             The text attribute giving the colours.
+
+  @return EFI_GLYPH_WIDTH * EFI_GLYPH_HEIGHT pixels, or NULL if the font
+          has no glyph for the character or memory ran out.
+
+**/
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+GetCachedGlyph (
+  IN  CHAR16                           UnicodeWeight,
+  IN  INTN                             Attribute
+  )
+{
+  UINTN                             Slot;
+  UINTN                             GlyphIndex;
+  GLYPH_CACHE_SLOT                  *Cache;
+  EFI_NARROW_GLYPH                  *Glyph;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Pixels;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     Foreground;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     Background;
+  UINTN                             PosX;
+  UINTN                             PosY;
+
+  if (mGlyphIndex == NULL) {
+    return NULL;
+  }
+
+  Attribute &= 0x7F;
+
+  for (Slot = UnicodeWeight & (mGlyphIndexSize - 1);
+       mGlyphIndex[Slot] != 0;
+       Slot = (Slot + 1) & (mGlyphIndexSize - 1)) {
+    if (gUsStdNarrowGlyphData[mGlyphIndex[Slot] - 1].UnicodeWeight == UnicodeWeight) {
+      break;
+    }
+  }
+  if (mGlyphIndex[Slot] == 0) {
+    return NULL;
+  }
+  GlyphIndex = mGlyphIndex[Slot] - 1;
+
+  //
+  // Find the colour pair, or take over the least recently used slot.
+  //
+  Cache = &mGlyphCache[0];
+  for (Slot = 0; Slot < GLYPH_CACHE_SLOTS; Slot++) {
+    if (mGlyphCache[Slot].Pixels != NULL &&
+        mGlyphCache[Slot].Attribute == Attribute) {
+      Cache = &mGlyphCache[Slot];
+      break;
+    }
+    if (mGlyphCache[Slot].LastUsed < Cache->LastUsed) {
+      Cache = &mGlyphCache[Slot];
+    }
+  }
+
+  if (Slot == GLYPH_CACHE_SLOTS) {
+    if (Cache->Pixels == NULL) {
+      Cache->Pixels = AllocatePool (sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL) *
+                        EFI_GLYPH_WIDTH * EFI_GLYPH_HEIGHT * mGlyphCount);
+      Cache->Rendered = AllocatePool (sizeof (BOOLEAN) * mGlyphCount);
+      if (Cache->Pixels == NULL || Cache->Rendered == NULL) {
+        if (Cache->Pixels != NULL) {
+          FreePool (Cache->Pixels);
+          Cache->Pixels = NULL;
+        }
+        if (Cache->Rendered != NULL) {
+          FreePool (Cache->Rendered);
+          Cache->Rendered = NULL;
+        }
+        return NULL;
+      }
+    }
+    ZeroMem (Cache->Rendered, sizeof (BOOLEAN) * mGlyphCount);
+    Cache->Attribute = (INT32)Attribute;
+  }
+
+  Cache->LastUsed = ++mGlyphCacheTick;
+
+  Pixels = Cache->Pixels + GlyphIndex * EFI_GLYPH_WIDTH * EFI_GLYPH_HEIGHT;
+  if (!Cache->Rendered[GlyphIndex]) {
+    Glyph = &gUsStdNarrowGlyphData[GlyphIndex];
+    Foreground = mGraphicsEfiColors[Attribute & 0x0f];
+    Background = mGraphicsEfiColors[Attribute >> 4];
+    for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+      for (PosX = 0; PosX < EFI_GLYPH_WIDTH; PosX++) {
+        Pixels[PosY * EFI_GLYPH_WIDTH + EFI_GLYPH_WIDTH - PosX - 1] =
+          ((Glyph->GlyphCol1[PosY] & (BIT0 << PosX)) != 0) ? Foreground : Background;
+      }
+    }
+    Cache->Rendered[GlyphIndex] = TRUE;
+  }
+
+  return Pixels;
+}
+
+/**
+  Draw Unicode string into the Graphics Console device's shadow buffer
+  using the HII Font protocol.
 
   @param  This                  Protocol instance pointer.
   @param  UnicodeWeight         One Unicode string to be displayed.
   @param  Count                 The count of Unicode string.
+  @param  X                     Horizontal position in the shadow buffer.
+  @param  Y                     Vertical position in the shadow buffer.
 
   @retval EFI_OUT_OF_RESOURCES  If no memory resource to use.
-  @retval EFI_UNSUPPORTED       If no Graphics Output Protocol exists.
   @retval EFI_SUCCESS           Drawing Unicode string implemented successfully.
 
 **/
+STATIC
 EFI_STATUS
-DrawUnicodeWeightAtCursorN (
+DrawHiiStringToShadow (
   IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
   IN  CHAR16                           *UnicodeWeight,
-  IN  UINTN                            Count
+  IN  UINTN                            Count,
+  IN  UINTN                            X,
+  IN  UINTN                            Y
   )
 {
   EFI_STATUS                        Status;
   GRAPHICS_CONSOLE_DEV              *Private;
+  EFI_IMAGE_OUTPUT                  Image;
   EFI_IMAGE_OUTPUT                  *Blt;
   EFI_STRING                        String;
-  EFI_FONT_DISPLAY_INFO             *FontInfo;
+  EFI_FONT_DISPLAY_INFO             FontInfo;
 
   Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
-  Blt = (EFI_IMAGE_OUTPUT*)AllocateZeroPool (sizeof (EFI_IMAGE_OUTPUT));
-  if (Blt == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  Blt->Width  = (UINT16)(Private->ModeData[This->Mode->Mode].GopWidth);
-  Blt->Height = (UINT16)(Private->ModeData[This->Mode->Mode].GopHeight);
 
   String = AllocateCopyPool ((Count + 1) * sizeof (CHAR16), UnicodeWeight);
   if (String == NULL) {
-    FreePool (Blt);
     return EFI_OUT_OF_RESOURCES;
   }
   //
@@ -1577,44 +1768,126 @@ DrawUnicodeWeightAtCursorN (
   //
   *(String + Count) = L'\0';
 
-  FontInfo = (EFI_FONT_DISPLAY_INFO*)AllocateZeroPool (sizeof (EFI_FONT_DISPLAY_INFO));
-  if (FontInfo == NULL) {
-    FreePool (Blt);
-    FreePool (String);
-    return EFI_OUT_OF_RESOURCES;
-  }
-  //
-  // Get current foreground and background colors.
-  //
-  GetTextColors (This, &FontInfo->ForegroundColor, &FontInfo->BackgroundColor);
+  ZeroMem (&FontInfo, sizeof (FontInfo));
+  GetTextColors (This, &FontInfo.ForegroundColor, &FontInfo.BackgroundColor);
 
   //
-  // If Graphics Output protocol exists, using HII Font protocol to draw.
+  // Let the HII Font protocol render straight into the shadow buffer.
   //
-  Blt->Image.Screen = Private->GraphicsOutput;
+  Image.Width  = (UINT16)(Private->ModeData[This->Mode->Mode].Columns * EFI_GLYPH_WIDTH);
+  Image.Height = (UINT16)(Private->ModeData[This->Mode->Mode].Rows * EFI_GLYPH_HEIGHT);
+  Image.Image.Bitmap = Private->ShadowBuffer;
+  Blt = &Image;
 
   Status = mHiiFont->StringToImage (
                        mHiiFont,
-                       EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_DIRECT_TO_SCREEN | EFI_HII_IGNORE_LINE_BREAK,
+                       EFI_HII_IGNORE_IF_NO_GLYPH | EFI_HII_IGNORE_LINE_BREAK,
                        String,
-                       FontInfo,
+                       &FontInfo,
                        &Blt,
-                       This->Mode->CursorColumn * EFI_GLYPH_WIDTH + Private->ModeData[This->Mode->Mode].DeltaX,
-                       This->Mode->CursorRow * EFI_GLYPH_HEIGHT + Private->ModeData[This->Mode->Mode].DeltaY,
+                       X,
+                       Y,
                        NULL,
                        NULL,
                        NULL
                      );
 
-  if (Blt != NULL) {
-    FreePool (Blt);
+  FreePool (String);
+  return Status;
+}
+
+/**
+  Draw Unicode string on the Graphics Console device's screen.
+
+  Narrow characters found in gUsStdNarrowGlyphData are copied from the
+  glyph cache, anything else is rendered by the HII Font protocol. The
+  text is drawn into the shadow buffer and then written to the screen
+  with a single Blt () call.
+
+  @param  This                  Protocol instance pointer.
+  @param  UnicodeWeight         One Unicode string to be displayed.
+  @param  Count                 The count of Unicode string.
+
+  @retval EFI_OUT_OF_RESOURCES  If no memory resource to use.
+  @retval EFI_UNSUPPORTED       If no Graphics Output Protocol exists.
+  @retval EFI_SUCCESS           Drawing Unicode string implemented successfully.
+
+**/
+EFI_STATUS
+DrawUnicodeWeightAtCursorN (
+  IN  EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+  IN  CHAR16                           *UnicodeWeight,
+  IN  UINTN                            Count
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_STATUS                        DrawStatus;
+  GRAPHICS_CONSOLE_DEV              *Private;
+  GRAPHICS_CONSOLE_MODE_DATA        *ModeData;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Glyph;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL     *Dest;
+  UINTN                             ShadowWidth;
+  UINTN                             X;
+  UINTN                             Y;
+  UINTN                             Width;
+  UINTN                             Index;
+  UINTN                             PosY;
+
+  Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
+  ModeData = &Private->ModeData[This->Mode->Mode];
+
+  ShadowWidth = ModeData->Columns * EFI_GLYPH_WIDTH;
+  X = This->Mode->CursorColumn * EFI_GLYPH_WIDTH;
+  Y = This->Mode->CursorRow * EFI_GLYPH_HEIGHT;
+
+  Status = EFI_SUCCESS;
+  if ((This->Mode->Attribute & EFI_WIDE_ATTRIBUTE) != 0) {
+    Status = DrawHiiStringToShadow (This, UnicodeWeight, Count, X, Y);
+    Width = 2 * Count * EFI_GLYPH_WIDTH;
+  } else {
+    for (Index = 0; Index < Count; Index++) {
+      Glyph = GetCachedGlyph (UnicodeWeight[Index], This->Mode->Attribute);
+      if (Glyph == NULL) {
+        DrawStatus = DrawHiiStringToShadow (This, &UnicodeWeight[Index], 1,
+                       X + Index * EFI_GLYPH_WIDTH, Y);
+        if (EFI_ERROR (DrawStatus)) {
+          Status = DrawStatus;
+        }
+        continue;
+      }
+
+      Dest = Private->ShadowBuffer + Y * ShadowWidth + X + Index * EFI_GLYPH_WIDTH;
+      for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
+        CopyMem (
+          Dest + PosY * ShadowWidth,
+          Glyph + PosY * EFI_GLYPH_WIDTH,
+          EFI_GLYPH_WIDTH * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+          );
+      }
+    }
+    Width = Count * EFI_GLYPH_WIDTH;
   }
-  if (String != NULL) {
-    FreePool (String);
+
+  if (X + Width > ShadowWidth) {
+    Width = ShadowWidth - X;
   }
-  if (FontInfo != NULL) {
-    FreePool (FontInfo);
+  if (Width == 0) {
+    return Status;
   }
+
+  Private->GraphicsOutput->Blt (
+                             Private->GraphicsOutput,
+                             Private->ShadowBuffer,
+                             EfiBltBufferToVideo,
+                             X,
+                             Y,
+                             X + ModeData->DeltaX,
+                             Y + ModeData->DeltaY,
+                             Width,
+                             EFI_GLYPH_HEIGHT,
+                             ShadowWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                           );
+
   return Status;
 }
 
@@ -1643,7 +1916,8 @@ FlushCursor (
   EFI_GRAPHICS_OUTPUT_PROTOCOL        *GraphicsOutput;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Foreground;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION Background;
-  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION BltChar[EFI_GLYPH_HEIGHT][EFI_GLYPH_WIDTH];
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION *BltChar;
+  UINTN                               ShadowWidth;
   UINTN                               PosX;
   UINTN                               PosY;
 
@@ -1656,27 +1930,26 @@ FlushCursor (
   Private = GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS (This);
   GraphicsOutput = Private->GraphicsOutput;
 
+  if (Private->ShadowBuffer == NULL) {
+    return EFI_SUCCESS;
+  }
+
   //
   // In this driver, only narrow character was supported.
   //
   //
   // Blt a character to the screen
   //
-  GlyphX = (CurrentMode->CursorColumn * EFI_GLYPH_WIDTH) + Private->ModeData[CurrentMode->Mode].DeltaX;
-  GlyphY = (CurrentMode->CursorRow * EFI_GLYPH_HEIGHT) + Private->ModeData[CurrentMode->Mode].DeltaY;
+  GlyphX = CurrentMode->CursorColumn * EFI_GLYPH_WIDTH;
+  GlyphY = CurrentMode->CursorRow * EFI_GLYPH_HEIGHT;
 
-  GraphicsOutput->Blt (
-                    GraphicsOutput,
-                    (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)BltChar,
-                    EfiBltVideoToBltBuffer,
-                    GlyphX,
-                    GlyphY,
-                    0,
-                    0,
-                    EFI_GLYPH_WIDTH,
-                    EFI_GLYPH_HEIGHT,
-                    EFI_GLYPH_WIDTH * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
-                  );
+  //
+  // The shadow buffer holds what is on the screen, so the character cell
+  // need not be read back from the frame buffer.
+  //
+  ShadowWidth = Private->ModeData[CurrentMode->Mode].Columns * EFI_GLYPH_WIDTH;
+  BltChar = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION*)Private->ShadowBuffer +
+            GlyphY * ShadowWidth + GlyphX;
 
   GetTextColors (This, &Foreground.Pixel, &Background.Pixel);
 
@@ -1686,22 +1959,22 @@ FlushCursor (
   for (PosY = 0; PosY < EFI_GLYPH_HEIGHT; PosY++) {
     for (PosX = 0; PosX < EFI_GLYPH_WIDTH; PosX++) {
       if ((mCursorGlyph.GlyphCol1[PosY] & (BIT0 << PosX)) != 0) {
-        BltChar[PosY][EFI_GLYPH_WIDTH - PosX - 1].Raw ^= Foreground.Raw;
+        BltChar[PosY * ShadowWidth + EFI_GLYPH_WIDTH - PosX - 1].Raw ^= Foreground.Raw;
       }
     }
   }
 
   GraphicsOutput->Blt (
                     GraphicsOutput,
-                    (EFI_GRAPHICS_OUTPUT_BLT_PIXEL*)BltChar,
+                    Private->ShadowBuffer,
                     EfiBltBufferToVideo,
-                    0,
-                    0,
                     GlyphX,
                     GlyphY,
+                    GlyphX + Private->ModeData[CurrentMode->Mode].DeltaX,
+                    GlyphY + Private->ModeData[CurrentMode->Mode].DeltaY,
                     EFI_GLYPH_WIDTH,
                     EFI_GLYPH_HEIGHT,
-                    EFI_GLYPH_WIDTH * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
+                    ShadowWidth * sizeof (EFI_GRAPHICS_OUTPUT_BLT_PIXEL)
                   );
 
   return EFI_SUCCESS;
@@ -1803,6 +2076,8 @@ InitializeGraphicsConsole (
 {
   EFI_STATUS              Status;
 
+  InitializeGlyphCache ();
+
   //
   // Register notify function on HII Database Protocol to add font package.
   //
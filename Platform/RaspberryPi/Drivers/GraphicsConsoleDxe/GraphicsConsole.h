@@ -60,12 +60,31 @@ typedef struct {
   EFI_SIMPLE_TEXT_OUTPUT_MODE      SimpleTextOutputMode;
   GRAPHICS_CONSOLE_MODE_DATA       *ModeData;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *LineBuffer;
+  //
+  // Copy of the text area of the screen, Columns * EFI_GLYPH_WIDTH pixels
+  // wide and Rows * EFI_GLYPH_HEIGHT pixels high, kept in cached memory.
+  // Text is drawn here first and then written out to the frame buffer.
+  //
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *ShadowBuffer;
   EXTENDED_TEXT_OUTPUT_PROTOCOL    ExtendedTextOutput;
 } GRAPHICS_CONSOLE_DEV;
 
 #define GRAPHICS_CONSOLE_CON_OUT_DEV_FROM_THIS(a) \
   CR (a, GRAPHICS_CONSOLE_DEV, SimpleTextOutput, GRAPHICS_CONSOLE_DEV_SIGNATURE)
 
+//
+// Number of foreground/background colour pairs for which rendered
+// glyphs are kept.
+//
+#define GLYPH_CACHE_SLOTS   4
+
+typedef struct {
+  INT32                            Attribute;
+  UINTN                            LastUsed;
+  BOOLEAN                          *Rendered;
+  EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *Pixels;
+} GLYPH_CACHE_SLOT;
+
 
 //
 // EFI Component Name Functions
@@ -518,6 +537,33 @@ GetTextColors (
   OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL    *Background
   );
 
+/**
+  Build the lookup table used by GetCachedGlyph () from the narrow glyphs
+  of gUsStdNarrowGlyphData.
+
+**/
+VOID
+InitializeGlyphCache (
+  VOID
+  );
+
+/**
+  Get a narrow glyph of gUsStdNarrowGlyphData rendered in the colours of
+  the given text attribute, rendering it first if needed.
+
+  @param  UnicodeWeight         The character to look up.
+  @param  Attribute             The text attribute giving the colours.
+
+  @return EFI_GLYPH_WIDTH * EFI_GLYPH_HEIGHT pixels, or NULL if the font
+          has no glyph for the character or memory ran out.
+
+**/
+EFI_GRAPHICS_OUTPUT_BLT_PIXEL *
+GetCachedGlyph (
+  IN  CHAR16                           UnicodeWeight,
+  IN  INTN                             Attribute
+  );
+
 /**
   Draw Unicode string on the Graphics Console device's screen.
 
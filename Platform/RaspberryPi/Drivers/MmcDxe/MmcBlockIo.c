@@ -229,10 +229,20 @@ MmcTransferBlock (
   MMC_HOST_INSTANCE       *MmcHostInstance;
   EFI_MMC_HOST_PROTOCOL   *MmcHost;
   UINTN                   CmdArg;
+  BOOLEAN                 UseCmd23;
+  UINTN                   BlocksWritten;
 
   MmcHostInstance = MMC_HOST_INSTANCE_FROM_BLOCK_IO_THIS (This);
   MmcHost = MmcHostInstance->MmcHost;
 
+  //
+  // With a pre-defined block count (CMD23) the card leaves the data
+  // state on its own after the last block, so no CMD12 is needed.
+  //
+  UseCmd23 = (Cmd == MMC_CMD18 || Cmd == MMC_CMD25) &&
+             MmcHostInstance->CardInfo.Cmd23Supported &&
+             PcdGet32 (PcdMmcEnableCmd23) != 0;
+
   //Set command argument based on the card access mode (Byte mode or Block mode)
   if ((MmcHostInstance->CardInfo.OCRData.AccessMode & MMC_OCR_ACCESS_MASK) ==
       MMC_OCR_ACCESS_SECTOR) {
@@ -241,6 +251,15 @@ MmcTransferBlock (
     CmdArg = Lba * This->Media->BlockSize;
   }
 
+  if (UseCmd23) {
+    Status = MmcHost->SendCommand (MmcHost, MMC_CMD23,
+               BufferSize / This->Media->BlockSize);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a(MMC_CMD23): Error %r\n", __func__, Status));
+      return Status;
+    }
+  }
+
   Status = MmcHost->SendCommand (MmcHost, Cmd, CmdArg);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "%a(MMC_CMD%d): Error %r\n", __func__, MMC_INDX (Cmd), Status));
@@ -261,10 +280,10 @@ MmcTransferBlock (
   }
 
   if (EFI_ERROR (Status) ||
-      BufferSize > This->Media->BlockSize) {
+      (BufferSize > This->Media->BlockSize && !UseCmd23)) {
     /*
-     * CMD12 needs to be set for multiblock (to transition from
-     * RECV to PROG) or for errors.
+     * CMD12 needs to be set for open-ended multiblock (to transition
+     * from RECV to PROG) or for errors.
      */
     EFI_STATUS Status2 = MmcStopTransmission (MmcHost);
     if (EFI_ERROR (Status2)) {
@@ -283,9 +302,15 @@ MmcTransferBlock (
   }
 
   //
-  // For reads, should be already in TRAN. For writes, wait
-  // until programming finishes.
+  // For reads, the card is already back in TRAN: skip the CMD13 poll
+  // so back-to-back reads are not serialized on a status round trip.
+  // For writes, wait until programming finishes.
   //
+  if (Transfer == MMC_IOBLOCKS_READ) {
+    *TransferredSize = BufferSize;
+    return EFI_SUCCESS;
+  }
+
   Status = WaitUntilTran (MmcHostInstance);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "WaitUntilTran after write failed\n"));
@@ -298,17 +323,12 @@ MmcTransferBlock (
     return Status;
   }
 
-  if (Transfer != MMC_IOBLOCKS_READ) {
-    UINTN BlocksWritten = 0;
-
-    Status = ValidateWrittenBlockCount (MmcHostInstance,
-               BufferSize /
-               This->Media->BlockSize,
-               &BlocksWritten);
-    *TransferredSize = BlocksWritten * This->Media->BlockSize;
-  } else {
-    *TransferredSize = BufferSize;
-  }
+  BlocksWritten = 0;
+  Status = ValidateWrittenBlockCount (MmcHostInstance,
+             BufferSize /
+             This->Media->BlockSize,
+             &BlocksWritten);
+  *TransferredSize = BlocksWritten * This->Media->BlockSize;
 
   return Status;
 }
@@ -380,14 +400,18 @@ MmcIoBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
+  //
+  // Every chunk leaves the card in TRAN (writes wait for programming
+  // to finish), so checking once up front is enough.
+  //
+  Status = WaitUntilTran (MmcHostInstance);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "WaitUntilTran before IO failed"));
+    return Status;
+  }
+
   BytesRemainingToBeTransfered = BufferSize;
   while (BytesRemainingToBeTransfered > 0) {
-    Status = WaitUntilTran (MmcHostInstance);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "WaitUntilTran before IO failed"));
-      return Status;
-    }
-
     if (Transfer == MMC_IOBLOCKS_READ) {
       if (BlockCount == 1) {
         // Read a single block
@@ -461,3 +485,91 @@ MmcFlushBlocks (
 {
   return EFI_SUCCESS;
 }
+
+EFI_STATUS
+EFIAPI
+MmcResetEx (
+  IN EFI_BLOCK_IO2_PROTOCOL   *This,
+  IN BOOLEAN                  ExtendedVerification
+  )
+{
+  MMC_HOST_INSTANCE       *MmcHostInstance;
+
+  MmcHostInstance = MMC_HOST_INSTANCE_FROM_BLOCK_IO2_THIS (This);
+
+  return MmcReset (&MmcHostInstance->BlockIo, ExtendedVerification);
+}
+
+STATIC
+EFI_STATUS
+MmcCompleteToken (
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     EFI_STATUS             Status
+  )
+{
+  //
+  // Errors are reported synchronously, without signalling the event.
+  //
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if ((Token != NULL) && (Token->Event != NULL)) {
+    Token->TransactionStatus = EFI_SUCCESS;
+    gBS->SignalEvent (Token->Event);
+  }
+
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+MmcReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  OUT    VOID                   *Buffer
+  )
+{
+  MMC_HOST_INSTANCE       *MmcHostInstance;
+  EFI_STATUS              Status;
+
+  MmcHostInstance = MMC_HOST_INSTANCE_FROM_BLOCK_IO2_THIS (This);
+
+  Status = MmcIoBlocks (&MmcHostInstance->BlockIo, MMC_IOBLOCKS_READ,
+             MediaId, Lba, BufferSize, Buffer);
+  return MmcCompleteToken (Token, Status);
+}
+
+EFI_STATUS
+EFIAPI
+MmcWriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN     UINT32                 MediaId,
+  IN     EFI_LBA                Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token,
+  IN     UINTN                  BufferSize,
+  IN     VOID                   *Buffer
+  )
+{
+  MMC_HOST_INSTANCE       *MmcHostInstance;
+  EFI_STATUS              Status;
+
+  MmcHostInstance = MMC_HOST_INSTANCE_FROM_BLOCK_IO2_THIS (This);
+
+  Status = MmcIoBlocks (&MmcHostInstance->BlockIo, MMC_IOBLOCKS_WRITE,
+             MediaId, Lba, BufferSize, Buffer);
+  return MmcCompleteToken (Token, Status);
+}
+
+EFI_STATUS
+EFIAPI
+MmcFlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN    *Token
+  )
+{
+  return MmcCompleteToken (Token, EFI_SUCCESS);
+}
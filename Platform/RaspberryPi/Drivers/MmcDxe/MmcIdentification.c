@@ -264,6 +264,10 @@ InitializeEmmcDevice (
 
   Host = MmcHostInstance->MmcHost;
   ECSDData = MmcHostInstance->CardInfo.ECSDData;
+
+  // eMMC always supports SET_BLOCK_COUNT.
+  MmcHostInstance->CardInfo.Cmd23Supported = TRUE;
+
   if (ECSDData->DEVICE_TYPE == EMMCBACKWARD) {
     return EFI_SUCCESS;
   }
@@ -675,6 +679,9 @@ InitializeSdMmcDevice (
      return Status;
   }
 
+  MmcHostInstance->CardInfo.Cmd23Supported =
+    (Scr.CMD_SUPPORT & SD_SCR_CMD_SUPPORT_CMD23) != 0;
+
   if (Scr.SD_SPEC == 2) {
     if (Scr.SD_SPEC3 == 1) {
       if (Scr.SD_SPEC4 == 1) {
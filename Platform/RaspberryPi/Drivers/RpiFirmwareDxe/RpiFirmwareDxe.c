@@ -42,6 +42,37 @@ STATIC UINTN mDmaBufferBusAddress;
 
 STATIC SPIN_LOCK mMailboxLock;
 
+//
+// Properties that cannot change while UEFI is running. They are fetched
+// with a single mailbox transaction when the driver starts, and on first
+// use if that failed for any of them.
+//
+#define RPI_FW_CACHE_ARM_MEMORY         BIT0
+#define RPI_FW_CACHE_MAC_ADDRESS        BIT1
+#define RPI_FW_CACHE_SERIAL             BIT2
+#define RPI_FW_CACHE_MODEL              BIT3
+#define RPI_FW_CACHE_MODEL_REVISION     BIT4
+#define RPI_FW_CACHE_FIRMWARE_REVISION  BIT5
+
+#define RPI_FW_CACHE_NUM_CLOCKS         (RPI_MBOX_CLOCK_RATE_PWM + 1)
+
+typedef struct {
+  UINT32    Valid;
+  UINT32    ArmMemoryBase;
+  UINT32    ArmMemorySize;
+  UINT8     MacAddress[6];
+  UINT64    Serial;
+  UINT32    Model;
+  UINT32    ModelRevision;
+  UINT32    FirmwareRevision;
+  UINT32    MaxClockRateValid;
+  UINT32    MinClockRateValid;
+  UINT32    MaxClockRate[RPI_FW_CACHE_NUM_CLOCKS];
+  UINT32    MinClockRate[RPI_FW_CACHE_NUM_CLOCKS];
+} RPI_FW_PROPERTY_CACHE;
+
+STATIC RPI_FW_PROPERTY_CACHE mCache;
+
 STATIC
 BOOLEAN
 DrainMailbox (
@@ -228,6 +259,116 @@ RpiFirmwareSetPowerState (
   return Status;
 }
 
+/**
+  Query several firmware properties with a single mailbox transaction.
+
+  @param  Count       Number of entries in Properties.
+  @param  Properties  Property tags to query. See RPI_FIRMWARE_PROPERTY.
+
+  @retval EFI_SUCCESS             The firmware answered every tag.
+  @retval EFI_INVALID_PARAMETER   Count is 0, Properties is NULL or an entry
+                                  has a NULL Buffer.
+  @retval EFI_BAD_BUFFER_SIZE     The tags do not fit in one message.
+  @retval EFI_DEVICE_ERROR        The transaction failed, or the firmware did
+                                  not answer at least one tag.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+RpiFirmwareGetProperties (
+  IN      UINTN                   Count,
+  IN OUT  RPI_FIRMWARE_PROPERTY   *Properties
+  )
+{
+  RPI_FW_BUFFER_HEAD          *Head;
+  RPI_FW_TAG_HEAD             *Tag;
+  UINT8                       *Ptr;
+  UINTN                       Index;
+  UINTN                       Size;
+  UINT32                      ValueSize;
+  EFI_STATUS                  Status;
+  UINT32                      Result;
+
+  if (Count == 0 || Properties == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Size = sizeof (RPI_FW_BUFFER_HEAD) + sizeof (UINT32);
+  for (Index = 0; Index < Count; Index++) {
+    if (Properties[Index].Buffer == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    Size += sizeof (RPI_FW_TAG_HEAD) +
+            ALIGN_VALUE (Properties[Index].BufferSize, sizeof (UINT32));
+    if (Size > EFI_PAGES_TO_SIZE (NUM_PAGES)) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+  }
+
+  if (!AcquireSpinLockOrFail (&mMailboxLock)) {
+    DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
+    return EFI_DEVICE_ERROR;
+  }
+
+  Head = mDmaBuffer;
+  ZeroMem (Head, Size);
+
+  Head->BufferSize = (UINT32)Size;
+  Head->Response = 0;
+
+  Ptr = (UINT8 *)(Head + 1);
+  for (Index = 0; Index < Count; Index++) {
+    Tag = (RPI_FW_TAG_HEAD *)Ptr;
+    Tag->TagId = Properties[Index].TagId;
+    Tag->TagSize = ALIGN_VALUE (Properties[Index].BufferSize, sizeof (UINT32));
+    Tag->TagValueSize = 0;
+    CopyMem (Tag + 1, Properties[Index].Buffer, Properties[Index].BufferSize);
+    Ptr += sizeof (*Tag) + Tag->TagSize;
+  }
+  //
+  // The end tag is already zero.
+  //
+
+  Status = MailboxTransaction (Head->BufferSize, RPI_MBOX_VC_CHANNEL, &Result);
+
+  if (EFI_ERROR (Status) ||
+      Head->Response != RPI_MBOX_RESP_SUCCESS) {
+    DEBUG ((DEBUG_ERROR,
+      "%a: mailbox transaction error: Status == %r, Response == 0x%x\n",
+      __FUNCTION__, Status, Head->Response));
+    ReleaseSpinLock (&mMailboxLock);
+    return EFI_DEVICE_ERROR;
+  }
+
+  //
+  // Copy the values out before releasing the lock, as the next caller
+  // will reuse the DMA buffer. Walk the tags using the sizes we wrote
+  // rather than anything the firmware returned.
+  //
+  Ptr = (UINT8 *)(Head + 1);
+  for (Index = 0; Index < Count; Index++) {
+    Tag = (RPI_FW_TAG_HEAD *)Ptr;
+    if ((Tag->TagValueSize & RPI_MBOX_VALUE_SIZE_RESPONSE_MASK) != 0) {
+      ValueSize = Tag->TagValueSize & ~RPI_MBOX_VALUE_SIZE_RESPONSE_MASK;
+      Properties[Index].ResponseSize = ValueSize;
+      CopyMem (Properties[Index].Buffer, Tag + 1,
+        MIN (ValueSize, Properties[Index].BufferSize));
+    } else {
+      DEBUG ((DEBUG_WARN, "%a: no response for tag 0x%x\n",
+        __FUNCTION__, Properties[Index].TagId));
+      Properties[Index].ResponseSize = 0;
+      Status = EFI_DEVICE_ERROR;
+    }
+    Ptr += sizeof (*Tag) +
+           ALIGN_VALUE (Properties[Index].BufferSize, sizeof (UINT32));
+  }
+
+  ReleaseSpinLock (&mMailboxLock);
+
+  return Status;
+}
+
 #pragma pack()
 typedef struct {
   UINT32                    Base;
@@ -254,6 +395,12 @@ RpiFirmwareGetArmMemory (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_ARM_MEMORY) != 0) {
+    *Base = mCache.ArmMemoryBase;
+    *Size = mCache.ArmMemorySize;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -283,6 +430,10 @@ RpiFirmwareGetArmMemory (
 
   *Base = Cmd->TagBody.Base;
   *Size = Cmd->TagBody.Size;
+
+  mCache.ArmMemoryBase = *Base;
+  mCache.ArmMemorySize = *Size;
+  mCache.Valid |= RPI_FW_CACHE_ARM_MEMORY;
   return EFI_SUCCESS;
 }
 
@@ -311,6 +462,11 @@ RpiFirmwareGetMacAddress (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_MAC_ADDRESS) != 0) {
+    CopyMem (MacAddress, mCache.MacAddress, sizeof (mCache.MacAddress));
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -339,6 +495,9 @@ RpiFirmwareGetMacAddress (
   }
 
   CopyMem (MacAddress, Cmd->TagBody.MacAddress, sizeof (Cmd->TagBody.MacAddress));
+
+  CopyMem (mCache.MacAddress, MacAddress, sizeof (mCache.MacAddress));
+  mCache.Valid |= RPI_FW_CACHE_MAC_ADDRESS;
   return EFI_SUCCESS;
 }
 
@@ -366,6 +525,11 @@ RpiFirmwareGetSerial (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_SERIAL) != 0) {
+    *Serial = mCache.Serial;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -401,6 +565,11 @@ RpiFirmwareGetSerial (
     *Serial = SwapBytes64 (*Serial << 16);
   }
 
+  if (!EFI_ERROR (Status)) {
+    mCache.Serial = *Serial;
+    mCache.Valid |= RPI_FW_CACHE_SERIAL;
+  }
+
   return Status;
 }
 
@@ -428,6 +597,11 @@ RpiFirmwareGetModel (
   EFI_STATUS                  Status;
   UINT32                      Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_MODEL) != 0) {
+    *Model = mCache.Model;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -456,6 +630,9 @@ RpiFirmwareGetModel (
   }
 
   *Model = Cmd->TagBody.Model;
+
+  mCache.Model = *Model;
+  mCache.Valid |= RPI_FW_CACHE_MODEL;
   return EFI_SUCCESS;
 }
 
@@ -483,6 +660,11 @@ RpiFirmwareGetModelRevision (
   EFI_STATUS                    Status;
   UINT32                        Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_MODEL_REVISION) != 0) {
+    *Revision = mCache.ModelRevision;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -511,6 +693,9 @@ RpiFirmwareGetModelRevision (
   }
 
   *Revision = Cmd->TagBody.Revision;
+
+  mCache.ModelRevision = *Revision;
+  mCache.Valid |= RPI_FW_CACHE_MODEL_REVISION;
   return EFI_SUCCESS;
 }
 
@@ -525,6 +710,11 @@ RpiFirmwareGetFirmwareRevision (
   EFI_STATUS                    Status;
   UINT32                        Result;
 
+  if ((mCache.Valid & RPI_FW_CACHE_FIRMWARE_REVISION) != 0) {
+    *Revision = mCache.FirmwareRevision;
+    return EFI_SUCCESS;
+  }
+
   if (!AcquireSpinLockOrFail (&mMailboxLock)) {
     DEBUG ((DEBUG_ERROR, "%a: failed to acquire spinlock\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
@@ -553,6 +743,9 @@ RpiFirmwareGetFirmwareRevision (
   }
 
   *Revision = Cmd->TagBody.Revision;
+
+  mCache.FirmwareRevision = *Revision;
+  mCache.Valid |= RPI_FW_CACHE_FIRMWARE_REVISION;
   return EFI_SUCCESS;
 }
 
@@ -1141,7 +1334,21 @@ RpiFirmwareGetMaxClockRate (
   OUT UINT32    *ClockRate
   )
 {
-  return RpiFirmwareGetClockRate (ClockId, RPI_MBOX_GET_MAX_CLOCK_RATE, ClockRate);
+  EFI_STATUS    Status;
+
+  if (ClockId < RPI_FW_CACHE_NUM_CLOCKS &&
+      (mCache.MaxClockRateValid & (1U << ClockId)) != 0) {
+    *ClockRate = mCache.MaxClockRate[ClockId];
+    return EFI_SUCCESS;
+  }
+
+  Status = RpiFirmwareGetClockRate (ClockId, RPI_MBOX_GET_MAX_CLOCK_RATE, ClockRate);
+  if (!EFI_ERROR (Status) && ClockId < RPI_FW_CACHE_NUM_CLOCKS) {
+    mCache.MaxClockRate[ClockId] = *ClockRate;
+    mCache.MaxClockRateValid |= 1U << ClockId;
+  }
+
+  return Status;
 }
 
 STATIC
@@ -1152,7 +1359,21 @@ RpiFirmwareGetMinClockRate (
   OUT UINT32    *ClockRate
   )
 {
-  return RpiFirmwareGetClockRate (ClockId, RPI_MBOX_GET_MIN_CLOCK_RATE, ClockRate);
+  EFI_STATUS    Status;
+
+  if (ClockId < RPI_FW_CACHE_NUM_CLOCKS &&
+      (mCache.MinClockRateValid & (1U << ClockId)) != 0) {
+    *ClockRate = mCache.MinClockRate[ClockId];
+    return EFI_SUCCESS;
+  }
+
+  Status = RpiFirmwareGetClockRate (ClockId, RPI_MBOX_GET_MIN_CLOCK_RATE, ClockRate);
+  if (!EFI_ERROR (Status) && ClockId < RPI_FW_CACHE_NUM_CLOCKS) {
+    mCache.MinClockRate[ClockId] = *ClockRate;
+    mCache.MinClockRateValid |= 1U << ClockId;
+  }
+
+  return Status;
 }
 
 #pragma pack()
@@ -1215,6 +1436,129 @@ RpiFirmwareSetLed (
   }
 }
 
+//
+// Number of tags queried by RpiFirmwareFillCache ()
+//
+#define RPI_FW_CACHE_FIXED_TAGS   6
+#define RPI_FW_CACHE_NUM_TAGS     (RPI_FW_CACHE_FIXED_TAGS + \
+                                   2 * (RPI_FW_CACHE_NUM_CLOCKS - 1))
+
+/**
+  Fetch every immutable property with one mailbox transaction and record
+  the ones the firmware answered. Properties missing from the response are
+  left to be fetched, and cached, the first time they are asked for.
+
+**/
+STATIC
+VOID
+RpiFirmwareFillCache (
+  VOID
+  )
+{
+  RPI_FIRMWARE_PROPERTY       Properties[RPI_FW_CACHE_NUM_TAGS];
+  RPI_FW_ARM_MEMORY_TAG       ArmMemory;
+  RPI_FW_MAC_ADDR_TAG         MacAddress;
+  UINT64                      Serial;
+  RPI_FW_CLOCK_RATE_TAG       MaxClock[RPI_FW_CACHE_NUM_CLOCKS];
+  RPI_FW_CLOCK_RATE_TAG       MinClock[RPI_FW_CACHE_NUM_CLOCKS];
+  UINT32                      ClockId;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  ZeroMem (Properties, sizeof (Properties));
+  ZeroMem (MaxClock, sizeof (MaxClock));
+  ZeroMem (MinClock, sizeof (MinClock));
+
+  Properties[0].TagId       = RPI_MBOX_GET_ARM_MEMSIZE;
+  Properties[0].BufferSize  = sizeof (ArmMemory);
+  Properties[0].Buffer      = &ArmMemory;
+  Properties[1].TagId       = RPI_MBOX_GET_MAC_ADDRESS;
+  Properties[1].BufferSize  = sizeof (MacAddress);
+  Properties[1].Buffer      = &MacAddress;
+  Properties[2].TagId       = RPI_MBOX_GET_BOARD_SERIAL;
+  Properties[2].BufferSize  = sizeof (Serial);
+  Properties[2].Buffer      = &Serial;
+  Properties[3].TagId       = RPI_MBOX_GET_BOARD_MODEL;
+  Properties[3].BufferSize  = sizeof (mCache.Model);
+  Properties[3].Buffer      = &mCache.Model;
+  Properties[4].TagId       = RPI_MBOX_GET_BOARD_REVISION;
+  Properties[4].BufferSize  = sizeof (mCache.ModelRevision);
+  Properties[4].Buffer      = &mCache.ModelRevision;
+  Properties[5].TagId       = RPI_MBOX_GET_REVISION;
+  Properties[5].BufferSize  = sizeof (mCache.FirmwareRevision);
+  Properties[5].Buffer      = &mCache.FirmwareRevision;
+
+  Index = RPI_FW_CACHE_FIXED_TAGS;
+  for (ClockId = RPI_MBOX_CLOCK_RATE_EMMC; ClockId < RPI_FW_CACHE_NUM_CLOCKS; ClockId++) {
+    MaxClock[ClockId].ClockId   = ClockId;
+    Properties[Index].TagId       = RPI_MBOX_GET_MAX_CLOCK_RATE;
+    Properties[Index].BufferSize  = sizeof (MaxClock[ClockId]);
+    Properties[Index].Buffer      = &MaxClock[ClockId];
+    Index++;
+
+    MinClock[ClockId].ClockId   = ClockId;
+    Properties[Index].TagId       = RPI_MBOX_GET_MIN_CLOCK_RATE;
+    Properties[Index].BufferSize  = sizeof (MinClock[ClockId]);
+    Properties[Index].Buffer      = &MinClock[ClockId];
+    Index++;
+  }
+  ASSERT (Index == RPI_FW_CACHE_NUM_TAGS);
+
+  //
+  // ResponseSize stays 0 for any tag that was not answered, including when
+  // the whole transaction failed, so the individual results are all we need.
+  //
+  Status = RpiFirmwareGetProperties (RPI_FW_CACHE_NUM_TAGS, Properties);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a: not all properties cached (Status == %r)\n",
+      __FUNCTION__, Status));
+  }
+
+  if (Properties[0].ResponseSize != 0) {
+    mCache.ArmMemoryBase = ArmMemory.Base;
+    mCache.ArmMemorySize = ArmMemory.Size;
+    mCache.Valid |= RPI_FW_CACHE_ARM_MEMORY;
+  }
+  if (Properties[1].ResponseSize != 0) {
+    CopyMem (mCache.MacAddress, MacAddress.MacAddress, sizeof (mCache.MacAddress));
+    mCache.Valid |= RPI_FW_CACHE_MAC_ADDRESS;
+  }
+  if (Properties[2].ResponseSize != 0) {
+    //
+    // Apply the same MAC address fallback as RpiFirmwareGetSerial ()
+    //
+    if (Serial != 0) {
+      mCache.Serial = Serial;
+      mCache.Valid |= RPI_FW_CACHE_SERIAL;
+    } else if ((mCache.Valid & RPI_FW_CACHE_MAC_ADDRESS) != 0) {
+      CopyMem (&Serial, mCache.MacAddress, sizeof (mCache.MacAddress));
+      mCache.Serial = SwapBytes64 (Serial << 16);
+      mCache.Valid |= RPI_FW_CACHE_SERIAL;
+    }
+  }
+  if (Properties[3].ResponseSize != 0) {
+    mCache.Valid |= RPI_FW_CACHE_MODEL;
+  }
+  if (Properties[4].ResponseSize != 0) {
+    mCache.Valid |= RPI_FW_CACHE_MODEL_REVISION;
+  }
+  if (Properties[5].ResponseSize != 0) {
+    mCache.Valid |= RPI_FW_CACHE_FIRMWARE_REVISION;
+  }
+
+  Index = RPI_FW_CACHE_FIXED_TAGS;
+  for (ClockId = RPI_MBOX_CLOCK_RATE_EMMC; ClockId < RPI_FW_CACHE_NUM_CLOCKS; ClockId++) {
+    if (Properties[Index++].ResponseSize != 0) {
+      mCache.MaxClockRate[ClockId] = MaxClock[ClockId].ClockRate;
+      mCache.MaxClockRateValid |= 1U << ClockId;
+    }
+    if (Properties[Index++].ResponseSize != 0) {
+      mCache.MinClockRate[ClockId] = MinClock[ClockId].ClockRate;
+      mCache.MinClockRateValid |= 1U << ClockId;
+    }
+  }
+}
+
 STATIC RASPBERRY_PI_FIRMWARE_PROTOCOL mRpiFirmwareProtocol = {
   RpiFirmwareSetPowerState,
   RpiFirmwareGetMacAddress,
@@ -1235,7 +1579,8 @@ STATIC RASPBERRY_PI_FIRMWARE_PROTOCOL mRpiFirmwareProtocol = {
   RpiFirmwareGetFirmwareRevision,
   RpiFirmwareGetManufacturerName,
   RpiFirmwareGetCpuName,
-  RpiFirmwareGetArmMemory
+  RpiFirmwareGetArmMemory,
+  RpiFirmwareGetProperties
 };
 
 /**
@@ -1285,6 +1630,8 @@ RpiFirmwareDxeInitialize (
   //
   ASSERT (!(mDmaBufferBusAddress & (BCM2836_MBOX_NUM_CHANNELS - 1)));
 
+  RpiFirmwareFillCache ();
+
   Status = gBS->InstallProtocolInterface (&ImageHandle,
                   &gRaspberryPiFirmwareProtocolGuid, EFI_NATIVE_INTERFACE,
                   &mRpiFirmwareProtocol);
@@ -38,6 +38,7 @@
 #define CMD_MAX_RETRY_COUNT                 3
 #define CMD_STALL_AFTER_RETRY_US            20 // 20us
 #define FIFO_MAX_POLL_COUNT                 1000000
+#define FIFO_STALL_AFTER_POLL_US            1
 #define STALL_TO_STABILIZE_US               10000 // 10ms
 
 #define IDENT_MODE_SD_CLOCK_FREQ_HZ         400000 // 400KHz
@@ -520,31 +521,37 @@ SdReadBlockData (
   mFwProtocol->SetLed (TRUE);
   {
     UINT32 NumWords = Length / 4;
-    UINT32 WordIdx;
-
-    for (WordIdx = 0; WordIdx < NumWords; ++WordIdx) {
-      UINT32 PollCount = 0;
-      while (PollCount < FIFO_MAX_POLL_COUNT) {
-        UINT32 Hsts = MmioRead32 (SDHOST_HSTS);
-        if ((Hsts & SDHOST_HSTS_DATA_FLAG) != 0) {
-          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
-          Buffer[WordIdx] = MmioRead32 (SDHOST_DATA);
+    UINT32 WordIdx = 0;
+    UINT32 PollCount = 0;
+
+    //
+    // Drain everything the FIFO holds on each poll instead of
+    // checking the data flag for every single word.
+    //
+    while (WordIdx < NumWords) {
+      UINT32 Words = SDHOST_EDM_FIFO_FILL (MmioRead32 (SDHOST_EDM));
+      if (Words == 0) {
+        if (++PollCount == FIFO_MAX_POLL_COUNT) {
+          DEBUG ((DEBUG_MMCHOST_SD_ERROR,
+              "SdHost: SdReadBlockData(): Block Word%d read poll timed-out\n", WordIdx));
+          SdHostDumpStatus ();
+          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
+          Status = EFI_TIMEOUT;
           break;
         }
 
-        ++PollCount;
-        gBS->Stall (CMD_STALL_AFTER_RETRY_US);
+        gBS->Stall (FIFO_STALL_AFTER_POLL_US);
+        continue;
       }
 
-      if (PollCount == FIFO_MAX_POLL_COUNT) {
-        DEBUG ((DEBUG_MMCHOST_SD_ERROR,
-            "SdHost: SdReadBlockData(): Block Word%d read poll timed-out\n", WordIdx));
-        SdHostDumpStatus ();
-        MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
-        Status = EFI_TIMEOUT;
-        break;
+      PollCount = 0;
+      Words = MIN (Words, NumWords - WordIdx);
+      while (Words-- > 0) {
+        Buffer[WordIdx++] = MmioRead32 (SDHOST_DATA);
       }
     }
+
+    MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
   }
   mFwProtocol->SetLed (FALSE);
 
@@ -571,30 +578,38 @@ SdWriteBlockData (
   mFwProtocol->SetLed (TRUE);
   {
     UINT32 NumWords = Length / 4;
-    UINT32 WordIdx;
-
-    for (WordIdx = 0; WordIdx < NumWords; ++WordIdx) {
-      UINT32 PollCount = 0;
-      while (PollCount < FIFO_MAX_POLL_COUNT) {
-        if (MmioRead32 (SDHOST_HSTS) & SDHOST_HSTS_DATA_FLAG) {
-          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
-          MmioWrite32 (SDHOST_DATA, Buffer[WordIdx]);
+    UINT32 WordIdx = 0;
+    UINT32 PollCount = 0;
+
+    //
+    // Fill all free FIFO slots on each poll instead of checking the
+    // data flag for every single word.
+    //
+    while (WordIdx < NumWords) {
+      UINT32 Words = SDHOST_EDM_FIFO_FILL (MmioRead32 (SDHOST_EDM));
+      Words = (Words < SDHOST_FIFO_WORDS) ? SDHOST_FIFO_WORDS - Words : 0;
+      if (Words == 0) {
+        if (++PollCount == FIFO_MAX_POLL_COUNT) {
+          DEBUG ((DEBUG_MMCHOST_SD_ERROR,
+            "SdHost: SdWriteBlockData(): Block Word%d write poll timed-out\n", WordIdx));
+          SdHostDumpStatus ();
+          MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
+          Status = EFI_TIMEOUT;
           break;
         }
 
-        ++PollCount;
-        gBS->Stall (CMD_STALL_AFTER_RETRY_US);
+        gBS->Stall (FIFO_STALL_AFTER_POLL_US);
+        continue;
       }
 
-      if (PollCount == FIFO_MAX_POLL_COUNT) {
-        DEBUG ((DEBUG_MMCHOST_SD_ERROR,
-          "SdHost: SdWriteBlockData(): Block Word%d write poll timed-out\n", WordIdx));
-        SdHostDumpStatus ();
-        MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_CLEAR);
-        Status = EFI_TIMEOUT;
-        break;
+      PollCount = 0;
+      Words = MIN (Words, NumWords - WordIdx);
+      while (Words-- > 0) {
+        MmioWrite32 (SDHOST_DATA, Buffer[WordIdx++]);
       }
     }
+
+    MmioWrite32 (SDHOST_HSTS, SDHOST_HSTS_DATA_FLAG);
   }
   mFwProtocol->SetLed (FALSE);
 
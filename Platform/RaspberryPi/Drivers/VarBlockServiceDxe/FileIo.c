@@ -30,6 +30,31 @@ FileWrite (
 }
 
 
+EFI_STATUS
+FileRead (
+  IN EFI_FILE_PROTOCOL *File,
+  IN UINTN Offset,
+  IN VOID *Buffer,
+  IN UINTN Size
+  )
+{
+  EFI_STATUS Status;
+  UINTN ReadSize;
+
+  Status = File->SetPosition (File, Offset);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ReadSize = Size;
+  Status = File->Read (File, &ReadSize, Buffer);
+  if (!EFI_ERROR (Status) && ReadSize != Size) {
+    Status = EFI_END_OF_FILE;
+  }
+  return Status;
+}
+
+
 VOID
 FileClose (
   IN  EFI_FILE_PROTOCOL *File
@@ -108,6 +133,28 @@ FileOpen (
 }
 
 
+EFI_STATUS
+FileDelete (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device,
+  IN CHAR16 *FileName
+  )
+{
+  EFI_STATUS Status;
+  EFI_FILE_PROTOCOL *File;
+
+  Status = FileOpen (Device, FileName, &File,
+             EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Delete closes the handle.
+  //
+  return File->Delete (File);
+}
+
+
 EFI_STATUS
 CheckStore (
   IN  EFI_HANDLE SimpleFileSystemHandle,
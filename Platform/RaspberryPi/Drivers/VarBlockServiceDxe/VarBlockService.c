@@ -86,6 +86,31 @@ EFI_FW_VOL_BLOCK_DEVICE mFvbDeviceTemplate = {
 };
 
 
+STATIC
+VOID
+VarStoreMarkDirty (
+  IN UINTN Address,
+  IN UINTN Length
+  )
+{
+  UINTN Lba;
+  UINTN LastLba;
+
+  if (Length == 0) {
+    return;
+  }
+
+  Lba = (Address - mFvInstance->FvBase) / mFvInstance->BlockSize;
+  LastLba = (Address + Length - 1 - mFvInstance->FvBase) /
+            mFvInstance->BlockSize;
+  for (; Lba <= LastLba; Lba++) {
+    mFvInstance->DirtyBitmap[Lba / 8] |= (UINT8)(1 << (Lba % 8));
+  }
+
+  mFvInstance->Dirty = TRUE;
+}
+
+
 EFI_STATUS
 VarStoreWrite (
   IN     UINTN Address,
@@ -94,7 +119,7 @@ VarStoreWrite (
   )
 {
   CopyMem ((VOID*)Address, Buffer, *NumBytes);
-  mFvInstance->Dirty = TRUE;
+  VarStoreMarkDirty (Address, *NumBytes);
 
   return EFI_SUCCESS;
 }
@@ -107,7 +132,7 @@ VarStoreErase (
   )
 {
   SetMem ((VOID*)Address, LbaLength, 0xff);
-  mFvInstance->Dirty = TRUE;
+  VarStoreMarkDirty (Address, LbaLength);
 
   return EFI_SUCCESS;
 }
@@ -847,6 +872,16 @@ FvbInitialize (
    * Should I parse config.txt instead and find the real name?
    */
   mFvInstance->MappedFile = L"RPI_EFI.FD";
+  mFvInstance->JournalFile = L"RPI_EFI.JNL";
+  mFvInstance->BlockSize = PcdGet32 (PcdFirmwareBlockSize);
+  ASSERT ((Length % mFvInstance->BlockSize) == 0);
+
+  mFvInstance->DirtyBitmap = AllocateRuntimeZeroPool (
+                               (Length / mFvInstance->BlockSize + 7) / 8);
+  if (mFvInstance->DirtyBitmap == NULL) {
+    FreePool (mFvInstance);
+    return EFI_OUT_OF_RESOURCES;
+  }
 
   Status = ValidateFvHeader (mFvInstance->VolumeHeader);
   if (!EFI_ERROR (Status)) {
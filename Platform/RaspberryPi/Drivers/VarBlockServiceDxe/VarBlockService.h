@@ -32,9 +32,27 @@ typedef struct {
   UINTN                      NumOfBlocks;
   EFI_DEVICE_PATH_PROTOCOL   *Device;
   CHAR16                     *MappedFile;
+  CHAR16                     *JournalFile;
+  UINTN                      BlockSize;
+  UINT8                      *DirtyBitmap;     // One bit per LBA
   BOOLEAN                    Dirty;
 } EFI_FW_VOL_INSTANCE;
 
+//
+// Write-ahead record of a flush, kept in JournalFile until all the
+// blocks have reached MappedFile. The header is followed by BlockCount
+// LBAs (UINT32) and then by the contents of those blocks. Crc32 covers
+// everything after the header.
+//
+#define VAR_JOURNAL_SIGNATURE SIGNATURE_32 ('R', 'P', 'V', 'J')
+
+typedef struct {
+  UINT32                     Signature;
+  UINT32                     BlockSize;
+  UINT32                     BlockCount;
+  UINT32                     Crc32;
+} VAR_JOURNAL_HEADER;
+
 extern EFI_FW_VOL_INSTANCE *mFvInstance;
 
 typedef struct {
@@ -184,6 +202,20 @@ FileWrite (
   IN UINTN             Size
   );
 
+EFI_STATUS
+FileRead (
+  IN EFI_FILE_PROTOCOL *File,
+  IN UINTN             Offset,
+  IN VOID              *Buffer,
+  IN UINTN             Size
+  );
+
+EFI_STATUS
+FileDelete (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device,
+  IN CHAR16                   *FileName
+  );
+
 EFI_STATUS
 CheckStore (
   IN  EFI_HANDLE SimpleFileSystemHandle,
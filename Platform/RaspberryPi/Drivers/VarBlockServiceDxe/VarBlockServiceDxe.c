@@ -8,6 +8,9 @@
  *
  **/
 
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
 #include "VarBlockService.h"
 
 VOID *mSFSRegistration;
@@ -93,6 +96,7 @@ FvbVirtualAddressChangeEvent (
 --*/
 {
   EfiConvertPointer (0x0, (VOID**)&mFvInstance->FvBase);
+  EfiConvertPointer (0x0, (VOID**)&mFvInstance->DirtyBitmap);
   EfiConvertPointer (0x0, (VOID**)&mFvInstance->VolumeHeader);
   EfiConvertPointer (0x0, (VOID**)&mFvInstance);
 }
@@ -118,14 +122,301 @@ InstallVirtualAddressChangeHandler (
 }
 
 
+STATIC
+BOOLEAN
+IsBlockDirty (
+  IN UINTN Lba
+  )
+{
+  return (mFvInstance->DirtyBitmap[Lba / 8] & (1 << (Lba % 8))) != 0;
+}
+
+
+STATIC
+UINTN
+BlockAddress (
+  IN UINTN Lba
+  )
+{
+  return mFvInstance->FvBase + Lba * mFvInstance->BlockSize;
+}
+
+
+/**
+  Saves the dirty blocks to the journal file, so that an interrupted
+  flush can be completed on the next boot.
+**/
+STATIC
+EFI_STATUS
+WriteJournal (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device,
+  IN UINTN DirtyCount
+  )
+{
+  EFI_STATUS Status;
+  EFI_FILE_PROTOCOL *File;
+  VAR_JOURNAL_HEADER *Header;
+  UINT32 *LbaList;
+  UINT8 *Data;
+  UINTN Size;
+  UINTN Lba;
+  UINTN Index;
+
+  Size = sizeof (VAR_JOURNAL_HEADER) +
+         DirtyCount * (sizeof (UINT32) + mFvInstance->BlockSize);
+  Header = AllocatePool (Size);
+  if (Header == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  LbaList = (UINT32*)(Header + 1);
+  Data = (UINT8*)(LbaList + DirtyCount);
+  for (Lba = 0, Index = 0; Lba < mFvInstance->NumOfBlocks; Lba++) {
+    if (IsBlockDirty (Lba)) {
+      LbaList[Index] = (UINT32)Lba;
+      CopyMem (Data + Index * mFvInstance->BlockSize,
+        (VOID*)BlockAddress (Lba), mFvInstance->BlockSize);
+      Index++;
+    }
+  }
+
+  Header->Signature = VAR_JOURNAL_SIGNATURE;
+  Header->BlockSize = (UINT32)mFvInstance->BlockSize;
+  Header->BlockCount = (UINT32)DirtyCount;
+  Header->Crc32 = 0;
+  gBS->CalculateCrc32 (LbaList, Size - sizeof (VAR_JOURNAL_HEADER),
+         &Header->Crc32);
+
+  Status = FileOpen (Device,
+             mFvInstance->JournalFile,
+             &File,
+             EFI_FILE_MODE_WRITE |
+             EFI_FILE_MODE_READ |
+             EFI_FILE_MODE_CREATE);
+  if (!EFI_ERROR (Status)) {
+    Status = FileWrite (File, 0, (UINTN)Header, Size);
+    FileClose (File);
+  }
+
+  FreePool (Header);
+  return Status;
+}
+
+
+/**
+  Removes the journal once the store no longer depends on it. Should the
+  file system refuse the delete, the journal signature is cleared instead
+  so that the next boot does not replay it.
+**/
+STATIC
+EFI_STATUS
+DiscardJournal (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device
+  )
+{
+  EFI_STATUS Status;
+  EFI_FILE_PROTOCOL *File;
+  UINT32 Signature;
+
+  //
+  // Delete reports a failure with EFI_WARN_DELETE_FAILURE, which
+  // EFI_ERROR() does not catch.
+  //
+  Status = FileDelete (Device, mFvInstance->JournalFile);
+  if (Status == EFI_SUCCESS || Status == EFI_NOT_FOUND) {
+    return EFI_SUCCESS;
+  }
+
+  DEBUG ((DEBUG_ERROR, "Couldn't delete '%s': %r, invalidating it\n",
+    mFvInstance->JournalFile, Status));
+
+  Status = FileOpen (Device,
+             mFvInstance->JournalFile,
+             &File,
+             EFI_FILE_MODE_WRITE |
+             EFI_FILE_MODE_READ);
+  if (!EFI_ERROR (Status)) {
+    Signature = 0;
+    Status = FileWrite (File,
+               OFFSET_OF (VAR_JOURNAL_HEADER, Signature),
+               (UINTN)&Signature,
+               sizeof (Signature));
+    FileClose (File);
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Couldn't invalidate '%s': %r\n",
+      mFvInstance->JournalFile, Status));
+    return EFI_DEVICE_ERROR;
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Completes a flush that was interrupted after its journal was written.
+  Returns EFI_NOT_FOUND when there is no journal to replay, and
+  EFI_SUCCESS only when the journal was both applied and discarded, so
+  that the caller may reset without replaying it again on every boot.
+**/
+STATIC
+EFI_STATUS
+ReplayJournal (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device
+  )
+{
+  EFI_STATUS Status;
+  EFI_STATUS DiscardStatus;
+  EFI_FILE_PROTOCOL *File;
+  VAR_JOURNAL_HEADER Header;
+  UINT32 *LbaList;
+  UINT8 *Data;
+  UINTN Size;
+  UINTN Index;
+  UINT32 Crc32;
+
+  Status = FileOpen (Device,
+             mFvInstance->JournalFile,
+             &File,
+             EFI_FILE_MODE_READ);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  LbaList = NULL;
+  Size = 0;
+  Status = FileRead (File, 0, &Header, sizeof (Header));
+  if (!EFI_ERROR (Status) &&
+      (Header.Signature != VAR_JOURNAL_SIGNATURE ||
+       Header.BlockSize != mFvInstance->BlockSize ||
+       Header.BlockCount == 0 ||
+       Header.BlockCount > mFvInstance->NumOfBlocks)) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Size = Header.BlockCount * (sizeof (UINT32) + mFvInstance->BlockSize);
+    LbaList = AllocatePool (Size);
+    if (LbaList == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Status = FileRead (File, sizeof (Header), LbaList, Size);
+    }
+  }
+  FileClose (File);
+
+  if (!EFI_ERROR (Status)) {
+    Crc32 = 0;
+    gBS->CalculateCrc32 (LbaList, Size, &Crc32);
+    if (Crc32 != Header.Crc32) {
+      Status = EFI_VOLUME_CORRUPTED;
+    }
+
+    for (Index = 0; !EFI_ERROR (Status) && Index < Header.BlockCount; Index++) {
+      if (LbaList[Index] >= mFvInstance->NumOfBlocks) {
+        Status = EFI_VOLUME_CORRUPTED;
+      }
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    //
+    // A torn journal means the flush never got to the store itself.
+    //
+    DEBUG ((DEBUG_WARN, "Discarding '%s': %r\n", mFvInstance->JournalFile, Status));
+    goto Done;
+  }
+
+  Status = FileOpen (Device,
+             mFvInstance->MappedFile,
+             &File,
+             EFI_FILE_MODE_WRITE |
+             EFI_FILE_MODE_READ);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  Data = (UINT8*)(LbaList + Header.BlockCount);
+  for (Index = 0; Index < Header.BlockCount; Index++) {
+    Status = FileWrite (File,
+               mFvInstance->Offset + LbaList[Index] * mFvInstance->BlockSize,
+               (UINTN)(Data + Index * mFvInstance->BlockSize),
+               mFvInstance->BlockSize);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    CopyMem ((VOID*)BlockAddress (LbaList[Index]),
+      Data + Index * mFvInstance->BlockSize, mFvInstance->BlockSize);
+  }
+  FileClose (File);
+
+  if (EFI_ERROR (Status)) {
+    //
+    // Keep the journal for the next attempt.
+    //
+    FreePool (LbaList);
+    return Status;
+  }
+
+Done:
+  if (LbaList != NULL) {
+    FreePool (LbaList);
+  }
+
+  DiscardStatus = DiscardJournal (Device);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (EFI_ERROR (DiscardStatus)) {
+    //
+    // The store is repaired, but a reset would only replay the journal
+    // again, and reset again. Carry on with this boot instead.
+    //
+    DEBUG ((DEBUG_ERROR, "Recovered '%s' but couldn't discard '%s', not resetting\n",
+      mFvInstance->MappedFile, mFvInstance->JournalFile));
+    return EFI_ABORTED;
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Writes the dirty blocks to the store file. The blocks are journaled
+  first, and runs of adjacent dirty blocks are written with one call.
+**/
 STATIC
 EFI_STATUS
-DoDump (
+FlushDirtyBlocks (
   IN EFI_DEVICE_PATH_PROTOCOL *Device
   )
 {
   EFI_STATUS Status;
   EFI_FILE_PROTOCOL *File;
+  UINTN DirtyCount;
+  UINTN Lba;
+  UINTN End;
+  BOOLEAN Journaled;
+
+  DirtyCount = 0;
+  for (Lba = 0; Lba < mFvInstance->NumOfBlocks; Lba++) {
+    if (IsBlockDirty (Lba)) {
+      DirtyCount++;
+    }
+  }
+
+  if (DirtyCount == 0) {
+    mFvInstance->Dirty = FALSE;
+    return EFI_SUCCESS;
+  }
+
+  Status = WriteJournal (Device, DirtyCount);
+  Journaled = !EFI_ERROR (Status);
+  if (!Journaled) {
+    DEBUG ((DEBUG_WARN, "Couldn't write '%s': %r, flushing without it\n",
+      mFvInstance->JournalFile, Status));
+  }
 
   Status = FileOpen (Device,
              mFvInstance->MappedFile,
@@ -136,12 +427,92 @@ DoDump (
     return Status;
   }
 
-  Status = FileWrite (File,
-             mFvInstance->Offset,
-             mFvInstance->FvBase,
-             mFvInstance->FvLength);
+  for (Lba = 0; Lba < mFvInstance->NumOfBlocks; Lba = End) {
+    End = Lba + 1;
+    if (!IsBlockDirty (Lba)) {
+      continue;
+    }
+
+    while (End < mFvInstance->NumOfBlocks && IsBlockDirty (End)) {
+      End++;
+    }
+
+    Status = FileWrite (File,
+               mFvInstance->Offset + Lba * mFvInstance->BlockSize,
+               BlockAddress (Lba),
+               (End - Lba) * mFvInstance->BlockSize);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
   FileClose (File);
-  return Status;
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  DEBUG ((DEBUG_INFO, "Flushed %Lu of %Lu variable store blocks\n",
+    (UINT64)DirtyCount, (UINT64)mFvInstance->NumOfBlocks));
+
+  ZeroMem (mFvInstance->DirtyBitmap, (mFvInstance->NumOfBlocks + 7) / 8);
+  mFvInstance->Dirty = FALSE;
+
+  if (Journaled) {
+    //
+    // The store is already up to date, so a journal left behind is only
+    // replayed once more; DiscardJournal() has logged why.
+    //
+    DiscardJournal (Device);
+  }
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Brings a newly found store file up to date with the in-memory store,
+  rewriting only the blocks that differ.
+**/
+STATIC
+EFI_STATUS
+SyncStore (
+  IN EFI_DEVICE_PATH_PROTOCOL *Device
+  )
+{
+  EFI_STATUS Status;
+  EFI_FILE_PROTOCOL *File;
+  UINT8 *Buffer;
+  UINTN Lba;
+
+  Buffer = AllocatePool (mFvInstance->FvLength);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = FileOpen (Device,
+             mFvInstance->MappedFile,
+             &File,
+             EFI_FILE_MODE_READ);
+  if (!EFI_ERROR (Status)) {
+    Status = FileRead (File, mFvInstance->Offset, Buffer, mFvInstance->FvLength);
+    FileClose (File);
+  }
+
+  if (EFI_ERROR (Status)) {
+    //
+    // Rewrite the whole store.
+    //
+    SetMem (mFvInstance->DirtyBitmap, (mFvInstance->NumOfBlocks + 7) / 8, 0xff);
+  } else {
+    for (Lba = 0; Lba < mFvInstance->NumOfBlocks; Lba++) {
+      if (CompareMem (Buffer + Lba * mFvInstance->BlockSize,
+            (VOID*)BlockAddress (Lba), mFvInstance->BlockSize) != 0) {
+        mFvInstance->DirtyBitmap[Lba / 8] |= (UINT8)(1 << (Lba % 8));
+      }
+    }
+  }
+
+  FreePool (Buffer);
+  return FlushDirtyBlocks (Device);
 }
 
 
@@ -165,7 +536,7 @@ DumpVars (
     return;
   }
 
-  Status = DoDump (mFvInstance->Device);
+  Status = FlushDirtyBlocks (mFvInstance->Device);
   if (EFI_ERROR (Status)) {
     DEBUG ((DEBUG_ERROR, "Couldn't dump '%s'\n", mFvInstance->MappedFile));
     ASSERT_EFI_ERROR (Status);
@@ -173,7 +544,6 @@ DumpVars (
   }
 
   DEBUG ((DEBUG_INFO, "Variables dumped!\n"));
-  mFvInstance->Dirty = FALSE;
 }
 
 
@@ -281,7 +651,16 @@ OnSimpleFileSystemInstall (
       continue;
     }
 
-    Status = DoDump (Device);
+    if (!EFI_ERROR (ReplayJournal (Device))) {
+      //
+      // The store loaded for this boot was the one torn by the
+      // interrupted flush; restart with the repaired one.
+      //
+      DEBUG ((DEBUG_WARN, "Recovered '%s', resetting\n", mFvInstance->MappedFile));
+      EfiResetSystem (EfiResetWarm, EFI_SUCCESS, 0, NULL);
+    }
+
+    Status = SyncStore (Device);
     if (EFI_ERROR (Status)) {
       DEBUG ((DEBUG_ERROR, "Couldn't update '%s'\n", mFvInstance->MappedFile));
       ASSERT_EFI_ERROR (Status);
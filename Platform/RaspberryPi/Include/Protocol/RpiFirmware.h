@@ -134,6 +134,26 @@ EFI_STATUS
   UINT32 *Size
   );
 
+//
+// One property tag of a GET_PROPERTIES batch. Buffer holds the request
+// value (e.g. a clock ID) on input and receives the response value on
+// output; ResponseSize is set to the size of the value returned by the
+// firmware, or 0 if the firmware did not answer the tag.
+//
+typedef struct {
+  UINT32    TagId;
+  UINT32    BufferSize;
+  VOID      *Buffer;
+  UINT32    ResponseSize;
+} RPI_FIRMWARE_PROPERTY;
+
+typedef
+EFI_STATUS
+(EFIAPI *GET_PROPERTIES) (
+  IN      UINTN                   Count,
+  IN OUT  RPI_FIRMWARE_PROPERTY   *Properties
+  );
+
 typedef struct {
   SET_POWER_STATE       SetPowerState;
   GET_MAC_ADDRESS       GetMacAddress;
@@ -155,6 +175,7 @@ typedef struct {
   GET_MANUFACTURER_NAME GetManufacturerName;
   GET_CPU_NAME          GetCpuName;
   GET_ARM_MEM           GetArmMem;
+  GET_PROPERTIES        GetProperties;
 } RASPBERRY_PI_FIRMWARE_PROTOCOL;
 
 extern EFI_GUID gRaspberryPiFirmwareProtocolGuid;
@@ -74,6 +74,10 @@
 // EDM
 //
 #define SDHOST_EDM_FIFO_CLEAR               BIT21
+#define SDHOST_EDM_FIFO_FILL_SHIFT          4
+#define SDHOST_EDM_FIFO_FILL_MASK           0x1F
+#define SDHOST_EDM_FIFO_FILL(X)             (((X) >> SDHOST_EDM_FIFO_FILL_SHIFT) & SDHOST_EDM_FIFO_FILL_MASK)
+#define SDHOST_FIFO_WORDS                   16
 #define SDHOST_EDM_WRITE_THRESHOLD_SHIFT    9
 #define SDHOST_EDM_READ_THRESHOLD_SHIFT     14
 #define SDHOST_EDM_THRESHOLD_MASK           0x1F
@@ -20,6 +20,7 @@
 #define MMCHS_ARG         (MMCHS1BASE + 0x8)
 
 #define MMCHS_CMD         (MMCHS1BASE + 0xC)
+#define DE_ENABLE         BIT0
 #define BCE_ENABLE        BIT1
 #define DDIR_READ         BIT4
 #define DDIR_WRITE        (0x0UL << 4)
@@ -59,6 +60,8 @@
 #define MMCHS_HCTL        (MMCHS1BASE + 0x28)
 #define DTW_1_BIT         (0x0UL << 1)
 #define DTW_4_BIT         BIT1
+#define DMAS_MASK         (0x3UL << 3)
+#define DMAS_ADMA2        (0x2UL << 3)
 #define SDBP_MASK         BIT8
 #define SDBP_OFF          (0x0UL << 8)
 #define SDBP_ON           BIT8
@@ -90,9 +93,13 @@
 #define CARD_INS          BIT6
 #define ERRI              BIT15
 #define CTO               BIT16
+#define CCRC              BIT17
+#define CEB               BIT18
+#define CIE               BIT19
 #define DTO               BIT20
 #define DCRC              BIT21
 #define DEB               BIT22
+#define ADMAE             BIT25
 
 #define MMCHS_IE          (MMCHS1BASE + 0x34)
 #define CC_EN             BIT0
@@ -128,10 +135,13 @@
 #define MMCHS_AC12        (MMCHS1BASE + 0x3C)
 
 #define MMCHS_CAPA        (MMCHS1BASE + 0x40)
+#define ADMA2S            BIT19
 #define VS30              BIT25
 #define VS18              BIT26
 
 #define MMCHS_CUR_CAPA    (MMCHS1BASE + 0x48)
+#define MMCHS_ADMA_ES     (MMCHS1BASE + 0x54)
+#define MMCHS_ADMA_SAL    (MMCHS1BASE + 0x58)
 #define MMCHS_REV         (MMCHS1BASE + 0xFC)
 
 #define BLOCK_COUNT_SHIFT 16
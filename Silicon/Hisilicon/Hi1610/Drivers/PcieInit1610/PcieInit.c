@@ -8,6 +8,7 @@
 **/
 
 #include "PcieInit.h"
+#include <Library/BaseMemoryLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/PcdLib.h>
 #include <Library/OemMiscLib.h>
@@ -16,7 +17,6 @@
 
 extern VOID PcieRegWrite(UINT32 Port, UINTN Offset, UINT32 Value);
 extern EFI_STATUS PciePortReset(UINT32 HostBridgeNum, UINT32 Port);
-extern EFI_STATUS PciePortInit (UINT32 soctype, UINT32 HostBridgeNum, PCIE_DRIVER_CFG *PcieCfg);
 
 PCIE_DRIVER_CFG gastr_pcie_driver_cfg[PCIE_MAX_ROOTBRIDGE] =
 {
@@ -106,6 +106,8 @@ PCIE_DRIVER_CFG gastr_pcie_driver_cfg[PCIE_MAX_ROOTBRIDGE] =
     },
 };
 
+STATIC PCIE_PORT_LINK mPortLinks[PCIE_MAX_HOSTBRIDGE * PCIE_MAX_ROOTBRIDGE];
+
 EFI_STATUS
 PcieInitEntry (
   IN EFI_HANDLE                 ImageHandle,
@@ -118,6 +120,7 @@ PcieInitEntry (
     UINT32             HostBridgeNum = 0;
     UINT32             soctype = 0;
     UINT32       PcieRootBridgeMask;
+    UINTN              LinkCount = 0;
 
 
     if (!OemIsMpBoot())
@@ -130,6 +133,11 @@ PcieInitEntry (
     }
 
     soctype = PcdGet32(Pcdsoctype);
+
+    /*
+       Start link training on every enabled port first, then wait for
+       all of them together, so that the timeouts of empty slots overlap.
+    */
     for (HostBridgeNum = 0; HostBridgeNum < PCIE_MAX_HOSTBRIDGE; HostBridgeNum++) {
         for (Port = 0; Port < PCIE_MAX_ROOTBRIDGE; Port++) {
             /*
@@ -142,15 +150,20 @@ PcieInitEntry (
                 continue;
             }
 
-            Status = PciePortInit(soctype, HostBridgeNum, &gastr_pcie_driver_cfg[Port]);
+            mPortLinks[LinkCount].HostBridgeNum = HostBridgeNum;
+            CopyMem (&mPortLinks[LinkCount].PcieCfg, &gastr_pcie_driver_cfg[Port], sizeof (PCIE_DRIVER_CFG));
+            Status = PciePortStartTraining(soctype, &mPortLinks[LinkCount]);
             if(EFI_ERROR(Status))
             {
                 DEBUG((EFI_D_ERROR, "HostBridge %d, Pcie Port %d Init Failed! \n", HostBridgeNum, Port));
+                continue;
             }
-
+            LinkCount++;
         }
     }
 
+    PcieWaitLinksUp(soctype, mPortLinks, LinkCount, PCIE_LINK_UP_TIMEOUT_MS);
+
 
     return EFI_SUCCESS;
 
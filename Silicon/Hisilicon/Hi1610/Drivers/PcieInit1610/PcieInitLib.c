@@ -35,7 +35,7 @@ extern PCIE_IATU_VA mPcieIatuTable;
 
 EFI_STATUS
 EFIAPI
-PciePortInit (
+PciePortStartLink (
   IN UINT32 soctype,
   IN UINT32 HostBridgeNum,
   IN PCIE_DRIVER_CFG *PcieCfg
@@ -191,82 +191,93 @@ VOID PcieGetLtssmValue (
 
 }
 
+/*
+ * Time elapsed since StartTime, a value of the performance counter.
+ */
+STATIC
+UINT64
+PcieElapsedUs (
+  IN UINT64 StartTime
+  )
+{
+  UINT64  StartValue;
+  UINT64  EndValue;
+  UINT64  Ticks;
+
+  GetPerformanceCounterProperties (&StartValue, &EndValue);
+  Ticks = GetPerformanceCounter ();
+  if (StartValue > EndValue) {
+    Ticks = StartTime - Ticks;
+  } else {
+    Ticks = Ticks - StartTime;
+  }
+
+  return DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+}
+
 /*
  * In some cases, the PCIe device may close part of lanes in
  * config state of LTSSM, the hip06 RC should reconfig lane num
  * and try to linkup again.
+ *
+ * Called on every poll of a training link. It takes 100 ms at most
+ * after LTSSM is enabled to detect the lane num problem.
  */
-VOID PcieReconfigLaneNum (
+STATIC
+VOID
+PcieCheckLaneNum (
   IN UINT32 soctype,
-  IN UINT32 HostBridgeNum,
-  IN UINT32 Port,
-  IN PCIE_DRIVER_CFG *PcieCfg
+  IN PCIE_PORT_LINK *Link
   )
 {
-  EFI_STATUS Status;
   UINT32  LtssmStatus;
   UINT32  RegVal;
-  UINT32  LoopCnt = 0;
-  UINT32  LaneNumCnt = 0;
-  PCIE_PORT_WIDTH PortWidth = PcieCfg->PortInfo.PortWidth;
+  UINT32  HostBridgeNum = Link->HostBridgeNum;
+  UINT32  Port = Link->PcieCfg.PortIndex;
 
-  // 500 * 200us = 100ms, so it takes 100 ms must to reconfig lane numbers
-  while (LoopCnt < 500) {
+  /*
+   * The minimum lanenum is 1, no need to try any more.
+   */
+  if (Link->PcieCfg.PortInfo.PortWidth <= 1) {
+    return;
+  }
 
-    /*
-     * The minimum lanenum is 1, no need to try any more.
-     */
-    if (PortWidth <= 1) {
-      DEBUG ((DEBUG_ERROR, "PcieReconfigLanenum  PortWidth <= 1 !\n"));
-      return;
-    }
+  if (PcieElapsedUs (Link->StartTime) >= PCIE_LANE_NUM_CHECK_US) {
+    return;
+  }
 
-    /*
-     * Check the lane num config state is normal or not.
-     */
-    PcieGetLtssmValue (HostBridgeNum, Port, &LtssmStatus);
-    if ((LtssmStatus == PCIE_LTSSM_CFG_LANENUM_ACPT) || (LtssmStatus == PCIE_LTSSM_CFG_COMPLETE)) {
-      LaneNumCnt++;
-    } else if (LtssmStatus == PCIE_LTSSM_LINKUP_STATE) {
-      PcieGetLtssmValue (HostBridgeNum, Port, &LtssmStatus);
-      if (LtssmStatus == PCIE_LTSSM_LINKUP_STATE) {
-          break;
-      }
-    } else {
-      LaneNumCnt = 0;
-    }
+  /*
+   * Check the lane num config state is normal or not.
+   * Pcie 3.0 Spec,part 4.2.6.3.4.1: the Upstream Lanes are permitted
+   * delay up to 1 ms before transitioning to Configuration.Lanenum.Accept.
+   * So the poll interval 200 us * 5(LanNumCnt) = 1ms, not beyond the reasonable range.
+   */
+  PcieGetLtssmValue (HostBridgeNum, Port, &LtssmStatus);
+  if ((LtssmStatus == PCIE_LTSSM_CFG_LANENUM_ACPT) || (LtssmStatus == PCIE_LTSSM_CFG_COMPLETE)) {
+    Link->LaneNumCnt++;
+  } else {
+    Link->LaneNumCnt = 0;
+  }
 
+  /*
+   * The lane num config state is abnormal, need to reconfig
+   * the lane num and try to establish link again.
+   */
+  if (Link->LaneNumCnt > MAX_TRY_LINK_NUM) {
+    /* Disable LTSSM */
+    RegRead (PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][Port] + PCIE_CTRL_7_REG, RegVal);
+    RegVal &= ~(LTSSM_ENABLE);
+    RegWrite (PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][Port] + PCIE_CTRL_7_REG, RegVal);
     /*
-     * The lane num config state is abnormal, need to reconfig
-     * the lane num and try to establish link again.
+     * Decrease the PortWidth and try to link again,
+     * the value of PortWidth 0xf (X8), 0x7(x4), 0x3(X2), 0x1(X1)
      */
-    if (LaneNumCnt > MAX_TRY_LINK_NUM) {
-      /* Disable LTSSM */
-      RegRead (PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][Port] + PCIE_CTRL_7_REG, RegVal);
-      RegVal &= ~(LTSSM_ENABLE);
-      RegWrite (PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][Port] + PCIE_CTRL_7_REG, RegVal);
-      /*
-       * Decrease the PortWidth and try to link again,
-       * the value of PortWidth 0xf (X8), 0x7(x4), 0x3(X2), 0x1(X1)
-       */
-      PcieCfg->PortInfo.PortWidth = (PCIE_PORT_WIDTH)((UINT8)PcieCfg->PortInfo.PortWidth >> 1);
-
-      Status = PciePortInit (soctype, HostBridgeNum, PcieCfg);
-      if (EFI_ERROR(Status)) {
-          DEBUG ((DEBUG_ERROR, "PcieReconfigLanenum HostBridge %d, Pcie Port %d Init Failed! \n", HostBridgeNum, Port));
-      }
-      return;
-    }
+    Link->PcieCfg.PortInfo.PortWidth = (PCIE_PORT_WIDTH)((UINT8)Link->PcieCfg.PortInfo.PortWidth >> 1);
 
-    LoopCnt++;
-    /* Pcie 3.0 Spec,part 4.2.6.3.4.1: the Upstream Lanes are permitted
-     * delay up to 1 ms before transitioning to Configuration.Lanenum.Accept.
-     * So the delay time 200 us * 5(LanNumCnt) = 1ms, not beyond the reasonable range.
-     */
-    MicroSecondDelay (200);
+    if (EFI_ERROR (PciePortStartTraining (soctype, Link))) {
+      DEBUG ((DEBUG_ERROR, "PcieReconfigLanenum HostBridge %d, Pcie Port %d Init Failed! \n", HostBridgeNum, Port));
+    }
   }
-
-  return ;
 }
 
 EFI_STATUS
@@ -290,7 +301,6 @@ PcieEnableItssm (
         Value |= BIT11|BIT30|BIT31;
         RegWrite(PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][Port] + 0x1114, Value);
         (VOID)PcieRxValidCtrl(soctype, HostBridgeNum, Port, 1);
-        PcieReconfigLaneNum (soctype, HostBridgeNum, Port, PcieCfg);
         return EFI_SUCCESS;
     }
     else
@@ -1127,9 +1137,35 @@ SwitchPcieASPMSupport (
   PcieDbiCs2Enable (HostBridgeNum, Port, TRUE);
 }
 
+/*
+ * PcieRegRead/PcieRegWrite only take the port index, so point the register
+ * window of this port index at the right host bridge before using them.
+ */
+STATIC
+VOID
+PcieSetRegResource (
+  IN UINT32 soctype,
+  IN UINT32 HostBridgeNum,
+  IN UINT32 PortIndex
+  )
+{
+     if (0x1610 == soctype)
+     {
+         mPcieIntCfg.RegResource[PortIndex] = (VOID *)PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][PortIndex];
+     }
+     else
+     {
+         mPcieIntCfg.RegResource[PortIndex] = (VOID *)(UINTN)PCIE_REG_BASE(HostBridgeNum, PortIndex);
+     }
+}
+
+/*
+ * Bring the port out of reset and enable LTSSM. The link trains in the
+ * background and is polled by PcieWaitLinksUp ().
+ */
 EFI_STATUS
 EFIAPI
-PciePortInit (
+PciePortStartLink (
   IN UINT32                 soctype,
   IN UINT32                 HostBridgeNum,
   IN PCIE_DRIVER_CFG        *PcieCfg
@@ -1142,16 +1178,7 @@ PciePortInit (
         return EFI_INVALID_PARAMETER;
      }
 
-     if (0x1610 == soctype)
-     {
-         mPcieIntCfg.RegResource[PortIndex] = (VOID *)PCIE_APB_SLAVE_BASE_1610[HostBridgeNum][PortIndex];
-         DEBUG((DEBUG_INFO, "Soc type is 161x\n"));
-     }
-     else
-     {
-         mPcieIntCfg.RegResource[PortIndex] = (VOID *)(UINTN)PCIE_REG_BASE(HostBridgeNum, PortIndex);
-         DEBUG((EFI_D_INFO, "Soc type is 660\n"));
-     }
+     PcieSetRegResource (soctype, HostBridgeNum, PortIndex);
 
      /* assert reset signals */
      (VOID)AssertPcieCoreReset(soctype, HostBridgeNum, PortIndex);
@@ -1204,22 +1231,122 @@ PciePortInit (
      */
      PcieRegWrite(PortIndex, 0x10, 0);
      (VOID)PcieWriteOwnConfig(HostBridgeNum, PortIndex, 0xa, 0x0604);
-     /* check if the link is up or not */
-     while (!PcieIsLinkUp(soctype, HostBridgeNum, PortIndex)) {
-         MicroSecondDelay(1000);
-         Count++;
-         if (Count >= 1000) {
-            DEBUG((EFI_D_ERROR, "HostBridge %d, Port %d link up failed\n", HostBridgeNum, PortIndex));
-            return PCIE_ERR_LINK_OVER_TIME;
-         }
-     }
-     DEBUG((EFI_D_INFO, "HostBridge %d, Port %d Link up ok\n", HostBridgeNum, PortIndex));
-
-     PcieRegWrite(PortIndex, 0x8BC, 0);
 
      return EFI_SUCCESS;
 }
 
+/*
+ * Start (or restart) link training of a port.
+ */
+EFI_STATUS
+PciePortStartTraining (
+  IN UINT32                 soctype,
+  IN PCIE_PORT_LINK         *Link
+  )
+{
+  Link->LaneNumCnt = 0;
+  Link->TrainingTimeUs = 0;
+  Link->StartTime = GetPerformanceCounter ();
+  Link->Status = PciePortStartLink (soctype, Link->HostBridgeNum, &Link->PcieCfg);
+  if (EFI_ERROR (Link->Status)) {
+    return Link->Status;
+  }
+
+  Link->Status = EFI_NOT_READY;
+  return EFI_SUCCESS;
+}
+
+/*
+ * Report the training time and the negotiated width and speed of a port.
+ */
+STATIC
+VOID
+PciePortReportLink (
+  IN UINT32                 soctype,
+  IN PCIE_PORT_LINK         *Link
+  )
+{
+  UINT32                    Port = Link->PcieCfg.PortIndex;
+  PCIE_EP_PCIE_CAP4_U       LinkStatus;
+
+  if (EFI_ERROR (Link->Status)) {
+    DEBUG ((EFI_D_ERROR, "HostBridge %d, Port %d link up failed after %lu ms\n",
+            Link->HostBridgeNum, Port, DivU64x32 (PcieElapsedUs (Link->StartTime), 1000)));
+    return;
+  }
+
+  if (0x1610 == soctype) {
+    PcieDbiCs2Enable (Link->HostBridgeNum, Port, FALSE);
+  }
+  LinkStatus.UInt32 = PcieRegRead (Port, PCIE_EP_PCIE_CAP4_REG);
+  if (0x1610 == soctype) {
+    PcieDbiCs2Enable (Link->HostBridgeNum, Port, TRUE);
+  }
+
+  DEBUG ((EFI_D_INFO, "HostBridge %d, Port %d Link up ok in %lu ms: x%d Gen%d\n",
+          Link->HostBridgeNum, Port, DivU64x32 (Link->TrainingTimeUs, 1000),
+          LinkStatus.Bits.negotiated_link_width, LinkStatus.Bits.current_link_speed));
+}
+
+/*
+ * Poll all training links together until every link is up or has timed out,
+ * so that empty slots do not add up their timeouts. The timeout of a port
+ * counts from its last (re)start, a lane num retrain gets the full time again.
+ */
+VOID
+PcieWaitLinksUp (
+  IN UINT32                 soctype,
+  IN PCIE_PORT_LINK         *Links,
+  IN UINTN                  LinkCount,
+  IN UINT32                 TimeoutMs
+  )
+{
+  PCIE_PORT_LINK            *Link;
+  UINTN                     Index;
+  UINTN                     Pending;
+  UINT32                    Port;
+
+  for (;;) {
+    Pending = 0;
+    for (Index = 0; Index < LinkCount; Index++) {
+      Link = &Links[Index];
+      if (Link->Status != EFI_NOT_READY) {
+        continue;
+      }
+
+      Port = Link->PcieCfg.PortIndex;
+      if (PcieIsLinkUp (soctype, Link->HostBridgeNum, Port)) {
+        Link->TrainingTimeUs = PcieElapsedUs (Link->StartTime);
+        Link->Status = EFI_SUCCESS;
+
+        PcieSetRegResource (soctype, Link->HostBridgeNum, Port);
+        PcieRegWrite (Port, 0x8BC, 0);
+        PciePortReportLink (soctype, Link);
+        continue;
+      }
+
+      if (0x1610 == soctype) {
+        PcieCheckLaneNum (soctype, Link);
+      }
+      if (Link->Status != EFI_NOT_READY) {
+        continue;
+      }
+
+      if (PcieElapsedUs (Link->StartTime) >= (UINT64)TimeoutMs * 1000) {
+        Link->Status = PCIE_ERR_LINK_OVER_TIME;
+        PciePortReportLink (soctype, Link);
+        continue;
+      }
+      Pending++;
+    }
+
+    if (Pending == 0) {
+      break;
+    }
+    MicroSecondDelay (PCIE_LINK_POLL_INTERVAL_US);
+  }
+}
+
 
 
 
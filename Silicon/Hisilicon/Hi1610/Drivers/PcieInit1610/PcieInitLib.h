@@ -158,6 +158,24 @@ typedef struct {
     VOID                *CfgResource[PCIE_MAX_ROOTBRIDGE];
 } PCIE_INIT_CFG;
 
+//
+// Link training of the enabled root ports runs in parallel: every port
+// is started first, then all of them are polled together. Each port times
+// out PCIE_LINK_UP_TIMEOUT_MS after its last (re)start.
+//
+#define PCIE_LINK_UP_TIMEOUT_MS         1000
+#define PCIE_LINK_POLL_INTERVAL_US      200
+#define PCIE_LANE_NUM_CHECK_US          100000
+
+typedef struct {
+    UINT32              HostBridgeNum;
+    PCIE_DRIVER_CFG     PcieCfg;            // Private copy, the width may be reduced on retry
+    EFI_STATUS          Status;             // EFI_NOT_READY while the link is training
+    UINT32              LaneNumCnt;
+    UINT64              StartTime;          // Performance counter when LTSSM was enabled
+    UINT64              TrainingTimeUs;
+} PCIE_PORT_LINK;
+
 typedef enum {
     PCIE_MMIO_IEP_CFG  = 0x1000,
     PCIE_MMIO_IEP_CTRL = 0x0,
@@ -240,4 +258,8 @@ EFI_STATUS PcieWaitLinkUp(UINT32 Port);
 
 EFI_STATUS PcieSetDBICS2Enable(UINT32 HostBridgeNum, UINT32 Port, UINT32 Enable);
 
+EFI_STATUS PciePortStartTraining(UINT32 soctype, PCIE_PORT_LINK *Link);
+
+VOID PcieWaitLinksUp(UINT32 soctype, PCIE_PORT_LINK *Links, UINTN LinkCount, UINT32 TimeoutMs);
+
 #endif
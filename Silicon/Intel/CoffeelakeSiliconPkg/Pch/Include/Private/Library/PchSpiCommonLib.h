@@ -19,6 +19,12 @@
 #define SPI_WAIT_TIME   6000000     ///< Wait Time = 6 seconds = 6000000 microseconds
 #define SPI_WAIT_PERIOD 10          ///< Wait Period = 10 microseconds
 
+//
+// The top of the BIOS region is always decoded right below 4 GB,
+// reads that fall in this window are served from memory.
+//
+#define SPI_BIOS_DECODE_WINDOW_SIZE  SIZE_16MB
+
 ///
 /// Flash cycle Type
 ///
@@ -64,6 +70,7 @@ typedef struct {
   UINT8                 NumberOfComponents;
   UINT32                Component1StartAddr;
   UINT32                TotalFlashSize;
+  UINT32                BiosRegionSize;
 } SPI_INSTANCE;
 
 #define SPI_INSTANCE_FROM_SPIPROTOCOL(a)  CR (a, SPI_INSTANCE, SpiProtocol, PCH_SPI_PRIVATE_DATA_SIGNATURE)
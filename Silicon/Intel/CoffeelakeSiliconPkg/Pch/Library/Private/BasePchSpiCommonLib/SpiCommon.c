@@ -11,6 +11,7 @@
 #include <Library/IoLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/CacheMaintenanceLib.h>
 #include <IndustryStandard/Pci30.h>
 #include <Library/PmcLib.h>
 #include <Library/PciSegmentLib.h>
@@ -35,6 +36,7 @@ SpiProtocolConstructor (
 {
   UINTN           PchSpiBar0;
   UINT32          Data32;
+  UINT32          BiosRegionBase;
 
   //
   // Initialize the SPI protocol instance
@@ -181,9 +183,52 @@ SpiProtocolConstructor (
                                         * sizeof (UINT32));
   DEBUG ((DEBUG_INFO, "CpuStrapSize : %0x\n", SpiInstance->CpuStrapSize));
 
+  //
+  // Keep the BIOS region size for the memory mapped read path
+  //
+  if (EFI_ERROR (SpiProtocolGetRegionAddress (
+                   &SpiInstance->SpiProtocol,
+                   FlashRegionBios,
+                   &BiosRegionBase,
+                   &SpiInstance->BiosRegionSize
+                   ))) {
+    SpiInstance->BiosRegionSize = 0;
+  }
+  DEBUG ((DEBUG_INFO, "BiosRegionSize : %0x\n", SpiInstance->BiosRegionSize));
+
   return EFI_SUCCESS;
 }
 
+/**
+  Get the memory mapped address of a range of the BIOS region.
+
+  @param[in] SpiInstance          Pointer to the SPI instance.
+  @param[in] Address              Offset of the range in the BIOS region.
+  @param[in] ByteCount            Size of the range.
+
+  @retval NULL                    The range is not decoded below 4 GB.
+  @retval others                  The address of the range below 4 GB.
+**/
+STATIC
+VOID *
+SpiGetBiosMappedAddress (
+  IN     SPI_INSTANCE       *SpiInstance,
+  IN     UINT32             Address,
+  IN     UINT32             ByteCount
+  )
+{
+  UINT32          BiosRegionSize;
+
+  BiosRegionSize = SpiInstance->BiosRegionSize;
+  if ((BiosRegionSize == 0) ||
+      ((UINT64) Address + ByteCount > BiosRegionSize) ||
+      ((BiosRegionSize - Address) > SPI_BIOS_DECODE_WINDOW_SIZE)) {
+    return NULL;
+  }
+
+  return (VOID *) (UINTN) (SIZE_4GB - BiosRegionSize + Address);
+}
+
 /**
   Delay for at least the request number of microseconds for Runtime usage.
 
@@ -612,6 +657,36 @@ SendSpiCmdEnd:
   return Status;
 }
 
+/**
+  Drop the cached copy of a BIOS region range after it has been written or
+  erased, so that the memory mapped read path sees the new flash content.
+
+  @param[in] This                 Pointer to the PCH_SPI_PROTOCOL instance.
+  @param[in] FlashRegionType      The Flash Region type of the flash cycle.
+  @param[in] Address              Offset of the range in the region.
+  @param[in] ByteCount            Size of the range.
+**/
+STATIC
+VOID
+SpiInvalidateBiosMapping (
+  IN     PCH_SPI_PROTOCOL   *This,
+  IN     FLASH_REGION_TYPE  FlashRegionType,
+  IN     UINT32             Address,
+  IN     UINT32             ByteCount
+  )
+{
+  VOID              *MappedAddress;
+
+  if (FlashRegionType != FlashRegionBios) {
+    return;
+  }
+
+  MappedAddress = SpiGetBiosMappedAddress (SPI_INSTANCE_FROM_SPIPROTOCOL (This), Address, ByteCount);
+  if (MappedAddress != NULL) {
+    WriteBackInvalidateDataCacheRange (MappedAddress, ByteCount);
+  }
+}
+
 /**
   Read data from the flash part.
 
@@ -637,6 +712,19 @@ SpiProtocolFlashRead (
   )
 {
   EFI_STATUS        Status;
+  VOID              *MappedAddress;
+
+  //
+  // Reads of the decoded part of the BIOS region are a plain memory copy,
+  // instead of hardware sequencing cycles of 64 bytes each.
+  //
+  if (FlashRegionType == FlashRegionBios) {
+    MappedAddress = SpiGetBiosMappedAddress (SPI_INSTANCE_FROM_SPIPROTOCOL (This), Address, ByteCount);
+    if (MappedAddress != NULL) {
+      CopyMem (Buffer, MappedAddress, ByteCount);
+      return EFI_SUCCESS;
+    }
+  }
 
   //
   // Sends the command to the SPI interface to execute.
@@ -688,6 +776,7 @@ SpiProtocolFlashWrite (
              ByteCount,
              Buffer
              );
+  SpiInvalidateBiosMapping (This, FlashRegionType, Address, ByteCount);
   return Status;
 }
 
@@ -725,6 +814,7 @@ SpiProtocolFlashErase (
              ByteCount,
              NULL
              );
+  SpiInvalidateBiosMapping (This, FlashRegionType, Address, ByteCount);
   return Status;
 }
 
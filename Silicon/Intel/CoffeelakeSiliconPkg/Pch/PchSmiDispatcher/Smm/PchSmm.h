@@ -413,6 +413,10 @@ VOID
 struct _DATABASE_RECORD {
   UINT32                        Signature;
   LIST_ENTRY                    Link;
+  ///
+  /// Link in the SMI_STS bit bucket of PRIVATE_DATA.SmiStsIndex
+  ///
+  LIST_ENTRY                    IndexLink;
   BOOLEAN                       Processed;
   ///
   /// Status and Enable bit description
@@ -457,6 +461,7 @@ struct _DATABASE_RECORD {
 };
 
 #define DATABASE_RECORD_FROM_LINK(_record)  CR (_record, DATABASE_RECORD, Link, DATABASE_RECORD_SIGNATURE)
+#define DATABASE_RECORD_FROM_INDEX_LINK(_record)  CR (_record, DATABASE_RECORD, IndexLink, DATABASE_RECORD_SIGNATURE)
 #define DATABASE_RECORD_FROM_CHILDCONTEXT(_record)  CR (_record, DATABASE_RECORD, ChildContext, DATABASE_RECORD_SIGNATURE)
 
 ///
@@ -581,6 +586,25 @@ typedef struct {
   PROTOCOL_SIGNATURE \
   )
 
+///
+/// The callback database is indexed by the R_ACPI_IO_SMI_STS bit that gates each source.
+/// Buckets 0-31 match the SMI_STS bits, the last bucket holds the sources which are
+/// not gated by an SMI_STS bit and has to be scanned on every SMI.
+///
+#define PCH_SMM_STS_INDEX_UNGATED  32
+#define PCH_SMM_STS_INDEX_COUNT    (PCH_SMM_STS_INDEX_UNGATED + 1)
+
+///
+/// Cycle counts of the PCH SMI dispatcher, measured with the TSC per dispatcher invocation
+///
+typedef struct {
+  UINT64                      DispatchCount;
+  UINT64                      RecordsScanned;   ///< Records passed to SourceIsActive
+  UINT64                      LastCycles;
+  UINT64                      MaxCycles;
+  UINT64                      TotalCycles;
+} PCH_SMM_DISPATCH_STATS;
+
 ///
 /// Create private data for the protocols that we'll publish
 ///
@@ -589,6 +613,9 @@ typedef struct {
   EFI_HANDLE                  SmiHandle;
   EFI_HANDLE                  InstallMultProtHandle;
   PCH_SMM_QUALIFIED_PROTOCOL  Protocols[PCH_SMM_PROTOCOL_TYPE_MAX];
+  LIST_ENTRY                  SmiStsIndex[PCH_SMM_STS_INDEX_COUNT];
+  UINT32                      SmiStsIndexMask;  ///< Bit N is set when SmiStsIndex[N] is not empty
+  PCH_SMM_DISPATCH_STATS      DispatchStats;
 } PRIVATE_DATA;
 
 extern PRIVATE_DATA           mPrivateData;
@@ -611,6 +638,17 @@ SmmCoreInsertRecord (
   OUT EFI_HANDLE                        *DispatchHandle
   );
 
+/**
+  The internal function used to take a database record out of the database and its SMI_STS index.
+  The record itself is not freed.
+
+  @param[in]  Record                    Record to remove from database.
+**/
+VOID
+SmmCoreRemoveRecord (
+  IN  DATABASE_RECORD                   *Record
+  );
+
 /**
   Get the Sleep type
 
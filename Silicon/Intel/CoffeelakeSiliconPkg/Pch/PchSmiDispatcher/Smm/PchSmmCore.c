@@ -219,6 +219,7 @@ InitializePchSmmDispatcher (
 {
   EFI_STATUS           Status;
   VOID                 *SmmReadyToLockRegistration;
+  UINTN                Bucket;
 
   //
   // Access ACPI Base Addresses Register
@@ -244,6 +245,9 @@ InitializePchSmmDispatcher (
   // Initialize Callback DataBase
   //
   InitializeListHead (&mPrivateData.CallbackDataBase);
+  for (Bucket = 0; Bucket < PCH_SMM_STS_INDEX_COUNT; Bucket++) {
+    InitializeListHead (&mPrivateData.SmiStsIndex[Bucket]);
+  }
 
   //
   // Enable SMIs on the PCH now that we have a callback
@@ -273,6 +277,163 @@ InitializePchSmmDispatcher (
   return EFI_SUCCESS;
 }
 
+/**
+  Get the SMI_STS index bucket of an SMI source.
+
+  The source is gated by its top level PMC SMI_STS bit. If that is not described,
+  a secondary status bit living in SMI_STS is used instead. Sources with neither
+  go to the ungated bucket.
+
+  @param[in]  SrcDesc                   Pointer to the PCH SMI source description
+
+  @retval     Bucket index in mPrivateData.SmiStsIndex
+**/
+STATIC
+UINTN
+SmmCoreGetIndexBucket (
+  IN CONST PCH_SMM_SOURCE_DESC          *SrcDesc
+  )
+{
+  UINTN                                 DescIndex;
+
+  if ((SrcDesc->PmcSmiSts.Reg.Type == ACPI_ADDR_TYPE) &&
+      (SrcDesc->PmcSmiSts.Reg.Data.acpi == R_ACPI_IO_SMI_STS) &&
+      (SrcDesc->PmcSmiSts.Bit < PCH_SMM_STS_INDEX_UNGATED)) {
+    return SrcDesc->PmcSmiSts.Bit;
+  }
+
+  for (DescIndex = 0; DescIndex < NUM_STS_BITS; DescIndex++) {
+    if ((SrcDesc->Sts[DescIndex].Reg.Type == ACPI_ADDR_TYPE) &&
+        (SrcDesc->Sts[DescIndex].Reg.Data.acpi == R_ACPI_IO_SMI_STS) &&
+        (SrcDesc->Sts[DescIndex].Bit < PCH_SMM_STS_INDEX_UNGATED)) {
+      return SrcDesc->Sts[DescIndex].Bit;
+    }
+  }
+
+  return PCH_SMM_STS_INDEX_UNGATED;
+}
+
+/**
+  Add a database record to its SMI_STS index bucket.
+
+  Records sharing the same source description are kept next to each other, so the
+  dispatcher checks a source once and skips the rest of that group when it is inactive.
+
+  @param[in]  Record                    Record which is already in the database.
+**/
+STATIC
+VOID
+SmmCoreIndexRecord (
+  IN  DATABASE_RECORD                   *Record
+  )
+{
+  UINTN                                 Bucket;
+  LIST_ENTRY                            *Head;
+  LIST_ENTRY                            *LinkInIndex;
+  LIST_ENTRY                            *InsertAfter;
+  DATABASE_RECORD                       *RecordInIndex;
+
+  Bucket      = SmmCoreGetIndexBucket (&Record->SrcDesc);
+  Head        = &mPrivateData.SmiStsIndex[Bucket];
+  InsertAfter = Head->BackLink;
+
+  LinkInIndex = GetFirstNode (Head);
+  while (!IsNull (Head, LinkInIndex)) {
+    RecordInIndex = DATABASE_RECORD_FROM_INDEX_LINK (LinkInIndex);
+    if (CompareSources (&RecordInIndex->SrcDesc, &Record->SrcDesc)) {
+      //
+      // Find the last record of the group with the same source
+      //
+      while (!IsNodeAtEnd (Head, LinkInIndex) &&
+             CompareSources (&DATABASE_RECORD_FROM_INDEX_LINK (LinkInIndex->ForwardLink)->SrcDesc, &Record->SrcDesc)) {
+        LinkInIndex = GetNextNode (Head, LinkInIndex);
+      }
+      InsertAfter = LinkInIndex;
+      break;
+    }
+    LinkInIndex = GetNextNode (Head, LinkInIndex);
+  }
+
+  //
+  // Inserting at the head of a node puts the record right behind that node
+  //
+  InsertHeadList (InsertAfter, &Record->IndexLink);
+
+  if (Bucket < PCH_SMM_STS_INDEX_UNGATED) {
+    mPrivateData.SmiStsIndexMask |= (1u << Bucket);
+  }
+}
+
+/**
+  The internal function used to take a database record out of the database and its SMI_STS index.
+  The record itself is not freed.
+
+  @param[in]  Record                    Record to remove from database.
+**/
+VOID
+SmmCoreRemoveRecord (
+  IN  DATABASE_RECORD                   *Record
+  )
+{
+  UINTN                                 Bucket;
+
+  RemoveEntryList (&Record->Link);
+  RemoveEntryList (&Record->IndexLink);
+
+  Bucket = SmmCoreGetIndexBucket (&Record->SrcDesc);
+  if ((Bucket < PCH_SMM_STS_INDEX_UNGATED) &&
+      IsListEmpty (&mPrivateData.SmiStsIndex[Bucket])) {
+    mPrivateData.SmiStsIndexMask &= ~(1u << Bucket);
+  }
+}
+
+/**
+  Find the first active record of an SMI_STS index bucket.
+
+  @param[in]  Head                      Head of the index bucket
+  @param[in]  SciEn                     Cached SCI_EN value
+  @param[in]  SmiEnValue                Cached R_ACPI_IO_SMI_EN value
+  @param[in]  SmiStsValue               Cached R_ACPI_IO_SMI_STS value
+
+  @retval     The first record whose source is active, NULL if there is none.
+**/
+STATIC
+DATABASE_RECORD *
+SmmCoreFindActiveRecord (
+  IN LIST_ENTRY                         *Head,
+  IN BOOLEAN                            SciEn,
+  IN UINT32                             SmiEnValue,
+  IN UINT32                             SmiStsValue
+  )
+{
+  LIST_ENTRY                            *LinkInIndex;
+  DATABASE_RECORD                       *RecordInIndex;
+  DATABASE_RECORD                       *InactiveRecord;
+
+  InactiveRecord = NULL;
+  LinkInIndex    = GetFirstNode (Head);
+  while (!IsNull (Head, LinkInIndex)) {
+    RecordInIndex = DATABASE_RECORD_FROM_INDEX_LINK (LinkInIndex);
+    LinkInIndex   = GetNextNode (Head, LinkInIndex);
+
+    //
+    // Records of the same source are grouped, don't read the hardware again for them
+    //
+    if ((InactiveRecord != NULL) &&
+        CompareSources (&InactiveRecord->SrcDesc, &RecordInIndex->SrcDesc)) {
+      continue;
+    }
+
+    mPrivateData.DispatchStats.RecordsScanned++;
+    if (SourceIsActive (&RecordInIndex->SrcDesc, SciEn, SmiEnValue, SmiStsValue)) {
+      return RecordInIndex;
+    }
+    InactiveRecord = RecordInIndex;
+  }
+
+  return NULL;
+}
+
 /**
   The internal function used to create and insert a database record
 
@@ -310,6 +471,7 @@ SmmCoreInsertRecord (
   // After ensuring the source of event is not null, we will insert the record into the database
   //
   InsertTailList (&mPrivateData.CallbackDataBase, &Record->Link);
+  SmmCoreIndexRecord (Record);
 
   //
   // Child's handle will be the address linked list link in the record
@@ -570,7 +732,7 @@ PchSmmCoreUnRegister (
     return EFI_INVALID_PARAMETER;
   }
 
-  RemoveEntryList (&RecordToDelete->Link);
+  SmmCoreRemoveRecord (RecordToDelete);
 
   //
   // Loop through all the souces in record linked list to see if any source enable is equal.
@@ -677,7 +839,9 @@ PchSmmCoreDispatcher (
   BOOLEAN             SxChildWasDispatched;
 
   DATABASE_RECORD     *RecordInDb;
-  LIST_ENTRY          *LinkInDb;
+  LIST_ENTRY          *IndexHead;
+  UINTN               Bucket;
+  UINT32              PendingBuckets;
   DATABASE_RECORD     *RecordToExhaust;
   LIST_ENTRY          *LinkToExhaust;
 
@@ -693,6 +857,10 @@ PchSmmCoreDispatcher (
   UINT8               Port76Save;
 
   PCH_SMM_SOURCE_DESC ActiveSource;
+  UINT64              StartTsc;
+  UINT64              Cycles;
+
+  StartTsc = AsmReadTsc ();
 
   //
   // Initialize ActiveSource
@@ -721,8 +889,6 @@ PchSmmCoreDispatcher (
     while ((!EosSet) && (EscapeCount > 0)) {
       EscapeCount--;
 
-      LinkInDb = GetFirstNode (&mPrivateData.CallbackDataBase);
-
       //
       // Cache SciEn, SmiEnValue and SmiStsValue to determine if source is active
       //
@@ -730,149 +896,159 @@ PchSmmCoreDispatcher (
       SmiEnValue  = IoRead32 ((UINTN) (mAcpiBaseAddr + R_ACPI_IO_SMI_EN));
       SmiStsValue = IoRead32 ((UINTN) (mAcpiBaseAddr + R_ACPI_IO_SMI_STS));
 
-      while (!IsNull (&mPrivateData.CallbackDataBase, LinkInDb)) {
-        RecordInDb = DATABASE_RECORD_FROM_LINK (LinkInDb);
+      //
+      // Only the buckets of the set SMI_STS bits can hold an active source,
+      // the ungated bucket is always checked last.
+      //
+      PendingBuckets = SmiStsValue & mPrivateData.SmiStsIndexMask;
+      RecordInDb     = NULL;
+      IndexHead      = NULL;
+      for (Bucket = 0; (Bucket < PCH_SMM_STS_INDEX_COUNT) && (RecordInDb == NULL); Bucket++) {
+        if ((Bucket < PCH_SMM_STS_INDEX_UNGATED) && ((PendingBuckets & (1u << Bucket)) == 0)) {
+          continue;
+        }
+        IndexHead  = &mPrivateData.SmiStsIndex[Bucket];
+        RecordInDb = SmmCoreFindActiveRecord (IndexHead, SciEn, SmiEnValue, SmiStsValue);
+      }
 
+      if (RecordInDb == NULL) {
         //
-        // look for the first active source
+        // No active source, clear pending SMI status and try to clear EOS
         //
-        if (!SourceIsActive (&RecordInDb->SrcDesc, SciEn, SmiEnValue, SmiStsValue)) {
-          //
-          // Didn't find the source yet, keep looking
-          //
-          LinkInDb = GetNextNode (&mPrivateData.CallbackDataBase, &RecordInDb->Link);
+        ClearPendingSmiStatus (SmiStsValue, SciEn);
+        EosSet = PchSmmSetAndCheckEos ();
+      } else {
+        //
+        // We found a source. If this is a sleep type, we have to go to
+        // appropriate sleep state anyway.No matter there is sleep child or not
+        //
+        if (RecordInDb->ProtocolType == SxType) {
+          SxChildWasDispatched = TRUE;
+        }
+        //
+        // "cache" the source description and don't query I/O anymore
+        //
+        CopyMem ((VOID *) &ActiveSource, (VOID *) &(RecordInDb->SrcDesc), sizeof (PCH_SMM_SOURCE_DESC));
+        LinkToExhaust = &RecordInDb->IndexLink;
 
+        //
+        // exhaust the rest of the bucket looking for the same source
+        //
+        while (!IsNull (IndexHead, LinkToExhaust)) {
+          RecordToExhaust = DATABASE_RECORD_FROM_INDEX_LINK (LinkToExhaust);
           //
-          // if it's the last one, try to clear EOS
-          //
-          if (IsNull (&mPrivateData.CallbackDataBase, LinkInDb)) {
-            //
-            // Clear pending SMI status before EOS
-            //
-            ClearPendingSmiStatus (SmiStsValue, SciEn);
-            EosSet = PchSmmSetAndCheckEos ();
-          }
-        } else {
-          //
-          // We found a source. If this is a sleep type, we have to go to
-          // appropriate sleep state anyway.No matter there is sleep child or not
-          //
-          if (RecordInDb->ProtocolType == SxType) {
-            SxChildWasDispatched = TRUE;
-          }
-          //
-          // "cache" the source description and don't query I/O anymore
+          // RecordToExhaust->IndexLink might be removed (unregistered) by Callback function, and then the
+          // system will hang in ASSERT() while calling GetNextNode().
+          // To prevent the issue, we need to get next record in DB here (before Callback function).
           //
-          CopyMem ((VOID *) &ActiveSource, (VOID *) &(RecordInDb->SrcDesc), sizeof (PCH_SMM_SOURCE_DESC));
-          LinkToExhaust = LinkInDb;
+          LinkToExhaust = GetNextNode (IndexHead, &RecordToExhaust->IndexLink);
 
-          //
-          // exhaust the rest of the queue looking for the same source
-          //
-          while (!IsNull (&mPrivateData.CallbackDataBase, LinkToExhaust)) {
-            RecordToExhaust = DATABASE_RECORD_FROM_LINK (LinkToExhaust);
+          if (CompareSources (&RecordToExhaust->SrcDesc, &ActiveSource)) {
             //
-            // RecordToExhaust->Link might be removed (unregistered) by Callback function, and then the
-            // system will hang in ASSERT() while calling GetNextNode().
-            // To prevent the issue, we need to get next record in DB here (before Callback function).
+            // These source descriptions are equal, so this callback should be
+            // dispatched.
             //
-            LinkToExhaust = GetNextNode (&mPrivateData.CallbackDataBase, &RecordToExhaust->Link);
+            if (RecordToExhaust->ContextFunctions.GetContext != NULL) {
+              //
+              // This child requires that we get a calling context from
+              // hardware and compare that context to the one supplied
+              // by the child.
+              //
+              ASSERT (RecordToExhaust->ContextFunctions.CmpContext != NULL);
 
-            if (CompareSources (&RecordToExhaust->SrcDesc, &ActiveSource)) {
               //
-              // These source descriptions are equal, so this callback should be
-              // dispatched.
+              // Make sure contexts match before dispatching event to child
               //
-              if (RecordToExhaust->ContextFunctions.GetContext != NULL) {
-                //
-                // This child requires that we get a calling context from
-                // hardware and compare that context to the one supplied
-                // by the child.
-                //
-                ASSERT (RecordToExhaust->ContextFunctions.CmpContext != NULL);
+              RecordToExhaust->ContextFunctions.GetContext (RecordToExhaust, &Context);
+              ContextsMatch = RecordToExhaust->ContextFunctions.CmpContext (&Context, &RecordToExhaust->ChildContext);
+
+            } else {
+              //
+              // This child doesn't require any more calling context beyond what
+              // it supplied in registration.  Simply pass back what it gave us.
+              //
+              Context       = RecordToExhaust->ChildContext;
+              ContextsMatch = TRUE;
+            }
 
+            if (ContextsMatch) {
+              if (RecordToExhaust->ProtocolType == PchSmiDispatchType) {
                 //
-                // Make sure contexts match before dispatching event to child
+                // For PCH SMI dispatch protocols
                 //
-                RecordToExhaust->ContextFunctions.GetContext (RecordToExhaust, &Context);
-                ContextsMatch = RecordToExhaust->ContextFunctions.CmpContext (&Context, &RecordToExhaust->ChildContext);
-
+                PchSmiTypeCallbackDispatcher (RecordToExhaust);
               } else {
                 //
-                // This child doesn't require any more calling context beyond what
-                // it supplied in registration.  Simply pass back what it gave us.
+                // For EFI standard SMI dispatch protocols
                 //
-                Context       = RecordToExhaust->ChildContext;
-                ContextsMatch = TRUE;
-              }
-
-              if (ContextsMatch) {
-                if (RecordToExhaust->ProtocolType == PchSmiDispatchType) {
-                  //
-                  // For PCH SMI dispatch protocols
-                  //
-                  PchSmiTypeCallbackDispatcher (RecordToExhaust);
-                } else {
-                  //
-                  // For EFI standard SMI dispatch protocols
-                  //
-                  if (RecordToExhaust->Callback != NULL) {
-                    if (RecordToExhaust->ContextFunctions.GetCommBuffer != NULL) {
-                      //
-                      // This callback function needs CommBuffer and CommBufferSize.
-                      // Get those from child and then pass to callback function.
-                      //
-                      RecordToExhaust->ContextFunctions.GetCommBuffer (RecordToExhaust, &CommBuffer, &CommBufferSize);
-                    } else {
-                      //
-                      // Child doesn't support the CommBuffer and CommBufferSize.
-                      // Just pass NULL value to callback function.
-                      //
-                      CommBuffer     = NULL;
-                      CommBufferSize = 0;
-                    }
-
-                    PERF_START_EX (NULL, "SmmFunction", NULL, AsmReadTsc (), RecordToExhaust->ProtocolType);
-                    RecordToExhaust->Callback ((EFI_HANDLE) & RecordToExhaust->Link, &Context, CommBuffer, &CommBufferSize);
-                    PERF_END_EX (NULL, "SmmFunction", NULL, AsmReadTsc (), RecordToExhaust->ProtocolType);
-                    if (RecordToExhaust->ProtocolType == SxType) {
-                      SxChildWasDispatched = TRUE;
-                    }
+                if (RecordToExhaust->Callback != NULL) {
+                  if (RecordToExhaust->ContextFunctions.GetCommBuffer != NULL) {
+                    //
+                    // This callback function needs CommBuffer and CommBufferSize.
+                    // Get those from child and then pass to callback function.
+                    //
+                    RecordToExhaust->ContextFunctions.GetCommBuffer (RecordToExhaust, &CommBuffer, &CommBufferSize);
                   } else {
-                    ASSERT (FALSE);
+                    //
+                    // Child doesn't support the CommBuffer and CommBufferSize.
+                    // Just pass NULL value to callback function.
+                    //
+                    CommBuffer     = NULL;
+                    CommBufferSize = 0;
                   }
+
+                  PERF_START_EX (NULL, "SmmFunction", NULL, AsmReadTsc (), RecordToExhaust->ProtocolType);
+                  RecordToExhaust->Callback ((EFI_HANDLE) & RecordToExhaust->Link, &Context, CommBuffer, &CommBufferSize);
+                  PERF_END_EX (NULL, "SmmFunction", NULL, AsmReadTsc (), RecordToExhaust->ProtocolType);
+                  if (RecordToExhaust->ProtocolType == SxType) {
+                    SxChildWasDispatched = TRUE;
+                  }
+                } else {
+                  ASSERT (FALSE);
                 }
               }
             }
           }
+        }
 
-          if (RecordInDb->ClearSource == NULL) {
-            //
-            // Clear the SMI associated w/ the source using the default function
-            //
-            PchSmmClearSource (&ActiveSource);
-          } else {
-            //
-            // This source requires special handling to clear
-            //
-            RecordInDb->ClearSource (&ActiveSource);
-          }
-          //
-          // Clear pending SMI status before EOS
+        if (RecordInDb->ClearSource == NULL) {
           //
-          ClearPendingSmiStatus (SmiStsValue, SciEn);
+          // Clear the SMI associated w/ the source using the default function
           //
-          // Also, try to clear EOS
-          //
-          EosSet = PchSmmSetAndCheckEos ();
+          PchSmmClearSource (&ActiveSource);
+        } else {
           //
-          // Queue is empty, reset the search
+          // This source requires special handling to clear
           //
-          break;
+          RecordInDb->ClearSource (&ActiveSource);
         }
+        //
+        // Clear pending SMI status before EOS
+        //
+        ClearPendingSmiStatus (SmiStsValue, SciEn);
+        //
+        // Also, try to clear EOS
+        //
+        EosSet = PchSmmSetAndCheckEos ();
       }
     }
   }
+
+  Cycles = AsmReadTsc () - StartTsc;
+  mPrivateData.DispatchStats.DispatchCount++;
+  mPrivateData.DispatchStats.LastCycles   = Cycles;
+  mPrivateData.DispatchStats.TotalCycles += Cycles;
+  if (Cycles > mPrivateData.DispatchStats.MaxCycles) {
+    mPrivateData.DispatchStats.MaxCycles = Cycles;
+    DEBUG ((
+      DEBUG_VERBOSE,
+      "PchSmmCoreDispatcher: new max %lu cycles, %lu dispatches, %lu records scanned\n",
+      Cycles,
+      mPrivateData.DispatchStats.DispatchCount,
+      mPrivateData.DispatchStats.RecordsScanned
+      ));
+  }
+
   //
   // If you arrive here, there are two possible reasons:
   // (1) you've got problems with clearing the SMI status bits in the
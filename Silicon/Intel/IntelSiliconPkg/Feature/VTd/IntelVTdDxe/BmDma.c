@@ -24,7 +24,8 @@ typedef struct {
 #define MAP_INFO_SIGNATURE  SIGNATURE_32 ('D', 'M', 'A', 'P')
 typedef struct {
   UINT32                                    Signature;
-  LIST_ENTRY                                Link;
+  LIST_ENTRY                                Link;           // Hashed by MAP_INFO address
+  LIST_ENTRY                                DeviceLink;     // Hashed by DeviceAddress
   EDKII_IOMMU_OPERATION                     Operation;
   UINTN                                     NumberOfBytes;
   UINTN                                     NumberOfPages;
@@ -33,8 +34,254 @@ typedef struct {
   LIST_ENTRY                                HandleList;
 } MAP_INFO;
 #define MAP_INFO_FROM_LINK(a) CR (a, MAP_INFO, Link, MAP_INFO_SIGNATURE)
+#define MAP_INFO_FROM_DEVICE_LINK(a) CR (a, MAP_INFO, DeviceLink, MAP_INFO_SIGNATURE)
+
+//
+// Active mappings are hashed twice, by the Mapping handle returned to the
+// caller and by the device address, so that Unmap() and SetAttribute() do
+// not have to walk every mapping in the system.
+//
+#define MAP_HASH_BUCKETS        256
+#define MAP_HASH_INDEX(Value)   ((((UINTN) (Value) >> 4) ^ ((UINTN) (Value) >> 12)) & (MAP_HASH_BUCKETS - 1))
+
+LIST_ENTRY                        mMapsByHandle[MAP_HASH_BUCKETS];
+LIST_ENTRY                        mMapsByDevice[MAP_HASH_BUCKETS];
+
+//
+// Freed bounce buffers below 4GB are kept for reuse, one list per page count.
+// The list node lives in the first bytes of the free buffer itself.
+//
+#define BOUNCE_BUFFER_SIGNATURE  SIGNATURE_32 ('B', 'B', 'U', 'F')
+typedef struct {
+  UINT32                                    Signature;
+  LIST_ENTRY                                Link;
+} BOUNCE_BUFFER;
+#define BOUNCE_BUFFER_FROM_LINK(a) CR (a, BOUNCE_BUFFER, Link, BOUNCE_BUFFER_SIGNATURE)
+
+#define BOUNCE_POOL_MAX_BUFFER_PAGES  16
+#define BOUNCE_POOL_MAX_PAGES         512
+
+LIST_ENTRY                        mBouncePool[BOUNCE_POOL_MAX_BUFFER_PAGES];
+
+EDKII_VTD_DMA_STATISTICS          mDmaStatistics;
+
+/**
+  Initialize the mapping tables and the bounce buffer pool.
+**/
+VOID
+InitializeMapTable (
+  VOID
+  )
+{
+  UINTN                    Index;
+
+  for (Index = 0; Index < MAP_HASH_BUCKETS; Index++) {
+    InitializeListHead (&mMapsByHandle[Index]);
+    InitializeListHead (&mMapsByDevice[Index]);
+  }
+  for (Index = 0; Index < BOUNCE_POOL_MAX_BUFFER_PAGES; Index++) {
+    InitializeListHead (&mBouncePool[Index]);
+  }
+}
+
+/**
+  Find the MAP_INFO of a Mapping handle returned by Map().
+
+  The caller must hold VTD_TPL_LEVEL.
+
+  @param[in]  Mapping       The mapping value returned from Map().
+
+  @return The MAP_INFO, or NULL if Mapping is not an active mapping.
+**/
+MAP_INFO *
+FindMapInfoByHandle (
+  IN VOID                  *Mapping
+  )
+{
+  LIST_ENTRY               *Head;
+  LIST_ENTRY               *Link;
+
+  Head = &mMapsByHandle[MAP_HASH_INDEX (Mapping)];
+  for (Link = GetFirstNode (Head)
+       ; !IsNull (Head, Link)
+       ; Link = GetNextNode (Head, Link)
+       ) {
+    if (MAP_INFO_FROM_LINK (Link) == Mapping) {
+      return Mapping;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Find the oldest active MAP_INFO using a device address.
+
+  The caller must hold VTD_TPL_LEVEL.
+
+  @param[in]  DeviceAddress The base of device memory address of the mapping.
+
+  @return The MAP_INFO, or NULL if there is no mapping at DeviceAddress.
+**/
+MAP_INFO *
+FindMapInfoByDeviceAddress (
+  IN EFI_PHYSICAL_ADDRESS  DeviceAddress
+  )
+{
+  LIST_ENTRY               *Head;
+  LIST_ENTRY               *Link;
+  MAP_INFO                 *MapInfo;
 
-LIST_ENTRY                        gMaps = INITIALIZE_LIST_HEAD_VARIABLE(gMaps);
+  Head = &mMapsByDevice[MAP_HASH_INDEX (DeviceAddress)];
+  for (Link = GetFirstNode (Head)
+       ; !IsNull (Head, Link)
+       ; Link = GetNextNode (Head, Link)
+       ) {
+    MapInfo = MAP_INFO_FROM_DEVICE_LINK (Link);
+    if (MapInfo->DeviceAddress == DeviceAddress) {
+      return MapInfo;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Allocate a bounce buffer, reusing a pooled one within the DMA limit when possible.
+
+  @param[in]      NumberOfPages   The number of pages of the bounce buffer.
+  @param[in, out] Address         On input the highest acceptable address,
+                                  on output the address of the bounce buffer.
+
+  @retval EFI_SUCCESS             The bounce buffer is allocated.
+  @retval others                  The pages could not be allocated.
+**/
+EFI_STATUS
+AllocateBounceBuffer (
+  IN     UINTN                 NumberOfPages,
+  IN OUT EFI_PHYSICAL_ADDRESS  *Address
+  )
+{
+  EFI_STATUS               Status;
+  EFI_PHYSICAL_ADDRESS     MaxAddress;
+  BOUNCE_BUFFER            *BounceBuffer;
+  LIST_ENTRY               *Head;
+  LIST_ENTRY               *Link;
+  EFI_TPL                  OriginalTpl;
+
+  MaxAddress = *Address;
+
+  if ((NumberOfPages != 0) && (NumberOfPages <= BOUNCE_POOL_MAX_BUFFER_PAGES)) {
+    //
+    // Pooled buffers are all below 4GB, but MaxAddress is the DMA limit
+    // of this mapping and may be lower than that, so only take a buffer
+    // that ends at or below it.
+    //
+    BounceBuffer = NULL;
+    OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+    Head = &mBouncePool[NumberOfPages - 1];
+    for (Link = GetFirstNode (Head)
+         ; !IsNull (Head, Link)
+         ; Link = GetNextNode (Head, Link)
+         ) {
+      BounceBuffer = BOUNCE_BUFFER_FROM_LINK (Link);
+      if ((UINTN) BounceBuffer + EFI_PAGES_TO_SIZE (NumberOfPages) - 1 <= MaxAddress) {
+        RemoveEntryList (&BounceBuffer->Link);
+        mDmaStatistics.BouncePoolPages -= NumberOfPages;
+        mDmaStatistics.BouncePoolHits++;
+        break;
+      }
+      BounceBuffer = NULL;
+    }
+    gBS->RestoreTPL (OriginalTpl);
+
+    if (BounceBuffer != NULL) {
+      *Address = (EFI_PHYSICAL_ADDRESS) (UINTN) BounceBuffer;
+      return EFI_SUCCESS;
+    }
+
+    //
+    // Prefer memory below 4GB so that the buffer can go back to the pool
+    //
+    *Address = MIN (MaxAddress, SIZE_4GB - 1);
+    Status = gBS->AllocatePages (
+                    AllocateMaxAddress,
+                    EfiBootServicesData,
+                    NumberOfPages,
+                    Address
+                    );
+    if (!EFI_ERROR (Status) || (MaxAddress <= SIZE_4GB - 1)) {
+      return Status;
+    }
+    *Address = MaxAddress;
+  }
+
+  return gBS->AllocatePages (
+                AllocateMaxAddress,
+                EfiBootServicesData,
+                NumberOfPages,
+                Address
+                );
+}
+
+/**
+  Free a bounce buffer, keeping it in the pool when it is small and below 4GB.
+
+  @param[in]  Address         The address of the bounce buffer.
+  @param[in]  NumberOfPages   The number of pages of the bounce buffer.
+**/
+VOID
+FreeBounceBuffer (
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINTN                 NumberOfPages
+  )
+{
+  BOUNCE_BUFFER            *BounceBuffer;
+  EFI_TPL                  OriginalTpl;
+
+  if ((NumberOfPages != 0) && (NumberOfPages <= BOUNCE_POOL_MAX_BUFFER_PAGES) &&
+      (Address + EFI_PAGES_TO_SIZE (NumberOfPages) <= SIZE_4GB)) {
+    OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+    if (mDmaStatistics.BouncePoolPages + NumberOfPages <= BOUNCE_POOL_MAX_PAGES) {
+      BounceBuffer = (BOUNCE_BUFFER *) (UINTN) Address;
+      BounceBuffer->Signature = BOUNCE_BUFFER_SIGNATURE;
+      InsertHeadList (&mBouncePool[NumberOfPages - 1], &BounceBuffer->Link);
+      mDmaStatistics.BouncePoolPages += NumberOfPages;
+      gBS->RestoreTPL (OriginalTpl);
+      return ;
+    }
+    gBS->RestoreTPL (OriginalTpl);
+  }
+
+  gBS->FreePages (Address, NumberOfPages);
+}
+
+/**
+  Get the DMA mapping statistics of the VTd driver.
+
+  @param[in]  This                 The protocol instance pointer.
+  @param[out] Statistics           The DMA mapping statistics.
+
+  @retval EFI_SUCCESS              The statistics are returned.
+  @retval EFI_INVALID_PARAMETER    Statistics is NULL.
+**/
+EFI_STATUS
+EFIAPI
+VTdGetDmaStatistics (
+  IN  EDKII_VTD_DEBUG_PROTOCOL             *This,
+  OUT EDKII_VTD_DMA_STATISTICS             *Statistics
+  )
+{
+  EFI_TPL                  OriginalTpl;
+
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+  CopyMem (Statistics, &mDmaStatistics, sizeof (*Statistics));
+  gBS->RestoreTPL (OriginalTpl);
+
+  return EFI_SUCCESS;
+}
 
 /**
   This function fills DeviceHandle/IoMmuAccess to the MAP_HANDLE_INFO,
@@ -63,17 +310,8 @@ SyncDeviceHandleToMapInfo (
   // Find MapInfo according to DeviceAddress
   //
   OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
-  MapInfo = NULL;
-  for (Link = GetFirstNode (&gMaps)
-       ; !IsNull (&gMaps, Link)
-       ; Link = GetNextNode (&gMaps, Link)
-       ) {
-    MapInfo = MAP_INFO_FROM_LINK (Link);
-    if (MapInfo->DeviceAddress == DeviceAddress) {
-      break;
-    }
-  }
-  if ((MapInfo == NULL) || (MapInfo->DeviceAddress != DeviceAddress)) {
+  MapInfo = FindMapInfoByDeviceAddress (DeviceAddress);
+  if (MapInfo == NULL) {
     DEBUG ((DEBUG_ERROR, "SyncDeviceHandleToMapInfo: DeviceAddress(0x%lx) - not found\n", DeviceAddress));
     gBS->RestoreTPL (OriginalTpl);
     return ;
@@ -156,6 +394,7 @@ IoMmuMap (
   EFI_PHYSICAL_ADDRESS                              DmaMemoryTop;
   BOOLEAN                                           NeedRemap;
   EFI_TPL                                           OriginalTpl;
+  UINTN                                             BytesBounced;
 
   if (NumberOfBytes == NULL || DeviceAddress == NULL ||
       Mapping == NULL) {
@@ -173,6 +412,7 @@ IoMmuMap (
     return EFI_INVALID_PARAMETER;
   }
   NeedRemap = FALSE;
+  BytesBounced = 0;
   PhysicalAddress = (EFI_PHYSICAL_ADDRESS) (UINTN) HostAddress;
 
   DmaMemoryTop = DMA_MEMORY_TOP;
@@ -249,12 +489,7 @@ IoMmuMap (
   // Allocate a buffer below 4GB to map the transfer to.
   //
   if (NeedRemap) {
-    Status = gBS->AllocatePages (
-                    AllocateMaxAddress,
-                    EfiBootServicesData,
-                    MapInfo->NumberOfPages,
-                    &MapInfo->DeviceAddress
-                    );
+    Status = AllocateBounceBuffer (MapInfo->NumberOfPages, &MapInfo->DeviceAddress);
     if (EFI_ERROR (Status)) {
       FreePool (MapInfo);
       *NumberOfBytes = 0;
@@ -274,13 +509,21 @@ IoMmuMap (
         (VOID *) (UINTN) MapInfo->HostAddress,
         MapInfo->NumberOfBytes
         );
+      BytesBounced = MapInfo->NumberOfBytes;
     }
   } else {
     MapInfo->DeviceAddress = MapInfo->HostAddress;
   }
 
   OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
-  InsertTailList (&gMaps, &MapInfo->Link);
+  InsertTailList (&mMapsByHandle[MAP_HASH_INDEX (MapInfo)], &MapInfo->Link);
+  InsertTailList (&mMapsByDevice[MAP_HASH_INDEX (MapInfo->DeviceAddress)], &MapInfo->DeviceLink);
+  mDmaStatistics.MapCount++;
+  mDmaStatistics.ActiveMappings++;
+  if (NeedRemap) {
+    mDmaStatistics.RemapCount++;
+    mDmaStatistics.BytesBounced += BytesBounced;
+  }
   gBS->RestoreTPL (OriginalTpl);
 
   //
@@ -316,7 +559,6 @@ IoMmuUnmap (
 {
   MAP_INFO                 *MapInfo;
   MAP_HANDLE_INFO          *MapHandleInfo;
-  LIST_ENTRY               *Link;
   EFI_TPL                  OriginalTpl;
 
   DEBUG ((DEBUG_VERBOSE, "IoMmuUnmap: 0x%08x\n", Mapping));
@@ -327,25 +569,26 @@ IoMmuUnmap (
   }
 
   OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
-  MapInfo = NULL;
-  for (Link = GetFirstNode (&gMaps)
-       ; !IsNull (&gMaps, Link)
-       ; Link = GetNextNode (&gMaps, Link)
-       ) {
-    MapInfo = MAP_INFO_FROM_LINK (Link);
-    if (MapInfo == Mapping) {
-      break;
-    }
-  }
+  MapInfo = FindMapInfoByHandle (Mapping);
   //
   // Mapping is not a valid value returned by Map()
   //
-  if (MapInfo != Mapping) {
+  if (MapInfo == NULL) {
     gBS->RestoreTPL (OriginalTpl);
     DEBUG ((DEBUG_ERROR, "IoMmuUnmap: %r\n", EFI_INVALID_PARAMETER));
     return EFI_INVALID_PARAMETER;
   }
   RemoveEntryList (&MapInfo->Link);
+  RemoveEntryList (&MapInfo->DeviceLink);
+  mDmaStatistics.UnmapCount++;
+  mDmaStatistics.ActiveMappings--;
+  //
+  // The caller may free or reuse the buffer as soon as Unmap() returns, and a
+  // bounce buffer goes back to the pool for other devices. So the access the
+  // device gave up must be out of the IOTLB first, whether the buffer was
+  // mapped directly or bounced.
+  //
+  FlushPageTableUpdate ();
   gBS->RestoreTPL (OriginalTpl);
 
   //
@@ -370,12 +613,15 @@ IoMmuUnmap (
         (VOID *) (UINTN) MapInfo->DeviceAddress,
         MapInfo->NumberOfBytes
         );
+      OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+      mDmaStatistics.BytesBounced += MapInfo->NumberOfBytes;
+      gBS->RestoreTPL (OriginalTpl);
     }
 
     //
     // Free the mapped buffer and the MAP_INFO structure.
     //
-    gBS->FreePages (MapInfo->DeviceAddress, MapInfo->NumberOfPages);
+    FreeBounceBuffer (MapInfo->DeviceAddress, MapInfo->NumberOfPages);
   }
 
   FreePool (Mapping);
@@ -486,7 +732,17 @@ IoMmuFreeBuffer (
   IN  VOID                                     *HostAddress
   )
 {
+  EFI_TPL                  OriginalTpl;
+
   DEBUG ((DEBUG_VERBOSE, "IoMmuFreeBuffer: 0x%\n", Pages));
+
+  //
+  // Flush the deferred revocations before the pages go back to the system
+  //
+  OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+  FlushPageTableUpdate ();
+  gBS->RestoreTPL (OriginalTpl);
+
   return gBS->FreePages ((EFI_PHYSICAL_ADDRESS) (UINTN) HostAddress, Pages);
 }
 
@@ -508,26 +764,16 @@ GetDeviceInfoFromMapping (
   )
 {
   MAP_INFO                 *MapInfo;
-  LIST_ENTRY               *Link;
 
   if (Mapping == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  MapInfo = NULL;
-  for (Link = GetFirstNode (&gMaps)
-       ; !IsNull (&gMaps, Link)
-       ; Link = GetNextNode (&gMaps, Link)
-       ) {
-    MapInfo = MAP_INFO_FROM_LINK (Link);
-    if (MapInfo == Mapping) {
-      break;
-    }
-  }
+  MapInfo = FindMapInfoByHandle (Mapping);
   //
   // Mapping is not a valid value returned by Map()
   //
-  if (MapInfo != Mapping) {
+  if (MapInfo == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
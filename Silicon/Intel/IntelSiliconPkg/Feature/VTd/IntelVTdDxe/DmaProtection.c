@@ -510,6 +510,11 @@ SetupVtd (
 
   InitializePlatformVTdPolicy ();
 
+  //
+  // Apply the RMRR and early requests as one batch of page table updates
+  //
+  BeginPageTableUpdate ();
+
   ParseDmarAcpiTableRmrr ();
 
   if ((PcdGet8 (PcdVTdPolicyPropertyMask) & BIT2) == 0) {
@@ -520,6 +525,8 @@ SetupVtd (
     ProcessRequestedAccessAttribute ();
   }
 
+  CommitPageTableUpdate ();
+
   for (Index = 0; Index < mVtdUnitNumber; Index++) {
     DEBUG ((DEBUG_INFO,"VTD Unit %d (Segment: %04x)\n", Index, mVtdUnitInformation[Index].Segment));
     if (mVtdUnitInformation[Index].ExtRootEntryTable != NULL) {
@@ -538,6 +545,8 @@ SetupVtd (
   if (EFI_ERROR (Status)) {
     return;
   }
+
+  StartDeferredInvalidation ();
   DEBUG ((DEBUG_INFO, "DumpVtdRegs\n"));
   DumpVtdRegsAll ();
 }
@@ -589,6 +598,8 @@ OnExitBootServices (
   DEBUG ((DEBUG_INFO, "Vtd OnExitBootServices\n"));
   DumpVtdRegsAll ();
 
+  StopDeferredInvalidation ();
+
   DEBUG ((DEBUG_INFO, "Invalidate all\n"));
   for (VtdIndex = 0; VtdIndex < mVtdUnitNumber; VtdIndex++) {
     FlushWriteBuffer (VtdIndex);
@@ -596,6 +607,11 @@ OnExitBootServices (
     InvalidateContextCache (VtdIndex);
 
     InvalidateIOTLB (VtdIndex);
+
+    //
+    // The invalidation queue lives in boot services memory
+    //
+    DisableQueuedInvalidation (VtdIndex);
   }
 
   if ((PcdGet8(PcdVTdPolicyPropertyMask) & BIT1) == 0) {
@@ -619,6 +635,7 @@ OnLegacyBoot (
 {
   DEBUG ((DEBUG_INFO, "Vtd OnLegacyBoot\n"));
   DumpVtdRegsAll ();
+  StopDeferredInvalidation ();
   DisableDmar ();
   DumpVtdRegsAll ();
 }
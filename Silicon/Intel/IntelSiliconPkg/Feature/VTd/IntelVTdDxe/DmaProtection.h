@@ -33,6 +33,7 @@
 #include <Protocol/PciEnumerationComplete.h>
 #include <Protocol/PlatformVtdPolicy.h>
 #include <Protocol/IoMmu.h>
+#include <Protocol/VtdDebug.h>
 
 #include <IndustryStandard/Pci.h>
 #include <IndustryStandard/DmaRemappingReportingTable.h>
@@ -76,9 +77,33 @@ typedef struct {
   VTD_SECOND_LEVEL_PAGING_ENTRY    *FixedSecondLevelPagingEntry;
   BOOLEAN                          HasDirtyContext;
   BOOLEAN                          HasDirtyPages;
+  //
+  // Range of the dirty pages. DirtyDomainId is 0 if more than one domain is dirty.
+  //
+  UINT16                           DirtyDomainId;
+  UINT64                           DirtyBase;
+  UINT64                           DirtyLimit;
   PCI_DEVICE_INFORMATION           PciDeviceInfo;
+  //
+  // Invalidation queue, only used when ECAP.QI is set
+  //
+  VTD_QUEUED_INVALIDATION_DESCRIPTOR *QiQueue;
+  UINTN                            QiTail;
+  BOOLEAN                          QiEnabled;
+  volatile UINT32                  QiWaitStatus;
 } VTD_UNIT_INFORMATION;
 
+//
+// Number of descriptors in the invalidation queue (one page, IQA.QS = 0)
+//
+#define VTD_QI_QUEUE_LENGTH  (SIZE_4KB / sizeof (VTD_QUEUED_INVALIDATION_DESCRIPTOR))
+
+//
+// CAP_REG.SLLPS
+//
+#define VTD_SLLPS_2M         BIT0
+#define VTD_SLLPS_1G         BIT1
+
 //
 // This is the initial max ACCESS request.
 // The number may be enlarged later.
@@ -198,6 +223,60 @@ InvalidateIOTLB (
   IN UINTN  VtdIndex
   );
 
+/**
+  Invalidate VTd IOTLB with the requested granularity.
+
+  @param[in]  VtdIndex          The index used to identify a VTd engine.
+  @param[in]  Granularity       V_IOTLB_REG_IIRG_GLOBAL, V_IOTLB_REG_IIRG_DOMAIN or V_IOTLB_REG_IIRG_PAGE.
+  @param[in]  DomainId          The domain to invalidate, ignored for global invalidation.
+  @param[in]  Address           The base of the pages, only used for page selective invalidation.
+  @param[in]  AddressMask       The address mask (log2 of the page count), only used for page selective invalidation.
+**/
+EFI_STATUS
+InvalidateIOTLBEx (
+  IN UINTN   VtdIndex,
+  IN UINT64  Granularity,
+  IN UINT16  DomainId,
+  IN UINT64  Address,
+  IN UINT8   AddressMask
+  );
+
+/**
+  Invalidate the VTd IOTLB entries of the dirty page range only.
+
+  Page selective invalidation is used when the engine supports it and the range
+  fits the maximum address mask, domain selective invalidation otherwise.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+
+  @retval EFI_SUCCESS           VTd IOTLB is invalidated.
+  @retval EFI_DEVICE_ERROR      VTd IOTLB is not invalidated.
+**/
+EFI_STATUS
+InvalidateVtdIOTLBDirtyPages (
+  IN UINTN  VtdIndex
+  );
+
+/**
+  Enable queued invalidation if the VTd engine supports it.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+**/
+VOID
+EnableQueuedInvalidation (
+  IN UINTN  VtdIndex
+  );
+
+/**
+  Disable queued invalidation and fall back to register based invalidation.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+**/
+VOID
+DisableQueuedInvalidation (
+  IN UINTN  VtdIndex
+  );
+
 /**
   Invalid VTd global IOTLB.
 
@@ -460,6 +539,56 @@ SetAccessAttribute (
   IN UINT64                IoMmuAccess
   );
 
+/**
+  Start a batch of page table updates.
+
+  Until the matching CommitPageTableUpdate(), SetAccessAttribute() only records
+  the dirty range and the IOTLB invalidation is deferred. Batches may be nested.
+**/
+VOID
+BeginPageTableUpdate (
+  VOID
+  );
+
+/**
+  Finish a batch of page table updates and invalidate the IOTLB of all VTd engines
+  with dirty page table entries once.
+**/
+VOID
+CommitPageTableUpdate (
+  VOID
+  );
+
+/**
+  Invalidate the IOTLB of all VTd engines with page table updates still pending,
+  including the deferred revocations.
+
+  Call this at VTD_TPL_LEVEL before memory whose access was withdrawn is handed
+  out again. It does nothing inside a BeginPageTableUpdate() batch.
+**/
+VOID
+FlushPageTableUpdate (
+  VOID
+  );
+
+/**
+  Start deferring the IOTLB invalidation of withdrawn access.
+
+  Called once DMAR is enabled, when IoMmuSetAttribute() becomes the hot path.
+**/
+VOID
+StartDeferredInvalidation (
+  VOID
+  );
+
+/**
+  Stop deferring the IOTLB invalidation and flush what is pending.
+**/
+VOID
+StopDeferredInvalidation (
+  VOID
+  );
+
 /**
   Return the index of PCI data.
 
@@ -542,6 +671,30 @@ GetDeviceInfoFromMapping (
   OUT UINTN                                    *NumberOfPages
   );
 
+/**
+  Initialize the mapping tables and the bounce buffer pool.
+**/
+VOID
+InitializeMapTable (
+  VOID
+  );
+
+/**
+  Get the DMA mapping statistics of the VTd driver.
+
+  @param[in]  This                 The protocol instance pointer.
+  @param[out] Statistics           The DMA mapping statistics.
+
+  @retval EFI_SUCCESS              The statistics are returned.
+  @retval EFI_INVALID_PARAMETER    Statistics is NULL.
+**/
+EFI_STATUS
+EFIAPI
+VTdGetDmaStatistics (
+  IN  EDKII_VTD_DEBUG_PROTOCOL             *This,
+  OUT EDKII_VTD_DMA_STATISTICS             *Statistics
+  );
+
 /**
   Initialize DMA protection.
 **/
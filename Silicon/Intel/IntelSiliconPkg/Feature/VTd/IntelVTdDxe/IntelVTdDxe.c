@@ -361,6 +361,11 @@ EDKII_IOMMU_PROTOCOL  mIntelVTd = {
   IoMmuFreeBuffer,
 };
 
+EDKII_VTD_DEBUG_PROTOCOL  mIntelVTdDebug = {
+  EDKII_VTD_DEBUG_PROTOCOL_REVISION,
+  VTdGetDmaStatistics,
+};
+
 /**
   Initialize the VTd driver.
 
@@ -386,12 +391,14 @@ IntelVTdInitialize (
     return EFI_UNSUPPORTED;
   }
 
+  InitializeMapTable ();
   InitializeDmaProtection ();
 
   Handle = NULL;
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &Handle,
                   &gEdkiiIoMmuProtocolGuid, &mIntelVTd,
+                  &gEdkiiVTdDebugProtocolGuid, &mIntelVTdDebug,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -228,6 +228,23 @@ CreateSecondLevelPagingEntryTable (
 
     Lvl3PtEntry = (VTD_SECOND_LEVEL_PAGING_ENTRY *)(UINTN)VTD_64BITS_ADDRESS(Lvl4PtEntry[Index4].Bits.AddressLo, Lvl4PtEntry[Index4].Bits.AddressHi);
     for (Index3 = Lvl3Start; Index3 <= Lvl3End; Index3++) {
+      //
+      // Map a whole 1G with one entry when the engine supports 1G pages
+      //
+      if (((mVtdUnitInformation[VtdIndex].CapReg.Bits.SLLPS & VTD_SLLPS_1G) != 0) &&
+          (Lvl3PtEntry[Index3].Uint64 == 0) &&
+          ((BaseAddress & (SIZE_1GB - 1)) == 0) &&
+          (BaseAddress + SIZE_1GB <= EndAddress)) {
+        Lvl3PtEntry[Index3].Uint64 = BaseAddress;
+        SetSecondLevelPagingEntryAttribute (&Lvl3PtEntry[Index3], IoMmuAccess);
+        Lvl3PtEntry[Index3].Bits.PageSize = 1;
+        BaseAddress += SIZE_1GB;
+        if (BaseAddress >= MemoryLimit) {
+          break;
+        }
+        continue;
+      }
+
       if (Lvl3PtEntry[Index3].Uint64 == 0) {
         Lvl3PtEntry[Index3].Uint64 = (UINT64)(UINTN)AllocateZeroPages (1);
         if (Lvl3PtEntry[Index3].Uint64 == 0) {
@@ -430,9 +447,31 @@ DumpSecondLevelPagingEntry (
   DEBUG ((DEBUG_VERBOSE,"================\n"));
 }
 
+//
+// Nesting level of BeginPageTableUpdate()
+//
+UINTN  mPageTableUpdateDepth;
+
+//
+// Once DMAR is enabled, the IOTLB invalidation for withdrawn access is deferred
+// until VTD_DEFERRED_REVOKE_MAX revocations are pending, the flush timer fires, or
+// FlushPageTableUpdate() is called because the memory is handed out again. The
+// latter happens in every IoMmuUnmap() and IoMmuFreeBuffer(), so only access
+// withdrawn from a mapping that is still live can linger for a timer period.
+//
+#define VTD_DEFERRED_REVOKE_MAX     64
+#define VTD_DEFERRED_FLUSH_PERIOD   EFI_TIMER_PERIOD_MILLISECONDS (10)
+
+BOOLEAN    mDeferredInvalidation;
+UINTN      mDeferredRevokeCount;
+EFI_EVENT  mDeferredFlushEvent;
+
 /**
   Invalid page entry.
 
+  A dirty context needs the global invalidation, dirty pages only need their
+  range to be invalidated. Nothing is done inside a page table update batch.
+
   @param VtdIndex  The VTd engine index.
 **/
 VOID
@@ -440,13 +479,184 @@ InvalidatePageEntry (
   IN UINTN                 VtdIndex
   )
 {
-  if (mVtdUnitInformation[VtdIndex].HasDirtyContext || mVtdUnitInformation[VtdIndex].HasDirtyPages) {
+  if (mPageTableUpdateDepth != 0) {
+    return;
+  }
+
+  if (mVtdUnitInformation[VtdIndex].HasDirtyContext) {
     InvalidateVtdIOTLBGlobal (VtdIndex);
+  } else if (mVtdUnitInformation[VtdIndex].HasDirtyPages) {
+    InvalidateVtdIOTLBDirtyPages (VtdIndex);
   }
   mVtdUnitInformation[VtdIndex].HasDirtyContext = FALSE;
   mVtdUnitInformation[VtdIndex].HasDirtyPages = FALSE;
 }
 
+/**
+  Start a batch of page table updates.
+
+  Until the matching CommitPageTableUpdate(), SetAccessAttribute() only records
+  the dirty range and the IOTLB invalidation is deferred. Batches may be nested.
+**/
+VOID
+BeginPageTableUpdate (
+  VOID
+  )
+{
+  mPageTableUpdateDepth++;
+}
+
+/**
+  Finish a batch of page table updates and invalidate the IOTLB of all VTd engines
+  with dirty page table entries once.
+**/
+VOID
+CommitPageTableUpdate (
+  VOID
+  )
+{
+  ASSERT (mPageTableUpdateDepth != 0);
+  if (mPageTableUpdateDepth == 0) {
+    return;
+  }
+  mPageTableUpdateDepth--;
+
+  FlushPageTableUpdate ();
+}
+
+/**
+  Invalidate the IOTLB of all VTd engines with page table updates still pending,
+  including the deferred revocations.
+
+  Call this at VTD_TPL_LEVEL before memory whose access was withdrawn is handed
+  out again. It does nothing inside a BeginPageTableUpdate() batch.
+**/
+VOID
+FlushPageTableUpdate (
+  VOID
+  )
+{
+  UINTN  VtdIndex;
+
+  if (mPageTableUpdateDepth != 0) {
+    return;
+  }
+
+  for (VtdIndex = 0; VtdIndex < mVtdUnitNumber; VtdIndex++) {
+    InvalidatePageEntry (VtdIndex);
+  }
+  mDeferredRevokeCount = 0;
+}
+
+/**
+  Flush the deferred revocations periodically, so that withdrawn access does not
+  linger in the IOTLB for long.
+
+  @param[in]  Event    The event handle.
+  @param[in]  Context  The event content.
+**/
+STATIC
+VOID
+EFIAPI
+OnDeferredFlushTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  if (mDeferredRevokeCount != 0) {
+    FlushPageTableUpdate ();
+  }
+}
+
+/**
+  Start deferring the IOTLB invalidation of withdrawn access.
+
+  Called once DMAR is enabled, when IoMmuSetAttribute() becomes the hot path.
+**/
+VOID
+StartDeferredInvalidation (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  VTD_TPL_LEVEL,
+                  OnDeferredFlushTimer,
+                  NULL,
+                  &mDeferredFlushEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "VTd deferred invalidation is off - %r\n", Status));
+    return;
+  }
+
+  Status = gBS->SetTimer (mDeferredFlushEvent, TimerPeriodic, VTD_DEFERRED_FLUSH_PERIOD);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "VTd deferred invalidation is off - %r\n", Status));
+    gBS->CloseEvent (mDeferredFlushEvent);
+    mDeferredFlushEvent = NULL;
+    return;
+  }
+
+  mDeferredInvalidation = TRUE;
+}
+
+/**
+  Stop deferring the IOTLB invalidation and flush what is pending.
+**/
+VOID
+StopDeferredInvalidation (
+  VOID
+  )
+{
+  EFI_TPL  OriginalTpl;
+
+  OriginalTpl = gBS->RaiseTPL (VTD_TPL_LEVEL);
+  mDeferredInvalidation = FALSE;
+  if (mDeferredFlushEvent != NULL) {
+    gBS->CloseEvent (mDeferredFlushEvent);
+    mDeferredFlushEvent = NULL;
+  }
+  FlushPageTableUpdate ();
+  gBS->RestoreTPL (OriginalTpl);
+}
+
+/**
+  Record a modified page table range which needs an IOTLB invalidation.
+
+  @param[in]  VtdIndex          The index used to identify a VTd engine.
+  @param[in]  DomainIdentifier  The domain ID of the page table.
+  @param[in]  BaseAddress       The base of the modified range.
+  @param[in]  Length            The length of the modified range.
+**/
+VOID
+MarkDirtyPages (
+  IN UINTN                 VtdIndex,
+  IN UINT16                DomainIdentifier,
+  IN UINT64                BaseAddress,
+  IN UINT64                Length
+  )
+{
+  VTD_UNIT_INFORMATION  *VtdUnit;
+
+  VtdUnit = &mVtdUnitInformation[VtdIndex];
+  if (!VtdUnit->HasDirtyPages) {
+    VtdUnit->HasDirtyPages = TRUE;
+    VtdUnit->DirtyDomainId = DomainIdentifier;
+    VtdUnit->DirtyBase     = BaseAddress;
+    VtdUnit->DirtyLimit    = BaseAddress + Length;
+    return;
+  }
+
+  if (VtdUnit->DirtyDomainId != DomainIdentifier) {
+    VtdUnit->DirtyDomainId = 0;
+  }
+  VtdUnit->DirtyBase  = MIN (VtdUnit->DirtyBase, BaseAddress);
+  VtdUnit->DirtyLimit = MAX (VtdUnit->DirtyLimit, BaseAddress + Length);
+}
+
 #define VTD_PG_R                   BIT0
 #define VTD_PG_W                   BIT1
 #define VTD_PG_X                   BIT2
@@ -554,6 +764,16 @@ GetSecondLevelPageTableEntry (
   }
 
   L3PageTable = (UINT64 *)(UINTN)(L4PageTable[Index4] & PAGING_4K_ADDRESS_MASK_64);
+  if ((L3PageTable[Index3] == 0) &&
+      ((mVtdUnitInformation[VtdIndex].CapReg.Bits.SLLPS & VTD_SLLPS_1G) != 0)) {
+    //
+    // Start with a not present 1G page, it is only split when a smaller range is set.
+    //
+    L3PageTable[Index3] = Address & PAGING_1G_ADDRESS_MASK_64;
+    SetSecondLevelPagingEntryAttribute ((VTD_SECOND_LEVEL_PAGING_ENTRY *)&L3PageTable[Index3], 0);
+    L3PageTable[Index3] |= VTD_PG_PS;
+    FlushPageTableMemory (VtdIndex, (UINTN)&L3PageTable[Index3], sizeof(L3PageTable[Index3]));
+  }
   if (L3PageTable[Index3] == 0) {
     L3PageTable[Index3] = (UINT64)(UINTN)AllocateZeroPages (1);
     if (L3PageTable[Index3] == 0) {
@@ -774,6 +994,7 @@ SetSecondLevelPagingAttribute (
   PAGE_ATTRIBUTE                 SplitAttribute;
   EFI_STATUS                     Status;
   BOOLEAN                        IsEntryModified;
+  BOOLEAN                        NeedInvalidate;
 
   DEBUG ((DEBUG_VERBOSE,"SetSecondLevelPagingAttribute (%d) (0x%016lx - 0x%016lx : %x) \n", VtdIndex, BaseAddress, Length, IoMmuAccess));
   DEBUG ((DEBUG_VERBOSE,"  SecondLevelPagingEntry Base - 0x%x\n", SecondLevelPagingEntry));
@@ -795,10 +1016,16 @@ SetSecondLevelPagingAttribute (
     }
     PageEntryLength = PageAttributeToLength (PageAttribute);
     SplitAttribute = NeedSplitPage (BaseAddress, Length, PageAttribute);
+    //
+    // Without caching mode the IOTLB never holds not present entries,
+    // so making a not present entry present needs no invalidation.
+    //
+    NeedInvalidate = (BOOLEAN)(((PageEntry->Uint64 & (VTD_PG_R | VTD_PG_W)) != 0) ||
+                               (mVtdUnitInformation[VtdIndex].CapReg.Bits.CM != 0));
     if (SplitAttribute == PageNone) {
       ConvertSecondLevelPageEntryAttribute (VtdIndex, PageEntry, IoMmuAccess, &IsEntryModified);
-      if (IsEntryModified) {
-        mVtdUnitInformation[VtdIndex].HasDirtyPages = TRUE;
+      if (IsEntryModified && NeedInvalidate) {
+        MarkDirtyPages (VtdIndex, DomainIdentifier, BaseAddress, PageEntryLength);
       }
       //
       // Convert success, move to next
@@ -811,7 +1038,9 @@ SetSecondLevelPagingAttribute (
         DEBUG ((DEBUG_ERROR, "SplitSecondLevelPage - %r\n", Status));
         return RETURN_UNSUPPORTED;
       }
-      mVtdUnitInformation[VtdIndex].HasDirtyPages = TRUE;
+      if (NeedInvalidate) {
+        MarkDirtyPages (VtdIndex, DomainIdentifier, BaseAddress & ~((UINT64)PageEntryLength - 1), PageEntryLength);
+      }
       //
       // Just split current page
       // Convert success in next around
@@ -968,6 +1197,21 @@ SetAccessAttribute (
     }
   }
 
+  if (mDeferredInvalidation && (IoMmuAccess == 0) &&
+      !mVtdUnitInformation[VtdIndex].HasDirtyContext) {
+    //
+    // The device must not use memory whose access it gives up, so the stale
+    // IOTLB entries only have to go before the memory is handed out again.
+    // Granted access is still invalidated before returning, since the device
+    // is about to use it.
+    //
+    mDeferredRevokeCount++;
+    if (mDeferredRevokeCount >= VTD_DEFERRED_REVOKE_MAX) {
+      FlushPageTableUpdate ();
+    }
+    return EFI_SUCCESS;
+  }
+
   InvalidatePageEntry (VtdIndex);
 
   return EFI_SUCCESS;
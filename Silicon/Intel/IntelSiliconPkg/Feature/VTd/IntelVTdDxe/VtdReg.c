@@ -54,6 +54,133 @@ FlushWriteBuffer (
   }
 }
 
+/**
+  Submit one invalidation descriptor to the invalidation queue and wait for its completion.
+
+  An invalidation wait descriptor with status write follows the request, the
+  function returns when the hardware has written the status.
+
+  @param[in]  VtdIndex          The index used to identify a VTd engine.
+  @param[in]  Lo                The low 64 bits of the invalidation descriptor.
+  @param[in]  Hi                The high 64 bits of the invalidation descriptor.
+
+  @retval EFI_SUCCESS           The invalidation is complete.
+  @retval EFI_DEVICE_ERROR      The hardware reported an invalidation queue error.
+**/
+EFI_STATUS
+SubmitQueuedInvalidation (
+  IN UINTN   VtdIndex,
+  IN UINT64  Lo,
+  IN UINT64  Hi
+  )
+{
+  VTD_UNIT_INFORMATION                *VtdUnit;
+  VTD_QUEUED_INVALIDATION_DESCRIPTOR  *Desc;
+  UINT32                              Reg32;
+
+  VtdUnit = &mVtdUnitInformation[VtdIndex];
+
+  Desc = &VtdUnit->QiQueue[VtdUnit->QiTail];
+  Desc->Lo = Lo;
+  Desc->Hi = Hi;
+  FlushPageTableMemory (VtdIndex, (UINTN)Desc, sizeof(*Desc));
+  VtdUnit->QiTail = (VtdUnit->QiTail + 1) % VTD_QI_QUEUE_LENGTH;
+
+  VtdUnit->QiWaitStatus = 0;
+  Desc = &VtdUnit->QiQueue[VtdUnit->QiTail];
+  Desc->Lo = V_QI_DESC_TYPE_WAIT | B_QI_DESC_WAIT_SW | LShiftU64 (1, N_QI_DESC_WAIT_STATUS_DATA);
+  Desc->Hi = (UINT64)(UINTN)&VtdUnit->QiWaitStatus;
+  FlushPageTableMemory (VtdIndex, (UINTN)Desc, sizeof(*Desc));
+  VtdUnit->QiTail = (VtdUnit->QiTail + 1) % VTD_QI_QUEUE_LENGTH;
+
+  MmioWrite64 (VtdUnit->VtdUnitBaseAddress + R_IQT_REG, LShiftU64 (VtdUnit->QiTail, N_IQT_REG_QT));
+
+  while (VtdUnit->QiWaitStatus == 0) {
+    Reg32 = MmioRead32 (VtdUnit->VtdUnitBaseAddress + R_FSTS_REG);
+    if ((Reg32 & B_FSTS_REG_IQE) != 0) {
+      DEBUG ((DEBUG_ERROR,"ERROR: SubmitQueuedInvalidation: IQE for VTD(%d) - 0x%lx 0x%lx\n", VtdIndex, Lo, Hi));
+      MmioWrite32 (VtdUnit->VtdUnitBaseAddress + R_FSTS_REG, B_FSTS_REG_IQE);
+      return EFI_DEVICE_ERROR;
+    }
+    CpuPause ();
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Enable queued invalidation if the VTd engine supports it.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+**/
+VOID
+EnableQueuedInvalidation (
+  IN UINTN  VtdIndex
+  )
+{
+  VTD_UNIT_INFORMATION  *VtdUnit;
+  UINT32                Reg32;
+
+  VtdUnit = &mVtdUnitInformation[VtdIndex];
+  if ((VtdUnit->ECapReg.Bits.QI == 0) || VtdUnit->QiEnabled) {
+    return;
+  }
+
+  if (VtdUnit->QiQueue == NULL) {
+    VtdUnit->QiQueue = AllocateZeroPages (1);
+    if (VtdUnit->QiQueue == NULL) {
+      return;
+    }
+  }
+  VtdUnit->QiTail = 0;
+
+  MmioWrite64 (VtdUnit->VtdUnitBaseAddress + R_IQT_REG, 0);
+  MmioWrite64 (VtdUnit->VtdUnitBaseAddress + R_IQA_REG, (UINT64)(UINTN)VtdUnit->QiQueue);
+
+  Reg32 = MmioRead32 (VtdUnit->VtdUnitBaseAddress + R_GSTS_REG);
+  MmioWrite32 (VtdUnit->VtdUnitBaseAddress + R_GCMD_REG, (Reg32 & 0x96FFFFFF) | B_GMCD_REG_QIE);
+  do {
+    Reg32 = MmioRead32 (VtdUnit->VtdUnitBaseAddress + R_GSTS_REG);
+  } while ((Reg32 & B_GSTS_REG_QIES) == 0);
+
+  VtdUnit->QiEnabled = TRUE;
+  DEBUG ((DEBUG_INFO, "VTD (%d) queued invalidation enabled\n", VtdIndex));
+}
+
+/**
+  Disable queued invalidation and fall back to register based invalidation.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+**/
+VOID
+DisableQueuedInvalidation (
+  IN UINTN  VtdIndex
+  )
+{
+  VTD_UNIT_INFORMATION  *VtdUnit;
+  UINT32                Reg32;
+
+  VtdUnit = &mVtdUnitInformation[VtdIndex];
+  if (!VtdUnit->QiEnabled) {
+    return;
+  }
+
+  //
+  // Wait for the hardware to fetch all submitted descriptors
+  //
+  while (MmioRead64 (VtdUnit->VtdUnitBaseAddress + R_IQH_REG) != MmioRead64 (VtdUnit->VtdUnitBaseAddress + R_IQT_REG)) {
+    CpuPause ();
+  }
+
+  Reg32 = MmioRead32 (VtdUnit->VtdUnitBaseAddress + R_GSTS_REG);
+  MmioWrite32 (VtdUnit->VtdUnitBaseAddress + R_GCMD_REG, (Reg32 & 0x96FFFFFF) & ~B_GMCD_REG_QIE);
+  do {
+    Reg32 = MmioRead32 (VtdUnit->VtdUnitBaseAddress + R_GSTS_REG);
+  } while ((Reg32 & B_GSTS_REG_QIES) != 0);
+
+  VtdUnit->QiEnabled = FALSE;
+}
+
 /**
   Invalidate VTd context cache.
 
@@ -66,6 +193,10 @@ InvalidateContextCache (
 {
   UINT64  Reg64;
 
+  if (mVtdUnitInformation[VtdIndex].QiEnabled) {
+    return SubmitQueuedInvalidation (VtdIndex, V_QI_DESC_TYPE_CONTEXT | V_QI_DESC_CONTEXT_G_GLOBAL, 0);
+  }
+
   Reg64 = MmioRead64 (mVtdUnitInformation[VtdIndex].VtdUnitBaseAddress + R_CCMD_REG);
   if ((Reg64 & B_CCMD_REG_ICC) != 0) {
     DEBUG ((DEBUG_ERROR,"ERROR: InvalidateContextCache: B_CCMD_REG_ICC is set for VTD(%d)\n",VtdIndex));
@@ -84,16 +215,47 @@ InvalidateContextCache (
 }
 
 /**
-  Invalidate VTd IOTLB.
+  Invalidate VTd IOTLB with the requested granularity.
 
   @param[in]  VtdIndex          The index used to identify a VTd engine.
+  @param[in]  Granularity       V_IOTLB_REG_IIRG_GLOBAL, V_IOTLB_REG_IIRG_DOMAIN or V_IOTLB_REG_IIRG_PAGE.
+  @param[in]  DomainId          The domain to invalidate, ignored for global invalidation.
+  @param[in]  Address           The base of the pages, only used for page selective invalidation.
+  @param[in]  AddressMask       The address mask (log2 of the page count), only used for page selective invalidation.
 **/
 EFI_STATUS
-InvalidateIOTLB (
-  IN UINTN  VtdIndex
+InvalidateIOTLBEx (
+  IN UINTN   VtdIndex,
+  IN UINT64  Granularity,
+  IN UINT16  DomainId,
+  IN UINT64  Address,
+  IN UINT8   AddressMask
   )
 {
   UINT64  Reg64;
+  UINT64  QiGranularity;
+
+  if (mVtdUnitInformation[VtdIndex].QiEnabled) {
+    QiGranularity = 0;
+    if (mVtdUnitInformation[VtdIndex].CapReg.Bits.DRD != 0) {
+      QiGranularity |= B_QI_DESC_IOTLB_DR;
+    }
+    if (mVtdUnitInformation[VtdIndex].CapReg.Bits.DWD != 0) {
+      QiGranularity |= B_QI_DESC_IOTLB_DW;
+    }
+    if (Granularity == V_IOTLB_REG_IIRG_PAGE) {
+      QiGranularity |= V_QI_DESC_IOTLB_G_PAGE;
+    } else if (Granularity == V_IOTLB_REG_IIRG_DOMAIN) {
+      QiGranularity |= V_QI_DESC_IOTLB_G_DOMAIN;
+    } else {
+      QiGranularity |= V_QI_DESC_IOTLB_G_GLOBAL;
+    }
+    return SubmitQueuedInvalidation (
+             VtdIndex,
+             V_QI_DESC_TYPE_IOTLB | QiGranularity | LShiftU64 (DomainId, N_QI_DESC_IOTLB_DID),
+             (Granularity == V_IOTLB_REG_IIRG_PAGE) ? (Address | AddressMask) : 0
+             );
+  }
 
   Reg64 = MmioRead64 (mVtdUnitInformation[VtdIndex].VtdUnitBaseAddress + (mVtdUnitInformation[VtdIndex].ECapReg.Bits.IRO * 16) + R_IOTLB_REG);
   if ((Reg64 & B_IOTLB_REG_IVT) != 0) {
@@ -101,8 +263,15 @@ InvalidateIOTLB (
     return EFI_DEVICE_ERROR;
   }
 
-  Reg64 &= ((~B_IOTLB_REG_IVT) & (~B_IOTLB_REG_IIRG_MASK));
-  Reg64 |= (B_IOTLB_REG_IVT | V_IOTLB_REG_IIRG_GLOBAL);
+  if (Granularity == V_IOTLB_REG_IIRG_PAGE) {
+    MmioWrite64 (mVtdUnitInformation[VtdIndex].VtdUnitBaseAddress + (mVtdUnitInformation[VtdIndex].ECapReg.Bits.IRO * 16) + R_IVA_REG, Address | AddressMask);
+  }
+
+  Reg64 &= ((~B_IOTLB_REG_IVT) & (~B_IOTLB_REG_IIRG_MASK) & (~LShiftU64 (MAX_UINT16, N_IOTLB_REG_DID)));
+  Reg64 |= (B_IOTLB_REG_IVT | Granularity);
+  if (Granularity != V_IOTLB_REG_IIRG_GLOBAL) {
+    Reg64 |= LShiftU64 (DomainId, N_IOTLB_REG_DID);
+  }
   MmioWrite64 (mVtdUnitInformation[VtdIndex].VtdUnitBaseAddress + (mVtdUnitInformation[VtdIndex].ECapReg.Bits.IRO * 16) + R_IOTLB_REG, Reg64);
 
   do {
@@ -112,6 +281,72 @@ InvalidateIOTLB (
   return EFI_SUCCESS;
 }
 
+/**
+  Invalidate VTd IOTLB.
+
+  @param[in]  VtdIndex          The index used to identify a VTd engine.
+**/
+EFI_STATUS
+InvalidateIOTLB (
+  IN UINTN  VtdIndex
+  )
+{
+  return InvalidateIOTLBEx (VtdIndex, V_IOTLB_REG_IIRG_GLOBAL, 0, 0, 0);
+}
+
+/**
+  Invalidate the VTd IOTLB entries of the dirty page range only.
+
+  Page selective invalidation is used when the engine supports it and the range
+  fits the maximum address mask, domain selective invalidation otherwise.
+
+  @param[in]  VtdIndex              The index of VTd engine.
+
+  @retval EFI_SUCCESS           VTd IOTLB is invalidated.
+  @retval EFI_DEVICE_ERROR      VTd IOTLB is not invalidated.
+**/
+EFI_STATUS
+InvalidateVtdIOTLBDirtyPages (
+  IN UINTN  VtdIndex
+  )
+{
+  VTD_UNIT_INFORMATION  *VtdUnit;
+  UINT64                Base;
+  UINT8                 AddressMask;
+
+  if (!mVtdEnabled) {
+    return EFI_SUCCESS;
+  }
+
+  VtdUnit = &mVtdUnitInformation[VtdIndex];
+
+  FlushWriteBuffer (VtdIndex);
+
+  if (VtdUnit->DirtyDomainId == 0) {
+    return InvalidateIOTLB (VtdIndex);
+  }
+
+  if (VtdUnit->CapReg.Bits.PSI != 0) {
+    //
+    // Find the smallest naturally aligned 2^AddressMask pages covering the range
+    //
+    AddressMask = 0;
+    Base        = VtdUnit->DirtyBase & ~(UINT64)(SIZE_4KB - 1);
+    while ((AddressMask <= VtdUnit->CapReg.Bits.MAMV) &&
+           (Base + LShiftU64 (SIZE_4KB, AddressMask) < VtdUnit->DirtyLimit)) {
+      AddressMask++;
+      Base = VtdUnit->DirtyBase & ~(LShiftU64 (SIZE_4KB, AddressMask) - 1);
+    }
+    if (AddressMask <= VtdUnit->CapReg.Bits.MAMV) {
+      DEBUG ((DEBUG_VERBOSE, "InvalidateVtdIOTLBDirtyPages(%d) - DID 0x%x, 0x%lx, AM %d\n", VtdIndex, VtdUnit->DirtyDomainId, Base, AddressMask));
+      return InvalidateIOTLBEx (VtdIndex, V_IOTLB_REG_IIRG_PAGE, VtdUnit->DirtyDomainId, Base, AddressMask);
+    }
+  }
+
+  DEBUG ((DEBUG_VERBOSE, "InvalidateVtdIOTLBDirtyPages(%d) - DID 0x%x\n", VtdIndex, VtdUnit->DirtyDomainId));
+  return InvalidateIOTLBEx (VtdIndex, V_IOTLB_REG_IIRG_DOMAIN, VtdUnit->DirtyDomainId, 0, 0);
+}
+
 /**
   Invalid VTd global IOTLB.
 
@@ -273,6 +508,11 @@ EnableDmar (
     //
     InvalidateIOTLB (Index);
 
+    //
+    // Use the invalidation queue for the invalidations from now on
+    //
+    EnableQueuedInvalidation (Index);
+
     //
     // Enable VTd
     //
@@ -320,6 +560,8 @@ DisableDmar (
     //
     FlushWriteBuffer (Index);
 
+    DisableQueuedInvalidation (Index);
+
     //
     // Disable Dmar
     //
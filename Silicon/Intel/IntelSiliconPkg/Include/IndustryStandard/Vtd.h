@@ -206,10 +206,12 @@ typedef union {
 #define   B_CAP_REG_RWBF       BIT4
 #define R_ECAP_REG       0x10
 #define R_GCMD_REG       0x18
+#define   B_GMCD_REG_QIE       BIT26
 #define   B_GMCD_REG_WBF       BIT27
 #define   B_GMCD_REG_SRTP      BIT30
 #define   B_GMCD_REG_TE        BIT31
 #define R_GSTS_REG       0x1C
+#define   B_GSTS_REG_QIES      BIT26
 #define   B_GSTS_REG_WBF       BIT27
 #define   B_GSTS_REG_RTPS      BIT30
 #define   B_GSTS_REG_TE        BIT31
@@ -221,11 +223,17 @@ typedef union {
 #define   V_CCMD_REG_CIRG_DEVICE  (BIT62|BIT61)
 #define   B_CCMD_REG_ICC          BIT63
 #define R_FSTS_REG       0x34
+#define   B_FSTS_REG_IQE       BIT4
 #define R_FECTL_REG      0x38
 #define R_FEDATA_REG     0x3C
 #define R_FEADDR_REG     0x40
 #define R_FEUADDR_REG    0x44
 #define R_AFLOG_REG      0x58
+#define R_IQH_REG        0x80
+#define R_IQT_REG        0x88
+#define   N_IQT_REG_QT         4
+#define R_IQA_REG        0x90
+#define   B_IQA_REG_QS_MASK    (BIT0|BIT1|BIT2)
 
 #define R_IVA_REG        0x00 // + IRO
 #define   B_IVA_REG_AM_MASK       (BIT0|BIT1|BIT2|BIT3|BIT4|BIT5)
@@ -237,10 +245,35 @@ typedef union {
 #define   V_IOTLB_REG_IIRG_GLOBAL BIT60
 #define   V_IOTLB_REG_IIRG_DOMAIN BIT61
 #define   V_IOTLB_REG_IIRG_PAGE   (BIT61|BIT60)
+#define   N_IOTLB_REG_DID         32
 #define   B_IOTLB_REG_IVT         BIT63
 
 #define R_FRCD_REG       0x00 // + FRO
 
+//
+// Queued invalidation descriptors
+//
+typedef struct {
+  UINT64    Lo;
+  UINT64    Hi;
+} VTD_QUEUED_INVALIDATION_DESCRIPTOR;
+
+#define V_QI_DESC_TYPE_CONTEXT          0x01
+#define V_QI_DESC_TYPE_IOTLB            0x02
+#define V_QI_DESC_TYPE_WAIT             0x05
+
+#define V_QI_DESC_CONTEXT_G_GLOBAL      BIT4
+
+#define V_QI_DESC_IOTLB_G_GLOBAL        BIT4
+#define V_QI_DESC_IOTLB_G_DOMAIN        BIT5
+#define V_QI_DESC_IOTLB_G_PAGE          (BIT5|BIT4)
+#define   B_QI_DESC_IOTLB_DW            BIT6
+#define   B_QI_DESC_IOTLB_DR            BIT7
+#define   N_QI_DESC_IOTLB_DID           16
+
+#define   B_QI_DESC_WAIT_SW             BIT5
+#define   N_QI_DESC_WAIT_STATUS_DATA    32
+
 #define R_PMEN_ENABLE_REG         0x64
 #define R_PMEN_LOW_BASE_REG       0x68
 #define R_PMEN_LOW_LIMITE_REG     0x6C
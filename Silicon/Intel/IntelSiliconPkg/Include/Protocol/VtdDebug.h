@@ -0,0 +1,56 @@
+/** @file
+  The definition for VTD debug protocol.
+
+  It exposes the DMA mapping statistics collected by the Intel VTd driver.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __EDKII_VTD_DEBUG_PROTOCOL_H__
+#define __EDKII_VTD_DEBUG_PROTOCOL_H__
+
+#define EDKII_VTD_DEBUG_PROTOCOL_GUID \
+    { \
+      0x9079201f, 0x8375, 0x4ba6, { 0xa9, 0x74, 0xdd, 0xf0, 0x2e, 0x2a, 0x86, 0xa3 } \
+    }
+
+typedef struct _EDKII_VTD_DEBUG_PROTOCOL  EDKII_VTD_DEBUG_PROTOCOL;
+
+#define EDKII_VTD_DEBUG_PROTOCOL_REVISION 0x00010000
+
+typedef struct {
+  UINT64                                   MapCount;            ///< Successful IoMmuMap() calls
+  UINT64                                   UnmapCount;          ///< Successful IoMmuUnmap() calls
+  UINT64                                   RemapCount;          ///< Mappings served with a bounce buffer
+  UINT64                                   BytesBounced;        ///< Bytes copied to or from bounce buffers
+  UINT64                                   BouncePoolHits;      ///< Bounce buffers recycled from the pool
+  UINT64                                   ActiveMappings;      ///< Mappings not unmapped yet
+  UINT64                                   BouncePoolPages;     ///< Free pages held in the bounce buffer pool
+} EDKII_VTD_DMA_STATISTICS;
+
+/**
+  Get the DMA mapping statistics of the VTd driver.
+
+  @param[in]  This                 The protocol instance pointer.
+  @param[out] Statistics           The DMA mapping statistics.
+
+  @retval EFI_SUCCESS              The statistics are returned.
+  @retval EFI_INVALID_PARAMETER    Statistics is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_VTD_DEBUG_GET_DMA_STATISTICS) (
+  IN  EDKII_VTD_DEBUG_PROTOCOL             *This,
+  OUT EDKII_VTD_DMA_STATISTICS             *Statistics
+  );
+
+struct _EDKII_VTD_DEBUG_PROTOCOL {
+  UINT64                                   Revision;
+  EDKII_VTD_DEBUG_GET_DMA_STATISTICS       GetDmaStatistics;
+};
+
+extern EFI_GUID gEdkiiVTdDebugProtocolGuid;
+
+#endif
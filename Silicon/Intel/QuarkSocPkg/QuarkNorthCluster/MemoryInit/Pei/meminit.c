@@ -1580,6 +1580,10 @@ static void rd_train(
   uint32_t address; // target address for "check_bls_ex()"
   uint32_t result; // result of "check_bls_ex()"
   uint32_t bl_mask; // byte lane mask for "result" checking
+  search_state_t search[NUM_BYTE_LANES]; // RDQS edge search state
+  int32_t distance; // RDQS codes left until the eye is too small
+  uint32_t back; // RDQS codes to move back past a coarse step
+  bool retest; // a byte lane moved back and has to be tested again
 #ifdef R2R_SHARING
   uint32_t final_delay[NUM_CHANNELS][NUM_BYTE_LANES]; // used to find placement for rank2rank sharing configs
   uint32_t num_ranks_enabled = 0; // used to find placement for rank2rank sharing configs
@@ -1674,71 +1678,96 @@ static void rd_train(
               // request HTE reconfiguration
               mrc_params->hte_setup = 1;
 
+              // start the RDQS edge search
+              for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
+              {
+                search_init(mrc_params, &search[bl_i]);
+              } // bl_i loop
+
               // test the settings
               do
               {
 
                 // result[07:00] == failing byte lane (MAX 8)
                 result = check_bls_ex( mrc_params, address);
+                retest = false;
 
-                // check for failures
-                if (result & 0xFF)
+                for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
                 {
-                  // at least 1 byte lane failed
-                  for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
+                  if (result & (bl_mask << bl_i))
                   {
-                    if (result & (bl_mask << bl_i))
+                    // adjust the RDQS values accordingly, a coarse step never closes the RDQS_EYE below MIN_RDQS_EYE
+                    if (side_x == L)
                     {
-                      // adjust the RDQS values accordingly
-                      if (side_x == L)
+                      distance = MMIN(((RDQS_MAX - MIN_RDQS_EYE) + 1) - x_coordinate[L][side_y][channel_i][rank_i][bl_i],
+                          x_coordinate[R][side_y][channel_i][rank_i][bl_i] - x_coordinate[L][side_y][channel_i][rank_i][bl_i]);
+                      x_coordinate[L][side_y][channel_i][rank_i][bl_i] += (uint8_t) (RDQS_STEP * search_step(&search[bl_i], distance));
+                    }
+                    else
+                    {
+                      distance = MMIN(x_coordinate[R][side_y][channel_i][rank_i][bl_i] - ((RDQS_MIN + MIN_RDQS_EYE) - 1),
+                          x_coordinate[R][side_y][channel_i][rank_i][bl_i] - x_coordinate[L][side_y][channel_i][rank_i][bl_i]);
+                      x_coordinate[R][side_y][channel_i][rank_i][bl_i] -= (uint8_t) (RDQS_STEP * search_step(&search[bl_i], distance));
+                    }
+                    // check that we haven't closed the RDQS_EYE too much
+                    if ((x_coordinate[L][side_y][channel_i][rank_i][bl_i] > (RDQS_MAX - MIN_RDQS_EYE)) ||
+                        (x_coordinate[R][side_y][channel_i][rank_i][bl_i] < (RDQS_MIN + MIN_RDQS_EYE))
+                        ||
+                        (x_coordinate[L][side_y][channel_i][rank_i][bl_i]
+                            == x_coordinate[R][side_y][channel_i][rank_i][bl_i]))
+                    {
+                      // not enough RDQS margin available at this VREF
+                      // update VREF values accordingly
+                      if (side_y == B)
                       {
-                        x_coordinate[L][side_y][channel_i][rank_i][bl_i] += RDQS_STEP;
+                        y_coordinate[side_x][B][channel_i][bl_i] += VREF_STEP;
                       }
                       else
                       {
-                        x_coordinate[R][side_y][channel_i][rank_i][bl_i] -= RDQS_STEP;
+                        y_coordinate[side_x][T][channel_i][bl_i] -= VREF_STEP;
                       }
-                      // check that we haven't closed the RDQS_EYE too much
-                      if ((x_coordinate[L][side_y][channel_i][rank_i][bl_i] > (RDQS_MAX - MIN_RDQS_EYE)) ||
-                          (x_coordinate[R][side_y][channel_i][rank_i][bl_i] < (RDQS_MIN + MIN_RDQS_EYE))
-                          ||
-                          (x_coordinate[L][side_y][channel_i][rank_i][bl_i]
-                              == x_coordinate[R][side_y][channel_i][rank_i][bl_i]))
+                      // check that we haven't closed the VREF_EYE too much
+                      if ((y_coordinate[side_x][B][channel_i][bl_i] > (VREF_MAX - MIN_VREF_EYE)) ||
+                          (y_coordinate[side_x][T][channel_i][bl_i] < (VREF_MIN + MIN_VREF_EYE)) ||
+                          (y_coordinate[side_x][B][channel_i][bl_i] == y_coordinate[side_x][T][channel_i][bl_i]))
+                      {
+                        // VREF_EYE collapsed below MIN_VREF_EYE
+                        training_message(channel_i, rank_i, bl_i);
+                        post_code(0xEE, (0x70 + (side_y * 2) + (side_x)));
+                      }
+                      else
+                      {
+                        // update the VREF setting
+                        set_vref(channel_i, bl_i, y_coordinate[side_x][side_y][channel_i][bl_i]);
+                        // reset the X coordinate to begin the search at the new VREF
+                        x_coordinate[side_x][side_y][channel_i][rank_i][bl_i] =
+                            (side_x == L) ? (RDQS_MIN) : (RDQS_MAX);
+                        search_init(mrc_params, &search[bl_i]);
+                      }
+                    }
+                    // update the RDQS setting
+                    set_rdqs(channel_i, rank_i, bl_i, x_coordinate[side_x][side_y][channel_i][rank_i][bl_i]);
+                  } // if bl_i failed
+                  else
+                  {
+                    // passing, step back over a coarse move to find the first passing RDQS
+                    back = search_back(&search[bl_i]);
+                    if (back != 0)
+                    {
+                      if (side_x == L)
+                      {
+                        x_coordinate[L][side_y][channel_i][rank_i][bl_i] -= (uint8_t) (RDQS_STEP * back);
+                      }
+                      else
                       {
-                        // not enough RDQS margin available at this VREF
-                        // update VREF values accordingly
-                        if (side_y == B)
-                        {
-                          y_coordinate[side_x][B][channel_i][bl_i] += VREF_STEP;
-                        }
-                        else
-                        {
-                          y_coordinate[side_x][T][channel_i][bl_i] -= VREF_STEP;
-                        }
-                        // check that we haven't closed the VREF_EYE too much
-                        if ((y_coordinate[side_x][B][channel_i][bl_i] > (VREF_MAX - MIN_VREF_EYE)) ||
-                            (y_coordinate[side_x][T][channel_i][bl_i] < (VREF_MIN + MIN_VREF_EYE)) ||
-                            (y_coordinate[side_x][B][channel_i][bl_i] == y_coordinate[side_x][T][channel_i][bl_i]))
-                        {
-                          // VREF_EYE collapsed below MIN_VREF_EYE
-                          training_message(channel_i, rank_i, bl_i);
-                          post_code(0xEE, (0x70 + (side_y * 2) + (side_x)));
-                        }
-                        else
-                        {
-                          // update the VREF setting
-                          set_vref(channel_i, bl_i, y_coordinate[side_x][side_y][channel_i][bl_i]);
-                          // reset the X coordinate to begin the search at the new VREF
-                          x_coordinate[side_x][side_y][channel_i][rank_i][bl_i] =
-                              (side_x == L) ? (RDQS_MIN) : (RDQS_MAX);
-                        }
+                        x_coordinate[R][side_y][channel_i][rank_i][bl_i] += (uint8_t) (RDQS_STEP * back);
                       }
-                      // update the RDQS setting
                       set_rdqs(channel_i, rank_i, bl_i, x_coordinate[side_x][side_y][channel_i][rank_i][bl_i]);
-                    } // if bl_i failed
-                  } // bl_i loop
-                } // at least 1 byte lane failed
-              } while (result & 0xFF);
+                      retest = true;
+                    }
+                  }
+                } // bl_i loop
+              } while ((result & 0xFF) || retest);
             } // if rank is enabled
           } // rank_i loop
         } // if channel is enabled
@@ -1907,6 +1936,9 @@ static void wr_train(
   uint32_t address; // target address for "check_bls_ex()"
   uint32_t result; // result of "check_bls_ex()"
   uint32_t bl_mask; // byte lane mask for "result" checking
+  search_state_t search[NUM_BYTE_LANES]; // WDQ edge search state
+  uint32_t back; // WDQ codes to move back past a coarse step
+  bool retest; // a byte lane moved back and has to be tested again
 #ifdef R2R_SHARING
   uint32_t final_delay[NUM_CHANNELS][NUM_BYTE_LANES]; // used to find placement for rank2rank sharing configs
   uint32_t num_ranks_enabled = 0; // used to find placement for rank2rank sharing configs
@@ -2004,6 +2036,12 @@ static void wr_train(
             // request HTE reconfiguration
             mrc_params->hte_setup = 1;
 
+            // start the WDQ edge search
+            for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
+            {
+              search_init(mrc_params, &search[bl_i]);
+            } // bl_i loop
+
             // check the settings
             do
             {
@@ -2015,38 +2053,56 @@ static void wr_train(
 
               // result[07:00] == failing byte lane (MAX 8)
               result = check_bls_ex( mrc_params, address);
-              // check for failures
-              if (result & 0xFF)
+              retest = false;
+
+              for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
               {
-                // at least 1 byte lane failed
-                for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
+                if (result & (bl_mask << bl_i))
                 {
-                  if (result & (bl_mask << bl_i))
+                  // a coarse step never reaches the other side of the window
+                  tempD = WDQ_STEP * search_step(&search[bl_i],
+                      (int32_t) (delay[R][channel_i][rank_i][bl_i] - delay[L][channel_i][rank_i][bl_i]));
+                  if (side_i == L)
+                  {
+                    delay[L][channel_i][rank_i][bl_i] += tempD;
+                  }
+                  else
+                  {
+                    delay[R][channel_i][rank_i][bl_i] -= tempD;
+                  }
+                  // check for algorithm failure
+                  if (delay[L][channel_i][rank_i][bl_i] != delay[R][channel_i][rank_i][bl_i])
+                  {
+                    // margin available, update delay setting
+                    set_wdq(channel_i, rank_i, bl_i, delay[side_i][channel_i][rank_i][bl_i]);
+                  }
+                  else
+                  {
+                    // no margin available, notify the user and halt
+                    training_message(channel_i, rank_i, bl_i);
+                    post_code(0xEE, (0x80 + side_i));
+                  }
+                } // if bl_i failed
+                else
+                {
+                  // passing, step back over a coarse move to find the first passing WDQ
+                  back = search_back(&search[bl_i]);
+                  if (back != 0)
                   {
                     if (side_i == L)
                     {
-                      delay[L][channel_i][rank_i][bl_i] += WDQ_STEP;
-                    }
-                    else
-                    {
-                      delay[R][channel_i][rank_i][bl_i] -= WDQ_STEP;
-                    }
-                    // check for algorithm failure
-                    if (delay[L][channel_i][rank_i][bl_i] != delay[R][channel_i][rank_i][bl_i])
-                    {
-                      // margin available, update delay setting
-                      set_wdq(channel_i, rank_i, bl_i, delay[side_i][channel_i][rank_i][bl_i]);
+                      delay[L][channel_i][rank_i][bl_i] -= WDQ_STEP * back;
                     }
                     else
                     {
-                      // no margin available, notify the user and halt
-                      training_message(channel_i, rank_i, bl_i);
-                      post_code(0xEE, (0x80 + side_i));
+                      delay[R][channel_i][rank_i][bl_i] += WDQ_STEP * back;
                     }
-                  } // if bl_i failed
-                } // bl_i loop
-              } // at least 1 byte lane failed
-            } while (result & 0xFF); // stop when all byte lanes pass
+                    set_wdq(channel_i, rank_i, bl_i, delay[side_i][channel_i][rank_i][bl_i]);
+                    retest = true;
+                  }
+                }
+              } // bl_i loop
+            } while ((result & 0xFF) || retest); // stop when all byte lanes pass
           } // if rank is enabled
         } // rank_i loop
       } // if channel is enabled
@@ -2399,6 +2455,117 @@ static void static_timings(
   return;
 }
 
+#ifdef SEARCH_COMPARE
+// Compare one delay setting found by the linear and the adaptive edge search.
+static uint32_t search_compare_one(
+  char_t *name,
+  char_t *what,
+  uint32_t ch,
+  uint32_t rk,
+  uint32_t bl,
+  uint32_t linear,
+  uint32_t adaptive)
+{
+  if (linear == adaptive)
+  {
+    return 0;
+  }
+  DPF(D_ERROR, "%s: %s ch%d rk%d bl%d linear %d adaptive %d\n", name, what, ch, rk, bl, linear, adaptive);
+  return 1;
+}
+
+// Run a training step with the linear and with the adaptive edge search from the
+// same starting point and report every delay setting on which they disagree.
+// The configured search keeps its results so the rest of MemInit is unchanged.
+static void search_compare(
+  MRCParams_t *mrc_params,
+  MemInitFn_t train,
+  char_t *name)
+{
+  MrcTimings_t saved;
+  MrcTimings_t start;
+  MrcTimings_t linear;
+  MrcTimings_t *adaptive = &mrc_params->timings;
+  uint32_t adaptive_search = mrc_params->adaptive_search;
+  uint32_t errors = 0;
+  uint8_t ch, rk, bl;
+
+  memcpy((void *) &saved, (void *) &mrc_params->timings, (size_t) sizeof(saved));
+
+  store_timings(mrc_params);
+  memcpy((void *) &start, (void *) &mrc_params->timings, (size_t) sizeof(start));
+
+  mrc_params->adaptive_search = 0;
+  train(mrc_params);
+  store_timings(mrc_params);
+  memcpy((void *) &linear, (void *) &mrc_params->timings, (size_t) sizeof(linear));
+
+  memcpy((void *) &mrc_params->timings, (void *) &start, (size_t) sizeof(start));
+  restore_timings(mrc_params);
+  mrc_params->adaptive_search = 1;
+  train(mrc_params);
+  store_timings(mrc_params);
+
+  for (ch = 0; ch < NUM_CHANNELS; ch++)
+  {
+    for (rk = 0; rk < NUM_RANKS; rk++)
+    {
+      for (bl = 0; bl < NUM_BYTE_LANES; bl++)
+      {
+        errors += search_compare_one(name, "rcvn", ch, rk, bl, linear.rcvn[ch][rk][bl], adaptive->rcvn[ch][rk][bl]);
+        errors += search_compare_one(name, "rdqs", ch, rk, bl, linear.rdqs[ch][rk][bl], adaptive->rdqs[ch][rk][bl]);
+        errors += search_compare_one(name, "wdqs", ch, rk, bl, linear.wdqs[ch][rk][bl], adaptive->wdqs[ch][rk][bl]);
+        errors += search_compare_one(name, "wdq", ch, rk, bl, linear.wdq[ch][rk][bl], adaptive->wdq[ch][rk][bl]);
+        if (rk == 0)
+        {
+          errors += search_compare_one(name, "vref", ch, rk, bl, linear.vref[ch][bl], adaptive->vref[ch][bl]);
+        }
+      }
+      errors += search_compare_one(name, "wctl", ch, rk, 0, linear.wctl[ch][rk], adaptive->wctl[ch][rk]);
+    }
+    errors += search_compare_one(name, "wcmd", ch, 0, 0, linear.wcmd[ch], adaptive->wcmd[ch]);
+  }
+  DPF(D_INFO, "%s: edge search compare %s, %d mismatches\n", name, (errors == 0) ? "passed" : "FAILED", errors);
+
+  // continue with the results of the configured search
+  mrc_params->adaptive_search = adaptive_search;
+  if (!adaptive_search)
+  {
+    memcpy((void *) &mrc_params->timings, (void *) &linear, (size_t) sizeof(linear));
+    restore_timings(mrc_params);
+  }
+  memcpy((void *) &mrc_params->timings, (void *) &saved, (size_t) sizeof(saved));
+}
+
+static void rcvn_cal_compare(
+  MRCParams_t *mrc_params)
+{
+  search_compare(mrc_params, rcvn_cal, "rcvn_cal");
+}
+
+static void wr_level_compare(
+  MRCParams_t *mrc_params)
+{
+  search_compare(mrc_params, wr_level, "wr_level");
+}
+
+static void rd_train_compare(
+  MRCParams_t *mrc_params)
+{
+  search_compare(mrc_params, rd_train, "rd_train");
+}
+
+static void wr_train_compare(
+  MRCParams_t *mrc_params)
+{
+  search_compare(mrc_params, wr_train, "wr_train");
+}
+
+#define TRAIN(step) step##_compare
+#else
+#define TRAIN(step) step
+#endif
+
 //
 // Initialise system memory.
 //
@@ -2416,11 +2583,11 @@ void MemInit(
     { 0x0105, bmCold|bmFast            , set_ddr_init_complete    }, //6
     { 0x0106,        bmFast|bmWarm|bmS3, restore_timings          }, //7
     { 0x0106, bmCold                   , default_timings          }, //8
-    { 0x0500, bmCold                   , rcvn_cal                 }, //9  perform RCVN_CAL algorithm
-    { 0x0600, bmCold                   , wr_level                 }, //10  perform WR_LEVEL algorithm
+    { 0x0500, bmCold                   , TRAIN(rcvn_cal)          }, //9  perform RCVN_CAL algorithm
+    { 0x0600, bmCold                   , TRAIN(wr_level)          }, //10  perform WR_LEVEL algorithm
     { 0x0120, bmCold                   , prog_page_ctrl           }, //11
-    { 0x0700, bmCold                   , rd_train                 }, //12  perform RD_TRAIN algorithm
-    { 0x0800, bmCold                   , wr_train                 }, //13  perform WR_TRAIN algorithm
+    { 0x0700, bmCold                   , TRAIN(rd_train)          }, //12  perform RD_TRAIN algorithm
+    { 0x0800, bmCold                   , TRAIN(wr_train)          }, //13  perform WR_TRAIN algorithm
     { 0x010B, bmCold                   , store_timings            }, //14
     { 0x010C, bmCold|bmFast|bmWarm|bmS3, enable_scrambling        }, //15
     { 0x010D, bmCold|bmFast|bmWarm|bmS3, prog_ddr_control         }, //16
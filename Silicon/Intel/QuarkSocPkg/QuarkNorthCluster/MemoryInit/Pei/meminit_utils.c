@@ -865,6 +865,54 @@ static void dram_init_command(
   Wr32(DCMD, 0, data);
 }
 
+// search_init:
+//
+// This function will (re)start the edge search of a byte lane.
+void search_init(
+    MRCParams_t *mrc_params,
+    search_state_t *state)
+{
+  state->coarse_step = mrc_params->adaptive_search ? SEARCH_COARSE_STEP : 1;
+  state->fine = 0;
+  state->last_step = 0;
+}
+
+// search_step:
+//
+// This function will return how many codes a byte lane which has not reached its edge yet has to move.
+// "distance" is the number of codes to the first setting at which the caller gives up, a coarse move never gets there.
+uint32_t search_step(
+    search_state_t *state,
+    int32_t distance)
+{
+  uint32_t step = 1;
+
+  if (!state->fine && (distance > state->coarse_step))
+  {
+    step = state->coarse_step;
+  }
+  state->last_step = (uint8_t) step;
+  return step;
+}
+
+// search_back:
+//
+// This function will return how many codes a byte lane which is past its edge has to move back.
+// 0 means the edge is found.
+uint32_t search_back(
+    search_state_t *state)
+{
+  uint32_t back = 0;
+
+  if (!state->fine && (state->last_step > 1))
+  {
+    back = state->last_step - 1;
+  }
+  state->fine = 1;
+  state->last_step = 0;
+  return back;
+}
+
 // find_rising_edge:
 //
 // This function will find the rising edge transition on RCVN or WDQS.
@@ -883,12 +931,15 @@ void find_rising_edge(
 
   bool all_edges_found; // determines stop condition
   bool direction[NUM_BYTE_LANES]; // direction indicator
+  bool changed; // delay of the byte lane was updated
+  search_state_t search[NUM_BYTE_LANES]; // edge search state
   uint8_t sample_i; // sample counter
   uint8_t bl_i; // byte lane counter
   uint8_t bl_divisor = (mrc_params->channel_width == x16) ? 2 : 1; // byte lane divisor
   uint32_t sample_result[SAMPLE_CNT]; // results of "sample_dqs()"
   uint32_t tempD; // temporary DWORD
   uint32_t transition_pattern;
+  uint32_t back; // codes to move back past a coarse step
 
   ENTERFN();
 
@@ -978,6 +1029,7 @@ void find_rising_edge(
       post_code(0xEE, 0xEE);
       break;
     } // transition_pattern switch
+    search_init(mrc_params, &search[bl_i]);
     // program delays
     if (rcvn)
     {
@@ -990,7 +1042,7 @@ void find_rising_edge(
   } // bl_i loop
 
   // Based on the observed transition pattern on the byte lane,
-  // begin looking for a rising edge with single PI granularity.
+  // begin looking for a rising edge with a coarse-then-fine search down to single PI granularity.
   do
   {
     all_edges_found = true; // assume all byte lanes passed
@@ -998,21 +1050,24 @@ void find_rising_edge(
     // check all each byte lane for proper edge
     for (bl_i = 0; bl_i < (NUM_BYTE_LANES / bl_divisor); bl_i++)
     {
+      changed = false;
       if (tempD & (1 << bl_i))
       {
         // sampled "1"
         if (direction[bl_i] == BACKWARD)
         {
           // keep looking for edge on this byte lane
-          all_edges_found = false;
-          delay[bl_i] -= 1;
-          if (rcvn)
-          {
-            set_rcvn(channel, rank, bl_i, delay[bl_i]);
-          }
-          else
+          delay[bl_i] -= search_step(&search[bl_i], (int32_t) delay[bl_i]);
+          changed = true;
+        }
+        else
+        {
+          // past the edge, step back over a coarse move
+          back = search_back(&search[bl_i]);
+          if (back != 0)
           {
-            set_wdqs(channel, rank, bl_i, delay[bl_i]);
+            delay[bl_i] -= back;
+            changed = true;
           }
         }
       }
@@ -1022,18 +1077,33 @@ void find_rising_edge(
         if (direction[bl_i] == FORWARD)
         {
           // keep looking for edge on this byte lane
-          all_edges_found = false;
-          delay[bl_i] += 1;
-          if (rcvn)
-          {
-            set_rcvn(channel, rank, bl_i, delay[bl_i]);
-          }
-          else
+          delay[bl_i] += search_step(&search[bl_i], SEARCH_NO_LIMIT);
+          changed = true;
+        }
+        else
+        {
+          // past the edge, step back over a coarse move
+          back = search_back(&search[bl_i]);
+          if (back != 0)
           {
-            set_wdqs(channel, rank, bl_i, delay[bl_i]);
+            delay[bl_i] += back;
+            changed = true;
           }
         }
       }
+
+      if (changed)
+      {
+        all_edges_found = false;
+        if (rcvn)
+        {
+          set_rcvn(channel, rank, bl_i, delay[bl_i]);
+        }
+        else
+        {
+          set_wdqs(channel, rank, bl_i, delay[bl_i]);
+        }
+      }
     } // bl_i loop
   } while (!all_edges_found);
 
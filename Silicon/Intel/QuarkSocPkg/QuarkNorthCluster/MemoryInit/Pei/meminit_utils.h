@@ -26,6 +26,22 @@
 
 #define MCEIL(num,den) ((uint8_t)((num+den-1)/den))
 #define MMAX(a,b)      ((((int32_t)(a))>((int32_t)(b)))?(a):(b))
+#define MMIN(a,b)      ((((int32_t)(a))<((int32_t)(b)))?(a):(b))
+
+// Edge search used by the training loops:
+// by default a byte lane moves one code at a time (linear sweep). With
+// mrc_params->adaptive_search set it first moves by SEARCH_COARSE_STEP codes, once
+// a coarse move lands past the edge it goes back to the code after the last one
+// before the edge and continues one code at a time. For a clean edge this ends on
+// the same code as a linear sweep, SEARCH_COMPARE checks that in simulation.
+#define SEARCH_COARSE_STEP  4
+#define SEARCH_NO_LIMIT     0x7FFFFFFF
+
+typedef struct {
+  uint8_t coarse_step; // size of a coarse move, 1 for a linear sweep
+  uint8_t fine;      // single code phase
+  uint8_t last_step; // size of the last move, 0 when the lane did not move
+} search_state_t;
 #define MCOUNT(a)      (sizeof(a)/sizeof(*a))
 
 typedef enum ALGOS_enum {
@@ -67,6 +83,10 @@ uint32_t sample_dqs(MRCParams_t *mrc_params, uint8_t channel, uint8_t rank, bool
 uint32_t get_addr(MRCParams_t *mrc_params, uint8_t channel, uint8_t rank);
 uint32_t byte_lane_mask(MRCParams_t *mrc_params);
 
+void search_init(MRCParams_t *mrc_params, search_state_t *state);
+uint32_t search_step(search_state_t *state, int32_t distance);
+uint32_t search_back(search_state_t *state);
+
 uint64_t read_tsc(void);
 uint32_t get_tsc_freq(void);
 void delay_n(uint32_t nanoseconds);
@@ -20,6 +20,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #if defined (SIM) || defined(EMU)
 #define QUICKSIM              // reduce execution time using shorter rd/wr sequences
+#define SEARCH_COMPARE        // run the training steps with both edge searches and compare the results
 #endif
 
 #define CLT                   // required for Quark project
@@ -136,6 +136,7 @@ typedef struct MRCParams_s
   uint32_t menu_after_mrc : 1;
   uint32_t power_down_disable :1;
   uint32_t tune_rcvn :1;
+  uint32_t adaptive_search :1;  // when set training uses the coarse-then-fine edge search
 
   uint32_t channel_size[NUM_CHANNELS];
   uint32_t column_bits[NUM_CHANNELS];
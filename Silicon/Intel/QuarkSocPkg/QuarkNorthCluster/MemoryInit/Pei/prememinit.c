@@ -48,6 +48,7 @@ void PreMemInit(
     DPF(D_INFO, "- o - odt switch [%d]\n", mrc_params->rd_odt_value);
     DPF(D_INFO, "- d - dram density [%d]\n", mrc_params->params.DENSITY);
     DPF(D_INFO, "- p - power down disable [%d]\n", mrc_params->power_down_disable);
+    DPF(D_INFO, "- s - adaptive edge search [%d]\n", mrc_params->adaptive_search);
     DPF(D_INFO, "- l - log switch 0x%x\n", DpfPrintMask);
     ch = mgetc();
 
@@ -67,6 +68,11 @@ void PreMemInit(
       DPF(D_INFO, "Power down disable %d\n", mrc_params->power_down_disable);
       break;
 
+    case 's':
+      mrc_params->adaptive_search ^= 1;
+      DPF(D_INFO, "Adaptive edge search %d\n", mrc_params->adaptive_search);
+      break;
+
     case 'r':
       mrc_params->rank_enables ^= 2;
       DPF(D_INFO, "Rank enable %d\n", mrc_params->rank_enables);
@@ -16,6 +16,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/IoLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
@@ -104,12 +105,27 @@ MvI2cInitialiseController (
   I2cMasterContext->Bus = Bus;
   /* I2cMasterContext->Lock is responsible for serializing I2C operations */
   EfiInitializeLock(&I2cMasterContext->Lock, TPL_NOTIFY);
+  InitializeListHead (&I2cMasterContext->Queue);
+
+  /* Asynchronous requests are advanced from this timer */
+  Status = gBS->CreateEvent (EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  MvI2cPollQueue,
+                  I2cMasterContext,
+                  &I2cMasterContext->PollEvent);
+  if (EFI_ERROR(Status)) {
+    DEBUG((DEBUG_ERROR, "MvI2cDxe: I2C poll event creation failed\n"));
+    FreePool(I2cMasterContext);
+    return Status;
+  }
 
   MvI2cCalBaudRate( I2cMasterContext,
                     PcdGet32 (PcdI2cBaudRate),
                     &baud_rate,
                     I2cMasterContext->TclkFrequency
                   );
+  /* A byte takes 9 clock cycles on the bus, including the ACK */
+  I2cMasterContext->ByteTime = (9 * 1000000 + baud_rate.raw - 1) / baud_rate.raw;
 
   Status = gBS->InstallMultipleProtocolInterfaces(
       &I2cMasterContext->Controller,
@@ -135,6 +151,7 @@ MvI2cInitialiseController (
   return EFI_SUCCESS;
 
 fail:
+  gBS->CloseEvent(I2cMasterContext->PollEvent);
   FreePool(I2cMasterContext);
   return Status;
 }
@@ -208,97 +225,6 @@ MvI2cControlSet (
   I2C_WRITE(I2cMasterContext, I2C_CONTROL, Value);
 }
 
-STATIC
-VOID
-MvI2cClearIflg (
- IN I2C_MASTER_CONTEXT *I2cMasterContext
- )
-{
-  MvI2cPollCtrl (I2cMasterContext, I2C_OPERATION_TIMEOUT, I2C_CONTROL_IFLG);
-  MvI2cControlClear(I2cMasterContext, I2C_CONTROL_IFLG);
-}
-
-/* Timeout is given in us */
-STATIC
-UINTN
-MvI2cPollCtrl (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINTN Timeout,
-  IN UINT32 Mask)
-{
-  Timeout /= 10;
-  while (!(I2C_READ(I2cMasterContext, I2C_CONTROL) & Mask)) {
-    gBS->Stall(10);
-    if (--Timeout == 0)
-      return (Timeout);
-  }
-  return (0);
-}
-
-/*
- * 'Timeout' is given in us. Note also that Timeout handling is not exact --
- * MvI2cLockedStart() total wait can be more than 2 x Timeout
- * (MvI2cPollCtrl() is called twice). 'Mask' can be either I2C_STATUS_START
- * or I2C_STATUS_RPTD_START
- */
-STATIC
-EFI_STATUS
-MvI2cLockedStart (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN INT32 Mask,
-  IN UINT8 Slave,
-  IN UINTN Timeout
-  )
-{
-  UINTN ReadAccess, IflgSet = 0;
-  UINT32 I2cStatus;
-
-  if (Mask == I2C_STATUS_RPTD_START) {
-    /* read IFLG to know if it should be cleared later */
-    IflgSet = I2C_READ(I2cMasterContext, I2C_CONTROL) & I2C_CONTROL_IFLG;
-  }
-
-  MvI2cControlSet(I2cMasterContext, I2C_CONTROL_START);
-
-  if (Mask == I2C_STATUS_RPTD_START && IflgSet) {
-    DEBUG((DEBUG_INFO, "MvI2cDxe: IFLG set, clearing\n"));
-    MvI2cClearIflg(I2cMasterContext);
-  }
-
-  if (MvI2cPollCtrl(I2cMasterContext, Timeout, I2C_CONTROL_IFLG)) {
-    DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout sending %sSTART condition\n",
-        Mask == I2C_STATUS_START ? "" : "repeated "));
-    return EFI_NO_RESPONSE;
-  }
-
-  I2cStatus = I2C_READ(I2cMasterContext, I2C_STATUS);
-  if (I2cStatus != Mask) {
-    DEBUG((DEBUG_ERROR, "MvI2cDxe: wrong I2cStatus (%02x) after sending %sSTART condition\n",
-        I2cStatus, Mask == I2C_STATUS_START ? "" : "repeated "));
-    return EFI_DEVICE_ERROR;
-  }
-
-  I2C_WRITE(I2cMasterContext, I2C_DATA, Slave);
-  gBS->Stall(I2C_OPERATION_TIMEOUT);
-  MvI2cClearIflg(I2cMasterContext);
-
-  if (MvI2cPollCtrl(I2cMasterContext, Timeout, I2C_CONTROL_IFLG)) {
-    DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout sending Slave address\n"));
-    return EFI_NO_RESPONSE;
-  }
-
-  ReadAccess = (Slave & 0x1) ? 1 : 0;
-  I2cStatus = I2C_READ(I2cMasterContext, I2C_STATUS);
-  if (I2cStatus != (ReadAccess ?
-      I2C_STATUS_ADDR_R_ACK : I2C_STATUS_ADDR_W_ACK)) {
-    DEBUG((DEBUG_ERROR, "MvI2cDxe: no ACK (I2cStatus: %02x) after sending Slave address\n",
-        I2cStatus));
-    return EFI_NO_RESPONSE;
-  }
-
-  return EFI_SUCCESS;
-}
-
 #define  ABSSUB(a,b)  (((a) > (b)) ? (a) - (b) : (b) - (a))
 STATIC
 VOID
@@ -348,6 +274,11 @@ MvI2cReset (
   param = baud_rate.param;
 
   EfiAcquireLock (&I2cMasterContext->Lock);
+  if (I2cMasterContext->Current != NULL ||
+      !IsListEmpty (&I2cMasterContext->Queue)) {
+    EfiReleaseLock (&I2cMasterContext->Lock);
+    return EFI_ALREADY_STARTED;
+  }
   I2C_WRITE(I2cMasterContext, I2C_SOFT_RESET, 0x0);
   gBS->Stall(2 * I2C_OPERATION_TIMEOUT);
   I2C_WRITE(I2cMasterContext, I2C_BAUD_RATE, param);
@@ -359,163 +290,317 @@ MvI2cReset (
 }
 
 /*
- * Timeout is given in us
+ * Issue a START (or repeated START) condition for the current operation.
+ * A repeated START is requested while IFLG is still set from the previous
+ * byte, so IFLG has to be cleared to let the controller proceed.
  */
 STATIC
-EFI_STATUS
-MvI2cRepeatedStart (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINT8 Slave,
-  IN UINTN Timeout
+VOID
+MvI2cSendStart (
+  IN I2C_MASTER_CONTEXT *I2cMasterContext
   )
 {
-  EFI_STATUS Status;
+  UINT32 IflgSet;
 
-  EfiAcquireLock (&I2cMasterContext->Lock);
-  Status = MvI2cLockedStart(I2cMasterContext, I2C_STATUS_RPTD_START, Slave,
-      Timeout);
-  EfiReleaseLock (&I2cMasterContext->Lock);
-
-  if (EFI_ERROR(Status)) {
-    MvI2cStop(I2cMasterContext);
+  IflgSet = I2C_READ(I2cMasterContext, I2C_CONTROL) & I2C_CONTROL_IFLG;
+  MvI2cControlSet(I2cMasterContext, I2C_CONTROL_START);
+  if (IflgSet) {
+    MvI2cControlClear(I2cMasterContext, I2C_CONTROL_IFLG);
   }
-  return Status;
+  I2cMasterContext->State = I2C_STATE_START;
 }
 
 /*
- * Timeout is given in us
+ * Issue a STOP condition. The request completes once the controller has
+ * put it on the bus and cleared the STOP bit.
  */
 STATIC
-EFI_STATUS
-MvI2cStart (
+VOID
+MvI2cSendStop (
   IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINT8 Slave,
-  IN UINTN Timeout
+  IN EFI_STATUS Status
   )
 {
-  EFI_STATUS Status;
+  UINT32 Value;
 
-  EfiAcquireLock (&I2cMasterContext->Lock);
-  Status = MvI2cLockedStart(I2cMasterContext, I2C_STATUS_START, Slave, Timeout);
-  EfiReleaseLock (&I2cMasterContext->Lock);
+  Value = I2C_READ(I2cMasterContext, I2C_CONTROL);
+  Value |= I2C_CONTROL_STOP;
+  Value &= ~I2C_CONTROL_IFLG;
+  I2C_WRITE(I2cMasterContext, I2C_CONTROL, Value);
 
-  if (EFI_ERROR(Status)) {
-    MvI2cStop(I2cMasterContext);
-  }
-  return Status;
+  I2cMasterContext->Current->Status = Status;
+  I2cMasterContext->State = I2C_STATE_STOP;
 }
 
+/*
+ * Complete the current request, and report its status to the caller.
+ */
 STATIC
-EFI_STATUS
-MvI2cStop (
+VOID
+MvI2cCompleteRequest (
   IN I2C_MASTER_CONTEXT *I2cMasterContext
   )
 {
-  EfiAcquireLock (&I2cMasterContext->Lock);
-  MvI2cControlSet(I2cMasterContext, I2C_CONTROL_STOP);
-  gBS->Stall(I2C_OPERATION_TIMEOUT);
-  MvI2cClearIflg(I2cMasterContext);
-  EfiReleaseLock (&I2cMasterContext->Lock);
+  MV_I2C_REQUEST *Request;
 
-  return EFI_SUCCESS;
+  Request = I2cMasterContext->Current;
+  I2cMasterContext->Current = NULL;
+
+  if (Request->Event == NULL) {
+    /* Synchronous request, the caller is waiting on Done */
+    Request->Done = TRUE;
+    return;
+  }
+
+  if (Request->I2cStatus != NULL)
+    *Request->I2cStatus = Request->Status;
+  gBS->SignalEvent(Request->Event);
+  FreePool(Request);
 }
 
+/*
+ * Start the transfer of the next byte of the current operation, or move on
+ * to the next operation once the current one is done.
+ */
 STATIC
-EFI_STATUS
-MvI2cRead (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN OUT UINT8 *Buf,
-  IN UINTN Length,
-  IN OUT UINTN *read,
-  IN UINTN last,
-  IN UINTN delay
+VOID
+MvI2cNextByte (
+  IN I2C_MASTER_CONTEXT *I2cMasterContext
   )
 {
-  UINT32 I2cStatus;
-  UINTN LastByte;
-  EFI_STATUS Status;
+  EFI_I2C_REQUEST_PACKET *RequestPacket;
+  EFI_I2C_OPERATION *Operation;
+  BOOLEAN LastByte;
 
-  EfiAcquireLock (&I2cMasterContext->Lock);
-  *read = 0;
-  while (*read < Length) {
+  RequestPacket = I2cMasterContext->Current->RequestPacket;
+
+  while (TRUE) {
+    Operation = &RequestPacket->Operation[I2cMasterContext->OperationIndex];
+    if (I2cMasterContext->ByteIndex < Operation->LengthInBytes) {
+      break;
+    }
+
+    I2cMasterContext->OperationIndex++;
+    I2cMasterContext->ByteIndex = 0;
+    if (I2cMasterContext->OperationIndex == RequestPacket->OperationCount) {
+      MvI2cSendStop (I2cMasterContext, EFI_SUCCESS);
+      return;
+    }
+
+    Operation = &RequestPacket->Operation[I2cMasterContext->OperationIndex];
+    if (!(Operation->Flags & I2C_FLAG_NORESTART)) {
+      MvI2cSendStart (I2cMasterContext);
+      return;
+    }
+  }
+
+  if (Operation->Flags & I2C_FLAG_READ) {
     /*
-     * Check if we are reading last byte of the last Buffer,
-     * do not send ACK then, per I2C specs
+     * Do not ACK the last byte before a STOP or repeated START,
+     * per I2C specs
      */
-    LastByte = ((*read == Length - 1) && last) ? 1 : 0;
+    LastByte = (I2cMasterContext->ByteIndex == Operation->LengthInBytes - 1) &&
+               (I2cMasterContext->OperationIndex == RequestPacket->OperationCount - 1 ||
+                !(Operation[1].Flags & I2C_FLAG_NORESTART));
     if (LastByte)
       MvI2cControlClear(I2cMasterContext, I2C_CONTROL_ACK);
     else
       MvI2cControlSet(I2cMasterContext, I2C_CONTROL_ACK);
+  } else {
+    I2C_WRITE(I2cMasterContext, I2C_DATA,
+        Operation->Buffer[I2cMasterContext->ByteIndex]);
+  }
 
-    gBS->Stall (I2C_OPERATION_TIMEOUT);
-    MvI2cClearIflg(I2cMasterContext);
+  MvI2cControlClear(I2cMasterContext, I2C_CONTROL_IFLG);
+  I2cMasterContext->State = I2C_STATE_DATA;
+}
+
+/*
+ * Advance the current request by one step. Called once the controller has
+ * finished the previous step, i.e. IFLG is set (or STOP has been cleared).
+ */
+STATIC
+VOID
+MvI2cAdvance (
+  IN I2C_MASTER_CONTEXT *I2cMasterContext
+  )
+{
+  MV_I2C_REQUEST *Request;
+  EFI_I2C_OPERATION *Operation;
+  UINT32 I2cStatus;
+  UINT32 Expected;
+  UINTN ReadMode;
 
-    if (MvI2cPollCtrl(I2cMasterContext, delay, I2C_CONTROL_IFLG)) {
-      DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout reading data\n"));
-      Status = EFI_NO_RESPONSE;
-      goto out;
+  Request = I2cMasterContext->Current;
+  Operation = &Request->RequestPacket->Operation[I2cMasterContext->OperationIndex];
+  ReadMode = Operation->Flags & I2C_FLAG_READ;
+  I2cStatus = I2C_READ(I2cMasterContext, I2C_STATUS);
+
+  switch (I2cMasterContext->State) {
+  case I2C_STATE_START:
+    Expected = (I2cMasterContext->OperationIndex == 0) ?
+               I2C_STATUS_START : I2C_STATUS_RPTD_START;
+    if (I2cStatus != Expected) {
+      DEBUG((DEBUG_ERROR, "MvI2cDxe: wrong I2cStatus (%02x) after sending %sSTART condition\n",
+          I2cStatus, Expected == I2C_STATUS_START ? "" : "repeated "));
+      MvI2cSendStop (I2cMasterContext, EFI_DEVICE_ERROR);
+      return;
+    }
+    I2C_WRITE(I2cMasterContext, I2C_DATA, (UINT32)((Request->SlaveAddress << 1) | ReadMode));
+    MvI2cControlClear(I2cMasterContext, I2C_CONTROL_IFLG);
+    I2cMasterContext->State = I2C_STATE_ADDRESS;
+    return;
+
+  case I2C_STATE_ADDRESS:
+    Expected = ReadMode ? I2C_STATUS_ADDR_R_ACK : I2C_STATUS_ADDR_W_ACK;
+    if (I2cStatus != Expected) {
+      DEBUG((DEBUG_ERROR, "MvI2cDxe: no ACK (I2cStatus: %02x) after sending Slave address\n",
+          I2cStatus));
+      MvI2cSendStop (I2cMasterContext, EFI_NO_RESPONSE);
+      return;
     }
+    I2cMasterContext->ByteIndex = 0;
+    MvI2cNextByte (I2cMasterContext);
+    return;
 
-    I2cStatus = I2C_READ(I2cMasterContext, I2C_STATUS);
-    if (I2cStatus != (LastByte ?
-        I2C_STATUS_DATA_RD_NOACK : I2C_STATUS_DATA_RD_ACK)) {
-      DEBUG((DEBUG_ERROR, "MvI2cDxe: wrong I2cStatus (%02x) while reading\n", I2cStatus));
-      Status = EFI_DEVICE_ERROR;
-      goto out;
+  case I2C_STATE_DATA:
+    if (ReadMode) {
+      Expected = (I2C_READ(I2cMasterContext, I2C_CONTROL) & I2C_CONTROL_ACK) ?
+                 I2C_STATUS_DATA_RD_ACK : I2C_STATUS_DATA_RD_NOACK;
+    } else {
+      Expected = I2C_STATUS_DATA_WR_ACK;
+    }
+    if (I2cStatus != Expected) {
+      DEBUG((DEBUG_ERROR, "MvI2cDxe: wrong I2cStatus (%02x) while %a\n",
+          I2cStatus, ReadMode ? "reading" : "writing"));
+      Operation->LengthInBytes = I2cMasterContext->ByteIndex;
+      MvI2cSendStop (I2cMasterContext, EFI_DEVICE_ERROR);
+      return;
     }
+    if (ReadMode) {
+      Operation->Buffer[I2cMasterContext->ByteIndex] =
+        I2C_READ(I2cMasterContext, I2C_DATA);
+    }
+    I2cMasterContext->ByteIndex++;
+    MvI2cNextByte (I2cMasterContext);
+    return;
 
-    *Buf++ = I2C_READ(I2cMasterContext, I2C_DATA);
-    (*read)++;
+  default:
+    MvI2cCompleteRequest (I2cMasterContext);
+    return;
   }
-  Status = EFI_SUCCESS;
-out:
-  EfiReleaseLock (&I2cMasterContext->Lock);
-  return (Status);
 }
 
+/*
+ * Return the time elapsed since the performance counter read Start, in us.
+ * The generic timer counts up and is 64 bits wide, so it does not wrap.
+ */
+STATIC
+UINT64
+MvI2cElapsed (
+  IN UINT64 Start
+  )
+{
+  return DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter () - Start), 1000);
+}
+
+/*
+ * Advance the request queue, polling the controller for up to Budget us.
+ * A step that makes no progress for I2C_TRANSFER_TIMEOUT us fails the
+ * request. Must be called with I2cMasterContext->Lock held. Returns TRUE
+ * once the queue is empty.
+ */
 STATIC
-EFI_STATUS
-MvI2cWrite (
+BOOLEAN
+MvI2cRunQueue (
   IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN OUT CONST UINT8 *Buf,
-  IN UINTN Length,
-  IN OUT UINTN *Sent,
-  IN UINTN Timeout
+  IN UINT64 Budget
   )
 {
-  UINT32 status;
-  EFI_STATUS Status;
+  UINT64 Start;
+  UINT32 Control;
+  BOOLEAN Ready;
+
+  Start = GetPerformanceCounter ();
+  while (TRUE) {
+    if (I2cMasterContext->Current == NULL) {
+      if (IsListEmpty (&I2cMasterContext->Queue)) {
+        return TRUE;
+      }
+      I2cMasterContext->Current = MV_I2C_REQUEST_FROM_LINK (
+                                    GetFirstNode (&I2cMasterContext->Queue));
+      RemoveEntryList (&I2cMasterContext->Current->Link);
+      I2cMasterContext->OperationIndex = 0;
+      I2cMasterContext->ByteIndex = 0;
+      I2cMasterContext->StepStart = GetPerformanceCounter ();
+      if (I2cMasterContext->Current->RequestPacket->OperationCount == 0) {
+        I2cMasterContext->Current->Status = EFI_SUCCESS;
+        MvI2cCompleteRequest (I2cMasterContext);
+        continue;
+      }
+      MvI2cSendStart (I2cMasterContext);
+    }
 
-  EfiAcquireLock (&I2cMasterContext->Lock);
-  *Sent = 0;
-  while (*Sent < Length) {
-    I2C_WRITE(I2cMasterContext, I2C_DATA, *Buf++);
-
-    MvI2cClearIflg(I2cMasterContext);
-    if (MvI2cPollCtrl(I2cMasterContext, Timeout, I2C_CONTROL_IFLG)) {
-      DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout writing data\n"));
-      Status = EFI_NO_RESPONSE;
-      goto out;
+    Control = I2C_READ(I2cMasterContext, I2C_CONTROL);
+    if (I2cMasterContext->State == I2C_STATE_STOP) {
+      Ready = !(Control & I2C_CONTROL_STOP);
+    } else {
+      Ready = (Control & I2C_CONTROL_IFLG) != 0;
+    }
+
+    if (Ready) {
+      I2cMasterContext->StepStart = GetPerformanceCounter ();
+      MvI2cAdvance (I2cMasterContext);
+      continue;
     }
 
-    status = I2C_READ(I2cMasterContext, I2C_STATUS);
-    if (status != I2C_STATUS_DATA_WR_ACK) {
-      DEBUG((DEBUG_ERROR, "MvI2cDxe: wrong status (%02x) while writing\n", status));
-      Status = EFI_DEVICE_ERROR;
-      goto out;
+    if (MvI2cElapsed (I2cMasterContext->StepStart) >= I2C_TRANSFER_TIMEOUT) {
+      I2cMasterContext->StepStart = GetPerformanceCounter ();
+      if (I2cMasterContext->State == I2C_STATE_STOP) {
+        DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout sending STOP condition\n"));
+        if (!EFI_ERROR (I2cMasterContext->Current->Status))
+          I2cMasterContext->Current->Status = EFI_DEVICE_ERROR;
+        MvI2cCompleteRequest (I2cMasterContext);
+      } else {
+        DEBUG((DEBUG_ERROR, "MvI2cDxe: Timeout in state %d\n",
+            (UINT32)I2cMasterContext->State));
+        MvI2cSendStop (I2cMasterContext, EFI_NO_RESPONSE);
+      }
+      continue;
+    }
+
+    if (MvI2cElapsed (Start) >= Budget) {
+      return FALSE;
     }
-    (*Sent)++;
   }
-  Status = EFI_SUCCESS;
-out:
+}
+
+STATIC
+VOID
+EFIAPI
+MvI2cPollQueue (
+  IN EFI_EVENT Event,
+  IN VOID *Context
+  )
+{
+  I2C_MASTER_CONTEXT *I2cMasterContext = Context;
+
+  EfiAcquireLock (&I2cMasterContext->Lock);
+  if (MvI2cRunQueue (I2cMasterContext,
+        I2C_POLL_BYTES * I2cMasterContext->ByteTime)) {
+    gBS->SetTimer (Event, TimerCancel, 0);
+  }
   EfiReleaseLock (&I2cMasterContext->Lock);
-  return (Status);
 }
 
 /*
  * MvI2cStartRequest should be called only by I2cHost.
  * I2C device drivers ought to use EFI_I2C_IO_PROTOCOL instead.
+ *
+ * Requests with an Event are queued and run for up to I2C_POLL_BYTES
+ * byte-times, so short transfers complete before the call returns. Longer
+ * ones are advanced from a timer. Requests without an Event are queued as
+ * well, and the call waits for them to complete.
  */
 STATIC
 EFI_STATUS
@@ -527,77 +612,54 @@ MvI2cStartRequest (
   OUT EFI_STATUS                   *I2cStatus OPTIONAL
   )
 {
-  UINTN Count;
-  UINTN ReadMode;
-  UINTN Transmitted;
   I2C_MASTER_CONTEXT *I2cMasterContext = I2C_SC_FROM_MASTER(This);
-  EFI_I2C_OPERATION *Operation;
-  EFI_STATUS Status = EFI_SUCCESS;
+  MV_I2C_REQUEST SyncRequest;
+  MV_I2C_REQUEST *Request;
+  EFI_STATUS Status;
 
   ASSERT (RequestPacket != NULL);
   ASSERT (I2cMasterContext != NULL);
 
-  for (Count = 0; Count < RequestPacket->OperationCount; Count++) {
-    Operation = &RequestPacket->Operation[Count];
-    ReadMode = Operation->Flags & I2C_FLAG_READ;
-
-    if (Count == 0) {
-      Status = MvI2cStart (I2cMasterContext,
-                 (SlaveAddress << 1) | ReadMode,
-                 I2C_TRANSFER_TIMEOUT);
-    } else if (!(Operation->Flags & I2C_FLAG_NORESTART)) {
-      Status = MvI2cRepeatedStart (I2cMasterContext,
-                 (SlaveAddress << 1) | ReadMode,
-                 I2C_TRANSFER_TIMEOUT);
-    }
-
-    /* I2C transaction was aborted, so stop further transactions */
-    if (EFI_ERROR (Status)) {
-      MvI2cStop (I2cMasterContext);
-      break;
-    }
-
-    /*
-     * If sending the slave address was successful,
-     * proceed to read or write section.
-     */
-    if (ReadMode) {
-      Status = MvI2cRead (I2cMasterContext,
-                 Operation->Buffer,
-                 Operation->LengthInBytes,
-                 &Transmitted,
-                 Count == 1,
-                 I2C_TRANSFER_TIMEOUT);
-      Operation->LengthInBytes = Transmitted;
-    } else {
-      Status = MvI2cWrite (I2cMasterContext,
-                 Operation->Buffer,
-                 Operation->LengthInBytes,
-                 &Transmitted,
-                 I2C_TRANSFER_TIMEOUT);
-      Operation->LengthInBytes = Transmitted;
+  if (Event != NULL) {
+    Request = AllocatePool (sizeof (MV_I2C_REQUEST));
+    if (Request == NULL) {
+      return EFI_OUT_OF_RESOURCES;
     }
+  } else {
+    Request = &SyncRequest;
+  }
+  Request->SlaveAddress = SlaveAddress;
+  Request->RequestPacket = RequestPacket;
+  Request->Event = Event;
+  Request->I2cStatus = I2cStatus;
+  Request->Status = EFI_NOT_READY;
+  Request->Done = FALSE;
 
-    /*
-     * The I2C read or write transaction failed.
-     * Stop the I2C transaction.
-     */
-    if (EFI_ERROR (Status)) {
-      MvI2cStop (I2cMasterContext);
-      break;
+  EfiAcquireLock (&I2cMasterContext->Lock);
+  InsertTailList (&I2cMasterContext->Queue, &Request->Link);
+
+  if (Event != NULL) {
+    /* Run the transfer inline, the timer takes over if it is not done */
+    if (!MvI2cRunQueue (I2cMasterContext,
+           I2C_POLL_BYTES * I2cMasterContext->ByteTime)) {
+      Status = gBS->SetTimer (I2cMasterContext->PollEvent,
+                      TimerPeriodic,
+                      EFI_TIMER_PERIOD_MICROSECONDS (I2C_POLL_PERIOD));
+      ASSERT_EFI_ERROR (Status);
     }
+    EfiReleaseLock (&I2cMasterContext->Lock);
+    return EFI_SUCCESS;
+  }
 
-    /* Check if there is any more data to be sent */
-    if (Count == RequestPacket->OperationCount - 1) {
-      MvI2cStop ( I2cMasterContext );
-    }
+  /* Requests queued ahead of this one are run first */
+  while (!Request->Done) {
+    MvI2cRunQueue (I2cMasterContext, I2C_TRANSFER_TIMEOUT);
   }
+  EfiReleaseLock (&I2cMasterContext->Lock);
 
   if (I2cStatus != NULL)
-    *I2cStatus = EFI_SUCCESS;
-  if (Event != NULL)
-    gBS->SignalEvent(Event);
-  return EFI_SUCCESS;
+    *I2cStatus = Request->Status;
+  return Request->Status;
 }
 
 STATIC CONST EFI_GUID DevGuid = I2C_GUID;
@@ -43,6 +43,21 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define I2C_TRANSFER_TIMEOUT 10000
 #define I2C_OPERATION_TIMEOUT 100
 
+/*
+ * Request queue polling. Each poll of an asynchronous request, both from
+ * StartRequest() and from the timer, keeps the controller going for up to
+ * I2C_POLL_BYTES byte-times, so short transfers complete before StartRequest()
+ * returns and longer ones make progress however coarse the timer tick is.
+ * I2C_POLL_PERIOD is the requested timer period in us.
+ */
+#define I2C_POLL_BYTES      16
+#define I2C_POLL_PERIOD     1000
+
+#define I2C_STATE_START     0x0
+#define I2C_STATE_ADDRESS   0x1
+#define I2C_STATE_DATA      0x2
+#define I2C_STATE_STOP      0x3
+
 #define I2C_UNKNOWN        0x0
 #define I2C_SLOW           0x1
 #define I2C_FAST           0x2
@@ -55,6 +70,18 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define I2C_MASTER_SIGNATURE          SIGNATURE_32 ('I', '2', 'C', 'M')
 
+typedef struct {
+  LIST_ENTRY              Link;
+  UINTN                   SlaveAddress;
+  EFI_I2C_REQUEST_PACKET  *RequestPacket;
+  EFI_EVENT               Event;
+  EFI_STATUS              *I2cStatus;
+  EFI_STATUS              Status;
+  BOOLEAN                 Done;
+} MV_I2C_REQUEST;
+
+#define MV_I2C_REQUEST_FROM_LINK(a) BASE_CR (a, MV_I2C_REQUEST, Link)
+
 typedef struct {
   UINT32      Signature;
   EFI_HANDLE  Controller;
@@ -62,6 +89,15 @@ typedef struct {
   UINTN       TclkFrequency;
   UINTN       BaseAddress;
   INTN        Bus;
+  /* Request queue, protected by Lock */
+  LIST_ENTRY      Queue;
+  MV_I2C_REQUEST  *Current;
+  EFI_EVENT       PollEvent;
+  UINTN           State;
+  UINTN           OperationIndex;
+  UINTN           ByteIndex;
+  UINT64          StepStart;    // Performance counter value when the step began
+  UINTN           ByteTime;     // Time to transfer one byte, in us
   EFI_I2C_MASTER_PROTOCOL I2cMaster;
   EFI_I2C_ENUMERATE_PROTOCOL I2cEnumerate;
   EFI_I2C_BUS_CONFIGURATION_MANAGEMENT_PROTOCOL I2cBusConf;
@@ -120,25 +156,18 @@ MvI2cControlSet (
   );
 
 STATIC
-VOID
-MvI2cClearIflg (
- IN I2C_MASTER_CONTEXT *I2cMasterContext
- );
-STATIC
-UINTN
-MvI2cPollCtrl (
+BOOLEAN
+MvI2cRunQueue (
   IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINTN timeout,
-  IN UINT32 mask
+  IN UINT64 Budget
   );
 
 STATIC
-EFI_STATUS
-MvI2cLockedStart (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN INT32 mask,
-  IN UINT8 slave,
-  IN UINTN timeout
+VOID
+EFIAPI
+MvI2cPollQueue (
+  IN EFI_EVENT Event,
+  IN VOID *Context
   );
 
 STATIC
@@ -156,49 +185,6 @@ MvI2cReset (
   IN CONST EFI_I2C_MASTER_PROTOCOL *This
   );
 
-STATIC
-EFI_STATUS
-MvI2cRepeatedStart (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINT8 slave,
-  IN UINTN timeout
-  );
-
-STATIC
-EFI_STATUS
-MvI2cStart (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN UINT8 slave,
-  IN UINTN timeout
-  );
-
-STATIC
-EFI_STATUS
-MvI2cStop (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext
-  );
-
-STATIC
-EFI_STATUS
-MvI2cRead (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN OUT UINT8 *buf,
-  IN UINTN len,
-  IN OUT UINTN *read,
-  IN UINTN last,
-  IN UINTN delay
-  );
-
-STATIC
-EFI_STATUS
-MvI2cWrite (
-  IN I2C_MASTER_CONTEXT *I2cMasterContext,
-  IN OUT CONST UINT8 *buf,
-  IN UINTN len,
-  IN OUT UINTN *sent,
-  IN UINTN timeout
-  );
-
 STATIC
 EFI_STATUS
 EFIAPI
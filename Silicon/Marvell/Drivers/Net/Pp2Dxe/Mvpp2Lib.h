@@ -664,7 +664,6 @@ Mvpp2RxqNextDescGet (
   INT32 RxDesc = Rxq->NextDescToProc;
 
   Rxq->NextDescToProc = MVPP2_QUEUE_NEXT_DESC(Rxq, RxDesc);
-  Mvpp2Prefetch(Rxq->Descs + Rxq->NextDescToProc);
   return Rxq->Descs + RxDesc;
 }
 
@@ -97,7 +97,7 @@ EFI_SIMPLE_NETWORK_MODE Pp2SnpModeTemplate = {
   },                                                    // Permanent Address
   NET_IFTYPE_ETHERNET,                                  // IfType
   TRUE,                                                 // MacAddressChangeable
-  FALSE,                                                // MultipleTxSupported
+  TRUE,                                                 // MultipleTxSupported
   TRUE,                                                 // MediaPresentSupported
   FALSE                                                 // MediaPresent
 };
@@ -141,6 +141,90 @@ QueueRemove (
   return Buffer;
 }
 
+/*
+ * Take back from HW every buffer still in flight, after a transmit timeout
+ * or when the port is shut down. The port TXQ is drained, so that HW is done
+ * with all posted descriptors, and the in-flight buffers are then all counted
+ * as sent. Pp2DxeTxReap returns them to the caller like any other.
+ */
+STATIC
+VOID
+Pp2DxeTxFlush (
+  IN PP2DXE_CONTEXT *Pp2Context
+  )
+{
+  PP2DXE_PORT *Port = &Pp2Context->Port;
+  MVPP2_SHARED *Mvpp2Shared = Port->Priv;
+  INTN PollingCount;
+
+  Pp2Context->TxStallCount = 0;
+
+  if (Pp2Context->TxInFlightCount == 0) {
+    return;
+  }
+
+  /* Let HW move what is left in the aggregated TXQ to the port TXQ */
+  PollingCount = 0;
+  while (Mvpp2AggrTxqPendDescNumGet(Mvpp2Shared, 0) != 0) {
+    if (PollingCount++ > MVPP2_TX_SEND_MAX_POLLING_COUNT) {
+      DEBUG((DEBUG_ERROR, "Pp2Dxe%d: aggregated TXQ not drained\n", Pp2Context->Instance));
+      break;
+    }
+  }
+
+  /* Drain the port TXQ and discard its sent counter */
+  Mvpp2TxpClean(Port, 0, &Port->Txqs[0]);
+  Mvpp2TxqSentCounterClear(Port);
+
+  Pp2Context->TxSentCount = Pp2Context->TxInFlightCount;
+}
+
+/*
+ * Move buffers of packets sent by HW from the in-flight ring to the
+ * completion queue, from where GetStatus hands them back to the caller.
+ * Packets are sent in submission order, so the sent ones are always
+ * at the head of the ring. If HW stops making progress, the packets
+ * still in flight are reclaimed with Pp2DxeTxFlush.
+ */
+STATIC
+VOID
+Pp2DxeTxReap (
+  IN PP2DXE_CONTEXT *Pp2Context
+  )
+{
+  PP2DXE_PORT *Port = &Pp2Context->Port;
+  UINTN Sent;
+
+  if (Pp2Context->TxInFlightCount == 0) {
+    return;
+  }
+
+  /* Reading the sent counter clears it, so keep what we cannot recycle yet */
+  Sent = Mvpp2TxqSentDescProc(Port, &Port->Txqs[0]);
+  Pp2Context->TxSentCount += Sent;
+  Pp2Context->TxSentCount = MIN (Pp2Context->TxSentCount, Pp2Context->TxInFlightCount);
+
+  if (Sent != 0 || Pp2Context->TxSentCount == Pp2Context->TxInFlightCount) {
+    Pp2Context->TxStallCount = 0;
+  } else if (++Pp2Context->TxStallCount > MVPP2_TX_SEND_MAX_POLLING_COUNT) {
+    DEBUG((DEBUG_ERROR, "Pp2Dxe%d: transmit timed out, reclaiming %d buffers\n",
+      Pp2Context->Instance, (UINT32)(Pp2Context->TxInFlightCount - Pp2Context->TxSentCount)));
+    Pp2DxeTxFlush(Pp2Context);
+  }
+
+  while (Pp2Context->TxSentCount > 0) {
+    if (EFI_ERROR (QueueInsert (Pp2Context, Pp2Context->TxInFlight[Pp2Context->TxInFlightHead]))) {
+      /* Completion queue full - retry once the caller collected some buffers */
+      break;
+    }
+
+    Pp2Context->TxInFlight[Pp2Context->TxInFlightHead] = NULL;
+    Pp2Context->TxInFlightHead = (Pp2Context->TxInFlightHead + 1) % MVPP2_MAX_TXD;
+    Pp2Context->TxInFlightCount--;
+    Pp2Context->TxSentCount--;
+  }
+}
+
 STATIC
 EFI_STATUS
 Pp2DxeBmPoolInit (
@@ -618,6 +702,10 @@ Pp2SnpStop (
     }
   }
 
+  /* Packets still queued to HW are abandoned */
+  Pp2DxeTxFlush(Pp2Context);
+  Pp2DxeTxReap(Pp2Context);
+
   This->Mode->State = EfiSimpleNetworkStopped;
   ReturnUnlock (SavedTpl, EFI_SUCCESS);
 }
@@ -629,7 +717,18 @@ Pp2SnpReset (
   IN BOOLEAN                     ExtendedVerification
   )
 {
-  return EFI_SUCCESS;
+  PP2DXE_CONTEXT *Pp2Context = INSTANCE_FROM_SNP(This);
+  EFI_TPL SavedTpl;
+
+  SavedTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  /* Abort transmits in progress, their buffers go back through GetStatus */
+  if (This->Mode->State == EfiSimpleNetworkInitialized) {
+    Pp2DxeTxFlush(Pp2Context);
+    Pp2DxeTxReap(Pp2Context);
+  }
+
+  ReturnUnlock (SavedTpl, EFI_SUCCESS);
 }
 
 VOID
@@ -652,6 +751,9 @@ Pp2DxeHalt (
     Mvpp2Shared->BmEnabled = FALSE;
   }
 
+  /* Make sure HW is done with every Tx buffer before it is torn down */
+  Pp2DxeTxFlush(Pp2Context);
+
   Mvpp2TxqDrainSet(Port, 0, TRUE);
   Mvpp2IngressDisable(Port);
   Mvpp2EgressDisable(Port);
@@ -684,6 +786,10 @@ Pp2SnpShutdown (
     }
   }
 
+  /* Abort transmits in progress, their buffers go back through GetStatus */
+  Pp2DxeTxFlush(Pp2Context);
+  Pp2DxeTxReap(Pp2Context);
+
   ReturnUnlock (SavedTpl, EFI_SUCCESS);
 }
 
@@ -833,6 +939,7 @@ Pp2SnpGetStatus (
   Snp->Mode->MediaPresent = LinkUp;
 
   if (TxBuf != NULL) {
+    Pp2DxeTxReap (Pp2Context);
     *TxBuf = QueueRemove (Pp2Context);
   }
 
@@ -856,9 +963,7 @@ Pp2SnpTransmit (
   MVPP2_SHARED *Mvpp2Shared = Pp2Context->Port.Priv;
   MVPP2_TX_QUEUE *AggrTxq = Mvpp2Shared->AggrTxqs;
   MVPP2_TX_DESC *TxDesc;
-  EFI_STATUS Status;
-  INTN PollingCount;
-  INTN TxSent;
+  UINTN Slot;
   UINT8 *DataPtr = Buffer;
   UINT16 EtherType;
   UINT32 State = This->Mode->State;
@@ -898,6 +1003,14 @@ Pp2SnpTransmit (
 
   EtherType = HTONS (*EtherTypePtr);
 
+  /* Make room in the in-flight ring for this packet */
+  if (Pp2Context->TxInFlightCount >= Port->TxRingSize) {
+    Pp2DxeTxReap (Pp2Context);
+    if (Pp2Context->TxInFlightCount >= Port->TxRingSize) {
+      ReturnUnlock(SavedTpl, EFI_NOT_READY);
+    }
+  }
+
   /* Fetch next descriptor */
   TxDesc = Mvpp2TxqNextDescGet(AggrTxq);
 
@@ -927,41 +1040,56 @@ Pp2SnpTransmit (
 
   InvalidateDataCacheRange (DataPtr, BufferSize);
 
+  /*
+   * Record the buffer before handing the descriptor to HW. It is recycled
+   * through the completion queue once HW reports it sent (see Pp2DxeTxReap).
+   */
+  Slot = (Pp2Context->TxInFlightHead + Pp2Context->TxInFlightCount) % MVPP2_MAX_TXD;
+  Pp2Context->TxInFlight[Slot] = Buffer;
+  Pp2Context->TxInFlightCount++;
+
   /* Issue send */
   Mvpp2AggrTxqPendDescAdd(Port, 1);
 
-  /*
-   * Egress processing:
-   * Wait until packet is passed from per-cpu aggregated queue
-   * to physical per-port TXQ.
-   */
-  PollingCount = 0;
-  TxSent = Mvpp2AggrTxqPendDescNumGet(Mvpp2Shared, 0);
-  do {
-    if (PollingCount++ > MVPP2_TX_SEND_MAX_POLLING_COUNT) {
-      DEBUG((DEBUG_ERROR, "Pp2Dxe: transmit polling failed\n"));
-      ReturnUnlock(SavedTpl, EFI_TIMEOUT);
-    }
-    TxSent = Mvpp2AggrTxqPendDescNumGet(Mvpp2Shared, 0);
-  } while (TxSent);
+  ReturnUnlock (SavedTpl, EFI_SUCCESS);
+}
 
-  /* Wait for packet to be transmitted by hardware. */
-  PollingCount = 0;
-  TxSent = Mvpp2TxqSentDescProc(Port, &Port->Txqs[0]);
-  while (!TxSent) {
-    if (PollingCount++ > MVPP2_TX_SEND_MAX_POLLING_COUNT) {
-      DEBUG((DEBUG_ERROR, "Pp2Dxe: transmit polling failed\n"));
-      ReturnUnlock(SavedTpl, EFI_TIMEOUT);
-    }
-    TxSent = Mvpp2TxqSentDescProc(Port, &Port->Txqs[0]);
+/*
+ * Take all ready RX descriptors (up to PP2DXE_RX_BATCH_SIZE) from the RXQ
+ * in one pass and stage their contents, so that the RXQ status registers
+ * are read and updated once per batch rather than once per packet.
+ */
+STATIC
+UINTN
+Pp2DxeRxBatchFill (
+  IN PP2DXE_CONTEXT *Pp2Context
+  )
+{
+  PP2DXE_PORT *Port = &Pp2Context->Port;
+  MVPP2_RX_QUEUE *Rxq = &Port->Rxqs[0];
+  MVPP2_RX_DESC *RxDesc;
+  PP2DXE_RX_PACKET *Packet;
+  INTN ReceivedPackets;
+  UINTN Index;
+
+  ReceivedPackets = Mvpp2RxqReceived(Port, Rxq->Id);
+  ReceivedPackets = MIN (ReceivedPackets, PP2DXE_RX_BATCH_SIZE);
+
+  for (Index = 0; Index < ReceivedPackets; Index++) {
+    RxDesc = Mvpp2RxqNextDescGet(Rxq);
+    Packet = &Pp2Context->RxBatch[Index];
+
+    Packet->Status = RxDesc->status;
+    Packet->DataSize = RxDesc->DataSize;
+    Packet->PhysAddr = RxDesc->BufPhysAddrKeyHash & MVPP22_ADDR_MASK;
+    Packet->VirtAddr = RxDesc->BufCookieBmQsetClsInfo & MVPP22_ADDR_MASK;
   }
 
-  /*
-   * At this point TxSent has increased - HW sent the packet
-   * Add buffer to completion queue and return.
-   */
-  Status = QueueInsert (Pp2Context, Buffer);
-  ReturnUnlock (SavedTpl, Status);
+  Pp2Context->RxBatchHead = 0;
+  Pp2Context->RxBatchCount = ReceivedPackets;
+  Pp2Context->RxBatchDone = 0;
+
+  return ReceivedPackets;
 }
 
 EFI_STATUS
@@ -976,37 +1104,30 @@ Pp2SnpReceive (
   OUT UINT16                     *EtherType OPTIONAL
   )
 {
-  INTN ReceivedPackets;
   PP2DXE_CONTEXT *Pp2Context = INSTANCE_FROM_SNP(This);
   PP2DXE_PORT *Port = &Pp2Context->Port;
   MVPP2_SHARED *Mvpp2Shared = Pp2Context->Port.Priv;
-  UINTN PhysAddr, VirtAddr;
   EFI_STATUS Status = EFI_SUCCESS;
   EFI_TPL SavedTpl;
   UINT32 StatusReg;
   INTN PoolId;
   UINTN PktLength;
   UINT8 *DataPtr;
-  MVPP2_RX_DESC *RxDesc;
+  PP2DXE_RX_PACKET *Packet;
   MVPP2_RX_QUEUE *Rxq = &Port->Rxqs[0];
 
   ASSERT (Port != NULL);
   ASSERT (Rxq != NULL);
 
   SavedTpl = gBS->RaiseTPL (TPL_CALLBACK);
-  ReceivedPackets = Mvpp2RxqReceived(Port, Rxq->Id);
 
-  if (ReceivedPackets == 0) {
+  if (Pp2Context->RxBatchCount == 0 && Pp2DxeRxBatchFill (Pp2Context) == 0) {
     ReturnUnlock(SavedTpl, EFI_NOT_READY);
   }
 
-  /* Process one packet per call */
-  RxDesc = Mvpp2RxqNextDescGet(Rxq);
-  StatusReg = RxDesc->status;
-
-  /* extract addresses from descriptor */
-  PhysAddr = RxDesc->BufPhysAddrKeyHash & MVPP22_ADDR_MASK;
-  VirtAddr = RxDesc->BufCookieBmQsetClsInfo & MVPP22_ADDR_MASK;
+  /* Hand over one staged packet per call */
+  Packet = &Pp2Context->RxBatch[Pp2Context->RxBatchHead];
+  StatusReg = Packet->Status;
 
   /* Drop packets with error or with buffer header (MC, SG) */
   if ((StatusReg & MVPP2_RXD_BUF_HDR) || (StatusReg & MVPP2_RXD_ERR_SUMMARY)) {
@@ -1015,14 +1136,14 @@ Pp2SnpReceive (
     goto drop;
   }
 
-  PktLength = (UINTN) RxDesc->DataSize - 2;
+  PktLength = (UINTN) Packet->DataSize - 2;
   if (PktLength > *BufferSize) {
     *BufferSize = PktLength;
     DEBUG((DEBUG_ERROR, "Pp2Dxe: buffer too small\n"));
     ReturnUnlock(SavedTpl, EFI_BUFFER_TOO_SMALL);
   }
 
-  CopyMem (Buffer, (VOID*) (PhysAddr + 2), PktLength);
+  CopyMem (Buffer, (VOID*) (Packet->PhysAddr + 2), PktLength);
   *BufferSize = PktLength;
 
   if (HeaderSize != NULL) {
@@ -1051,10 +1172,17 @@ Pp2SnpReceive (
 drop:
   /* Refill: pass packet back to BM */
   PoolId = (StatusReg & MVPP2_RXD_BM_POOL_ID_MASK) >> MVPP2_RXD_BM_POOL_ID_OFFS;
-  Mvpp2BmPoolPut(Mvpp2Shared, PoolId, PhysAddr, VirtAddr);
+  Mvpp2BmPoolPut(Mvpp2Shared, PoolId, Packet->PhysAddr, Packet->VirtAddr);
 
-  /* Update counters with 1 packet received and 1 packet refilled */
-  Mvpp2RxqStatusUpdate(Port, Rxq->Id, 1, 1);
+  Pp2Context->RxBatchHead++;
+  Pp2Context->RxBatchCount--;
+  Pp2Context->RxBatchDone++;
+
+  /* Update counters once the whole batch has been received and refilled */
+  if (Pp2Context->RxBatchCount == 0) {
+    Mvpp2RxqStatusUpdate(Port, Rxq->Id, Pp2Context->RxBatchDone, Pp2Context->RxBatchDone);
+    Pp2Context->RxBatchDone = 0;
+  }
 
   ReturnUnlock(SavedTpl, Status);
 }
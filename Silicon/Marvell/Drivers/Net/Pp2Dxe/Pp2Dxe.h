@@ -44,7 +44,6 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define Mvpp2Fls(v)                         1
 #define Mvpp2IsBroadcastEtherAddr(da)       1
 #define Mvpp2IsMulticastEtherAddr(da)       1
-#define Mvpp2Prefetch(v)                    do {} while(0);
 #define Mvpp2Printf(...)                    do {} while(0);
 #define Mvpp2SwapVariables(a,b)             do { typeof(a) __tmp = (a); (a) = (b); (b) = __tmp; } while (0)
 #define Mvpp2SwapBytes16(x)                 SwapBytes16((x))
@@ -143,11 +142,19 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define MTU                               1500
 
 /*
- * Maximum retries of checking, wheter HW really sent the packet
- * after it was done is software.
+ * Number of consecutive checks of the TXQ sent counter without progress,
+ * after which the packets in flight are considered lost and reclaimed.
  */
 #define MVPP2_TX_SEND_MAX_POLLING_COUNT   10000
 
+/*
+ * Each port may have up to a physical TXQ worth of packets in flight. All ports
+ * share the aggregated TXQ, which must be able to hold all of them at once.
+ */
+#if MVPP2_MAX_TXD * MVPP2_MAX_PORT >= MVPP2_AGGR_TXQ_SIZE
+#error "Aggregated TXQ too small for the number of in-flight Tx descriptors"
+#endif
+
 /* Structures */
 typedef struct {
   /* Physical number of this Tx queue */
@@ -323,6 +330,17 @@ typedef struct {
   EFI_DEVICE_PATH_PROTOCOL  End;
 } PP2_DEVICE_PATH;
 
+/* RX descriptor contents staged by Receive, see Pp2DxeRxBatchFill */
+typedef struct {
+  UINTN  PhysAddr;
+  UINTN  VirtAddr;
+  UINT32 Status;
+  UINT16 DataSize;
+} PP2DXE_RX_PACKET;
+
+/* Maximum number of RX descriptors taken from the RXQ at once */
+#define PP2DXE_RX_BATCH_SIZE 16
+
 #define QUEUE_DEPTH 64
 typedef struct {
   UINT32                      Signature;
@@ -338,6 +356,20 @@ typedef struct {
   VOID                        *CompletionQueue[QUEUE_DEPTH];
   UINTN                       CompletionQueueHead;
   UINTN                       CompletionQueueTail;
+  /* Buffers handed to HW by Transmit, in submission order */
+  VOID                        *TxInFlight[MVPP2_MAX_TXD];
+  UINTN                       TxInFlightHead;
+  UINTN                       TxInFlightCount;
+  /* Number of TxInFlight entries (from the head) already sent by HW */
+  UINTN                       TxSentCount;
+  /* Checks of the sent counter in a row that found nothing new */
+  UINTN                       TxStallCount;
+  /* Received packets not yet handed to the caller */
+  PP2DXE_RX_PACKET            RxBatch[PP2DXE_RX_BATCH_SIZE];
+  UINTN                       RxBatchHead;
+  UINTN                       RxBatchCount;
+  /* Number of descriptors of the current batch already processed */
+  UINTN                       RxBatchDone;
   EFI_EVENT                   EfiExitBootServicesEvent;
   PP2_DEVICE_PATH             *DevicePath;
   EFI_ADAPTER_INFORMATION_PROTOCOL Aip;
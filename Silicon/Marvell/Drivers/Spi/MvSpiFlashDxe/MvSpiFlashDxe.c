@@ -148,28 +148,40 @@ SpiFlashBank (
   return BankSel;
 }
 
+STATIC
+UINTN
+MvSpiFlashGetEraseSize (
+  IN  SPI_DEVICE *Slave,
+  OUT UINT8 *EraseCmd
+  )
+{
+  if (Slave->Info->Flags & NOR_FLASH_ERASE_4K) {
+    *EraseCmd = CMD_ERASE_4K;
+    return SIZE_4KB;
+  } else if (Slave->Info->Flags & NOR_FLASH_ERASE_32K) {
+    *EraseCmd = CMD_ERASE_32K;
+    return SIZE_32KB;
+  }
+
+  *EraseCmd = CMD_ERASE_64K;
+  return Slave->Info->SectorSize;
+}
+
+STATIC
 EFI_STATUS
-MvSpiFlashErase (
+MvSpiFlashEraseWithCmd (
   IN SPI_DEVICE *Slave,
   IN UINTN Offset,
-  IN UINTN Length
+  IN UINTN Length,
+  IN UINT8 EraseCmd,
+  IN UINTN EraseSize
   )
 {
   EFI_STATUS Status;
   UINT32 EraseAddr;
-  UINTN EraseSize;
   UINT8 Cmd[5];
 
-  if (Slave->Info->Flags & NOR_FLASH_ERASE_4K) {
-    Cmd[0] = CMD_ERASE_4K;
-    EraseSize = SIZE_4KB;
-  } else if (Slave->Info->Flags & NOR_FLASH_ERASE_32K) {
-    Cmd[0] = CMD_ERASE_32K;
-    EraseSize = SIZE_32KB;
-  } else {
-    Cmd[0] = CMD_ERASE_64K;
-    EraseSize = Slave->Info->SectorSize;
-  }
+  Cmd[0] = EraseCmd;
 
   // Check input parameters
   if (Offset % EraseSize || Length % EraseSize) {
@@ -198,6 +210,21 @@ MvSpiFlashErase (
   return EFI_SUCCESS;
 }
 
+EFI_STATUS
+MvSpiFlashErase (
+  IN SPI_DEVICE *Slave,
+  IN UINTN Offset,
+  IN UINTN Length
+  )
+{
+  UINTN EraseSize;
+  UINT8 EraseCmd;
+
+  EraseSize = MvSpiFlashGetEraseSize (Slave, &EraseCmd);
+
+  return MvSpiFlashEraseWithCmd (Slave, Offset, Length, EraseCmd, EraseSize);
+}
+
 EFI_STATUS
 MvSpiFlashRead (
   IN SPI_DEVICE   *Slave,
@@ -280,6 +307,73 @@ MvSpiFlashWrite (
   return EFI_SUCCESS;
 }
 
+/**
+  Check whether going from OldData to NewData needs an erase, that is
+  whether any bit has to go from 0 to 1.
+**/
+STATIC
+BOOLEAN
+MvSpiFlashNeedsErase (
+  IN UINT8 *OldData,
+  IN UINT8 *NewData,
+  IN UINTN Length
+  )
+{
+  UINTN Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    if ((OldData[Index] & NewData[Index]) != NewData[Index]) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Program only the pages whose contents change. No bit may need to go
+  from 0 to 1 in any of them.
+**/
+STATIC
+EFI_STATUS
+MvSpiFlashProgramChanged (
+  IN SPI_DEVICE *Slave,
+  IN UINT32 Offset,
+  IN UINTN Length,
+  IN UINT8 *OldData,
+  IN UINT8 *NewData
+  )
+{
+  EFI_STATUS Status;
+  UINTN PageSize;
+  UINTN Index;
+  UINTN ChunkLength;
+
+  PageSize = Slave->Info->PageSize;
+
+  for (Index = 0; Index < Length; Index += ChunkLength) {
+    ChunkLength = MIN (Length - Index, PageSize - ((Offset + Index) % PageSize));
+    if (CompareMem (&OldData[Index], &NewData[Index], ChunkLength) == 0) {
+      continue;
+    }
+
+    Status = MvSpiFlashWrite (Slave, Offset + Index, ChunkLength, &NewData[Index]);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Update one sector, touching the flash only where the contents change:
+  identical sectors are skipped, 1->0 only changes are programmed in
+  place, and only the erase units that need it are erased. A sector
+  where every unit needs erasing is erased with a single sector erase.
+
+  TmpBuf must hold two sectors.
+**/
 STATIC
 EFI_STATUS
 MvSpiFlashUpdateBlock (
@@ -292,36 +386,78 @@ MvSpiFlashUpdateBlock (
   )
 {
   EFI_STATUS Status;
+  UINT8 *OldData;
+  UINT8 *NewData;
+  UINTN UnitSize;
+  UINTN UnitCount;
+  UINTN EraseCount;
+  UINTN Index;
+  UINT8 EraseCmd;
 
-  // Read backup
-  Status = MvSpiFlashRead (Slave, Offset, EraseSize, TmpBuf);
-    if (EFI_ERROR (Status)) {
-      DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while reading old data\n"));
-      return Status;
-    }
+  OldData = TmpBuf;
+  NewData = TmpBuf + EraseSize;
 
-  // Erase entire sector
-  Status = MvSpiFlashErase (Slave, Offset, EraseSize);
+  // Read current contents
+  Status = MvSpiFlashRead (Slave, Offset, EraseSize, OldData);
   if (EFI_ERROR (Status)) {
-      DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while erasing block\n"));
-      return Status;
-    }
+    DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while reading old data\n"));
+    return Status;
+  }
 
-  // Write new data
-  MvSpiFlashWrite (Slave, Offset, ToUpdate, Buf);
-  if (EFI_ERROR (Status)) {
-      DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while writing new data\n"));
-      return Status;
+  if (CompareMem (OldData, Buf, ToUpdate) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  // New data followed by what is kept from the old sector
+  CopyMem (NewData, Buf, ToUpdate);
+  CopyMem (NewData + ToUpdate, OldData + ToUpdate, EraseSize - ToUpdate);
+
+  UnitSize = MvSpiFlashGetEraseSize (Slave, &EraseCmd);
+  if (EraseSize % UnitSize != 0) {
+    UnitSize = EraseSize;
+    EraseCmd = CMD_ERASE_64K;
+  }
+  UnitCount = EraseSize / UnitSize;
+
+  EraseCount = 0;
+  for (Index = 0; Index < UnitCount; Index++) {
+    if (MvSpiFlashNeedsErase (OldData + Index * UnitSize,
+          NewData + Index * UnitSize, UnitSize)) {
+      EraseCount++;
     }
+  }
 
-  // Write backup
-  if (ToUpdate != EraseSize) {
-    Status = MvSpiFlashWrite (Slave, Offset + ToUpdate, EraseSize - ToUpdate,
-      &TmpBuf[ToUpdate]);
+  if (EraseCount == UnitCount && UnitCount > 1) {
+    // Whole sector changes: one sector erase instead of many small ones
+    Status = MvSpiFlashEraseWithCmd (Slave, Offset, EraseSize,
+               CMD_ERASE_64K, EraseSize);
     if (EFI_ERROR (Status)) {
-      DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while writing backup\n"));
+      DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while erasing block\n"));
       return Status;
     }
+    SetMem (OldData, EraseSize, 0xFF);
+  } else if (EraseCount != 0) {
+    for (Index = 0; Index < UnitCount; Index++) {
+      if (!MvSpiFlashNeedsErase (OldData + Index * UnitSize,
+             NewData + Index * UnitSize, UnitSize)) {
+        continue;
+      }
+
+      Status = MvSpiFlashEraseWithCmd (Slave, Offset + Index * UnitSize,
+                 UnitSize, EraseCmd, UnitSize);
+      if (EFI_ERROR (Status)) {
+        DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while erasing block\n"));
+        return Status;
+      }
+      SetMem (OldData + Index * UnitSize, UnitSize, 0xFF);
+    }
+  }
+
+  // Write new data
+  Status = MvSpiFlashProgramChanged (Slave, Offset, EraseSize, OldData, NewData);
+  if (EFI_ERROR (Status)) {
+    DEBUG((DEBUG_ERROR, "SpiFlash: Update: Error while writing new data\n"));
+    return Status;
   }
 
   return EFI_SUCCESS;
@@ -343,7 +479,7 @@ MvSpiFlashUpdate (
 
   End = Buf + ByteCount;
 
-  TmpBuf = (UINT8 *)AllocateZeroPool (SectorSize);
+  TmpBuf = (UINT8 *)AllocateZeroPool (2 * SectorSize);
   if (TmpBuf == NULL) {
     DEBUG((DEBUG_ERROR, "SpiFlash: Cannot allocate memory\n"));
     return EFI_OUT_OF_RESOURCES;
@@ -391,7 +527,7 @@ MvSpiFlashUpdateWithProgress (
   SectorNum = (ByteCount / SectorSize) + 1;
   ToUpdate = SectorSize;
 
-  TmpBuf = (UINT8 *)AllocateZeroPool (SectorSize);
+  TmpBuf = (UINT8 *)AllocateZeroPool (2 * SectorSize);
   if (TmpBuf == NULL) {
     DEBUG ((DEBUG_ERROR, "%a: Cannot allocate memory\n", __FUNCTION__));
     return EFI_OUT_OF_RESOURCES;
@@ -0,0 +1,308 @@
+/** @file
+  Unit tests of MvI2cDxe through EFI_I2C_MASTER_PROTOCOL.
+
+  The tests run on the target, against the first I2C controller that has a
+  device listed by its EFI_I2C_ENUMERATE_PROTOCOL. The device is only read
+  from, at its current address, so its contents are left as they were.
+
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Protocol/I2cEnumerate.h>
+#include <Protocol/I2cMaster.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME      "MvI2cDxe Unit Tests"
+#define UNIT_TEST_APP_VERSION   "1.0"
+
+//
+// Reserved for future purposes by the I2C specification, so no device ACKs it
+//
+#define ABSENT_SLAVE_ADDRESS    0x7C
+
+#define LONG_READ_LENGTH        64
+
+//
+// A long read takes about 6 ms on the bus at 100 kHz. Allow for a few timer
+// ticks on top of that, but not one tick per byte.
+//
+#define LONG_READ_LIMIT_US      200000
+
+typedef struct {
+  UINTN             OperationCount;
+  EFI_I2C_OPERATION Operation[1];
+} I2C_READ_PACKET;
+
+typedef struct {
+  EFI_I2C_MASTER_PROTOCOL   *I2cMaster;
+  UINTN                     SlaveAddress;
+} MV_I2C_TEST_CONTEXT;
+
+MV_I2C_TEST_CONTEXT         mTestContext;
+UINT8                       mBuffer[LONG_READ_LENGTH];
+
+VOID
+InitializeReadPacket (
+  OUT I2C_READ_PACKET   *Packet,
+  IN  UINT32            Length
+  )
+{
+  Packet->OperationCount = 1;
+  Packet->Operation[0].Flags = I2C_FLAG_READ;
+  Packet->Operation[0].LengthInBytes = Length;
+  Packet->Operation[0].Buffer = mBuffer;
+}
+
+/**
+  Return the time elapsed since the performance counter read Start, in us.
+**/
+UINT64
+ElapsedMicroSeconds (
+  IN UINT64   Start
+  )
+{
+  UINT64  CounterStart;
+  UINT64  CounterEnd;
+  UINT64  Ticks;
+
+  GetPerformanceCounterProperties (&CounterStart, &CounterEnd);
+  if (CounterStart < CounterEnd) {
+    Ticks = GetPerformanceCounter () - Start;
+  } else {
+    Ticks = Start - GetPerformanceCounter ();
+  }
+  return DivU64x32 (GetTimeInNanoSecond (Ticks), 1000);
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+ResetSucceedsWhenIdle (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MV_I2C_TEST_CONTEXT   *Test;
+
+  Test = (MV_I2C_TEST_CONTEXT *) Context;
+  UT_ASSERT_NOT_EFI_ERROR (Test->I2cMaster->Reset (Test->I2cMaster));
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+AbsentDeviceDoesNotRespond (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MV_I2C_TEST_CONTEXT   *Test;
+  I2C_READ_PACKET       Packet;
+
+  Test = (MV_I2C_TEST_CONTEXT *) Context;
+  InitializeReadPacket (&Packet, 1);
+  UT_ASSERT_STATUS_EQUAL (
+    Test->I2cMaster->StartRequest (
+                       Test->I2cMaster,
+                       ABSENT_SLAVE_ADDRESS,
+                       (EFI_I2C_REQUEST_PACKET *) &Packet,
+                       NULL,
+                       NULL
+                       ),
+    EFI_NO_RESPONSE
+    );
+  return UNIT_TEST_PASSED;
+}
+
+UNIT_TEST_STATUS
+EFIAPI
+EmptyRequestCompletesInline (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MV_I2C_TEST_CONTEXT     *Test;
+  EFI_I2C_REQUEST_PACKET  Packet;
+  EFI_EVENT               Event;
+  EFI_STATUS              I2cStatus;
+  EFI_STATUS              Status;
+
+  Test = (MV_I2C_TEST_CONTEXT *) Context;
+  Packet.OperationCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CreateEvent (0, TPL_NOTIFY, NULL, NULL, &Event));
+
+  I2cStatus = EFI_NOT_READY;
+  Status = Test->I2cMaster->StartRequest (Test->I2cMaster, Test->SlaveAddress, &Packet, Event, &I2cStatus);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CheckEvent (Event));
+  UT_ASSERT_NOT_EFI_ERROR (I2cStatus);
+
+  gBS->CloseEvent (Event);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A one byte read is shorter than what a single poll of the queue covers, so
+  the driver has to complete it before StartRequest() returns.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ShortReadCompletesInline (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MV_I2C_TEST_CONTEXT   *Test;
+  I2C_READ_PACKET       Packet;
+  EFI_EVENT             Event;
+  EFI_STATUS            I2cStatus;
+  EFI_STATUS            Status;
+
+  Test = (MV_I2C_TEST_CONTEXT *) Context;
+  InitializeReadPacket (&Packet, 1);
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CreateEvent (0, TPL_NOTIFY, NULL, NULL, &Event));
+
+  I2cStatus = EFI_NOT_READY;
+  Status = Test->I2cMaster->StartRequest (
+                              Test->I2cMaster,
+                              Test->SlaveAddress,
+                              (EFI_I2C_REQUEST_PACKET *) &Packet,
+                              Event,
+                              &I2cStatus
+                              );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CheckEvent (Event));
+  UT_ASSERT_NOT_EFI_ERROR (I2cStatus);
+
+  gBS->CloseEvent (Event);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A long read spans timer ticks. It must still complete in about its time on
+  the bus, rather than one tick per byte.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LongReadIsNotTickBound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MV_I2C_TEST_CONTEXT   *Test;
+  I2C_READ_PACKET       Packet;
+  EFI_EVENT             Event;
+  EFI_STATUS            I2cStatus;
+  EFI_STATUS            Status;
+  UINTN                 Index;
+  UINT64                Start;
+  UINT64                Elapsed;
+
+  Test = (MV_I2C_TEST_CONTEXT *) Context;
+  InitializeReadPacket (&Packet, LONG_READ_LENGTH);
+  UT_ASSERT_NOT_EFI_ERROR (gBS->CreateEvent (0, TPL_NOTIFY, NULL, NULL, &Event));
+
+  I2cStatus = EFI_NOT_READY;
+  Start = GetPerformanceCounter ();
+  Status = Test->I2cMaster->StartRequest (
+                              Test->I2cMaster,
+                              Test->SlaveAddress,
+                              (EFI_I2C_REQUEST_PACKET *) &Packet,
+                              Event,
+                              &I2cStatus
+                              );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_NOT_EFI_ERROR (gBS->WaitForEvent (1, &Event, &Index));
+  Elapsed = ElapsedMicroSeconds (Start);
+  UT_LOG_INFO ("%d byte read took %ld us\n", LONG_READ_LENGTH, Elapsed);
+
+  UT_ASSERT_NOT_EFI_ERROR (I2cStatus);
+  UT_ASSERT_TRUE (Elapsed < LONG_READ_LIMIT_US);
+
+  gBS->CloseEvent (Event);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Find the first I2C controller with an enumerated device, and take the first
+  device on it to test with.
+**/
+EFI_STATUS
+InitializeTestContext (
+  OUT MV_I2C_TEST_CONTEXT   *Test
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_HANDLE                  *Handles;
+  UINTN                       HandleCount;
+  UINTN                       Index;
+  EFI_I2C_ENUMERATE_PROTOCOL  *I2cEnumerate;
+  CONST EFI_I2C_DEVICE        *Device;
+
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiI2cMasterProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = EFI_NOT_FOUND;
+  for (Index = 0; Index < HandleCount; Index++) {
+    if (EFI_ERROR (gBS->HandleProtocol (Handles[Index], &gEfiI2cEnumerateProtocolGuid, (VOID **) &I2cEnumerate))) {
+      continue;
+    }
+    Device = NULL;
+    if (EFI_ERROR (I2cEnumerate->Enumerate (I2cEnumerate, &Device)) || Device == NULL) {
+      continue;
+    }
+    Test->SlaveAddress = Device->SlaveAddressArray[0];
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiI2cMasterProtocolGuid, (VOID **) &Test->I2cMaster);
+    break;
+  }
+
+  FreePool (Handles);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+MvI2cUnitTestEntrypoint (
+  IN EFI_HANDLE           ImageHandle,
+  IN EFI_SYSTEM_TABLE     *SystemTable
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      Suite;
+
+  Framework = NULL;
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = InitializeTestContext (&mTestContext);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "No I2C device to test with - %r\n", Status));
+    return Status;
+  }
+
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  Status = CreateUnitTestSuite (&Suite, Framework, "StartRequest", "Marvell.MvI2cDxe", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  AddTestCase (Suite, "Reset succeeds when idle", "Reset", ResetSucceedsWhenIdle, NULL, NULL, &mTestContext);
+  AddTestCase (Suite, "Absent device does not respond", "Absent", AbsentDeviceDoesNotRespond, NULL, NULL, &mTestContext);
+  AddTestCase (Suite, "Empty request completes inline", "Empty", EmptyRequestCompletesInline, NULL, NULL, &mTestContext);
+  AddTestCase (Suite, "Short read completes inline", "ShortRead", ShortReadCompletesInline, NULL, NULL, &mTestContext);
+  AddTestCase (Suite, "Long read is not bound to the timer tick", "LongRead", LongReadIsNotTickBound, NULL, NULL, &mTestContext);
+
+  Status = RunAllTestSuites (Framework);
+
+Done:
+  if (Framework != NULL) {
+    FreeUnitTestFramework (Framework);
+  }
+  return Status;
+}
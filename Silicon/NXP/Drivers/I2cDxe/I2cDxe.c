@@ -12,6 +12,7 @@
 #include <Library/DevicePathLib.h>
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
@@ -80,9 +81,35 @@ GetClkDivIndex (
   return (ARRAY_SIZE (mClkDiv) - 1);
 }
 
+/**
+  Scale the status polling budget to the bus clock rate
+
+  @param   I2c            Pointer to the I2c master
+  @param   BusClockRate   SCL frequency in Hz
+
+**/
+STATIC
+VOID
+SetPollBudget (
+  IN  NXP_I2C_MASTER      *I2c,
+  IN  UINTN               BusClockRate
+  )
+{
+  if (BusClockRate == 0) {
+    BusClockRate = I2C_DEFAULT_BUS_CLOCK;
+  }
+
+  I2c->PollDelay = 1000000 / (BusClockRate * I2C_POLLS_PER_BIT);
+  if (I2c->PollDelay == 0) {
+    I2c->PollDelay = 1;
+  }
+  I2c->PollRetries = I2C_POLL_BYTE_BUDGET * 9 * I2C_POLLS_PER_BIT;
+}
+
 /**
   Function used to check if i2c is in mentioned state or not
 
+  @param   I2c            Pointer to the I2c master
   @param   I2cRegs        Pointer to I2C registers
   @param   State          i2c state need to be checked
 
@@ -94,14 +121,15 @@ GetClkDivIndex (
 STATIC
 EFI_STATUS
 WaitForI2cState (
+  IN  NXP_I2C_MASTER      *I2c,
   IN  I2C_REGS            *I2cRegs,
   IN  UINT32              State
   )
 {
   UINT8                   CurrState;
-  UINT64                  Count;
+  UINTN                   Count;
 
-  for (Count = 0; Count < I2C_STATE_RETRIES; Count++) {
+  for (Count = 0; Count <= I2c->PollRetries; Count++) {
     MemoryFence ();
     CurrState = MmioRead8 ((UINTN)&I2cRegs->I2cSr);
     if (CurrState & I2C_SR_IAL) {
@@ -112,6 +140,8 @@ WaitForI2cState (
     if ((CurrState & (State >> 8)) == (UINT8)State) {
       return CurrState;
     }
+
+    MicroSecondDelay (I2c->PollDelay);
   }
 
   return EFI_TIMEOUT;
@@ -120,6 +150,7 @@ WaitForI2cState (
 /**
   Function to transfer byte on i2c
 
+  @param   I2c            Pointer to the I2c master
   @param   I2cRegs        Pointer to i2c registers
   @param   Byte           Byte to be transferred on i2c bus
 
@@ -132,6 +163,7 @@ WaitForI2cState (
 STATIC
 EFI_STATUS
 TransferByte (
+  IN  NXP_I2C_MASTER      *I2c,
   IN  I2C_REGS            *I2cRegs,
   IN  UINT8               Byte
   )
@@ -141,7 +173,7 @@ TransferByte (
   MmioWrite8 ((UINTN)&I2cRegs->I2cSr, I2C_SR_IIF_CLEAR);
   MmioWrite8 ((UINTN)&I2cRegs->I2cDr, Byte);
 
-  RetVal = WaitForI2cState (I2cRegs, IIF);
+  RetVal = WaitForI2cState (I2c, I2cRegs, IIF);
   if ((RetVal == EFI_TIMEOUT) || (RetVal == EFI_NOT_READY)) {
     return RetVal;
   }
@@ -156,6 +188,7 @@ TransferByte (
 /**
   Function to stop transaction on i2c bus
 
+  @param   I2c              Pointer to the I2c master
   @param   I2cRegs          Pointer to i2c registers
 
   @retval  EFI_NOT_READY    Arbitration was lost
@@ -166,6 +199,7 @@ TransferByte (
 STATIC
 EFI_STATUS
 I2cStop (
+  IN  NXP_I2C_MASTER       *I2c,
   IN  I2C_REGS             *I2cRegs
   )
 {
@@ -177,9 +211,9 @@ I2cStop (
   Temp &= ~(I2C_CR_MSTA | I2C_CR_MTX);
   MmioWrite8 ((UINTN)&I2cRegs->I2cCr, Temp);
 
-  RetVal = WaitForI2cState (I2cRegs, BUS_IDLE);
+  RetVal = WaitForI2cState (I2c, I2cRegs, BUS_IDLE);
 
-  if (RetVal < 0) {
+  if ((RetVal == EFI_TIMEOUT) || (RetVal == EFI_NOT_READY)) {
     return RetVal;
   } else {
     return EFI_SUCCESS;
@@ -187,13 +221,12 @@ I2cStop (
 }
 
 /**
-  Function to send start signal, Chip Address and
-  memory offset
+  Function to send start signal and Chip Address
 
+  @param   I2c             Pointer to the I2c master
   @param   I2cRegs         Pointer to i2c base registers
   @param   Chip            Chip Address
-  @param   Offset          Slave memory's offset
-  @param   AddressLength   length of chip address
+  @param   Read            TRUE to address the chip for reading
 
   @retval  EFI_NOT_READY   Arbitration lost
   @retval  EFI_TIMEOUT     Failed to initialize data transfer in predefined time
@@ -204,10 +237,10 @@ I2cStop (
 STATIC
 EFI_STATUS
 InitTransfer (
+  IN  NXP_I2C_MASTER       *I2c,
   IN  I2C_REGS             *I2cRegs,
   IN  UINT8                Chip,
-  IN  UINT32               Offset,
-  IN  INT32                AddressLength
+  IN  BOOLEAN              Read
   )
 {
   UINT32                   Temp;
@@ -223,7 +256,7 @@ InitTransfer (
   }
 
   MmioWrite8 ((UINTN)&I2cRegs->I2cSr, I2C_SR_IIF_CLEAR);
-  RetVal = WaitForI2cState (I2cRegs, BUS_IDLE);
+  RetVal = WaitForI2cState (I2c, I2cRegs, BUS_IDLE);
   if ((RetVal == EFI_TIMEOUT) || (RetVal == EFI_NOT_READY)) {
     return RetVal;
   }
@@ -234,7 +267,7 @@ InitTransfer (
   Temp |= I2C_CR_MSTA;
   MmioWrite8 ((UINTN)&I2cRegs->I2cCr, Temp);
 
-  RetVal = WaitForI2cState (I2cRegs, BUS_BUSY);
+  RetVal = WaitForI2cState (I2c, I2cRegs, BUS_BUSY);
   if ((RetVal == EFI_TIMEOUT) || (RetVal == EFI_NOT_READY)) {
     return RetVal;
   }
@@ -243,19 +276,7 @@ InitTransfer (
   MmioWrite8 ((UINTN)&I2cRegs->I2cCr, Temp);
 
   // write slave Address
-  RetVal = TransferByte (I2cRegs, Chip << 1);
-  if (RetVal != EFI_SUCCESS) {
-    return RetVal;
-  }
-
-  if (AddressLength >= 0) {
-    while (AddressLength--) {
-      RetVal = TransferByte (I2cRegs, (Offset >> (AddressLength * 8)) & 0xff);
-      if (RetVal != EFI_SUCCESS)
-        return RetVal;
-    }
-  }
-  return EFI_SUCCESS;
+  return TransferByte (I2c, I2cRegs, (Chip << 1) | (Read ? 1 : 0));
 }
 
 /**
@@ -278,10 +299,10 @@ I2cBusIdle (
 /**
   Function to initiate data transfer on i2c bus
 
+  @param   I2c             Pointer to the I2c master
   @param   I2cRegs         Pointer to i2c base registers
   @param   Chip            Chip Address
-  @param   Offset          Slave memory's offset
-  @param   AddressLength   length of chip address
+  @param   Read            TRUE to address the chip for reading
 
   @retval  EFI_NOT_READY   Arbitration lost
   @retval  EFI_TIMEOUT     Failed to initialize data transfer in predefined time
@@ -292,22 +313,22 @@ I2cBusIdle (
 STATIC
 EFI_STATUS
 InitDataTransfer (
+  IN  NXP_I2C_MASTER       *I2c,
   IN  I2C_REGS             *I2cRegs,
   IN  UINT8                Chip,
-  IN  UINT32               Offset,
-  IN  INT32                AddressLength
+  IN  BOOLEAN              Read
   )
 {
   EFI_STATUS               RetVal;
   INT32                    Retry;
 
   for (Retry = 0; Retry < RETRY_COUNT; Retry++) {
-    RetVal = InitTransfer (I2cRegs, Chip, Offset, AddressLength);
+    RetVal = InitTransfer (I2c, I2cRegs, Chip, Read);
     if (RetVal == EFI_SUCCESS) {
       return EFI_SUCCESS;
     }
 
-    I2cStop (I2cRegs);
+    I2cStop (I2c, I2cRegs);
 
     if (EFI_NOT_FOUND == RetVal) {
       return RetVal;
@@ -326,53 +347,69 @@ InitDataTransfer (
 }
 
 /**
-  Function to read data using i2c bus
+  Function to send a repeated start signal and Chip Address
 
-  @param   BaseAddr        I2c Controller Base Address
-  @param   Chip            Address of slave device from where data to be read
-  @param   Offset          Offset of slave memory
-  @param   AddressLength   Address length of slave
-  @param   Buffer          A pointer to the destination buffer for the data
-  @param   Len             Length of data to be read
+  @param   I2c             Pointer to the I2c master
+  @param   I2cRegs         Pointer to i2c base registers
+  @param   Chip            Chip Address
+  @param   Read            TRUE to address the chip for reading
 
   @retval  EFI_NOT_READY   Arbitration lost
-  @retval  EFI_TIMEOUT     Failed to initialize data transfer in predefined time
+  @retval  EFI_TIMEOUT     Failed to send the address in predefined time
   @retval  EFI_NOT_FOUND   ACK was not recieved
-  @retval  EFI_SUCCESS     Read was successful
+  @retval  EFI_SUCCESS     Repeated start was successful
 
 **/
 STATIC
 EFI_STATUS
-I2cDataRead (
-  IN  UINTN                BaseAddr,
+RepeatedStart (
+  IN  NXP_I2C_MASTER       *I2c,
+  IN  I2C_REGS             *I2cRegs,
   IN  UINT8                Chip,
-  IN  UINT32               Offset,
-  IN  UINT32               AddressLength,
-  IN  UINT8                *Buffer,
-  IN  UINT32               Len
+  IN  BOOLEAN              Read
   )
 {
-  EFI_STATUS               RetVal;
   UINT32                   Temp;
-  INT32                    I;
-  I2C_REGS                 *I2cRegs;
-
-  I2cRegs = (I2C_REGS *)(BaseAddr);
-
-  RetVal = InitDataTransfer (I2cRegs, Chip, Offset, AddressLength);
-  if (RetVal != EFI_SUCCESS) {
-    return RetVal;
-  }
 
   Temp = MmioRead8 ((UINTN)&I2cRegs->I2cCr);
-  Temp |= I2C_CR_RSTA;
+  Temp |= I2C_CR_RSTA | I2C_CR_MTX | I2C_CR_TX_NO_AK;
   MmioWrite8 ((UINTN)&I2cRegs->I2cCr, Temp);
 
-  RetVal = TransferByte (I2cRegs, (Chip << 1) | 1);
-  if (RetVal != EFI_SUCCESS) {
-    I2cStop (I2cRegs);
-    return RetVal;
-  }
+  return TransferByte (I2c, I2cRegs, (Chip << 1) | (Read ? 1 : 0));
+}
+
+/**
+  Function to read data from an addressed chip
+
+  The data register is read right after each byte is received. The receive
+  of the last byte ends with a STOP, or with the bus switched back to
+  transmit mode when a repeated start follows, so the controller does not
+  clock out another byte.
+
+  @param   I2c             Pointer to the I2c master
+  @param   I2cRegs         Pointer to i2c base registers
+  @param   Buffer          A pointer to the destination buffer for the data
+  @param   Len             Length of data to be read
+  @param   Last            TRUE if this is the last operation of the request
+
+  @retval  EFI_NOT_READY   Arbitration lost
+  @retval  EFI_TIMEOUT     Failed to receive data in predefined time
+  @retval  EFI_SUCCESS     Read was successful
+
+**/
+STATIC
+EFI_STATUS
+I2cDataRead (
+  IN  NXP_I2C_MASTER       *I2c,
+  IN  I2C_REGS             *I2cRegs,
+  OUT UINT8                *Buffer,
+  IN  UINT32               Len,
+  IN  BOOLEAN              Last
+  )
+{
+  EFI_STATUS               RetVal;
+  UINT32                   Temp;
+  UINT32                   I;
 
   // setup bus to read data
   Temp = MmioRead8 ((UINTN)&I2cRegs->I2cCr);
@@ -388,17 +425,22 @@ I2cDataRead (
   MmioRead8 ((UINTN)&I2cRegs->I2cDr);
 
   for (I = 0; I < Len; I++) {
-    RetVal = WaitForI2cState (I2cRegs, IIF);
+    RetVal = WaitForI2cState (I2c, I2cRegs, IIF);
     if ((RetVal == EFI_TIMEOUT) || (RetVal == EFI_NOT_READY)) {
-       I2cStop (I2cRegs);
-       return RetVal;
+      return RetVal;
     }
     //
-    // It must generate STOP before read I2DR to prevent
-    // controller from generating another clock cycle
+    // It must generate STOP (or switch to transmit mode) before read I2DR
+    // to prevent controller from generating another clock cycle
     //
     if (I == (Len - 1)) {
-      I2cStop (I2cRegs);
+      if (Last) {
+        I2cStop (I2c, I2cRegs);
+      } else {
+        Temp = MmioRead8 ((UINTN)&I2cRegs->I2cCr);
+        Temp |= I2C_CR_MTX;
+        MmioWrite8 ((UINTN)&I2cRegs->I2cCr, Temp);
+      }
     } else if (I == (Len - 2)) {
       Temp = MmioRead8 ((UINTN)&I2cRegs->I2cCr);
       Temp |= I2C_CR_TX_NO_AK;
@@ -408,59 +450,43 @@ I2cDataRead (
     Buffer[I] = MmioRead8 ((UINTN)&I2cRegs->I2cDr);
   }
 
-  I2cStop (I2cRegs);
-
   return EFI_SUCCESS;
 }
 
 /**
-  Function to write data using i2c bus
+  Function to write data to an addressed chip
 
-  @param   BaseAddr        I2c Controller Base Address
-  @param   Chip            Address of slave device where data to be written
-  @param   Offset          Offset of slave memory
-  @param   AddressLength   Address length of slave
+  @param   I2c             Pointer to the I2c master
+  @param   I2cRegs         Pointer to i2c base registers
   @param   Buffer          A pointer to the source buffer for the data
   @param   Len             Length of data to be write
 
   @retval  EFI_NOT_READY   Arbitration lost
-  @retval  EFI_TIMEOUT     Failed to initialize data transfer in predefined time
+  @retval  EFI_TIMEOUT     Failed to send data in predefined time
   @retval  EFI_NOT_FOUND   ACK was not recieved
-  @retval  EFI_SUCCESS     Read was successful
+  @retval  EFI_SUCCESS     Write was successful
 
 **/
 STATIC
 EFI_STATUS
 I2cDataWrite (
-  IN  UINTN                BaseAddr,
-  IN  UINT8                Chip,
-  IN  UINT32               Offset,
-  IN  INT32                AddressLength,
-  OUT UINT8                *Buffer,
-  IN  INT32                Len
+  IN  NXP_I2C_MASTER       *I2c,
+  IN  I2C_REGS             *I2cRegs,
+  IN  UINT8                *Buffer,
+  IN  UINT32               Len
   )
 {
   EFI_STATUS               RetVal;
-  I2C_REGS                 *I2cRegs;
-  INT32                    I;
-
-  I2cRegs = (I2C_REGS *)BaseAddr;
+  UINT32                   I;
 
-  RetVal = InitDataTransfer (I2cRegs, Chip, Offset, AddressLength);
-  if (RetVal != EFI_SUCCESS) {
-    return RetVal;
-  }
-
-  // Write operation
   for (I = 0; I < Len; I++) {
-    RetVal = TransferByte (I2cRegs, Buffer[I]);
+    RetVal = TransferByte (I2c, I2cRegs, Buffer[I]);
     if (RetVal != EFI_SUCCESS) {
-      break;
+      return RetVal;
     }
   }
 
-  I2cStop (I2cRegs);
-  return RetVal;
+  return EFI_SUCCESS;
 }
 
 /**
@@ -496,6 +522,8 @@ SetBusFrequency (
 
   MemoryFence ();
 
+  SetPollBudget (I2c, GetBusFrequency () / mClkDiv[ClkId].SCLDivider);
+
   return EFI_SUCCESS;
 }
 
@@ -529,6 +557,23 @@ Reset (
   return EFI_SUCCESS;
 }
 
+/**
+  Function to run an I2C request packet as one combined transfer
+
+  The operations are separated by repeated starts, unless an operation has
+  I2C_FLAG_NORESTART set, and the transfer ends with a single STOP.
+
+  @param  This             Pointer to I2c master protocol
+  @param  SlaveAddress     Address of the slave device
+  @param  RequestPacket    Operations to perform
+  @param  Event            Event to signal on completion
+  @param  I2cStatus        Status of the transfer
+
+  @retval EFI_INVALID_PARAMETER  The request packet is not valid
+  @retval EFI_UNSUPPORTED        The request needs a direction change
+                                 without a repeated start
+  @return                        Status of the transfer
+**/
 STATIC
 EFI_STATUS
 EFIAPI
@@ -541,17 +586,15 @@ StartRequest (
   )
 {
   NXP_I2C_MASTER                   *I2c;
-  UINT32                           Count;
-  INT32                            RetVal;
-  UINT32                           Length;
-  UINT8                            *Buffer;
-  UINT32                           Flag;
-  UINT32                           RegAddress;
-  UINT32                           OffsetLength;
-
-  RegAddress = 0;
+  I2C_REGS                         *I2cRegs;
+  EFI_I2C_OPERATION                *Operation;
+  UINTN                            Count;
+  EFI_STATUS                       RetVal;
+  BOOLEAN                          Read;
+  BOOLEAN                          Last;
 
   I2c = NXP_I2C_FROM_THIS (This);
+  I2cRegs = (I2C_REGS *)(I2c->Dev->Resources[0].AddrRangeMin);
 
   if (RequestPacket->OperationCount <= 0) {
     DEBUG ((DEBUG_ERROR,"%a: Operation count is not valid %d\n",
@@ -559,43 +602,78 @@ StartRequest (
     return EFI_INVALID_PARAMETER;
   }
 
-  OffsetLength = RequestPacket->Operation[0].LengthInBytes;
-  RegAddress = *RequestPacket->Operation[0].Buffer;
-
-  for (Count = 1; Count < RequestPacket->OperationCount; Count++) {
-    Flag = RequestPacket->Operation[Count].Flags;
-    Length = RequestPacket->Operation[Count].LengthInBytes;
-    Buffer = RequestPacket->Operation[Count].Buffer;
+  for (Count = 0; Count < RequestPacket->OperationCount; Count++) {
+    Operation = &RequestPacket->Operation[Count];
+    Read = (Operation->Flags & I2C_FLAG_READ) != 0;
 
-    if (Length <= 0) {
+    if (Read && Operation->LengthInBytes == 0) {
       DEBUG ((DEBUG_ERROR,"%a: Invalid length of buffer %d\n",
-             __FUNCTION__, Length));
+             __FUNCTION__, Operation->LengthInBytes));
       return EFI_INVALID_PARAMETER;
     }
 
-    if (Flag == I2C_FLAG_READ) {
-      RetVal = I2cDataRead (I2c->Dev->Resources[0].AddrRangeMin, SlaveAddress,
-                            RegAddress, OffsetLength, Buffer, Length);
+    //
+    // Without a repeated start, an operation can only extend a write
+    //
+    if ((Operation->Flags & I2C_FLAG_NORESTART) &&
+        (Count == 0 || Read ||
+         (Operation[-1].Flags & I2C_FLAG_READ))) {
+      DEBUG ((DEBUG_ERROR,"%a: Invalid Flag %d\n", __FUNCTION__,
+             Operation->Flags));
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  RetVal = EFI_SUCCESS;
+  Read = FALSE;
+  for (Count = 0; Count < RequestPacket->OperationCount; Count++) {
+    Operation = &RequestPacket->Operation[Count];
+    Read = (Operation->Flags & I2C_FLAG_READ) != 0;
+    Last = (Count == RequestPacket->OperationCount - 1);
+
+    if (Count == 0) {
+      RetVal = InitDataTransfer (I2c, I2cRegs, SlaveAddress, Read);
       if (RetVal != EFI_SUCCESS) {
-        DEBUG ((DEBUG_ERROR,"%a: I2c read operation failed (error %d)\n",
-               __FUNCTION__, RetVal));
-        return RetVal;
+        break;
       }
-    } else if (Flag == I2C_FLAG_WRITE) {
-      RetVal = I2cDataWrite (I2c->Dev->Resources[0].AddrRangeMin, SlaveAddress,
-                             RegAddress, OffsetLength, Buffer, Length);
+    } else if (!(Operation->Flags & I2C_FLAG_NORESTART)) {
+      RetVal = RepeatedStart (I2c, I2cRegs, SlaveAddress, Read);
       if (RetVal != EFI_SUCCESS) {
-        DEBUG ((DEBUG_ERROR,"%a: I2c write operation failed (error %d)\n",
-               __FUNCTION__, RetVal));
-        return RetVal;
+        I2cStop (I2c, I2cRegs);
+        break;
       }
+    }
+
+    if (Read) {
+      RetVal = I2cDataRead (I2c, I2cRegs, Operation->Buffer,
+                            Operation->LengthInBytes, Last);
     } else {
-      DEBUG ((DEBUG_ERROR,"%a: Invalid Flag %d\n", __FUNCTION__, Flag));
-      return EFI_INVALID_PARAMETER;
+      RetVal = I2cDataWrite (I2c, I2cRegs, Operation->Buffer,
+                             Operation->LengthInBytes);
+      if (RetVal == EFI_SUCCESS && Last) {
+        RetVal = I2cStop (I2c, I2cRegs);
+      }
+    }
+
+    if (RetVal != EFI_SUCCESS) {
+      I2cStop (I2c, I2cRegs);
+      break;
     }
   }
 
-  return EFI_SUCCESS;
+  if (RetVal != EFI_SUCCESS) {
+    DEBUG ((DEBUG_ERROR,"%a: I2c %a operation failed (error %r)\n",
+           __FUNCTION__, Read ? "read" : "write", RetVal));
+  }
+
+  if (I2cStatus != NULL) {
+    *I2cStatus = RetVal;
+  }
+  if (Event != NULL) {
+    gBS->SignalEvent (Event);
+  }
+
+  return RetVal;
 }
 
 EFI_STATUS
@@ -625,6 +703,8 @@ NxpI2cInit (
   I2c->I2cMaster.I2cControllerCapabilities  = &mI2cControllerCapabilities;
   I2c->Dev                                  = Dev;
 
+  SetPollBudget (I2c, PcdGet32 (PcdI2cSpeed));
+
   CopyGuid (&I2c->DevicePath.Vendor.Guid, &gEfiCallerIdGuid);
   I2c->DevicePath.MmioBase = I2c->Dev->Resources[0].AddrRangeMin;
   SetDevicePathNodeLength (&I2c->DevicePath.Vendor,
@@ -38,7 +38,14 @@
 
 #define I2C_FLAG_WRITE            0x0
 
-#define I2C_STATE_RETRIES         50000
+//
+// Status polling budget, expressed in bus byte times (9 SCL cycles) so that
+// the timeout scales with the bus frequency. Status is polled twice per SCL
+// cycle.
+//
+#define I2C_POLL_BYTE_BUDGET      64
+#define I2C_POLLS_PER_BIT         2
+#define I2C_DEFAULT_BUS_CLOCK     100000
 
 #define RETRY_COUNT               3
 
@@ -61,6 +68,8 @@ typedef struct {
   EFI_I2C_MASTER_PROTOCOL         I2cMaster;
   NXP_I2C_DEVICE_PATH             DevicePath;
   NON_DISCOVERABLE_DEVICE         *Dev;
+  UINTN                           PollDelay;      // us between status polls
+  UINTN                           PollRetries;    // polls before timing out
 } NXP_I2C_MASTER;
 
 /**
@@ -116,10 +116,6 @@ DriverStart (
   SIMPLE_NETWORK_DEVICE_PATH       *DevicePath;
   UINT64                           DefaultMacAddress;
   EFI_MAC_ADDRESS                  *SwapMacAddressPtr;
-  UINTN                            DescriptorSize;
-  UINTN                            BufferSize;
-  UINTN                            *RxBufferAddr;
-  EFI_PHYSICAL_ADDRESS             RxBufferAddrMap;
 
   // Allocate Resources
   Snp = AllocatePages (EFI_SIZE_TO_PAGES (sizeof (SIMPLE_NETWORK_DRIVER)));
@@ -134,51 +130,10 @@ DriverStart (
                               Controller,
                               EFI_OPEN_PROTOCOL_BY_DRIVER);
 
-  // Size for descriptor
-  DescriptorSize = EFI_PAGES_TO_SIZE (sizeof (DESIGNWARE_HW_DESCRIPTOR));
-  // Size for transmit and receive buffer
-  BufferSize = ETH_BUFSIZE;
-
-  for (int Index=0; Index < DESC_NUM; Index++) {
-    //DMA TxdescRing allocate buffer and map
-    Status = DmaAllocateBuffer (EfiBootServicesData,
-               EFI_SIZE_TO_PAGES (sizeof (DESIGNWARE_HW_DESCRIPTOR)), (VOID *)&Snp->MacDriver.TxdescRing[Index]);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a () for TxdescRing: %r\n", __FUNCTION__, Status));
-      return Status;
-    }
-
-    Status = DmaMap (MapOperationBusMasterCommonBuffer, Snp->MacDriver.TxdescRing[Index],
-               &DescriptorSize, &Snp->MacDriver.TxdescRingMap[Index].AddrMap, &Snp->MacDriver.TxdescRingMap[Index].Mapping);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a () for TxdescRing: %r\n", __FUNCTION__, Status));
-      return Status;
-    }
-
-    // DMA RxdescRing allocte buffer and map
-    Status = DmaAllocateBuffer (EfiBootServicesData,
-               EFI_SIZE_TO_PAGES (sizeof (DESIGNWARE_HW_DESCRIPTOR)), (VOID *)&Snp->MacDriver.RxdescRing[Index]);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a () for RxdescRing: %r\n", __FUNCTION__, Status));
-      return Status;
-    }
-
-    Status = DmaMap (MapOperationBusMasterCommonBuffer, Snp->MacDriver.RxdescRing[Index],
-               &DescriptorSize, &Snp->MacDriver.RxdescRingMap[Index].AddrMap, &Snp->MacDriver.RxdescRingMap[Index].Mapping);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a () for RxdescRing: %r\n", __FUNCTION__, Status));
-      return Status;
-    }
-
-    //DMA mapping for receive buffer
-    RxBufferAddr = (VOID *)Snp->MacDriver.RxBuffer + (Index * BufferSize);
-    Status = DmaMap (MapOperationBusMasterWrite,  (VOID *) RxBufferAddr,
-               &BufferSize, &RxBufferAddrMap, &Snp->MacDriver.RxBufNum[Index].Mapping);
-    if (EFI_ERROR (Status)) {
-      DEBUG ((DEBUG_ERROR, "%a () for Rxbuffer: %r\n", __FUNCTION__, Status));
-      return Status;
-    }
-    Snp->MacDriver.RxBufNum[Index].AddrMap= RxBufferAddrMap;
+  // Descriptor rings and frame buffers, mapped once for the device lifetime
+  Status = EmacAllocateDmaBuffers (&Snp->MacDriver);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   DevicePath = (SIMPLE_NETWORK_DEVICE_PATH*)AllocateCopyPool (sizeof (SIMPLE_NETWORK_DEVICE_PATH), &PathTemplate);
@@ -215,12 +170,7 @@ DriverStart (
   Snp->Snp.Transmit = SnpTransmit;
   Snp->Snp.Receive = SnpReceive;
 
-  Snp->RecycledTxBuf = AllocatePool (sizeof (UINT64) * SNP_TX_BUFFER_INCREASE);
-  if (Snp->RecycledTxBuf == NULL) {
-    Status = EFI_OUT_OF_RESOURCES;
-  }
-
-  Snp->MaxRecycledTxBuf = SNP_TX_BUFFER_INCREASE;
+  Snp->RecycledTxBufHead = 0;
   Snp->RecycledTxBufCount = 0;
 
   // Start completing simple network mode structure
@@ -252,8 +202,8 @@ DriverStart (
   // Mac address is changeable as it is loaded from erasable memory
   SnpMode->MacAddressChangeable = TRUE;
 
-  // Can only transmit one packet at a time
-  SnpMode->MultipleTxSupported = FALSE;
+  // Frames are queued on the transmit descriptor ring
+  SnpMode->MultipleTxSupported = TRUE;
 
   // MediaPresent checks for cable connection and partner link
   SnpMode->MediaPresentSupported = TRUE;
@@ -290,6 +240,7 @@ DriverStart (
                         This->DriverBindingHandle,
                         Controller);
 
+    EmacFreeDmaBuffers (&Snp->MacDriver);
     FreePages (Snp, EFI_SIZE_TO_PAGES (sizeof (SIMPLE_NETWORK_DRIVER)));
   } else {
     Snp->ControllerHandle = Controller;
@@ -334,7 +285,7 @@ DriverStop (
     return Status;
   }
 
-  FreePool (Snp->RecycledTxBuf);
+  EmacFreeDmaBuffers (&Snp->MacDriver);
   FreePages (Snp, EFI_SIZE_TO_PAGES (sizeof (SIMPLE_NETWORK_DRIVER)));
 
   return Status;
@@ -16,6 +16,7 @@
 #include "EmacDxeUtil.h"
 #include "PhyDxeUtil.h"
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/NetLib.h>
@@ -195,6 +196,10 @@ SnpInitialize (
     return EFI_DEVICE_ERROR;
   }
 
+  // The descriptor rings start over, and so does the recycled buffer ring
+  Snp->RecycledTxBufHead = 0;
+  Snp->RecycledTxBufCount = 0;
+
   // Set MAC Address
   EmacSetMacAddress (&Snp->SnpMode.CurrentAddress, Snp->MacBase);
   EmacReadMacAddress (&Snp->SnpMode.CurrentAddress, Snp->MacBase);
@@ -841,8 +846,9 @@ SnpGetStatus (
     if (Snp->RecycledTxBufCount == 0) {
       *TxBuff = NULL;
     } else {
+      *TxBuff = (VOID *)(UINTN) Snp->RecycledTxBuf[Snp->RecycledTxBufHead];
+      Snp->RecycledTxBufHead = (Snp->RecycledTxBufHead + 1) % SNP_TX_RECYCLED_NUM;
       Snp->RecycledTxBufCount--;
-      *TxBuff = (VOID *)(UINTN) Snp->RecycledTxBuf[Snp->RecycledTxBufCount];
     }
   }
 
@@ -923,40 +929,21 @@ SnpTransmit (
   SIMPLE_NETWORK_DRIVER      *Snp;
   UINT32                     DescNum;
   DESIGNWARE_HW_DESCRIPTOR   *TxDescriptor;
-  DESIGNWARE_HW_DESCRIPTOR   *TxDescriptorMap;
   UINT8                      *EthernetPacket;
-  UINT64                     *Tmp;
-  EFI_STATUS                 Status;
-  UINTN                      BufferSizeBuf;
-  EFI_PHYSICAL_ADDRESS       TxBufferAddrMap;
 
-  BufferSizeBuf = ETH_BUFSIZE;
   EthernetPacket = Data;
 
-  Snp = INSTANCE_FROM_SNP_THIS (This);
-
-  if (EFI_ERROR (EfiAcquireLockOrFail (&Snp->Lock))) {
-    return EFI_ACCESS_DENIED;
-  }
-
-  if ((Snp->MaxRecycledTxBuf + SNP_TX_BUFFER_INCREASE) >= SNP_MAX_TX_BUFFER_NUM) {
-    return EFI_NOT_READY;
-  }
-
   // Check preliminaries
   if ((This == NULL) || (Data == NULL)) {
     return EFI_INVALID_PARAMETER;
   }
+
+  Snp = INSTANCE_FROM_SNP_THIS (This);
+
   if (Snp->SnpMode.State != EfiSimpleNetworkInitialized) {
     return EFI_NOT_STARTED;
   }
 
-  Snp->MacDriver.TxCurrentDescriptorNum = Snp->MacDriver.TxNextDescriptorNum;
-  DescNum = Snp->MacDriver.TxCurrentDescriptorNum;
-
-  TxDescriptor = Snp->MacDriver.TxdescRing[DescNum];
-  TxDescriptorMap = (VOID *)(UINTN)Snp->MacDriver.TxdescRingMap[DescNum].AddrMap;
-
   // Ensure header is correct size if non-zero
   if (HdrSize) {
     if (HdrSize != Snp->SnpMode.MediaHeaderSize) {
@@ -972,6 +959,25 @@ SnpTransmit (
   if (BuffSize < Snp->SnpMode.MediaHeaderSize) {
     return EFI_BUFFER_TOO_SMALL;
   }
+  if (BuffSize > ETH_BUFSIZE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EFI_ERROR (EfiAcquireLockOrFail (&Snp->Lock))) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  Snp->MacDriver.TxCurrentDescriptorNum = Snp->MacDriver.TxNextDescriptorNum;
+  DescNum = Snp->MacDriver.TxCurrentDescriptorNum;
+  TxDescriptor = Snp->MacDriver.TxdescRing[DescNum];
+
+  // The ring is full until the DMA has sent the frame in the next descriptor,
+  // or until the caller has collected the recycled buffers with GetStatus ()
+  if (((TxDescriptor->Tdes0 & TDES0_OWN) != 0) ||
+      (Snp->RecycledTxBufCount >= SNP_TX_RECYCLED_NUM)) {
+    EfiReleaseLock (&Snp->Lock);
+    return EFI_NOT_READY;
+  }
 
   if (HdrSize) {
     EthernetPacket[0] = DstAddr->Addr[0];
@@ -992,22 +998,19 @@ SnpTransmit (
     EthernetPacket[12] = (*Protocol & 0xFF00) >> 8;
   }
 
-  CopyMem ((VOID *)(UINTN)TxDescriptor->Addr, EthernetPacket, BuffSize);
-
-  Status = DmaMap (MapOperationBusMasterRead, (VOID *)(UINTN)TxDescriptor->Addr,
-             &BufferSizeBuf, &TxBufferAddrMap, &Snp->MappingTxbuf);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "%a () for Txbuffer: %r\n", __FUNCTION__, Status));
-    return Status;
-  }
-  TxDescriptorMap->Addr = TxBufferAddrMap;
+  // The descriptor already points at its slice of the pre-mapped buffer
+  CopyMem (Snp->MacDriver.TxBuffer + (DescNum * ETH_BUFSIZE), EthernetPacket, BuffSize);
 
   TxDescriptor->Tdes1 = (BuffSize << TDES1_SIZE1SHFT) &
                          TDES1_SIZE1MASK;
 
-  TxDescriptor->Tdes0 |= (TDES0_TXFIRST |
-                          TDES0_TXLAST |
-                          TDES0_OWN);
+  // The frame must be visible to the DMA before it owns the descriptor
+  MemoryFence ();
+
+  TxDescriptor->Tdes0 = (TDES0_TXCHAIN |
+                         TDES0_TXFIRST |
+                         TDES0_TXLAST |
+                         TDES0_OWN);
 
   // Increase descriptor number
   DescNum++;
@@ -1018,24 +1021,14 @@ SnpTransmit (
 
   Snp->MacDriver.TxNextDescriptorNum = DescNum;
 
-  if (Snp->RecycledTxBufCount < Snp->MaxRecycledTxBuf) {
-    Snp->RecycledTxBuf[Snp->RecycledTxBufCount] = (UINT64)(UINTN)Data;
-    Snp->RecycledTxBufCount ++;
-  } else {
-    Tmp = AllocatePool (sizeof (UINT64) * (Snp->MaxRecycledTxBuf + SNP_TX_BUFFER_INCREASE));
-    if (Tmp == NULL) {
-      return EFI_DEVICE_ERROR;
-    }
-    CopyMem (Tmp, Snp->RecycledTxBuf, sizeof (UINT64) * Snp->RecycledTxBufCount);
-    FreePool (Snp->RecycledTxBuf);
-    Snp->RecycledTxBuf = Tmp;
-    Snp->MaxRecycledTxBuf += SNP_TX_BUFFER_INCREASE;
-  }
+  // The frame has been copied, so the caller's buffer can be recycled already
+  Snp->RecycledTxBuf[(Snp->RecycledTxBufHead + Snp->RecycledTxBufCount) % SNP_TX_RECYCLED_NUM] =
+    (UINT64)(UINTN)Data;
+  Snp->RecycledTxBufCount++;
 
   // Start the transmission
   EmacDmaStart (Snp->MacBase);
 
-  DmaUnmap (Snp->MappingTxbuf);
   EfiReleaseLock (&Snp->Lock);
   return EFI_SUCCESS;
 }
@@ -1109,14 +1102,9 @@ SnpReceive (
   UINT8                      *RawData;
   UINT32                     DescNum;
   DESIGNWARE_HW_DESCRIPTOR   *RxDescriptor;
-  DESIGNWARE_HW_DESCRIPTOR   *RxDescriptorMap;
-  UINTN                      BufferSizeBuf;
-  UINTN                      *RxBufferAddr;
-  EFI_PHYSICAL_ADDRESS       RxBufferAddrMap;
+  UINT8                      *RxBufferAddr;
   EFI_STATUS                 Status;
 
-  BufferSizeBuf = ETH_BUFSIZE;
-
   Snp = INSTANCE_FROM_SNP_THIS (This);
 
   // Check preliminaries
@@ -1135,24 +1123,27 @@ SnpReceive (
   Snp->MacDriver.RxCurrentDescriptorNum = Snp->MacDriver.RxNextDescriptorNum;
   DescNum = Snp->MacDriver.RxCurrentDescriptorNum;
   RxDescriptor = Snp->MacDriver.RxdescRing[DescNum];
-  RxBufferAddr = (VOID *)Snp->MacDriver.RxBuffer + (DescNum * BufferSizeBuf);
-  RxDescriptorMap = (VOID *)(UINTN)Snp->MacDriver.RxdescRingMap[DescNum].AddrMap;
+  RxBufferAddr = (UINT8 *)Snp->MacDriver.RxBuffer + (DescNum * ETH_BUFSIZE);
 
   RawData = (UINT8 *) Data;
 
   DescriptorStatus = RxDescriptor->Tdes0;
   if (DescriptorStatus & ((UINT32)RDES0_OWN)) {
+    Status = EFI_NOT_READY;
     goto ReleaseLock;
   }
 
+  // Erroneous frames are dropped, and their descriptor is handed back to the DMA
+  Status = EFI_DEVICE_ERROR;
+
   if (DescriptorStatus & RDES0_SAF) {
     DEBUG ((DEBUG_WARN, "SNP:DXE: Rx Descritpor Status Error: Source Address Filter Fail\n"));
-    return EFI_DEVICE_ERROR;
+    goto RecycleDescriptor;
   }
 
   if (DescriptorStatus & RDES0_AFM) {
     DEBUG ((DEBUG_WARN, "SNP:DXE: Rx Descritpor Status Error: Destination Address Filter Fail\n"));
-    return EFI_DEVICE_ERROR;
+    goto RecycleDescriptor;
   }
 
   if (DescriptorStatus & RDES0_ES) {
@@ -1186,28 +1177,28 @@ SnpReceive (
     if (DescriptorStatus & RDES0_CE) {
       DEBUG ((DEBUG_WARN, "SNP:DXE: Rx Descritpor Status Error: CRC Error\n"));
     }
-    return EFI_DEVICE_ERROR;
+    goto RecycleDescriptor;
   }
 
   Length = (DescriptorStatus >> RDES0_FL_SHIFT) & RDES0_FL_MASK;
   if (!Length) {
     DEBUG ((DEBUG_WARN, "SNP:DXE: Error: Invalid Frame Packet length \r\n"));
-    return EFI_NOT_READY;
+    Status = EFI_NOT_READY;
+    goto RecycleDescriptor;
   }
-  // Check buffer size
+  // Check buffer size, keeping the frame for a retry with a larger buffer
   if (*BuffSize < Length) {
     DEBUG ((DEBUG_WARN, "SNP:DXE: Error: Buffer size is too small\n"));
-    return EFI_BUFFER_TOO_SMALL;
+    *BuffSize = Length;
+    Status = EFI_BUFFER_TOO_SMALL;
+    goto ReleaseLock;
   }
   *BuffSize = Length;
 
   if (HdrSize != NULL)
     *HdrSize = Snp->SnpMode.MediaHeaderSize;
 
-  DmaUnmap (Snp->MacDriver.RxBufNum[DescNum].Mapping);
-  Snp->MacDriver.RxBufNum[DescNum].Mapping = NULL;
-
-  CopyMem (RawData, (VOID *)RxBufferAddr, *BuffSize);
+  CopyMem (RawData, RxBufferAddr, *BuffSize);
 
   if (DstAddr != NULL) {
     Dst.Addr[0] = RawData[0];
@@ -1237,16 +1228,10 @@ SnpReceive (
     *Protocol = NTOHS (RawData[12] | (RawData[13] >> 8) | (RawData[14] >> 16) | (RawData[15] >> 24));
   }
 
-  // DMA map for the current receive buffer
-  Status = DmaMap (MapOperationBusMasterWrite,  (VOID *)RxBufferAddr,
-             &BufferSizeBuf, &RxBufferAddrMap, &Snp->MacDriver.RxBufNum[DescNum].Mapping);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "%a () for Rxbuffer: %r\n", __FUNCTION__, Status));
-    return Status;
-  }
-  Snp->MacDriver.RxBufNum[DescNum].AddrMap = RxBufferAddrMap;
-  RxDescriptorMap->Addr = Snp->MacDriver.RxBufNum[DescNum].AddrMap;
+  Status = EFI_SUCCESS;
 
+RecycleDescriptor:
+  // The frame has been copied out, so the DMA can reuse the buffer
   RxDescriptor->Tdes0 |= (UINT32)RDES0_OWN;
 
   // Increase descriptor number
@@ -1257,11 +1242,8 @@ SnpReceive (
   }
   Snp->MacDriver.RxNextDescriptorNum = DescNum;
 
-  EfiReleaseLock (&Snp->Lock);
-  return EFI_SUCCESS;
-
 ReleaseLock:
   EfiReleaseLock (&Snp->Lock);
-  return EFI_NOT_READY;
+  return Status;
 }
 
@@ -27,6 +27,9 @@
 #include "PhyDxeUtil.h"
 #include "EmacDxeUtil.h"
 
+// Transmit buffers waiting to be returned by GetStatus ()
+#define SNP_TX_RECYCLED_NUM              CONFIG_TX_DESCR_NUM
+
 /*------------------------------------------------------------------------------
   Information Structure
 ------------------------------------------------------------------------------*/
@@ -57,18 +60,15 @@ typedef struct {
 
   UINTN                                  MacBase;
 
-  // Array of the recycled transmit buffer address
-  UINT64                                 *RecycledTxBuf;
+  // Ring of the recycled transmit buffer address
+  UINT64                                 RecycledTxBuf[SNP_TX_RECYCLED_NUM];
 
-  // The maximum number of recycled buffer pointers in RecycledTxBuf
-  UINT32                                 MaxRecycledTxBuf;
+  // Index of the oldest recycled buffer pointer in RecycledTxBuf
+  UINT32                                 RecycledTxBufHead;
 
   // Current number of recycled buffer pointers in RecycledTxBuf
   UINT32                                 RecycledTxBufCount;
 
-  // For TX buffer DmaUnmap
-  VOID                                   *MappingTxbuf;
-
 } SIMPLE_NETWORK_DRIVER;
 
 extern EFI_COMPONENT_NAME_PROTOCOL       gSnpComponentName;
@@ -76,9 +76,6 @@ extern EFI_COMPONENT_NAME2_PROTOCOL      gSnpComponentName2;
 
 #define SNP_DRIVER_SIGNATURE             SIGNATURE_32('A', 'S', 'N', 'P')
 #define INSTANCE_FROM_SNP_THIS(a)        CR(a, SIMPLE_NETWORK_DRIVER, Snp, SNP_DRIVER_SIGNATURE)
-#define SNP_TX_BUFFER_INCREASE           32
-#define SNP_MAX_TX_BUFFER_NUM            65536
-#define DESC_NUM                         10
 #define ETH_BUFSIZE                      0x800
 /*---------------------------------------------------------------------------------------------------------------------
 
@@ -18,6 +18,7 @@
 
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/DmaLib.h>
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
 
@@ -99,6 +100,151 @@ EmacDxeInitialization (
 }
 
 
+STATIC
+EFI_STATUS
+EmacAllocateCommonBuffer (
+  IN  UINTN         Size,
+  OUT VOID          **Buffer,
+  OUT MAP_INFO      *Map
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Pages;
+  UINTN       MapSize;
+
+  Pages = EFI_SIZE_TO_PAGES (Size);
+  Status = DmaAllocateBuffer (EfiBootServicesData, Pages, Buffer);
+  if (EFI_ERROR (Status)) {
+    *Buffer = NULL;
+    return Status;
+  }
+
+  MapSize = EFI_PAGES_TO_SIZE (Pages);
+  Status = DmaMap (MapOperationBusMasterCommonBuffer, *Buffer,
+             &MapSize, &Map->AddrMap, &Map->Mapping);
+  if (EFI_ERROR (Status)) {
+    DmaFreeBuffer (Pages, *Buffer);
+    *Buffer = NULL;
+    return Status;
+  }
+
+  ZeroMem (*Buffer, Size);
+  return EFI_SUCCESS;
+}
+
+
+STATIC
+VOID
+EmacFreeCommonBuffer (
+  IN  UINTN         Size,
+  IN  VOID          *Buffer,
+  IN  MAP_INFO      *Map
+  )
+{
+  if (Buffer != NULL) {
+    DmaUnmap (Map->Mapping);
+    DmaFreeBuffer (EFI_SIZE_TO_PAGES (Size), Buffer);
+  }
+}
+
+
+/**
+  Allocate the descriptor rings and the frame buffers as common buffers.
+
+  They are mapped once here and stay mapped until EmacFreeDmaBuffers (), so
+  the transmit and receive paths only copy frames in and out.
+
+  @param  EmacDriver             The EMAC driver instance.
+
+  @retval EFI_SUCCESS            The rings and the buffers are allocated.
+  @retval Others                 The allocation or the mapping failed.
+**/
+EFI_STATUS
+EFIAPI
+EmacAllocateDmaBuffers (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  EFI_STATUS                  Status;
+  UINTN                       Index;
+  DESIGNWARE_HW_DESCRIPTOR    *Ring;
+
+  EmacDriver->TxdescRing[0] = NULL;
+  EmacDriver->RxdescRing[0] = NULL;
+  EmacDriver->TxBuffer = NULL;
+  EmacDriver->RxBuffer = NULL;
+
+  Status = EmacAllocateCommonBuffer (sizeof (DESIGNWARE_HW_DESCRIPTOR) * CONFIG_TX_DESCR_NUM,
+             (VOID **)&Ring, &EmacDriver->TxdescRingMap[0]);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a () for TxdescRing: %r\n", __FUNCTION__, Status));
+    goto Error;
+  }
+  for (Index = 0; Index < CONFIG_TX_DESCR_NUM; Index++) {
+    EmacDriver->TxdescRing[Index] = &Ring[Index];
+    EmacDriver->TxdescRingMap[Index].AddrMap = EmacDriver->TxdescRingMap[0].AddrMap +
+                                               Index * sizeof (DESIGNWARE_HW_DESCRIPTOR);
+  }
+
+  Status = EmacAllocateCommonBuffer (sizeof (DESIGNWARE_HW_DESCRIPTOR) * CONFIG_RX_DESCR_NUM,
+             (VOID **)&Ring, &EmacDriver->RxdescRingMap[0]);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a () for RxdescRing: %r\n", __FUNCTION__, Status));
+    goto Error;
+  }
+  for (Index = 0; Index < CONFIG_RX_DESCR_NUM; Index++) {
+    EmacDriver->RxdescRing[Index] = &Ring[Index];
+    EmacDriver->RxdescRingMap[Index].AddrMap = EmacDriver->RxdescRingMap[0].AddrMap +
+                                               Index * sizeof (DESIGNWARE_HW_DESCRIPTOR);
+  }
+
+  Status = EmacAllocateCommonBuffer (TX_TOTAL_BUFSIZE,
+             (VOID **)&EmacDriver->TxBuffer, &EmacDriver->TxBufferMap);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a () for Txbuffer: %r\n", __FUNCTION__, Status));
+    goto Error;
+  }
+
+  Status = EmacAllocateCommonBuffer (RX_TOTAL_BUFSIZE,
+             (VOID **)&EmacDriver->RxBuffer, &EmacDriver->RxBufferMap);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a () for Rxbuffer: %r\n", __FUNCTION__, Status));
+    goto Error;
+  }
+
+  return EFI_SUCCESS;
+
+Error:
+  EmacFreeDmaBuffers (EmacDriver);
+  return Status;
+}
+
+
+/**
+  Unmap and free the buffers allocated by EmacAllocateDmaBuffers ().
+
+  @param  EmacDriver             The EMAC driver instance.
+**/
+VOID
+EFIAPI
+EmacFreeDmaBuffers (
+  IN  EMAC_DRIVER   *EmacDriver
+  )
+{
+  EmacFreeCommonBuffer (RX_TOTAL_BUFSIZE, EmacDriver->RxBuffer, &EmacDriver->RxBufferMap);
+  EmacFreeCommonBuffer (TX_TOTAL_BUFSIZE, EmacDriver->TxBuffer, &EmacDriver->TxBufferMap);
+  EmacFreeCommonBuffer (sizeof (DESIGNWARE_HW_DESCRIPTOR) * CONFIG_RX_DESCR_NUM,
+    EmacDriver->RxdescRing[0], &EmacDriver->RxdescRingMap[0]);
+  EmacFreeCommonBuffer (sizeof (DESIGNWARE_HW_DESCRIPTOR) * CONFIG_TX_DESCR_NUM,
+    EmacDriver->TxdescRing[0], &EmacDriver->TxdescRingMap[0]);
+
+  EmacDriver->TxdescRing[0] = NULL;
+  EmacDriver->RxdescRing[0] = NULL;
+  EmacDriver->TxBuffer = NULL;
+  EmacDriver->RxBuffer = NULL;
+}
+
+
 EFI_STATUS
 EFIAPI
 EmacDmaInit (
@@ -230,19 +376,16 @@ EmacSetupTxdesc (
   INTN                       Index;
   DESIGNWARE_HW_DESCRIPTOR   *TxDescriptor;
 
+  // Each descriptor owns a fixed slice of the pre-mapped transmit buffer,
+  // and the last descriptor chains back to the first one
   for (Index = 0; Index < CONFIG_TX_DESCR_NUM; Index++) {
-    TxDescriptor = (VOID *)(UINTN)EmacDriver->TxdescRingMap[Index].AddrMap;
-    TxDescriptor->Addr = (UINT32)(UINTN)&EmacDriver->TxBuffer[Index * CONFIG_ETH_BUFSIZE];
-    if (Index < 9) {
-      TxDescriptor->AddrNext = (UINT32)(UINTN)EmacDriver->TxdescRingMap[Index + 1].AddrMap;
-    }
+    TxDescriptor = EmacDriver->TxdescRing[Index];
+    TxDescriptor->Addr = (UINT32)(EmacDriver->TxBufferMap.AddrMap + Index * CONFIG_ETH_BUFSIZE);
+    TxDescriptor->AddrNext = (UINT32)EmacDriver->TxdescRingMap[(Index + 1) % CONFIG_TX_DESCR_NUM].AddrMap;
     TxDescriptor->Tdes0 = TDES0_TXCHAIN;
     TxDescriptor->Tdes1 = 0;
   }
 
-  // Correcting the last pointer of the chain
-  TxDescriptor->AddrNext = (UINT32)(UINTN)EmacDriver->TxdescRingMap[0].AddrMap;
-
   // Write the address of tx descriptor list
   MmioWrite32 (MacBaseAddress +
               DW_EMAC_DMAGRP_TRANSMIT_DESCRIPTOR_LIST_ADDRESS_OFST,
@@ -267,18 +410,13 @@ EmacSetupRxdesc (
   DESIGNWARE_HW_DESCRIPTOR    *RxDescriptor;
 
   for (Index = 0; Index < CONFIG_RX_DESCR_NUM; Index++) {
-    RxDescriptor = (VOID *)(UINTN)EmacDriver->RxdescRingMap[Index].AddrMap;
-    RxDescriptor->Addr = EmacDriver->RxBufNum[Index].AddrMap;
-    if (Index < 9) {
-      RxDescriptor->AddrNext = (UINT32)(UINTN)EmacDriver->RxdescRingMap[Index + 1].AddrMap;
-    }
+    RxDescriptor = EmacDriver->RxdescRing[Index];
+    RxDescriptor->Addr = (UINT32)(EmacDriver->RxBufferMap.AddrMap + Index * CONFIG_ETH_BUFSIZE);
+    RxDescriptor->AddrNext = (UINT32)EmacDriver->RxdescRingMap[(Index + 1) % CONFIG_RX_DESCR_NUM].AddrMap;
     RxDescriptor->Tdes0 = RDES0_OWN;
     RxDescriptor->Tdes1 = RDES1_CHAINED | RX_MAX_PACKET;
   }
 
-  // Correcting the last pointer of the chain
-  RxDescriptor->AddrNext = (UINT32)(UINTN)EmacDriver->RxdescRingMap[0].AddrMap;
-
   // Write the address of tx descriptor list
   MmioWrite32(MacBaseAddress +
               DW_EMAC_DMAGRP_RECEIVE_DESCRIPTOR_LIST_ADDRESS_OFST,
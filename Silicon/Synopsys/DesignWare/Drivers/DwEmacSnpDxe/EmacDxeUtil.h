@@ -19,14 +19,16 @@
 
 #include <Protocol/SimpleNetwork.h>
 
+#include <Library/PcdLib.h>
+
 // Most common CRC32 Polynomial for little endian machines
 #define CRC_POLYNOMIAL                                            0xEDB88320
 #define HASH_TABLE_REG(n)                                         0x500 + (0x4 * n)
 #define RX_MAX_PACKET                                             1600
 
 #define CONFIG_ETH_BUFSIZE                                         2048
-#define CONFIG_TX_DESCR_NUM                                        10
-#define CONFIG_RX_DESCR_NUM                                        10
+#define CONFIG_TX_DESCR_NUM                                        FixedPcdGet32 (PcdDwEmacTxDescriptorCount)
+#define CONFIG_RX_DESCR_NUM                                        FixedPcdGet32 (PcdDwEmacRxDescriptorCount)
 #define TX_TOTAL_BUFSIZE                                           (CONFIG_ETH_BUFSIZE * CONFIG_TX_DESCR_NUM)
 #define RX_TOTAL_BUFSIZE                                           (CONFIG_ETH_BUFSIZE * CONFIG_RX_DESCR_NUM)
 
@@ -241,14 +243,20 @@ typedef struct {
   void                        *Mapping;
 } MAP_INFO;
 
+//
+// The descriptor rings and the frame buffers are each allocated as one
+// common buffer, mapped once for the lifetime of the driver instance.
+// TxdescRingMap[0]/RxdescRingMap[0] hold the mappings of the rings.
+//
 typedef struct {
   DESIGNWARE_HW_DESCRIPTOR    *TxdescRing[CONFIG_TX_DESCR_NUM];
   DESIGNWARE_HW_DESCRIPTOR    *RxdescRing[CONFIG_RX_DESCR_NUM];
-  CHAR8                       TxBuffer[TX_TOTAL_BUFSIZE];
-  CHAR8                       RxBuffer[RX_TOTAL_BUFSIZE];
-  MAP_INFO                    TxdescRingMap[CONFIG_TX_DESCR_NUM ];
-  MAP_INFO                    RxdescRingMap[CONFIG_RX_DESCR_NUM ];
-  MAP_INFO                    RxBufNum[CONFIG_TX_DESCR_NUM];
+  CHAR8                       *TxBuffer;
+  CHAR8                       *RxBuffer;
+  MAP_INFO                    TxdescRingMap[CONFIG_TX_DESCR_NUM];
+  MAP_INFO                    RxdescRingMap[CONFIG_RX_DESCR_NUM];
+  MAP_INFO                    TxBufferMap;
+  MAP_INFO                    RxBufferMap;
   UINT32                      TxCurrentDescriptorNum;
   UINT32                      TxNextDescriptorNum;
   UINT32                      RxCurrentDescriptorNum;
@@ -276,6 +284,18 @@ EmacDxeInitialization (
   IN  UINTN                   MacBaseAddress
   );
 
+EFI_STATUS
+EFIAPI
+EmacAllocateDmaBuffers (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
+VOID
+EFIAPI
+EmacFreeDmaBuffers (
+  IN  EMAC_DRIVER             *EmacDriver
+  );
+
 EFI_STATUS
 EFIAPI
 EmacDmaInit (